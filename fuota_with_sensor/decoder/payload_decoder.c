@@ -0,0 +1,133 @@
+/*
+ * Host decoder for sensor uplinks
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "batch.h"
+#include "payload_decoder.h"
+#include "tscodec.h"
+
+struct field_info {
+    const char *name;
+    const char *unit;
+    double scale;
+};
+
+#define FIELD_INFO(name, bits, lo, hi, scale, unit) {#name, unit, scale},
+
+static const struct field_info full_info[] = {PAYLOAD_FULL_FIELDS(FIELD_INFO)};
+static const struct field_info compact_info[] = {PAYLOAD_COMPACT_FIELDS(FIELD_INFO)};
+
+static const struct field_info *info_of(const struct payload_schema *schema, int field)
+{
+    const struct field_info *info = NULL;
+
+    if (schema == &payload_schema_full) {
+        info = full_info;
+    } else if (schema == &payload_schema_compact) {
+        info = compact_info;
+    }
+    return (info != NULL && field >= 0 && field < schema->nfields) ? &info[field] : NULL;
+}
+
+const char *payload_field_name(const struct payload_schema *schema, int field)
+{
+    const struct field_info *info = info_of(schema, field);
+
+    return (info != NULL) ? info->name : NULL;
+}
+
+const char *payload_field_unit(const struct payload_schema *schema, int field)
+{
+    const struct field_info *info = info_of(schema, field);
+
+    return (info != NULL) ? info->unit : NULL;
+}
+
+double payload_field_scale(const struct payload_schema *schema, int field)
+{
+    const struct field_info *info = info_of(schema, field);
+
+    return (info != NULL) ? info->scale : 0.0;
+}
+
+double payload_value(const struct payload_record *rec, int field)
+{
+    return payload_expand(rec->schema, field, (uint32_t)rec->values[field]) *
+           payload_field_scale(rec->schema, field);
+}
+
+static int decode_raw(const uint8_t *frame, size_t len, struct payload_record *out,
+                      size_t max_records)
+{
+    size_t size = frame[0];
+    size_t count;
+
+    if (size == 0 || (len - BATCH_HDR_SIZE) % size != 0) {
+        return -EINVAL;
+    }
+
+    count = (len - BATCH_HDR_SIZE) / size;
+    if (count > max_records) {
+        return -ENOSPC;
+    }
+
+    for (size_t r = 0; r < count; r++) {
+        const uint8_t *rec = &frame[BATCH_HDR_SIZE + r * size];
+        const struct payload_schema *schema = payload_schema_find(rec[0]);
+
+        if (schema == NULL || payload_unpack(schema, rec, size, out[r].values) < 0) {
+            return -EINVAL;
+        }
+        out[r].schema = schema;
+    }
+    return (int)count;
+}
+
+static int decode_compressed(const uint8_t *frame, size_t len, struct payload_record *out,
+                             size_t max_records)
+{
+    /* Every value takes at least one byte of the stream */
+    int32_t values[BATCH_FRAME_MAX];
+    uint8_t ch;
+    int count = tscodec_decode(&frame[BATCH_HDR_SIZE], len - BATCH_HDR_SIZE, values,
+                               sizeof(values) / sizeof(values[0]), &ch);
+
+    if (count < 0) {
+        return count;
+    }
+    if ((size_t)count > max_records) {
+        return -ENOSPC;
+    }
+
+    for (int r = 0; r < count; r++) {
+        const int32_t *v = &values[r * ch];
+        const struct payload_schema *schema =
+            (v[0] >= 0 && v[0] <= UINT8_MAX) ? payload_schema_find((uint8_t)v[0]) : NULL;
+
+        if (schema == NULL || schema->nfields + 1 != ch ||
+            schema->size != (frame[0] & ~BATCH_HDR_CODEC)) {
+            return -EINVAL;
+        }
+        out[r].schema = schema;
+        memcpy(out[r].values, &v[1], schema->nfields * sizeof(int32_t));
+    }
+    return count;
+}
+
+int payload_decode_frame(const uint8_t *frame, size_t len, struct payload_record *out,
+                         size_t max_records)
+{
+    if (len <= BATCH_HDR_SIZE) {
+        return -EINVAL;
+    }
+
+    if (frame[0] & BATCH_HDR_CODEC) {
+        return decode_compressed(frame, len, out, max_records);
+    }
+    return decode_raw(frame, len, out, max_records);
+}
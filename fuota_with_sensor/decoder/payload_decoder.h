@@ -0,0 +1,45 @@
+/*
+ * Host decoder for sensor uplinks
+ *
+ * Decodes FPort 2 frames, raw or compressed (see batch.h), into records of
+ * the schemas in payload_schema.h. Builds from the firmware sources, so a
+ * layout change reaches the decoder with the next build. Records without an
+ * id byte predate the schema and are not supported.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef PAYLOAD_DECODER_H_
+#define PAYLOAD_DECODER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "payload.h"
+
+struct payload_record {
+    const struct payload_schema *schema;
+    int32_t values[PAYLOAD_MAX_FIELDS];   /* Wire units */
+};
+
+/**
+ * Decode one sensor frame into out[max_records]
+ * Returns the number of records, -EINVAL on a malformed frame or an unknown
+ * record, -ENOSPC if out is too small
+ */
+int payload_decode_frame(const uint8_t *frame, size_t len, struct payload_record *out,
+                         size_t max_records);
+
+/**
+ * Field metadata from the schema, NULL/0 for a bad index
+ */
+const char *payload_field_name(const struct payload_schema *schema, int field);
+const char *payload_field_unit(const struct payload_schema *schema, int field);
+double payload_field_scale(const struct payload_schema *schema, int field);
+
+/**
+ * Physical value of one field of a record: offset, step and scale applied
+ */
+double payload_value(const struct payload_record *rec, int field);
+
+#endif /* PAYLOAD_DECODER_H_ */
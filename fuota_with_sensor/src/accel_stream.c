@@ -0,0 +1,216 @@
+/*
+ * ADXL345 FIFO streaming acquisition
+ *
+ * The ADXL345 FIFO runs in stream mode with a watermark interrupt. Each
+ * watermark produces one RTIO completion that carries the whole FIFO burst,
+ * read in a single I2C transaction by the driver. The burst is decoded here
+ * and pushed into a ring buffer for downstream analysis.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/device.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/drivers/sensor.h>
+#include <zephyr/drivers/sensor_data_types.h>
+#include <zephyr/rtio/rtio.h>
+#include <zephyr/sys/ring_buffer.h>
+
+#include "accel_stream.h"
+
+LOG_MODULE_REGISTER(accel_stream, CONFIG_LORAWAN_SERVICES_LOG_LEVEL);
+
+#define ACCEL_NODE DT_COMPAT_GET_ANY_STATUS_OKAY(adi_adxl345)
+
+/* Max FIFO depth of the ADXL345 */
+#define ACCEL_FIFO_FRAMES 32
+
+/* Frames decoded per decoder call */
+#define ACCEL_DECODE_BATCH 8
+
+#define ACCEL_STREAM_STACK_SIZE 1024
+#define ACCEL_STREAM_PRIORITY   5
+
+/* Wait between attempts to arm the stream */
+#define ACCEL_STREAM_REARM_MS 1000
+
+/* 1000 / 9.80665 scaled by 1000: m/s^2 -> mg */
+#define MG_PER_MS2_X1000 101972
+
+static const struct device *const accel_dev = DEVICE_DT_GET(ACCEL_NODE);
+
+SENSOR_DT_STREAM_IODEV(accel_stream_iodev, ACCEL_NODE,
+        {SENSOR_TRIG_FIFO_WATERMARK, SENSOR_STREAM_DATA_INCLUDE},
+        {SENSOR_TRIG_FIFO_FULL, SENSOR_STREAM_DATA_INCLUDE});
+
+/* Two burst buffers so the driver can fill one while we decode the other */
+RTIO_DEFINE_WITH_MEMPOOL(accel_stream_ctx, 2, 2, 2, 256, sizeof(void *));
+
+RING_BUF_DECLARE(accel_ring, ACCEL_STREAM_RING_FRAMES * sizeof(struct accel_frame));
+
+static struct accel_stream_stats stats;
+
+/* Decoder output for one batch of frames */
+static union {
+    struct sensor_three_axis_data data;
+    uint8_t raw[sizeof(struct sensor_three_axis_data) +
+                (ACCEL_DECODE_BATCH - 1) * sizeof(struct sensor_three_axis_sample_data)];
+} decoded;
+
+/**
+ * Convert a Q31 m/s^2 value with the given shift to milli-g, saturating to int16
+ */
+static int16_t q31_to_mg(q31_t value, int8_t shift)
+{
+    int64_t mg = (int64_t)value * MG_PER_MS2_X1000;
+
+    if (shift > 31) {
+        mg <<= (shift - 31);
+    } else {
+        mg >>= (31 - shift);
+    }
+    mg /= 1000;
+
+    return (int16_t)CLAMP(mg, INT16_MIN, INT16_MAX);
+}
+
+/**
+ * Decode a FIFO burst and push the frames to the ring buffer
+ */
+static void accel_stream_process(const struct sensor_decoder_api *decoder,
+                                 const uint8_t *buf)
+{
+    const struct sensor_chan_spec spec = {SENSOR_CHAN_ACCEL_XYZ, 0};
+    uint16_t frame_count = 0;
+    uint32_t fit = 0;
+
+    if (decoder->get_frame_count(buf, spec, &frame_count) != 0 || frame_count == 0) {
+        return;
+    }
+
+    while (fit < frame_count) {
+        int n = decoder->decode(buf, spec, &fit, ACCEL_DECODE_BATCH, &decoded.data);
+
+        if (n <= 0) {
+            break;
+        }
+
+        for (int i = 0; i < n; i++) {
+            const struct sensor_three_axis_sample_data *s = &decoded.data.readings[i];
+            struct accel_frame frame = {
+                .x = q31_to_mg(s->x, decoded.data.shift),
+                .y = q31_to_mg(s->y, decoded.data.shift),
+                .z = q31_to_mg(s->z, decoded.data.shift),
+            };
+
+            if (ring_buf_space_get(&accel_ring) < sizeof(frame)) {
+                stats.dropped++;
+                continue;
+            }
+            ring_buf_put(&accel_ring, (const uint8_t *)&frame, sizeof(frame));
+            stats.frames++;
+        }
+    }
+
+    stats.bursts++;
+    stats.last_burst = frame_count;
+}
+
+/**
+ * Submit the multishot stream, retrying until the driver takes it: a stream
+ * that is not armed stops vibration capture for good
+ */
+static void arm_stream(struct rtio_sqe **handle)
+{
+    int rc;
+
+    while ((rc = sensor_stream(&accel_stream_iodev, &accel_stream_ctx, NULL, handle)) != 0) {
+        stats.arm_failed++;
+        LOG_ERR("ADXL345: sensor_stream() failed: %d, retrying", rc);
+        k_msleep(ACCEL_STREAM_REARM_MS);
+    }
+}
+
+static void accel_stream_thread(void *p1, void *p2, void *p3)
+{
+    ARG_UNUSED(p1);
+    ARG_UNUSED(p2);
+    ARG_UNUSED(p3);
+
+    const struct sensor_decoder_api *decoder;
+    struct rtio_sqe *handle;
+    int rc;
+
+    rc = sensor_get_decoder(accel_dev, &decoder);
+    if (rc != 0) {
+        LOG_ERR("ADXL345: sensor_get_decoder() failed: %d", rc);
+        return;
+    }
+
+    arm_stream(&handle);
+
+    while (1) {
+        /* Sleeps until the FIFO watermark completion arrives */
+        struct rtio_cqe *cqe = rtio_cqe_consume_block(&accel_stream_ctx);
+        uint8_t *buf = NULL;
+        uint32_t buf_len = 0;
+
+        rc = cqe->result;
+        if (rc == 0) {
+            rc = rtio_cqe_get_mempool_buffer(&accel_stream_ctx, cqe, &buf, &buf_len);
+        }
+        rtio_cqe_release(&accel_stream_ctx, cqe);
+
+        if (rc != 0) {
+            stats.errors++;
+            LOG_ERR("ADXL345: stream completion failed: %d", rc);
+            /* Multishot stream is cancelled on error, re-arm it */
+            rtio_sqe_cancel(handle);
+            arm_stream(&handle);
+            continue;
+        }
+
+        accel_stream_process(decoder, buf);
+        rtio_release_buffer(&accel_stream_ctx, buf, buf_len);
+    }
+}
+
+K_THREAD_DEFINE(accel_stream_tid, ACCEL_STREAM_STACK_SIZE, accel_stream_thread,
+                NULL, NULL, NULL, ACCEL_STREAM_PRIORITY, 0, SYS_FOREVER_MS);
+
+BUILD_ASSERT(ACCEL_STREAM_WATERMARK <= ACCEL_FIFO_FRAMES,
+             "watermark exceeds the ADXL345 FIFO depth");
+BUILD_ASSERT(ACCEL_STREAM_RING_FRAMES >= 2 * ACCEL_FIFO_FRAMES,
+             "ring must hold at least two full FIFO bursts");
+
+int accel_stream_start(void)
+{
+    if (!device_is_ready(accel_dev)) {
+        LOG_ERR("ADXL345: Device '%s' is not ready.", accel_dev->name);
+        return -ENODEV;
+    }
+
+    k_thread_start(accel_stream_tid);
+    LOG_INF("ADXL345: streaming at %d Hz, watermark %d frames",
+            ACCEL_STREAM_ODR_HZ, ACCEL_STREAM_WATERMARK);
+    return 0;
+}
+
+size_t accel_stream_read(struct accel_frame *frames, size_t max_frames)
+{
+    uint32_t len = ring_buf_get(&accel_ring, (uint8_t *)frames,
+                                max_frames * sizeof(struct accel_frame));
+
+    return len / sizeof(struct accel_frame);
+}
+
+size_t accel_stream_available(void)
+{
+    return ring_buf_size_get(&accel_ring) / sizeof(struct accel_frame);
+}
+
+void accel_stream_get_stats(struct accel_stream_stats *out)
+{
+    *out = stats;
+}
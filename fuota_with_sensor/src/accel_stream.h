@@ -0,0 +1,65 @@
+/*
+ * ADXL345 FIFO streaming acquisition
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef ACCEL_STREAM_H_
+#define ACCEL_STREAM_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Output data rate programmed into the ADXL345 (see the board overlay) */
+#define ACCEL_STREAM_ODR_HZ 100
+
+/* FIFO watermark in frames, one RTIO completion per watermark */
+#define ACCEL_STREAM_WATERMARK 16
+
+/* Longest the consumer may leave the ring undrained */
+#define ACCEL_STREAM_DRAIN_MAX_MS 1000
+
+/* Ring buffer capacity in frames: the drain period plus two full 32-frame bursts */
+#define ACCEL_STREAM_RING_FRAMES (ACCEL_STREAM_ODR_HZ * ACCEL_STREAM_DRAIN_MAX_MS / 1000 + 64)
+
+/**
+ * One decoded accelerometer sample, in milli-g per axis.
+ * The ADXL345 resolution is ~3.9 mg/LSB so no precision is lost.
+ */
+struct accel_frame {
+    int16_t x;
+    int16_t y;
+    int16_t z;
+};
+
+struct accel_stream_stats {
+    uint32_t bursts;      /* FIFO watermark completions */
+    uint32_t frames;      /* Frames decoded into the ring */
+    uint32_t dropped;     /* Frames lost because the ring was full */
+    uint32_t errors;      /* Failed completions (stream re-armed) */
+    uint32_t arm_failed;  /* sensor_stream() attempts refused by the driver */
+    uint16_t last_burst;  /* Frames in the most recent burst */
+};
+
+/**
+ * Start streaming from the ADXL345 FIFO.
+ * Decoded frames are pushed to the ring buffer by a dedicated thread that only
+ * wakes up when the FIFO watermark completion arrives.
+ * Returns 0 on success, error code on failure
+ */
+int accel_stream_start(void);
+
+/**
+ * Copy up to max_frames decoded frames out of the ring buffer.
+ * Single consumer only. Returns the number of frames copied.
+ */
+size_t accel_stream_read(struct accel_frame *frames, size_t max_frames);
+
+/**
+ * Number of frames currently waiting in the ring buffer
+ */
+size_t accel_stream_available(void);
+
+void accel_stream_get_stats(struct accel_stream_stats *stats);
+
+#endif /* ACCEL_STREAM_H_ */
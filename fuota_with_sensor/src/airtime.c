@@ -0,0 +1,131 @@
+/*
+ * LoRa time-on-air model and rolling airtime budget
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include "airtime.h"
+
+#define PREAMBLE_SYMBOLS 8
+#define CODING_RATE      1   /* 4/5 */
+
+struct dr_params {
+    uint8_t sf;
+    uint16_t bw_khz;
+    uint8_t max_payload;
+};
+
+static const struct dr_params us915_dr[AIRTIME_US915_NUM_DR] = {
+    {10, 125, 11}, {9, 125, 53}, {8, 125, 125}, {7, 125, 242}, {8, 500, 242},
+};
+
+uint32_t airtime_lora_us(uint8_t sf, uint16_t bw_khz, uint8_t phy_len)
+{
+    /* 2^SF / BW is a whole number of us for 125, 250 and 500 kHz */
+    uint32_t tsym_us = ((uint32_t)1000 << sf) / bw_khz;
+    int32_t de = (sf >= 11 && bw_khz == 125) ? 1 : 0;
+    int32_t num = 8 * phy_len - 4 * sf + 28 + 16;
+    int32_t den = 4 * (sf - 2 * de);
+    uint32_t symbols = 8;
+
+    if (num > 0) {
+        symbols += (uint32_t)((num + den - 1) / den) * (CODING_RATE + 4);
+    }
+
+    /* Preamble is n + 4.25 symbols */
+    return (PREAMBLE_SYMBOLS * 4 + 17) * tsym_us / 4 + symbols * tsym_us;
+}
+
+uint32_t airtime_us915_us(uint8_t dr, uint8_t app_len)
+{
+    if (dr >= AIRTIME_US915_NUM_DR) {
+        return 0;
+    }
+    return airtime_lora_us(us915_dr[dr].sf, us915_dr[dr].bw_khz,
+                           (uint8_t)(app_len + AIRTIME_LORAWAN_OVERHEAD));
+}
+
+uint8_t airtime_us915_dr_of_payload(uint8_t max_payload)
+{
+    uint8_t dr;
+
+    for (dr = 0; dr < AIRTIME_US915_NUM_DR - 1; dr++) {
+        if (us915_dr[dr].max_payload >= max_payload) {
+            break;
+        }
+    }
+    return dr;
+}
+
+void airtime_init(struct airtime_budget *b, uint32_t budget_ms_per_hour, uint32_t now_ms)
+{
+    memset(b, 0, sizeof(*b));
+    b->budget_us = budget_ms_per_hour * 1000;
+    b->bucket_start_ms = now_ms;
+}
+
+/* Retire buckets older than the window */
+static void advance(struct airtime_budget *b, uint32_t now_ms)
+{
+    uint32_t steps = (now_ms - b->bucket_start_ms) / AIRTIME_BUCKET_MS;
+
+    if (steps >= AIRTIME_BUCKETS) {
+        memset(b->bucket_us, 0, sizeof(b->bucket_us));
+        b->used_us = 0;
+        b->bucket_start_ms = now_ms;
+        return;
+    }
+
+    while (steps--) {
+        b->cur = (uint8_t)((b->cur + 1) % AIRTIME_BUCKETS);
+        b->used_us -= b->bucket_us[b->cur];
+        b->bucket_us[b->cur] = 0;
+        b->bucket_start_ms += AIRTIME_BUCKET_MS;
+    }
+}
+
+void airtime_charge(struct airtime_budget *b, uint32_t now_ms, uint32_t toa_us)
+{
+    advance(b, now_ms);
+    b->bucket_us[b->cur] += toa_us;
+    b->used_us += toa_us;
+    b->stats.frames++;
+    b->stats.total_us += toa_us;
+    if (b->used_us > b->stats.peak_us) {
+        b->stats.peak_us = b->used_us;
+    }
+}
+
+uint32_t airtime_used_us(struct airtime_budget *b, uint32_t now_ms)
+{
+    advance(b, now_ms);
+    return b->used_us;
+}
+
+bool airtime_allows(struct airtime_budget *b, uint32_t now_ms, uint32_t toa_us)
+{
+    if (airtime_used_us(b, now_ms) + (uint64_t)toa_us <= b->budget_us) {
+        return true;
+    }
+    b->stats.deferred++;
+    return false;
+}
+
+uint32_t airtime_pace_ms(struct airtime_budget *b, uint32_t now_ms, uint32_t toa_us)
+{
+    uint32_t used = airtime_used_us(b, now_ms);
+    uint32_t left = (used < b->budget_us) ? b->budget_us - used : 0;
+
+    if (left < b->budget_us / 16) {
+        left = b->budget_us / 16;
+    }
+    if (left == 0) {
+        return UINT32_MAX;
+    }
+
+    uint64_t pace = (uint64_t)toa_us * AIRTIME_WINDOW_MS / left;
+
+    return (pace > UINT32_MAX) ? UINT32_MAX : (uint32_t)pace;
+}
@@ -0,0 +1,91 @@
+/*
+ * LoRa time-on-air model and rolling airtime budget
+ *
+ * Time-on-air follows the Semtech formula (AN1200.13) for LoRaWAN uplinks:
+ * 8 symbol preamble, explicit header, CRC on, coding rate 4/5, low data rate
+ * optimization at SF11/SF12 125 kHz. The budget is a one-hour sliding
+ * window of one-minute buckets. Integer only, has no Zephyr dependency so it
+ * also builds on the host (see tests_host).
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef AIRTIME_H_
+#define AIRTIME_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* MHDR + FHDR without FOpts + FPort + MIC */
+#define AIRTIME_LORAWAN_OVERHEAD 13
+
+#define AIRTIME_WINDOW_MS  (60 * 60 * 1000)
+#define AIRTIME_BUCKETS    60
+#define AIRTIME_BUCKET_MS  (AIRTIME_WINDOW_MS / AIRTIME_BUCKETS)
+
+/* US915 uplink data rates DR0..DR4 */
+#define AIRTIME_US915_NUM_DR 5
+
+struct airtime_stats {
+    uint32_t frames;        /* Frames charged */
+    uint32_t deferred;      /* airtime_allows() said no */
+    uint64_t total_us;      /* Airtime since init */
+    uint32_t peak_us;       /* Highest window use seen */
+};
+
+struct airtime_budget {
+    uint32_t budget_us;     /* Allowed per window */
+    uint32_t used_us;       /* Sum of the buckets */
+    uint32_t bucket_us[AIRTIME_BUCKETS];
+    uint32_t bucket_start_ms;
+    uint8_t cur;
+    struct airtime_stats stats;
+};
+
+/**
+ * Time-on-air of one LoRa frame in microseconds
+ * sf 7..12, bw_khz 125/250/500, phy_len: PHY payload bytes
+ */
+uint32_t airtime_lora_us(uint8_t sf, uint16_t bw_khz, uint8_t phy_len);
+
+/**
+ * Time-on-air of an uplink with app_len application bytes at a US915 DR
+ * Returns microseconds, 0 for an unknown DR
+ */
+uint32_t airtime_us915_us(uint8_t dr, uint8_t app_len);
+
+/**
+ * Slowest US915 DR whose max application payload reaches max_payload, for
+ * when only the payload size is known. DR3 for 242, which DR4 shares.
+ */
+uint8_t airtime_us915_dr_of_payload(uint8_t max_payload);
+
+/* Static initializer, same as airtime_init() at uptime 0 */
+#define AIRTIME_BUDGET_INITIALIZER(budget_ms_per_hour) \
+    { .budget_us = (budget_ms_per_hour) * 1000 }
+
+void airtime_init(struct airtime_budget *b, uint32_t budget_ms_per_hour, uint32_t now_ms);
+
+/**
+ * Account for a transmission
+ */
+void airtime_charge(struct airtime_budget *b, uint32_t now_ms, uint32_t toa_us);
+
+/**
+ * Airtime used in the last hour
+ */
+uint32_t airtime_used_us(struct airtime_budget *b, uint32_t now_ms);
+
+/**
+ * Whether a frame of toa_us still fits the budget; counts a deferral if not
+ */
+bool airtime_allows(struct airtime_budget *b, uint32_t now_ms, uint32_t toa_us);
+
+/**
+ * Spacing between frames of toa_us that spends the budget left in the
+ * window evenly over the next hour. Grows as the window fills up, capped at
+ * 16 times the spacing of an empty window.
+ */
+uint32_t airtime_pace_ms(struct airtime_budget *b, uint32_t now_ms, uint32_t toa_us);
+
+#endif /* AIRTIME_H_ */
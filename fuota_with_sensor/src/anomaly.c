@@ -0,0 +1,146 @@
+/*
+ * Sliding-window anomaly detector (SRS 02)
+ *
+ * The window keeps exact integer sums, so removing the oldest sample never
+ * drifts. With n samples, the z-score of x against the window is
+ *   z = (x - sum/n) / sqrt((n*sumsq - sum^2) / n^2)
+ *     = (n*x - sum) / sqrt(n*sumsq - sum^2)
+ * which needs one integer square root and no division before the last step.
+ *
+ * CUSUM on the z-score detects level shifts too small for a single spike:
+ *   S+ = max(0, S+ + z - k),  S- = max(0, S- - z - k),  alarm when S > h
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "anomaly.h"
+#include "vib_features.h"
+
+static int32_t clamp32(int64_t v, int32_t lo, int32_t hi)
+{
+    return (v < lo) ? lo : ((v > hi) ? hi : (int32_t)v);
+}
+
+int anomaly_init(struct anomaly_detector *det, const struct anomaly_config cfg[ANOMALY_NUM_CH])
+{
+    for (int i = 0; i < ANOMALY_NUM_CH; i++) {
+        if (cfg[i].min_std <= 0 || cfg[i].z_thresh_q8 <= 0 || cfg[i].cusum_k_q8 < 0 ||
+            cfg[i].cusum_h_q8 <= 0) {
+            return -EINVAL;
+        }
+    }
+
+    memset(det, 0, sizeof(*det));
+    for (int i = 0; i < ANOMALY_NUM_CH; i++) {
+        det->ch[i].cfg = cfg[i];
+    }
+    return 0;
+}
+
+/* z-score of x against the current window, Q8 */
+static int32_t window_z_q8(const struct anomaly_channel_state *c, int32_t x)
+{
+    int64_t n = c->count;
+    int64_t var_n2 = n * c->sumsq - c->sum * c->sum;
+    int64_t denom = vib_isqrt64((uint64_t)(var_n2 > 0 ? var_n2 : 0));
+    int64_t noise = n * c->cfg.min_std;
+
+    if (denom < noise) {
+        denom = noise;
+    }
+    return clamp32(((n * x - c->sum) * 256) / denom, -INT16_MAX, INT16_MAX);
+}
+
+static void window_push(struct anomaly_channel_state *c, int32_t x)
+{
+    if (c->count == ANOMALY_WINDOW) {
+        int32_t old = c->window[c->head];
+
+        c->sum -= old;
+        c->sumsq -= (int64_t)old * old;
+    } else {
+        c->count++;
+    }
+
+    c->window[c->head] = x;
+    c->sum += x;
+    c->sumsq += (int64_t)x * x;
+    c->head = (uint16_t)((c->head + 1) % ANOMALY_WINDOW);
+}
+
+uint16_t anomaly_update(struct anomaly_detector *det, enum anomaly_channel ch, int32_t value)
+{
+    struct anomaly_channel_state *c = &det->ch[ch];
+    uint16_t ev = 0;
+
+    if (c->count < ANOMALY_WINDOW) {
+        window_push(c, value);
+        return 0;
+    }
+
+    int32_t z = window_z_q8(c, value);
+
+    c->z_q8 = (int16_t)z;
+    c->score = (uint8_t)clamp32((((z < 0) ? -z : z) * 10) / 256, 0, UINT8_MAX);
+
+    if (z >= c->cfg.z_thresh_q8) {
+        ev |= ANOMALY_EV_SPIKE_HIGH;
+    } else if (z <= -c->cfg.z_thresh_q8) {
+        ev |= ANOMALY_EV_SPIKE_LOW;
+    }
+
+    /* Capped so a long excursion does not take as long to unwind */
+    c->cusum_pos = clamp32((int64_t)c->cusum_pos + z - c->cfg.cusum_k_q8, 0,
+                           2 * c->cfg.cusum_h_q8);
+    c->cusum_neg = clamp32((int64_t)c->cusum_neg - z - c->cfg.cusum_k_q8, 0,
+                           2 * c->cfg.cusum_h_q8);
+    if (c->cusum_pos > c->cfg.cusum_h_q8) {
+        ev |= ANOMALY_EV_SHIFT_UP;
+        c->cusum_pos = 0;
+    }
+    if (c->cusum_neg > c->cfg.cusum_h_q8) {
+        ev |= ANOMALY_EV_SHIFT_DOWN;
+        c->cusum_neg = 0;
+    }
+
+    window_push(c, value);
+
+    if (c->holdoff > 0) {
+        c->holdoff--;
+        return 0;
+    }
+    if (ev != 0) {
+        c->holdoff = ANOMALY_HOLDOFF;
+        det->events++;
+    }
+    return ANOMALY_FLAG(ch, ev);
+}
+
+uint8_t anomaly_score(const struct anomaly_detector *det)
+{
+    uint8_t score = 0;
+
+    for (int i = 0; i < ANOMALY_NUM_CH; i++) {
+        if (det->ch[i].score > score) {
+            score = det->ch[i].score;
+        }
+    }
+    return score;
+}
+
+int anomaly_encode_alert(const struct anomaly_detector *det, uint16_t flags, uint8_t *buf)
+{
+    buf[0] = (uint8_t)(flags >> 8);
+    buf[1] = (uint8_t)(flags & 0xFF);
+    buf[2] = anomaly_score(det);
+
+    for (int i = 0; i < ANOMALY_NUM_CH; i++) {
+        /* Q8 -> Q3 */
+        buf[3 + i] = (uint8_t)(int8_t)clamp32(det->ch[i].z_q8 / 32, INT8_MIN, INT8_MAX);
+    }
+    return ANOMALY_ALERT_SIZE;
+}
@@ -0,0 +1,99 @@
+/*
+ * Sliding-window anomaly detector (SRS 02)
+ *
+ * Per channel: rolling mean/variance over the last ANOMALY_WINDOW samples,
+ * z-score spike detection and two-sided CUSUM change detection. O(1) work
+ * per sample, integer-only, memory fixed at compile time. Has no Zephyr
+ * dependency so it also builds on the host (see tests_host).
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef ANOMALY_H_
+#define ANOMALY_H_
+
+#include <stdint.h>
+
+/* Baseline length in samples per channel */
+#ifndef ANOMALY_WINDOW
+#define ANOMALY_WINDOW 32
+#endif
+
+/* Samples during which a channel does not re-raise an event */
+#ifndef ANOMALY_HOLDOFF
+#define ANOMALY_HOLDOFF 16
+#endif
+
+enum anomaly_channel {
+    ANOMALY_CH_TEMP,      /* 0.001 degC */
+    ANOMALY_CH_HUM,       /* 0.001 %RH */
+    ANOMALY_CH_VIB_RMS,   /* Total AC RMS over all axes, mg */
+    ANOMALY_CH_VIB_KURT,  /* Largest axis kurtosis, Q8 */
+    ANOMALY_NUM_CH,
+};
+
+/* Event bits of one channel */
+#define ANOMALY_EV_SPIKE_HIGH  0x1   /* z >= threshold */
+#define ANOMALY_EV_SPIKE_LOW   0x2   /* z <= -threshold */
+#define ANOMALY_EV_SHIFT_UP    0x4   /* CUSUM upward level change */
+#define ANOMALY_EV_SHIFT_DOWN  0x8   /* CUSUM downward level change */
+#define ANOMALY_EV_BITS 4
+
+/* Position of a channel's events in the combined flags word */
+#define ANOMALY_FLAG(ch, ev) ((uint16_t)((ev) << ((ch) * ANOMALY_EV_BITS)))
+
+/* Alert payload: flags (2), score (1), z per channel (1 each) */
+#define ANOMALY_ALERT_SIZE (3 + ANOMALY_NUM_CH)
+
+struct anomaly_config {
+    int32_t min_std;      /* Noise floor in channel units, avoids z blowing up */
+    int16_t z_thresh_q8;  /* Spike threshold, Q8 standard deviations */
+    int16_t cusum_k_q8;   /* CUSUM slack per sample, Q8 */
+    int16_t cusum_h_q8;   /* CUSUM decision threshold, Q8 */
+};
+
+struct anomaly_channel_state {
+    struct anomaly_config cfg;
+    int32_t window[ANOMALY_WINDOW];
+    int64_t sum;
+    int64_t sumsq;
+    uint16_t head;
+    uint16_t count;
+    uint16_t holdoff;
+    int32_t cusum_pos;    /* Q8 */
+    int32_t cusum_neg;    /* Q8 */
+    int16_t z_q8;         /* z-score of the latest sample */
+    uint8_t score;        /* |z| in 0.1 standard deviations, saturating */
+};
+
+struct anomaly_detector {
+    struct anomaly_channel_state ch[ANOMALY_NUM_CH];
+    uint32_t events;      /* Non-zero updates since init */
+};
+
+/**
+ * Reset all channels with their configuration
+ * Returns 0 on success, -EINVAL on a non-positive threshold or noise floor
+ */
+int anomaly_init(struct anomaly_detector *det, const struct anomaly_config cfg[ANOMALY_NUM_CH]);
+
+/**
+ * Add one sample to a channel. Scores are computed against the baseline
+ * before the sample joins it; nothing is flagged until the window is full.
+ * Returns the channel's events, already positioned with ANOMALY_FLAG()
+ */
+uint16_t anomaly_update(struct anomaly_detector *det, enum anomaly_channel ch, int32_t value);
+
+/**
+ * Highest latest score over all channels
+ */
+uint8_t anomaly_score(const struct anomaly_detector *det);
+
+/**
+ * Serialize an alert, ANOMALY_ALERT_SIZE bytes: flags (BE16), overall score,
+ * then each channel's latest z-score as signed Q3 (saturating at +-16)
+ * Returns the number of bytes written
+ */
+int anomaly_encode_alert(const struct anomaly_detector *det, uint16_t flags, uint8_t *buf);
+
+#endif /* ANOMALY_H_ */
@@ -0,0 +1,183 @@
+/*
+ * Datarate-aware multi-record uplink packer
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "batch.h"
+
+#define IDX(b, i) (((b)->head + (i)) % BATCH_MAX_RECORDS)
+
+void batch_init(struct batch *b, uint8_t max_payload, uint32_t max_age_ms)
+{
+    memset(b, 0, sizeof(*b));
+    b->max_age_ms = max_age_ms;
+    b->max_payload = (max_payload > BATCH_FRAME_MAX) ? BATCH_FRAME_MAX : max_payload;
+}
+
+void batch_set_codec(struct batch *b, batch_fields_cb fields)
+{
+    b->fields = fields;
+}
+
+/**
+ * Compress up to run leading records into frame. Sets *full when the next
+ * record could not fit anyway.
+ * Returns the number of records encoded, 0 if the codec does not apply
+ */
+static uint8_t encode_run(struct batch *b, uint8_t run, uint8_t *frame, int *len, bool *full)
+{
+    struct tscodec_enc *enc = &b->enc;
+    int32_t *fields = b->enc_fields;
+    uint8_t size = b->rec_len[b->head];
+    uint8_t n = 0;
+    int ch = b->fields(b->rec[b->head], size, fields);
+
+    if (ch <= 0 || ch > TSCODEC_MAX_CHANNELS ||
+        tscodec_enc_init(enc, frame + BATCH_HDR_SIZE, b->max_payload - BATCH_HDR_SIZE,
+                         (uint8_t)ch) != 0) {
+        return 0;
+    }
+
+    *full = false;
+    while (n < run) {
+        b->fields(b->rec[IDX(b, n)], size, fields);
+        if (tscodec_enc_add(enc, fields) != 0) {
+            *full = true;
+            break;
+        }
+        n++;
+    }
+
+    /* Every field takes at least one byte */
+    if (enc->cap - tscodec_enc_len(enc) < (size_t)ch) {
+        *full = true;
+    }
+
+    frame[0] = (uint8_t)(BATCH_HDR_CODEC | size);
+    *len = BATCH_HDR_SIZE + (int)tscodec_enc_len(enc);
+    return n;
+}
+
+void batch_set_max_payload(struct batch *b, uint8_t max_payload)
+{
+    if (max_payload > BATCH_FRAME_MAX) {
+        max_payload = BATCH_FRAME_MAX;
+    }
+    if (max_payload != b->max_payload) {
+        b->max_payload = max_payload;
+        b->stats.replans++;
+    }
+}
+
+void batch_set_max_age(struct batch *b, uint32_t max_age_ms)
+{
+    b->max_age_ms = max_age_ms;
+}
+
+uint8_t batch_record_space(const struct batch *b)
+{
+    return (b->max_payload > BATCH_HDR_SIZE) ? (uint8_t)(b->max_payload - BATCH_HDR_SIZE) : 0;
+}
+
+static void drop_head(struct batch *b, uint8_t n)
+{
+    b->head = (uint8_t)IDX(b, n);
+    b->count -= n;
+}
+
+int batch_add(struct batch *b, const uint8_t *rec, uint8_t len, uint32_t now_ms)
+{
+    if (len == 0 || len > BATCH_RECORD_MAX) {
+        return -EMSGSIZE;
+    }
+
+    if (b->count == BATCH_MAX_RECORDS) {
+        drop_head(b, 1);
+        b->stats.dropped++;
+    }
+
+    uint8_t i = (uint8_t)IDX(b, b->count);
+
+    memcpy(b->rec[i], rec, len);
+    b->rec_len[i] = len;
+    b->rec_ms[i] = now_ms;
+    b->count++;
+    b->stats.records++;
+    return 0;
+}
+
+void batch_clear(struct batch *b)
+{
+    b->head = 0;
+    b->count = 0;
+}
+
+int batch_pop(struct batch *b, uint32_t now_ms, bool force, uint8_t *frame)
+{
+    while (b->count > 0) {
+        uint8_t size = b->rec_len[b->head];
+
+        if (size > batch_record_space(b)) {
+            /* Queued at a faster DR, can never be sent at this one */
+            drop_head(b, 1);
+            b->stats.dropped++;
+            continue;
+        }
+
+        uint8_t fit = batch_record_space(b) / size;
+        uint8_t run = 1;
+
+        while (run < b->count && b->rec_len[IDX(b, run)] == size) {
+            run++;
+        }
+
+        uint8_t take = (run < fit) ? run : fit;
+        bool full = (run >= fit);
+        bool codec_full = false;
+        int codec_len = 0;
+        uint8_t codec_take = (b->fields != NULL) ?
+                             encode_run(b, run, frame, &codec_len, &codec_full) : 0;
+        bool use_codec = (codec_take > take) ||
+                         (codec_take == take && codec_len < BATCH_HDR_SIZE + take * size);
+
+        if (use_codec) {
+            take = codec_take;
+            full = codec_full;
+        }
+
+        bool format_change = (run < b->count);
+        bool aged = (now_ms - b->rec_ms[b->head]) >= b->max_age_ms;
+        bool queue_full = (b->count == BATCH_MAX_RECORDS);
+
+        if (!full && !format_change && !aged && !queue_full && !force) {
+            return 0;
+        }
+
+        if (use_codec) {
+            drop_head(b, take);
+            b->stats.frames++;
+            b->stats.compressed++;
+            b->stats.bytes += (uint32_t)codec_len;
+            b->stats.raw_bytes += BATCH_HDR_SIZE + take * size;
+            return codec_len;
+        }
+
+        uint8_t *p = frame;
+
+        *p++ = size;
+        for (uint8_t i = 0; i < take; i++) {
+            memcpy(p, b->rec[IDX(b, i)], size);
+            p += size;
+        }
+        drop_head(b, take);
+
+        b->stats.frames++;
+        b->stats.bytes += (uint32_t)(p - frame);
+        return (int)(p - frame);
+    }
+    return 0;
+}
@@ -0,0 +1,112 @@
+/*
+ * Datarate-aware multi-record uplink packer
+ *
+ * Records are queued as they are produced and packed into frames only when a
+ * frame is taken, using the max payload of the *current* data rate. A DR
+ * change therefore re-plans every pending frame at once, from 11 bytes at
+ * US915 DR0 up to 242 bytes at DR3/DR4. Has no Zephyr dependency so it also
+ * builds on the host (see tests_host).
+ *
+ * Frame formats:
+ * - raw: one header byte holding the record size, then as many records of
+ *   that size as fit
+ * - compressed (with a codec set): header BATCH_HDR_CODEC | record size,
+ *   then a tscodec stream of the records' fields. Used whenever it carries
+ *   more records, or the same records in fewer bytes.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef BATCH_H_
+#define BATCH_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "tscodec.h"
+
+#define BATCH_HDR_SIZE    1
+#define BATCH_FRAME_MAX   242   /* Largest LoRaWAN application payload */
+#define BATCH_RECORD_MAX  48    /* Largest record */
+#define BATCH_MAX_RECORDS 16    /* Records that can wait for a frame */
+#define BATCH_HDR_CODEC   0x80  /* Header flag of a compressed frame */
+
+/**
+ * Unpack a record into integer fields for the codec
+ * Returns the number of fields, negative if the record is not supported
+ */
+typedef int (*batch_fields_cb)(const uint8_t *rec, uint8_t len, int32_t *fields);
+
+struct batch_stats {
+    uint32_t records;     /* Records accepted */
+    uint32_t frames;      /* Frames produced */
+    uint32_t bytes;       /* Frame bytes produced, headers included */
+    uint32_t replans;     /* Max payload changes */
+    uint32_t dropped;     /* Records lost: queue full or too big for the DR */
+    uint32_t compressed;  /* Frames sent in the compressed format */
+    uint32_t raw_bytes;   /* What the compressed frames would have taken raw */
+};
+
+struct batch {
+    uint8_t rec[BATCH_MAX_RECORDS][BATCH_RECORD_MAX];
+    uint8_t rec_len[BATCH_MAX_RECORDS];
+    uint32_t rec_ms[BATCH_MAX_RECORDS];
+    uint8_t head;
+    uint8_t count;
+    uint8_t max_payload;
+    uint32_t max_age_ms;
+    batch_fields_cb fields;
+    struct batch_stats stats;
+    /* Codec scratch, kept here rather than on the caller's stack */
+    struct tscodec_enc enc;
+    int32_t enc_fields[TSCODEC_MAX_CHANNELS];
+};
+
+/**
+ * Reset the packer. max_age_ms bounds how long the oldest record may wait
+ * for a frame to fill up (0 = send every record as soon as it is added).
+ */
+void batch_init(struct batch *b, uint8_t max_payload, uint32_t max_age_ms);
+
+/**
+ * Enable compressed frames, fields unpacks records for the codec
+ */
+void batch_set_codec(struct batch *b, batch_fields_cb fields);
+
+/**
+ * New max application payload, e.g. from the DR changed callback
+ */
+void batch_set_max_payload(struct batch *b, uint8_t max_payload);
+
+/**
+ * New bound on how long the oldest record waits, e.g. to pace frames to an
+ * airtime budget
+ */
+void batch_set_max_age(struct batch *b, uint32_t max_age_ms);
+
+/**
+ * Largest record that fits a frame at the current data rate
+ */
+uint8_t batch_record_space(const struct batch *b);
+
+/**
+ * Queue one record. If the queue is full the oldest record is dropped.
+ * Returns 0 on success, -EMSGSIZE if len is 0 or above BATCH_RECORD_MAX
+ */
+int batch_add(struct batch *b, const uint8_t *rec, uint8_t len, uint32_t now_ms);
+
+/**
+ * Drop every queued record without counting them as dropped, e.g. to queue
+ * them again from the telemetry log after a failed send
+ */
+void batch_clear(struct batch *b);
+
+/**
+ * Take the next frame if one is due: it is full, the oldest record reached
+ * max_age_ms, the queue is full, or force is set. Call until it returns 0.
+ * frame must hold BATCH_FRAME_MAX bytes.
+ * Returns the frame length, 0 if nothing is due
+ */
+int batch_pop(struct batch *b, uint32_t now_ms, bool force, uint8_t *frame);
+
+#endif /* BATCH_H_ */
@@ -0,0 +1,262 @@
+/*
+ * Streaming delta patch decoder for FUOTA
+ *
+ * A byte-wise state machine: varints and ops may be split across any chunk
+ * boundary, as the patch is read from flash in fixed blocks.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "delta.h"
+
+enum {
+    ST_OP,
+    ST_COPY_LEN,
+    ST_COPY_OFF,
+    ST_COPY_FIXES,
+    ST_FIX_GAP,
+    ST_FIX_BYTE,
+    ST_INSERT_LEN,
+    ST_INSERT_DATA,
+    ST_DONE,
+    ST_ERROR,
+};
+
+static uint32_t get_le32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+uint32_t delta_crc32(uint32_t crc, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+
+    crc = ~crc;
+    while (len--) {
+        crc ^= *p++;
+        for (int i = 0; i < 8; i++) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+        }
+    }
+    return ~crc;
+}
+
+int delta_parse_header(const uint8_t *buf, size_t len, struct delta_hdr *hdr)
+{
+    if (len < DELTA_HDR_SIZE || get_le32(buf) != DELTA_MAGIC) {
+        return -ENOMSG;
+    }
+
+    hdr->old_size = get_le32(&buf[4]);
+    hdr->old_crc = get_le32(&buf[8]);
+    hdr->new_size = get_le32(&buf[12]);
+    hdr->new_crc = get_le32(&buf[16]);
+    hdr->patch_size = get_le32(&buf[20]);
+
+    if (hdr->new_size == 0 || hdr->patch_size <= DELTA_HDR_SIZE) {
+        return -EINVAL;
+    }
+    return 0;
+}
+
+void delta_init(struct delta_dec *d, const struct delta_hdr *hdr, const struct delta_io *io)
+{
+    memset(d, 0, sizeof(*d));
+    d->hdr = *hdr;
+    d->io = io;
+    d->state = ST_OP;
+}
+
+static int emit(struct delta_dec *d, const uint8_t *data, uint32_t len)
+{
+    if (len > d->hdr.new_size - d->out) {
+        return -EINVAL;
+    }
+    d->crc = delta_crc32(d->crc, data, len);
+    d->out += len;
+    return d->io->write_new(d->io->ctx, data, len);
+}
+
+/* Copy n old bytes of the current op unchanged */
+static int copy_old(struct delta_dec *d, uint32_t n)
+{
+    while (n > 0) {
+        uint32_t chunk = (n < DELTA_CHUNK) ? n : DELTA_CHUNK;
+        int ret = d->io->read_old(d->io->ctx, d->old_pos, d->buf, chunk);
+
+        if (ret < 0) {
+            return ret;
+        }
+        ret = emit(d, d->buf, chunk);
+        if (ret < 0) {
+            return ret;
+        }
+        d->old_pos += chunk;
+        d->len -= chunk;
+        n -= chunk;
+    }
+    return 0;
+}
+
+/* The op is complete: next op, or the end of the image */
+static int op_done(struct delta_dec *d)
+{
+    if (d->out < d->hdr.new_size) {
+        d->state = ST_OP;
+        return 0;
+    }
+    if (d->crc != d->hdr.new_crc) {
+        return -EBADMSG;
+    }
+    d->state = ST_DONE;
+    return 0;
+}
+
+/**
+ * Accumulate a varint byte
+ * Returns 1 when the varint is complete, 0 for more, -EINVAL on overflow
+ */
+static int varint_byte(struct delta_dec *d, uint8_t b)
+{
+    if (d->shift > 28 || (d->shift == 28 && (b & 0x70))) {
+        return -EINVAL;
+    }
+    d->varint |= (uint32_t)(b & 0x7F) << d->shift;
+    if (b & 0x80) {
+        d->shift += 7;
+        return 0;
+    }
+    d->shift = 0;
+    return 1;
+}
+
+static int step(struct delta_dec *d, uint8_t b)
+{
+    int ret;
+
+    if (d->state != ST_OP && d->state != ST_FIX_BYTE && d->state != ST_INSERT_DATA) {
+        ret = varint_byte(d, b);
+        if (ret <= 0) {
+            return ret;
+        }
+    }
+
+    uint32_t v = d->varint;
+
+    d->varint = 0;
+
+    switch (d->state) {
+    case ST_OP:
+        if (b == DELTA_OP_COPY) {
+            d->state = ST_COPY_LEN;
+        } else if (b == DELTA_OP_INSERT) {
+            d->state = ST_INSERT_LEN;
+        } else {
+            return -EINVAL;
+        }
+        return 0;
+
+    case ST_COPY_LEN:
+        d->len = v;
+        d->state = ST_COPY_OFF;
+        return 0;
+
+    case ST_COPY_OFF: {
+        /* Zigzag: even values forward, odd ones back */
+        int64_t pos = (int64_t)d->old_pos + ((v & 1) ? -(int64_t)(v >> 1) - 1 : (int64_t)(v >> 1));
+
+        if (d->len == 0 || pos < 0 || pos + d->len > d->hdr.old_size) {
+            return -EINVAL;
+        }
+        d->old_pos = (uint32_t)pos;
+        d->state = ST_COPY_FIXES;
+        return 0;
+    }
+
+    case ST_COPY_FIXES:
+        d->fixes = v;
+        if (v > d->len) {
+            return -EINVAL;
+        }
+        if (v > 0) {
+            d->state = ST_FIX_GAP;
+            return 0;
+        }
+        ret = copy_old(d, d->len);
+        return (ret < 0) ? ret : op_done(d);
+
+    case ST_FIX_GAP:
+        if (v >= d->len) {
+            return -EINVAL;
+        }
+        d->state = ST_FIX_BYTE;
+        return copy_old(d, v);
+
+    case ST_FIX_BYTE:
+        /* Replaces one old byte */
+        ret = emit(d, &b, 1);
+        if (ret < 0) {
+            return ret;
+        }
+        d->old_pos++;
+        d->len--;
+        if (--d->fixes > 0) {
+            d->state = ST_FIX_GAP;
+            return 0;
+        }
+        ret = copy_old(d, d->len);
+        return (ret < 0) ? ret : op_done(d);
+
+    case ST_INSERT_LEN:
+        if (v == 0) {
+            return -EINVAL;
+        }
+        d->len = v;
+        d->state = ST_INSERT_DATA;
+        return 0;
+
+    default:
+        return -EINVAL;
+    }
+}
+
+int delta_feed(struct delta_dec *d, const uint8_t *data, size_t len)
+{
+    size_t i = 0;
+
+    while (i < len && d->state != ST_DONE) {
+        int ret;
+
+        if (d->state == ST_ERROR) {
+            return -EINVAL;
+        }
+
+        if (d->state == ST_INSERT_DATA) {
+            /* Literal run: straight through, no per-byte step */
+            uint32_t n = (len - i < d->len) ? (uint32_t)(len - i) : d->len;
+
+            ret = emit(d, &data[i], n);
+            i += n;
+            d->len -= n;
+            if (ret == 0 && d->len == 0) {
+                ret = op_done(d);
+            }
+        } else {
+            ret = step(d, data[i++]);
+        }
+
+        if (ret < 0) {
+            d->state = ST_ERROR;
+            return ret;
+        }
+    }
+    return 0;
+}
+
+bool delta_done(const struct delta_dec *d)
+{
+    return d->state == ST_DONE;
+}
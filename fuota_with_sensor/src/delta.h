@@ -0,0 +1,101 @@
+/*
+ * Streaming delta patch decoder for FUOTA
+ *
+ * A delta patch rebuilds the new signed image from the one running in
+ * slot0. It is made by tools/mkdelta from the old and new
+ * zephyr.signed.bin. A small code change shifts the functions after it, so
+ * most of the image is old bytes at an offset, with a few absolute
+ * addresses changed. The patch therefore carries mostly copies with sparse
+ * byte fixes.
+ *
+ * Layout, integers little-endian, varints LEB128:
+ * - header: "DLT1", old size, old CRC-32, new size, new CRC-32, patch size
+ *   (header included)
+ * - ops until the new size is reached:
+ *   - COPY:   0x01, len, old offset delta (zigzag, from the end of the
+ *             previous copy), fix count, fixes (gap since the last one,
+ *             byte)
+ *   - INSERT: 0x02, len, bytes
+ *
+ * The decoder takes the patch in chunks of any size, reads the old image
+ * and emits the new one in order through callbacks, with a fixed RAM
+ * footprint. Has no Zephyr dependency so it also builds on the host (see
+ * tests_host); delta_flash.c binds it to the flash partitions.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef DELTA_H_
+#define DELTA_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define DELTA_MAGIC    0x31544C44   /* "DLT1" */
+#define DELTA_HDR_SIZE 24
+
+#define DELTA_OP_COPY   0x01
+#define DELTA_OP_INSERT 0x02
+
+/* Old bytes read per callback */
+#define DELTA_CHUNK 64
+
+struct delta_hdr {
+    uint32_t old_size;
+    uint32_t old_crc;
+    uint32_t new_size;
+    uint32_t new_crc;
+    uint32_t patch_size;
+};
+
+struct delta_io {
+    void *ctx;
+    int (*read_old)(void *ctx, uint32_t off, void *buf, size_t len);
+    int (*write_new)(void *ctx, const void *buf, size_t len);
+};
+
+struct delta_dec {
+    struct delta_hdr hdr;
+    const struct delta_io *io;
+    uint8_t state;
+    uint8_t shift;      /* Varint being read */
+    uint32_t varint;
+    uint32_t len;       /* Bytes left in the current op */
+    uint32_t fixes;     /* Fixes left in the current copy */
+    uint32_t old_pos;   /* Next old byte of the current copy */
+    uint32_t out;       /* New bytes written */
+    uint32_t crc;       /* CRC-32 of the new bytes, running */
+    uint8_t buf[DELTA_CHUNK];
+};
+
+/**
+ * Parse a patch header
+ * Returns 0 on success, -ENOMSG if buf is not a delta patch (e.g. a full
+ * image), -EINVAL for an inconsistent header
+ */
+int delta_parse_header(const uint8_t *buf, size_t len, struct delta_hdr *hdr);
+
+/**
+ * Start applying a patch whose header was parsed; feed the ops after it
+ */
+void delta_init(struct delta_dec *d, const struct delta_hdr *hdr, const struct delta_io *io);
+
+/**
+ * Feed the next patch bytes
+ * Returns 0 on success, -EINVAL for a malformed patch or an op beyond an
+ * image, -EBADMSG if the new image does not match its CRC, callback errors
+ */
+int delta_feed(struct delta_dec *d, const uint8_t *data, size_t len);
+
+/**
+ * Whether the whole new image was written and matched its CRC
+ */
+bool delta_done(const struct delta_dec *d);
+
+/**
+ * CRC-32 (IEEE 802.3) continued over data, start with 0
+ */
+uint32_t delta_crc32(uint32_t crc, const void *data, size_t len);
+
+#endif /* DELTA_H_ */
@@ -0,0 +1,106 @@
+/*
+ * Delta FUOTA on the MCUboot slots
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/storage/flash_map.h>
+
+#include "delta_flash.h"
+#include "slot_inplace.h"
+
+LOG_MODULE_REGISTER(delta_flash, CONFIG_LORAWAN_SERVICES_LOG_LEVEL);
+
+#define OLD_PARTITION   slot0_partition
+#define NEW_PARTITION   slot1_partition
+
+/* The image the patch applies to, open while it is applied */
+static const struct flash_area *old_fa;
+
+static int read_old(void *ctx, uint32_t off, void *buf, size_t len)
+{
+    ARG_UNUSED(ctx);
+
+    return flash_area_read(old_fa, off, buf, len);
+}
+
+int delta_flash_check(struct delta_hdr *hdr)
+{
+    const struct flash_area *fa;
+    uint8_t buf[DELTA_HDR_SIZE];
+    uint32_t crc;
+    int ret;
+
+    ret = flash_area_open(FIXED_PARTITION_ID(NEW_PARTITION), &fa);
+    if (ret < 0) {
+        return ret;
+    }
+    ret = flash_area_read(fa, 0, buf, sizeof(buf));
+    flash_area_close(fa);
+    if (ret < 0) {
+        return ret;
+    }
+
+    ret = delta_parse_header(buf, sizeof(buf), hdr);
+    if (ret < 0) {
+        return (ret == -ENOMSG) ? ret : -EBADMSG;
+    }
+    if (hdr->patch_size > FIXED_PARTITION_SIZE(NEW_PARTITION) ||
+        hdr->new_size > FIXED_PARTITION_SIZE(NEW_PARTITION) ||
+        hdr->old_size > FIXED_PARTITION_SIZE(OLD_PARTITION)) {
+        return -ENOSPC;
+    }
+
+    ret = flash_area_open(FIXED_PARTITION_ID(OLD_PARTITION), &fa);
+    if (ret < 0) {
+        return ret;
+    }
+    ret = slot_inplace_crc(fa, hdr->old_size, &crc);
+    flash_area_close(fa);
+    if (ret < 0) {
+        return ret;
+    }
+    return (crc == hdr->old_crc) ? 0 : -EBADMSG;
+}
+
+static int feed(void *dec, const uint8_t *buf, size_t len)
+{
+    return delta_feed(dec, buf, len);
+}
+
+int delta_flash_apply(const struct delta_hdr *hdr, struct delta_flash_stats *stats)
+{
+    static struct slot_inplace slot;
+    static struct delta_dec dec;
+    const struct delta_io io = {&slot, read_old, slot_inplace_write};
+    uint32_t start = k_uptime_get_32();
+    int ret;
+
+    ret = flash_area_open(FIXED_PARTITION_ID(OLD_PARTITION), &old_fa);
+    if (ret < 0) {
+        return ret;
+    }
+
+    ret = slot_inplace_start(&slot, hdr->patch_size);
+    if (ret == 0) {
+        delta_init(&dec, hdr, &io);
+        ret = slot_inplace_run(&slot, DELTA_HDR_SIZE, feed, &dec);
+    }
+    if (ret == 0 && !delta_done(&dec)) {
+        ret = -EBADMSG;
+    }
+    ret = slot_inplace_finish(&slot, ret, hdr->new_size, hdr->new_crc);
+    flash_area_close(old_fa);
+
+    stats->patch_size = hdr->patch_size;
+    stats->new_size = hdr->new_size;
+    stats->apply_ms = k_uptime_get_32() - start;
+    if (ret < 0) {
+        LOG_ERR("Applying the delta patch failed: %d", ret);
+    }
+    return ret;
+}
@@ -0,0 +1,40 @@
+/*
+ * Delta FUOTA on the MCUboot slots
+ *
+ * The fragmented data transport writes what it receives to slot1, full
+ * image or delta patch (see delta.h). A patch is decoded in place in slot1
+ * (see slot_inplace.h) against the image running in slot0. The new image
+ * and the patch must therefore fit slot1 together, less one page.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef DELTA_FLASH_H_
+#define DELTA_FLASH_H_
+
+#include <stdint.h>
+
+#include "delta.h"
+
+struct delta_flash_stats {
+    uint32_t patch_size;
+    uint32_t new_size;
+    uint32_t apply_ms;   /* Moving, decoding and verification */
+};
+
+/**
+ * Check whether slot1 holds a patch for the running image
+ * Returns 0 if so, -ENOMSG if slot1 holds a full image, -EBADMSG if slot0
+ * is not the image the patch was made for, -ENOSPC if the patch or the new
+ * image do not fit, negative flash error
+ */
+int delta_flash_check(struct delta_hdr *hdr);
+
+/**
+ * Rebuild the new image in slot1 from the checked patch
+ * Returns 0 if slot1 holds the new image and matches its CRC, -ENOSPC if
+ * the image reached the patch, delta_feed() errors, negative flash error
+ */
+int delta_flash_apply(const struct delta_hdr *hdr, struct delta_flash_stats *stats);
+
+#endif /* DELTA_FLASH_H_ */
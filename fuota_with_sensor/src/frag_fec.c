@@ -0,0 +1,320 @@
+/*
+ * FEC reassembly of a fragmented data block (LoRaWAN TS004) in flash
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "frag_fec.h"
+
+static bool test_bit(const uint32_t *set, uint16_t i)
+{
+    return (set[i / 32] >> (i % 32)) & 1;
+}
+
+static void set_bit(uint32_t *set, uint16_t i)
+{
+    set[i / 32] |= 1u << (i % 32);
+}
+
+static uint16_t bits_len(const struct frag_fec *fec)
+{
+    return (fec->nb_frag + 7) / 8;
+}
+
+static uint8_t *row_bits(struct frag_fec *fec, int r)
+{
+    return &fec->rec[r][FRAG_FEC_ROW_HDR];
+}
+
+static uint8_t *row_data(struct frag_fec *fec, int r)
+{
+    return &fec->rec[r][FRAG_FEC_ROW_HDR + bits_len(fec)];
+}
+
+static void xor_bytes(uint8_t *dst, const uint8_t *src, size_t len)
+{
+    while (len--) {
+        *dst++ ^= *src++;
+    }
+}
+
+/* Lowest set bit, -1 if none */
+static int lowest_bit(const uint8_t *bits, uint16_t len)
+{
+    for (uint16_t i = 0; i < len; i++) {
+        if (bits[i] != 0) {
+            return i * 8 + __builtin_ctz(bits[i]);
+        }
+    }
+    return -1;
+}
+
+/* CRC-16/CCITT-FALSE */
+static uint16_t crc16(const uint8_t *p, size_t len)
+{
+    uint16_t crc = 0xFFFF;
+
+    while (len--) {
+        crc ^= (uint16_t)(*p++ << 8);
+        for (int i = 0; i < 8; i++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+static uint32_t prbs23(uint32_t x)
+{
+    uint32_t b0 = x & 1;
+    uint32_t b1 = (x & 0x20) >> 5;
+
+    return (x >> 1) + ((b0 ^ b1) << 22);
+}
+
+void frag_fec_parity_row(uint32_t n, uint16_t nb_frag, uint8_t *bits)
+{
+    /* A power of two would leave the last fragment out of every row */
+    uint32_t m = ((nb_frag & (nb_frag - 1)) == 0) ? 1 : 0;
+    uint32_t x = 1 + 1001 * n;
+
+    memset(bits, 0, (nb_frag + 7) / 8);
+    for (uint16_t k = 0; k < nb_frag / 2; k++) {
+        uint32_t r = 1 << 16;
+
+        while (r >= nb_frag) {
+            x = prbs23(x);
+            r = x % (nb_frag + m);
+        }
+        bits[r / 8] |= 1 << (r % 8);
+    }
+}
+
+uint16_t frag_fec_row_len(uint16_t nb_frag, uint8_t frag_size)
+{
+    return (FRAG_FEC_ROW_HDR + (nb_frag + 7) / 8 + frag_size + 7) & ~7;
+}
+
+int frag_fec_init(struct frag_fec *fec, const struct frag_fec_io *io, uint16_t nb_frag,
+                  uint8_t frag_size, uint16_t max_rows)
+{
+    if (nb_frag == 0 || nb_frag > FRAG_FEC_MAX_FRAGS || frag_size == 0 ||
+        frag_size > FRAG_FEC_MAX_SIZE) {
+        return -EINVAL;
+    }
+
+    memset(fec, 0, sizeof(*fec));
+    fec->io = io;
+    fec->nb_frag = nb_frag;
+    fec->frag_size = frag_size;
+    fec->row_len = frag_fec_row_len(nb_frag, frag_size);
+    fec->max_rows = (max_rows < FRAG_FEC_MAX_ROWS) ? max_rows : FRAG_FEC_MAX_ROWS;
+    return 0;
+}
+
+static int find_row(const struct frag_fec *fec, uint16_t pivot)
+{
+    for (uint16_t r = 0; r < fec->rows; r++) {
+        if (fec->row_pivot[r] == pivot) {
+            return r;
+        }
+    }
+    return -1;
+}
+
+uint16_t frag_fec_missing(const struct frag_fec *fec)
+{
+    uint16_t missing = 0;
+
+    for (uint16_t i = 0; i < fec->nb_frag; i++) {
+        missing += !test_bit(fec->have, i) && !test_bit(fec->pivot, i);
+    }
+    return missing;
+}
+
+/**
+ * Reduce a coded fragment, in rec[0], against the rows and keep it
+ */
+static int put_coded(struct frag_fec *fec)
+{
+    uint8_t *bits = row_bits(fec, 0);
+    uint8_t *data = row_data(fec, 0);
+    int p;
+    int ret;
+
+    while ((p = lowest_bit(bits, bits_len(fec))) >= 0) {
+        if (test_bit(fec->have, p)) {
+            /* Received: XOR it out */
+            ret = fec->io->read_frag(fec->io->ctx, p, row_data(fec, 1), fec->frag_size);
+            if (ret < 0) {
+                return ret;
+            }
+            xor_bytes(data, row_data(fec, 1), fec->frag_size);
+            bits[p / 8] &= ~(1 << (p % 8));
+        } else if (test_bit(fec->pivot, p)) {
+            ret = fec->io->read_row(fec->io->ctx, find_row(fec, p), fec->rec[1], fec->row_len);
+            if (ret < 0) {
+                return ret;
+            }
+            xor_bytes(bits, row_bits(fec, 1), bits_len(fec) + fec->frag_size);
+        } else {
+            break;
+        }
+    }
+
+    if (p < 0) {
+        fec->stats.redundant++;
+        return 0;
+    }
+    if (fec->rows >= fec->max_rows) {
+        fec->stats.no_room++;
+        return 0;
+    }
+
+    uint16_t crc = crc16(bits, fec->row_len - FRAG_FEC_ROW_HDR);
+
+    fec->rec[0][0] = (uint8_t)p;
+    fec->rec[0][1] = (uint8_t)(p >> 8);
+    fec->rec[0][2] = (uint8_t)crc;
+    fec->rec[0][3] = (uint8_t)(crc >> 8);
+    ret = fec->io->write_row(fec->io->ctx, fec->rows, fec->rec[0], fec->row_len);
+    if (ret < 0) {
+        return ret;
+    }
+    fec->row_pivot[fec->rows++] = (uint16_t)p;
+    set_bit(fec->pivot, p);
+    return 0;
+}
+
+/**
+ * Rebuild every missing fragment from the row it is the pivot of; the
+ * other bits of a row are all higher, so already in place
+ */
+static int solve(struct frag_fec *fec)
+{
+    uint8_t *bits = row_bits(fec, 0);
+    uint8_t *data = row_data(fec, 0);
+
+    for (int p = fec->nb_frag - 1; p >= 0; p--) {
+        int ret;
+
+        if (test_bit(fec->have, p)) {
+            continue;
+        }
+        ret = fec->io->read_row(fec->io->ctx, find_row(fec, p), fec->rec[0], fec->row_len);
+        for (int q = p + 1; q < fec->nb_frag && ret == 0; q++) {
+            if (bits[q / 8] & (1 << (q % 8))) {
+                ret = fec->io->read_frag(fec->io->ctx, q, row_data(fec, 1), fec->frag_size);
+                xor_bytes(data, row_data(fec, 1), fec->frag_size);
+            }
+        }
+        if (ret == 0) {
+            ret = fec->io->write_frag(fec->io->ctx, p, data, fec->frag_size);
+        }
+        if (ret < 0) {
+            return ret;
+        }
+        set_bit(fec->have, p);
+        fec->stats.solved++;
+    }
+    return 0;
+}
+
+void frag_fec_mark(struct frag_fec *fec, uint16_t idx)
+{
+    if (idx < fec->nb_frag) {
+        set_bit(fec->have, idx);
+    }
+}
+
+/**
+ * Returns 1 once every missing fragment is a pivot, 0 if not
+ */
+static int complete(const struct frag_fec *fec)
+{
+    return (frag_fec_missing(fec) == 0) ? 1 : 0;
+}
+
+int frag_fec_solve(struct frag_fec *fec)
+{
+    int ret;
+
+    if (fec->done) {
+        return 0;
+    }
+    if (!complete(fec)) {
+        return -EAGAIN;
+    }
+    ret = solve(fec);
+    if (ret < 0) {
+        return ret;
+    }
+    fec->done = true;
+    return 0;
+}
+
+int frag_fec_resume(struct frag_fec *fec)
+{
+    uint8_t *rec = fec->rec[0];
+
+    while (fec->rows < fec->max_rows) {
+        int ret = fec->io->read_row(fec->io->ctx, fec->rows, rec, fec->row_len);
+        uint16_t pivot = rec[0] | (rec[1] << 8);
+        uint16_t crc = rec[2] | (rec[3] << 8);
+
+        if (ret < 0) {
+            return ret;
+        }
+        if (pivot == UINT16_MAX) {
+            break;
+        }
+        if (pivot >= fec->nb_frag || test_bit(fec->pivot, pivot) ||
+            crc != crc16(&rec[FRAG_FEC_ROW_HDR], fec->row_len - FRAG_FEC_ROW_HDR)) {
+            /* Torn by a reset: its place is lost, its pivot matches nothing */
+            fec->row_pivot[fec->rows++] = UINT16_MAX;
+            continue;
+        }
+        fec->row_pivot[fec->rows++] = pivot;
+        set_bit(fec->pivot, pivot);
+    }
+    return complete(fec);
+}
+
+int frag_fec_put(struct frag_fec *fec, uint16_t counter, const uint8_t *data, size_t len)
+{
+    int ret = 0;
+
+    if (fec->done) {
+        return 1;
+    }
+    if (counter == 0 || len < fec->frag_size) {
+        return -EINVAL;
+    }
+
+    if (counter <= fec->nb_frag) {
+        uint16_t idx = counter - 1;
+
+        if (test_bit(fec->have, idx)) {
+            fec->stats.duplicates++;
+            return 0;
+        }
+        ret = fec->io->write_frag(fec->io->ctx, idx, data, fec->frag_size);
+        if (ret < 0) {
+            return ret;
+        }
+        set_bit(fec->have, idx);
+        fec->stats.uncoded++;
+    } else {
+        fec->stats.coded++;
+        frag_fec_parity_row(counter - fec->nb_frag, fec->nb_frag, row_bits(fec, 0));
+        memcpy(row_data(fec, 0), data, fec->frag_size);
+        ret = put_coded(fec);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+
+    return complete(fec);
+}
@@ -0,0 +1,125 @@
+/*
+ * FEC reassembly of a fragmented data block (LoRaWAN TS004) in flash
+ *
+ * Uncoded fragments are written in place as they arrive. A coded fragment
+ * is the XOR of the fragments its parity row selects (frag_fec_parity_row,
+ * the matrix of TS004); the received ones are XORed out, then it is reduced
+ * against the rows already kept until its lowest set bit, its pivot, is one
+ * no other row has. Reduced rows are appended to flash and never rewritten:
+ * once every missing fragment is the pivot of a row, frag_fec_solve()
+ * rebuilds them from the highest pivot down. That reads a row and up to
+ * every fragment per missing one, so it is left to the caller to run
+ * outside the radio's context.
+ *
+ * RAM holds two fragment bitsets, the pivot of each row and two row
+ * buffers, so redundancy costs two bytes of RAM per row instead of the
+ * square parity matrix of the reference decoder; the rows themselves live
+ * in flash. Rows carry a CRC, so after a reset they are read back up to the
+ * first one torn or never written (frag_fec_resume). Has no Zephyr
+ * dependency so it also builds on the host (see tests_host); frag_session.c
+ * binds it to slot1.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef FRAG_FEC_H_
+#define FRAG_FEC_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Session limits: 96 KB in fragments of 96 B or more, the longest payload */
+#define FRAG_FEC_MAX_FRAGS 1024
+#define FRAG_FEC_MAX_SIZE  240
+#define FRAG_FEC_MAX_ROWS  128
+
+/* Row record: pivot, CRC-16 of the rest, parity bits, fragment data */
+#define FRAG_FEC_ROW_HDR 4
+#define FRAG_FEC_ROW_MAX (FRAG_FEC_ROW_HDR + FRAG_FEC_MAX_FRAGS / 8 + FRAG_FEC_MAX_SIZE)
+
+struct frag_fec_io {
+    void *ctx;
+    int (*read_frag)(void *ctx, uint16_t idx, uint8_t *buf, size_t len);
+    int (*write_frag)(void *ctx, uint16_t idx, const uint8_t *buf, size_t len);
+    int (*read_row)(void *ctx, uint16_t row, uint8_t *buf, size_t len);
+    int (*write_row)(void *ctx, uint16_t row, const uint8_t *buf, size_t len);
+};
+
+struct frag_fec_stats {
+    uint16_t uncoded;     /* Uncoded fragments written */
+    uint16_t coded;       /* Coded fragments received */
+    uint16_t duplicates;  /* Fragments received twice */
+    uint16_t redundant;   /* Coded fragments adding nothing */
+    uint16_t no_room;     /* Coded fragments dropped with all rows in use */
+    uint16_t solved;      /* Fragments rebuilt from the rows */
+};
+
+struct frag_fec {
+    const struct frag_fec_io *io;
+    uint16_t nb_frag;
+    uint8_t frag_size;
+    uint16_t row_len;     /* Row record size, a multiple of 8 */
+    uint16_t max_rows;    /* Rows the flash area holds */
+    uint16_t rows;
+    bool done;
+    uint32_t have[FRAG_FEC_MAX_FRAGS / 32];    /* Fragment in place */
+    uint32_t pivot[FRAG_FEC_MAX_FRAGS / 32];   /* Fragment is the pivot of a row */
+    uint16_t row_pivot[FRAG_FEC_MAX_ROWS];
+    uint8_t rec[2][FRAG_FEC_ROW_MAX];
+    struct frag_fec_stats stats;
+};
+
+/**
+ * Fill bits (nb_frag bits, LSB first) with the parity row of coded fragment
+ * n, 1 for the first one after the nb_frag uncoded fragments
+ */
+void frag_fec_parity_row(uint32_t n, uint16_t nb_frag, uint8_t *bits);
+
+/**
+ * Size of a row record for a session
+ */
+uint16_t frag_fec_row_len(uint16_t nb_frag, uint8_t frag_size);
+
+/**
+ * Start a session of nb_frag fragments of frag_size bytes, with room for
+ * max_rows rows in flash
+ * Returns 0 on success, -EINVAL beyond the session limits
+ */
+int frag_fec_init(struct frag_fec *fec, const struct frag_fec_io *io, uint16_t nb_frag,
+                  uint8_t frag_size, uint16_t max_rows);
+
+/**
+ * Take fragment counter (1-based; above nb_frag a coded fragment) of
+ * frag_size bytes
+ * Returns 1 once the block can be solved, 0 if fragments are still needed,
+ * -EINVAL for a bad counter or size, io errors
+ */
+int frag_fec_put(struct frag_fec *fec, uint16_t counter, const uint8_t *data, size_t len);
+
+/**
+ * Note a fragment already in place, e.g. from a journal
+ */
+void frag_fec_mark(struct frag_fec *fec, uint16_t idx);
+
+/**
+ * Read back the rows of an interrupted session, after frag_fec_init() and
+ * frag_fec_mark() of the fragments in place; a torn row is skipped
+ * Returns 1 if the block can then be solved, 0 if fragments are still
+ * needed, io errors
+ */
+int frag_fec_resume(struct frag_fec *fec);
+
+/**
+ * Rebuild the missing fragments in flash once put or resume returned 1
+ * Returns 0 when the block is complete, -EAGAIN if fragments are still
+ * needed, io errors
+ */
+int frag_fec_solve(struct frag_fec *fec);
+
+/**
+ * Fragments still needed to complete the block
+ */
+uint16_t frag_fec_missing(const struct frag_fec *fec);
+
+#endif /* FRAG_FEC_H_ */
@@ -0,0 +1,66 @@
+/*
+ * Journal of a fragmentation session in flash, for resuming it after a reset
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "frag_journal.h"
+
+#define ERASED_FLAG 0x8000
+
+void frag_journal_init(struct frag_journal *j)
+{
+    j->base = 0;
+    j->mask = 0;
+    j->pending = 0;
+}
+
+static uint64_t window_rec(const struct frag_journal *j)
+{
+    return j->base | (j->mask << 16);
+}
+
+bool frag_journal_add(struct frag_journal *j, uint16_t idx, uint64_t *rec)
+{
+    bool flush = false;
+
+    if (idx < j->base || idx >= j->base + FRAG_JOURNAL_WINDOW) {
+        /* Close the window, the new one starts at the fragment */
+        if (j->pending > 0) {
+            *rec = window_rec(j);
+            flush = true;
+        }
+        j->base = idx;
+        j->mask = 0;
+        j->pending = 0;
+    }
+
+    j->mask |= 1ull << (idx - j->base);
+    if (!flush && ++j->pending >= FRAG_JOURNAL_EVERY) {
+        *rec = window_rec(j);
+        j->pending = 0;
+        flush = true;
+    } else if (flush) {
+        j->pending = 1;
+    }
+    return flush;
+}
+
+uint64_t frag_journal_erased(uint16_t page)
+{
+    return ERASED_FLAG | (page & 0x7FFF);
+}
+
+enum frag_journal_type frag_journal_parse(uint64_t rec, uint16_t *base, uint64_t *mask)
+{
+    if (rec == FRAG_JOURNAL_BLANK) {
+        return FRAG_JOURNAL_END;
+    }
+    if (rec & ERASED_FLAG) {
+        *base = rec & 0x7FFF;
+        return FRAG_JOURNAL_ERASED;
+    }
+    *base = (uint16_t)rec;
+    *mask = rec >> 16;
+    return FRAG_JOURNAL_FRAGS;
+}
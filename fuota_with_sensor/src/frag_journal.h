@@ -0,0 +1,61 @@
+/*
+ * Journal of a fragmentation session in flash, for resuming it after a reset
+ *
+ * Each record is one 8 byte flash write block, written once:
+ * - bits 0-15: first fragment of a window of FRAG_JOURNAL_WINDOW, bits
+ *   16-63: the fragments of that window in place
+ * - or, with bit 15 set, bits 0-14: a page of slot1 the session erased
+ * Fragments arrive in order, so a window is written when a fragment past it
+ * arrives, or every FRAG_JOURNAL_EVERY fragments; a later record of the same
+ * window is a superset. An erased record (all ones) ends the journal.
+ *
+ * A reset loses at most the last FRAG_JOURNAL_EVERY fragments of the
+ * journal. They stay in flash: received again, they are found identical in
+ * place. Has no Zephyr dependency so it also builds on the host (see
+ * tests_host).
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef FRAG_JOURNAL_H_
+#define FRAG_JOURNAL_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define FRAG_JOURNAL_WINDOW 48
+#define FRAG_JOURNAL_EVERY  16
+
+#define FRAG_JOURNAL_BLANK  UINT64_MAX
+
+struct frag_journal {
+    uint16_t base;      /* First fragment of the open window */
+    uint64_t mask;      /* Its fragments in place */
+    uint8_t pending;    /* ...not written yet */
+};
+
+enum frag_journal_type {
+    FRAG_JOURNAL_END,
+    FRAG_JOURNAL_FRAGS,
+    FRAG_JOURNAL_ERASED,
+};
+
+void frag_journal_init(struct frag_journal *j);
+
+/**
+ * Note fragment idx in place
+ * Returns true if *rec must be appended now
+ */
+bool frag_journal_add(struct frag_journal *j, uint16_t idx, uint64_t *rec);
+
+/**
+ * Record of an erased page
+ */
+uint64_t frag_journal_erased(uint16_t page);
+
+/**
+ * Decode a record: the window base and its mask, or the page in *base
+ */
+enum frag_journal_type frag_journal_parse(uint64_t rec, uint16_t *base, uint64_t *mask);
+
+#endif /* FRAG_JOURNAL_H_ */
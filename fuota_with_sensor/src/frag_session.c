@@ -0,0 +1,668 @@
+/*
+ * Fragmented data block transport (LoRaWAN TS004 v1.0.0) into slot1
+ *
+ * Fragments are written at their place in slot1, then one page for the
+ * journal (see frag_journal.h) from the end of the block rounded up to a
+ * page, then the edges, then the rows. Pages are erased the first time a
+ * session writes to them, rather than the whole slot at setup, so the
+ * downlink handler never blocks the stack for more than a page erase.
+ * Solving the missing fragments and erasing the rest of the slot take
+ * seconds; they are left to frag_session_finish() in the caller's thread.
+ *
+ * A write block is programmed once, so with a fragment size that is not a
+ * multiple of it (239 B at US915 DR3) the block two fragments share cannot
+ * be written by the first one to arrive. Each fragment writes its whole
+ * blocks in place and its partial first and last block to its own record
+ * in the edges, blank around its bytes; the shared blocks are merged into
+ * place once the block is complete.
+ *
+ * The setup is kept in settings until the session ends. After a reset the
+ * journal and the rows rebuild the decoder, and a status answer tells the
+ * server how many fragments are still missing.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include <zephyr/drivers/flash.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/lorawan/lorawan.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/storage/flash_map.h>
+#include <zephyr/sys/byteorder.h>
+
+#include "frag_journal.h"
+#include "frag_session.h"
+#include "uplink.h"
+
+LOG_MODULE_REGISTER(frag_session, CONFIG_LORAWAN_SERVICES_LOG_LEVEL);
+
+#define SLOT_PARTITION slot1_partition
+
+/* Largest flash program unit supported */
+#define WRITE_BLOCK_MAX 16
+
+#define FRAG_PACKAGE_ID      3
+#define FRAG_PACKAGE_VERSION 1
+
+#define CMD_PACKAGE_VERSION 0x00
+#define CMD_STATUS          0x01
+#define CMD_SETUP           0x02
+#define CMD_DELETE          0x03
+#define CMD_DATA_FRAGMENT   0x08
+
+/* FragSessionSetupAns status bits */
+#define SETUP_ALGO_UNSUPPORTED  BIT(0)
+#define SETUP_NO_MEMORY         BIT(1)
+#define SETUP_INDEX_UNSUPPORTED BIT(2)
+
+/* FragSessionDeleteAns: no such session */
+#define DELETE_NO_SESSION BIT(2)
+
+/* FragSessionStatusAns: rows ran out */
+#define STATUS_NO_MEMORY BIT(0)
+
+/* Session setup, as kept in settings and compared whole */
+struct session_params {
+    uint32_t descriptor;
+    uint16_t nb_frag;
+    uint8_t frag_size;
+    uint8_t index;
+    uint8_t padding;
+} __packed;
+
+struct session {
+    bool active;
+    bool done;      /* Block complete or solvable, waiting for frag_session_finish() */
+    struct session_params params;
+    uint16_t received;
+    uint16_t resumed;
+};
+
+static struct frag_fec fec;
+static struct session session;
+static void (*finished_cb)(void);
+
+/* Setup of the session a reset cut short */
+static struct session_params saved;
+static bool saved_valid;
+
+static const struct flash_area *fa;
+static uint32_t page_size;
+static uint32_t journal_base;
+static uint32_t edges_base;
+static uint32_t edge_len;   /* Edge record of a fragment, 0 if aligned */
+static uint32_t rows_base;
+static uint64_t erased;   /* Pages of slot1 erased by this session */
+
+static struct frag_journal journal;
+static uint16_t journal_len;
+
+BUILD_ASSERT(FIXED_PARTITION_SIZE(SLOT_PARTITION) / 2048 <= 64, "erased bitmap too small");
+
+static int params_set(const char *name, size_t len, settings_read_cb read_cb, void *cb_arg)
+{
+    ssize_t ret;
+
+    if (strcmp(name, "session") != 0) {
+        return -ENOENT;
+    }
+    if (len != sizeof(saved)) {
+        return -EINVAL;
+    }
+
+    ret = read_cb(cb_arg, &saved, sizeof(saved));
+    if (ret < 0) {
+        return ret;
+    }
+    saved_valid = true;
+    return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(frag_session, "frag", NULL, params_set, NULL, NULL);
+
+/**
+ * Append a record to the journal; once its page is full the session goes
+ * on, a reset only loses more of it
+ */
+static void journal_append(uint64_t rec)
+{
+    uint8_t buf[sizeof(rec)];
+    int ret;
+
+    if ((journal_len + 1) * sizeof(rec) > page_size) {
+        return;
+    }
+    sys_put_le64(rec, buf);
+    ret = flash_area_write(fa, journal_base + journal_len * sizeof(rec), buf, sizeof(buf));
+    if (ret < 0) {
+        LOG_ERR("Journal write failed: %d", ret);
+    }
+    journal_len++;
+}
+
+/**
+ * Erase the pages of [off, off + len) this session has not written yet
+ */
+static int prepare(uint32_t off, size_t len)
+{
+    for (uint32_t p = off / page_size; p <= (off + len - 1) / page_size; p++) {
+        if (erased & BIT64(p)) {
+            continue;
+        }
+        int ret = flash_area_erase(fa, p * page_size, page_size);
+
+        if (ret < 0) {
+            return ret;
+        }
+        erased |= BIT64(p);
+        journal_append(frag_journal_erased(p));
+    }
+    return 0;
+}
+
+/* Fragment idx spans the whole write blocks [lo, hi) and partial ones around */
+static void frag_span(uint16_t idx, size_t len, uint32_t *off, uint32_t *lo, uint32_t *hi)
+{
+    size_t align = flash_area_align(fa);
+
+    *off = (uint32_t)idx * len;
+    *lo = ROUND_UP(*off, align);
+    *hi = ROUND_DOWN(*off + len, align);
+}
+
+static int read_frag(void *ctx, uint16_t idx, uint8_t *buf, size_t len)
+{
+    uint8_t edge[2 * WRITE_BLOCK_MAX];
+    size_t align = flash_area_align(fa);
+    uint32_t off, lo, hi;
+    int ret;
+
+    ARG_UNUSED(ctx);
+    frag_span(idx, len, &off, &lo, &hi);
+    ret = flash_area_read(fa, lo, &buf[lo - off], hi - lo);
+    if (ret < 0 || edge_len == 0) {
+        return ret;
+    }
+
+    ret = flash_area_read(fa, edges_base + idx * edge_len, edge, edge_len);
+    if (ret < 0) {
+        return ret;
+    }
+    memcpy(buf, &edge[align - (lo - off)], lo - off);
+    memcpy(&buf[hi - off], &edge[align], off + len - hi);
+    return 0;
+}
+
+/**
+ * Write whole blocks that may already be in place from before a reset, or
+ * partly: blocks are programmed whole, so only the blank tail is written
+ */
+static int write_blocks(uint32_t off, const uint8_t *buf, size_t len)
+{
+    uint8_t cur[FRAG_FEC_MAX_SIZE];
+    size_t align = flash_area_align(fa);
+    size_t same = 0;
+    int ret = prepare(off, len);
+
+    if (ret == 0) {
+        ret = flash_area_read(fa, off, cur, len);
+    }
+    if (ret < 0) {
+        return ret;
+    }
+
+    while (same < len && memcmp(&cur[same], &buf[same], align) == 0) {
+        same += align;
+    }
+    for (size_t i = same; i < len; i++) {
+        if (cur[i] != 0xFF) {
+            return -EIO;
+        }
+    }
+    return (same == len) ? 0 : flash_area_write(fa, off + same, &buf[same], len - same);
+}
+
+static int write_frag(void *ctx, uint16_t idx, const uint8_t *buf, size_t len)
+{
+    uint8_t edge[2 * WRITE_BLOCK_MAX];
+    size_t align = flash_area_align(fa);
+    uint32_t off, lo, hi;
+    int ret = 0;
+
+    ARG_UNUSED(ctx);
+    frag_span(idx, len, &off, &lo, &hi);
+    if (hi > lo) {
+        ret = write_blocks(lo, &buf[lo - off], hi - lo);
+    }
+    if (ret < 0 || edge_len == 0) {
+        return ret;
+    }
+
+    memset(edge, 0xFF, edge_len);
+    memcpy(&edge[align - (lo - off)], buf, lo - off);
+    memcpy(&edge[align], &buf[hi - off], off + len - hi);
+    return write_blocks(edges_base + idx * edge_len, edge, edge_len);
+}
+
+/**
+ * Write the blocks fragments share from the edges of both, blank bytes
+ * ANDed with the other's data
+ */
+static int merge_edges(void)
+{
+    uint8_t edge[2 * WRITE_BLOCK_MAX];
+    uint8_t next[2 * WRITE_BLOCK_MAX];
+    size_t align = flash_area_align(fa);
+    uint16_t nb_frag = session.params.nb_frag;
+    uint8_t frag_size = session.params.frag_size;
+
+    for (uint16_t idx = 0; idx < nb_frag && edge_len > 0; idx++) {
+        uint32_t off, lo, hi;
+        int ret;
+
+        frag_span(idx, frag_size, &off, &lo, &hi);
+        if (hi == off + frag_size) {
+            continue;
+        }
+        ret = flash_area_read(fa, edges_base + idx * edge_len, edge, edge_len);
+        if (ret == 0 && idx + 1 < nb_frag) {
+            ret = flash_area_read(fa, edges_base + (idx + 1) * edge_len, next, edge_len);
+            for (size_t i = 0; i < align; i++) {
+                edge[align + i] &= next[i];
+            }
+        }
+        if (ret == 0) {
+            ret = write_blocks(hi, &edge[align], align);
+        }
+        if (ret < 0) {
+            return ret;
+        }
+    }
+    return 0;
+}
+
+static int read_row(void *ctx, uint16_t row, uint8_t *buf, size_t len)
+{
+    uint32_t off = rows_base + (uint32_t)row * len;
+
+    ARG_UNUSED(ctx);
+    if (!(erased & BIT64(off / page_size))) {
+        /* Not written by this session, whatever the page holds */
+        memset(buf, 0xFF, len);
+        return 0;
+    }
+    return flash_area_read(fa, off, buf, len);
+}
+
+static int write_row(void *ctx, uint16_t row, const uint8_t *buf, size_t len)
+{
+    uint32_t off = rows_base + (uint32_t)row * len;
+    int ret = prepare(off, len);
+
+    ARG_UNUSED(ctx);
+    return (ret < 0) ? ret : flash_area_write(fa, off, buf, len);
+}
+
+static const struct frag_fec_io fec_io = {NULL, read_frag, write_frag, read_row, write_row};
+
+static void answer(const uint8_t *data, uint8_t len)
+{
+    int ret = uplink_enqueue(UPLINK_CLASS_FRAG, data, len, k_uptime_get_32());
+
+    if (ret < 0) {
+        LOG_ERR("Fragmentation answer %02x dropped: %d", data[0], ret);
+    }
+}
+
+static void status_answer(void)
+{
+    uint16_t missing = frag_fec_missing(&fec);
+    uint8_t ans[5];
+
+    ans[0] = CMD_STATUS;
+    sys_put_le16((MIN(session.received, 0x3FFF)) | (session.params.index << 14), &ans[1]);
+    ans[3] = MIN(missing, UINT8_MAX);
+    ans[4] = (fec.stats.no_room > 0) ? STATUS_NO_MEMORY : 0;
+    answer(ans, 5);
+}
+
+/* The session is over for a reset too */
+static void forget(void)
+{
+    int ret = settings_delete("frag/session");
+
+    if (ret < 0) {
+        LOG_ERR("Deleting the session setup failed: %d", ret);
+    }
+}
+
+/**
+ * Slot1 layout and decoder for the session params
+ */
+static void open_session(void)
+{
+    uint16_t nb_frag = session.params.nb_frag;
+    uint8_t frag_size = session.params.frag_size;
+
+    journal_base = ROUND_UP((uint32_t)nb_frag * frag_size, page_size);
+    edges_base = journal_base + page_size;
+    edge_len = (frag_size % flash_area_align(fa) != 0) ? 2 * flash_area_align(fa) : 0;
+    rows_base = edges_base + nb_frag * edge_len;
+    frag_fec_init(&fec, &fec_io, nb_frag, frag_size,
+                  (fa->fa_size - rows_base) / frag_fec_row_len(nb_frag, frag_size));
+    frag_journal_init(&journal);
+    journal_len = 0;
+    erased = BIT64(journal_base / page_size);
+}
+
+/**
+ * Every fragment is in place or can be solved: stop taking fragments and
+ * hand the block over
+ */
+static void complete(void)
+{
+    session.done = true;
+    LOG_INF("Fragmentation session %u complete: %u received, %u rows", session.params.index,
+            session.received, fec.rows);
+    if (finished_cb != NULL) {
+        finished_cb();
+    }
+}
+
+int frag_session_finish(void)
+{
+    int ret;
+
+    if (!session.active || !session.done) {
+        return -ENOENT;
+    }
+
+    ret = frag_fec_solve(&fec);
+    if (ret == 0) {
+        ret = merge_edges();
+    }
+    if (ret < 0) {
+        /* Kept in settings: the next start resumes and solves again */
+        LOG_ERR("Rebuilding the block failed: %d", ret);
+        return ret;
+    }
+    forget();
+    session.active = false;
+
+    /* The journal, the edges, the rows, and the MCUboot trailer at the end of the slot */
+    ret = flash_area_erase(fa, journal_base, fa->fa_size - journal_base);
+    if (ret < 0) {
+        LOG_ERR("Erasing the FEC rows failed: %d", ret);
+        return ret;
+    }
+    LOG_INF("Fragmentation session %u finished: %u fragments rebuilt", session.params.index,
+            fec.stats.solved);
+    return 0;
+}
+
+static uint8_t setup(const uint8_t *req)
+{
+    uint8_t index = (req[0] >> 4) & 0x03;
+    uint16_t nb_frag = sys_get_le16(&req[1]);
+    uint8_t frag_size = req[3];
+    uint8_t algo = (req[4] >> 3) & 0x07;
+    uint8_t status = 0;
+    size_t align = flash_area_align(fa);
+    uint32_t edges = (frag_size % align != 0) ? nb_frag * 2 * align : 0;
+    struct session_params params = {
+        .descriptor = sys_get_le32(&req[6]),
+        .nb_frag = nb_frag,
+        .frag_size = frag_size,
+        .index = index,
+        .padding = req[5],
+    };
+    int ret;
+
+    if (algo != 0) {
+        status |= SETUP_ALGO_UNSUPPORTED;
+    }
+    if (session.active && !session.done && session.params.index != index) {
+        status |= SETUP_INDEX_UNSUPPORTED;
+    }
+    /* Slot1 holds a complete block until frag_session_finish() took it */
+    if (session.active && session.done) {
+        status |= SETUP_NO_MEMORY;
+    }
+    if (nb_frag == 0 || nb_frag > FRAG_FEC_MAX_FRAGS || frag_size < align ||
+        frag_size > FRAG_FEC_MAX_SIZE || align > WRITE_BLOCK_MAX ||
+        ROUND_UP((uint32_t)nb_frag * frag_size, page_size) + page_size + edges > fa->fa_size) {
+        status |= SETUP_NO_MEMORY;
+    }
+    if (status != 0) {
+        return status | (index << 6);
+    }
+
+    /* The same setup again, as after a reset: carry on where it was */
+    if (session.active && !session.done && memcmp(&params, &session.params, sizeof(params)) == 0) {
+        LOG_INF("Fragmentation session %u set up again, %u fragments missing", index,
+                frag_fec_missing(&fec));
+        return index << 6;
+    }
+
+    session = (struct session){
+        .active = true,
+        .params = params,
+    };
+    open_session();
+
+    /* Journal blank before the setup is kept, a stale one is never replayed */
+    ret = flash_area_erase(fa, journal_base, page_size);
+    if (ret == 0) {
+        ret = settings_save_one("frag/session", &params, sizeof(params));
+    }
+    if (ret < 0) {
+        LOG_ERR("Keeping the session setup failed: %d", ret);
+        session.active = false;
+        return SETUP_NO_MEMORY | (index << 6);
+    }
+
+    LOG_INF("Fragmentation session %u: %u fragments of %u B, room for %u rows", index,
+            nb_frag, frag_size, fec.max_rows);
+    return index << 6;
+}
+
+static void data_fragment(const uint8_t *req, uint8_t len)
+{
+    uint16_t index_and_n = sys_get_le16(req);
+    uint16_t n = index_and_n & 0x3FFF;
+    uint16_t uncoded = fec.stats.uncoded;
+    uint64_t rec;
+    int ret;
+
+    if (!session.active || (index_and_n >> 14) != session.params.index || session.done) {
+        return;
+    }
+
+    session.received++;
+    ret = frag_fec_put(&fec, n, &req[2], len - 2);
+    if (ret < 0) {
+        LOG_ERR("Fragment %u: %d", n, ret);
+        return;
+    }
+    if (fec.stats.uncoded != uncoded && frag_journal_add(&journal, n - 1, &rec)) {
+        journal_append(rec);
+    }
+    if (ret == 1) {
+        complete();
+    }
+}
+
+/**
+ * Rebuild the session kept in settings from the journal and the rows
+ */
+static void resume(void)
+{
+    uint8_t buf[sizeof(uint64_t)];
+    uint64_t mask;
+    uint16_t base;
+    int ret;
+
+    session = (struct session){
+        .active = true,
+        .params = saved,
+    };
+    open_session();
+
+    while ((journal_len + 1) * sizeof(buf) <= page_size) {
+        ret = flash_area_read(fa, journal_base + journal_len * sizeof(buf), buf, sizeof(buf));
+        if (ret < 0) {
+            break;
+        }
+
+        enum frag_journal_type type = frag_journal_parse(sys_get_le64(buf), &base, &mask);
+
+        if (type == FRAG_JOURNAL_END) {
+            break;
+        }
+        if (type == FRAG_JOURNAL_ERASED) {
+            erased |= BIT64(base);
+        }
+        for (int k = 0; type == FRAG_JOURNAL_FRAGS && k < FRAG_JOURNAL_WINDOW; k++) {
+            if (mask & BIT64(k)) {
+                frag_fec_mark(&fec, base + k);
+            }
+        }
+        journal_len++;
+    }
+
+    ret = frag_fec_resume(&fec);
+    session.resumed = session.params.nb_frag - frag_fec_missing(&fec);
+    LOG_INF("Fragmentation session %u resumed: %u of %u fragments kept, %u rows",
+            session.params.index, session.resumed, session.params.nb_frag, fec.rows);
+    if (ret < 0) {
+        LOG_ERR("Resuming failed: %d", ret);
+        session.active = false;
+        forget();
+    } else if (ret == 1) {
+        complete();
+    } else {
+        /* Unsolicited: the server sends about as many coded fragments */
+        status_answer();
+    }
+}
+
+static void frag_downlink(uint8_t port, uint8_t flags, int16_t rssi, int8_t snr, uint8_t len,
+                          const uint8_t *data)
+{
+    uint8_t ans[5];
+
+    ARG_UNUSED(port);
+    ARG_UNUSED(flags);
+    ARG_UNUSED(rssi);
+    ARG_UNUSED(snr);
+
+    if (len == 0 || fa == NULL) {
+        return;
+    }
+
+    switch (data[0]) {
+    case CMD_PACKAGE_VERSION:
+        ans[0] = CMD_PACKAGE_VERSION;
+        ans[1] = FRAG_PACKAGE_ID;
+        ans[2] = FRAG_PACKAGE_VERSION;
+        answer(ans, 3);
+        break;
+
+    case CMD_STATUS: {
+        uint8_t index = (len > 1) ? (data[1] >> 1) & 0x03 : 0;
+        bool all = (len > 1) && (data[1] & BIT(0));
+
+        if (!session.active || index != session.params.index ||
+            (!all && frag_fec_missing(&fec) == 0)) {
+            break;
+        }
+        status_answer();
+        break;
+    }
+
+    case CMD_SETUP:
+        if (len >= 11) {
+            ans[0] = CMD_SETUP;
+            ans[1] = setup(&data[1]);
+            answer(ans, 2);
+        }
+        break;
+
+    case CMD_DELETE: {
+        uint8_t index = (len > 1) ? data[1] & 0x03 : 0;
+
+        ans[0] = CMD_DELETE;
+        ans[1] = index;
+        /* A complete block is the caller's already */
+        if (session.active && !session.done && session.params.index == index) {
+            session.active = false;
+            forget();
+        } else {
+            ans[1] |= DELETE_NO_SESSION;
+        }
+        answer(ans, 2);
+        break;
+    }
+
+    case CMD_DATA_FRAGMENT:
+        if (len > 3) {
+            data_fragment(&data[1], len - 1);
+        }
+        break;
+
+    default:
+        LOG_WRN("Unknown fragmentation command %02x", data[0]);
+        break;
+    }
+}
+
+static struct lorawan_downlink_cb downlink_cb = {
+    .port = FRAG_SESSION_PORT,
+    .cb = frag_downlink,
+};
+
+void frag_session_start(void (*finished)(void))
+{
+    struct flash_pages_info info;
+    int ret;
+
+    finished_cb = finished;
+
+    ret = flash_area_open(FIXED_PARTITION_ID(SLOT_PARTITION), &fa);
+    if (ret == 0) {
+        ret = flash_get_page_info_by_offs(FIXED_PARTITION_DEVICE(SLOT_PARTITION),
+                                          FIXED_PARTITION_OFFSET(SLOT_PARTITION), &info);
+    }
+    if (ret < 0) {
+        LOG_ERR("slot1 unavailable (%d), no FUOTA", ret);
+        fa = NULL;
+        return;
+    }
+    page_size = info.size;
+
+    ret = settings_load_subtree("frag");
+    if (ret < 0) {
+        LOG_WRN("Loading the session setup failed: %d", ret);
+    }
+    if (saved_valid) {
+        resume();
+    }
+
+    lorawan_register_downlink_callback(&downlink_cb);
+}
+
+void frag_session_get_stats(struct frag_session_stats *stats)
+{
+    stats->nb_frag = fec.nb_frag;
+    stats->frag_size = fec.frag_size;
+    stats->rows = fec.rows;
+    stats->max_rows = fec.max_rows;
+    stats->received = session.received;
+    stats->resumed = session.resumed;
+    stats->missing = session.active ? frag_fec_missing(&fec) : 0;
+    stats->fec = fec.stats;
+}
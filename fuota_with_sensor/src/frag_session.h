@@ -0,0 +1,56 @@
+/*
+ * Fragmented data block transport (LoRaWAN TS004 v1.0.0) into slot1
+ *
+ * Replaces the Zephyr fragmented transport (CONFIG_LORAWAN_FRAG_TRANSPORT)
+ * so reassembly can keep its FEC rows in flash (see frag_fec.h): the rows
+ * go to slot1 behind the block, in the part of the slot the image does not
+ * use. Redundancy is then bounded by that space, not by RAM. Answers go out
+ * as UPLINK_CLASS_FRAG frames on FPort 201.
+ *
+ * One session at a time, with fragments from the 8 byte flash write block
+ * up to FRAG_FEC_MAX_SIZE. A session survives a reset: it is resumed at
+ * start, and the same setup sent again carries on with it.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef FRAG_SESSION_H_
+#define FRAG_SESSION_H_
+
+#include <stdint.h>
+
+#include "frag_fec.h"
+
+#define FRAG_SESSION_PORT 201
+
+struct frag_session_stats {
+    uint16_t nb_frag;
+    uint8_t frag_size;
+    uint16_t rows;          /* FEC rows kept */
+    uint16_t max_rows;      /* FEC rows the free part of slot1 holds */
+    uint16_t received;      /* Data fragments of the session received */
+    uint16_t resumed;       /* Fragments kept across a reset */
+    uint16_t missing;       /* Fragments still needed */
+    struct frag_fec_stats fec;
+};
+
+/**
+ * Handle the fragmentation package on its port, resuming a session a reset
+ * cut short; finished is called from the LoRaWAN stack context once every
+ * fragment of a block is in slot1 or can be rebuilt, or from here if
+ * resuming gets that far. It must not block, see frag_session_finish().
+ */
+void frag_session_start(void (*finished)(void));
+
+/**
+ * Rebuild the missing fragments of the block and erase the rest of slot1,
+ * which takes seconds; call it from a thread of the application once
+ * finished was called. A new session can be set up afterwards.
+ * Returns 0 if slot1 holds the whole block, -ENOENT if no block is
+ * complete, negative flash error (the session is resumed at the next start)
+ */
+int frag_session_finish(void);
+
+void frag_session_get_stats(struct frag_session_stats *stats);
+
+#endif /* FRAG_SESSION_H_ */
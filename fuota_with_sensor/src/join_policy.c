@@ -0,0 +1,112 @@
+/*
+ * OTAA join retry policy
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include "join_policy.h"
+
+/* Backoff stops doubling here, far beyond any sane cap */
+#define MAX_DOUBLINGS 20
+
+static uint32_t next_rand(struct join_policy *p)
+{
+    /* xorshift32, only needs to differ between nodes */
+    p->rng ^= p->rng << 13;
+    p->rng ^= p->rng >> 17;
+    p->rng ^= p->rng << 5;
+    return p->rng;
+}
+
+static uint32_t rand_upto(struct join_policy *p, uint32_t max)
+{
+    return (max == UINT32_MAX) ? next_rand(p) : next_rand(p) % (max + 1);
+}
+
+void join_policy_init(struct join_policy *p, const struct join_policy_cfg *cfg, uint32_t seed)
+{
+    memset(p, 0, sizeof(*p));
+    p->cfg = *cfg;
+    if (p->cfg.nbands == 0) {
+        p->cfg.nbands = 1;
+    } else if (p->cfg.nbands > JOIN_POLICY_MAX_BANDS) {
+        p->cfg.nbands = JOIN_POLICY_MAX_BANDS;
+    }
+    if (p->cfg.band_tries == 0) {
+        p->cfg.band_tries = 1;
+    }
+    p->rng = (seed != 0) ? seed : 0x2545F491;
+    join_policy_set_preferred(p, p->cfg.default_band);
+}
+
+void join_policy_set_preferred(struct join_policy *p, uint8_t band)
+{
+    uint8_t n = p->cfg.nbands;
+    uint8_t i = 0;
+
+    band %= n;
+    p->order[i++] = band;
+    if (p->cfg.default_band != band && p->cfg.default_band < n) {
+        p->order[i++] = p->cfg.default_band;
+    }
+    for (uint8_t b = 0; b < n; b++) {
+        if (b != band && b != p->cfg.default_band) {
+            p->order[i++] = b;
+        }
+    }
+}
+
+uint32_t join_policy_next(struct join_policy *p, uint8_t *band)
+{
+    uint32_t failures = p->stats.failures;
+    uint32_t bands_tried = failures / p->cfg.band_tries;
+    uint32_t backoff;
+
+    p->band = p->order[bands_tried % p->cfg.nbands];
+    *band = p->band;
+    p->stats.attempts++;
+
+    if (failures == 0) {
+        return rand_upto(p, p->cfg.first_max_ms);
+    }
+
+    bands_tried = (bands_tried < MAX_DOUBLINGS) ? bands_tried : MAX_DOUBLINGS;
+    backoff = ((uint64_t)p->cfg.base_ms << bands_tried > p->cfg.max_ms) ?
+              p->cfg.max_ms : p->cfg.base_ms << bands_tried;
+
+    return backoff / 2 + rand_upto(p, backoff - backoff / 2);
+}
+
+void join_policy_failed(struct join_policy *p)
+{
+    p->stats.failures++;
+}
+
+void join_policy_joined(struct join_policy *p)
+{
+    p->stats.failures = 0;
+    p->stats.joins++;
+}
+
+void join_policy_us915_mask(uint8_t band, uint16_t mask[JOIN_POLICY_US915_MASK_SIZE])
+{
+    memset(mask, 0, JOIN_POLICY_US915_MASK_SIZE * sizeof(mask[0]));
+    band &= JOIN_POLICY_MAX_BANDS - 1;
+    mask[band / 2] = (uint16_t)(0x00FF << (8 * (band % 2)));
+    mask[4] = (uint16_t)(1 << band);
+}
+
+int join_policy_us915_band(const uint16_t mask[JOIN_POLICY_US915_MASK_SIZE])
+{
+    uint16_t expect[JOIN_POLICY_US915_MASK_SIZE];
+
+    for (uint8_t band = 0; band < JOIN_POLICY_MAX_BANDS; band++) {
+        join_policy_us915_mask(band, expect);
+        if (memcmp(mask, expect, sizeof(expect)) == 0) {
+            return band;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,89 @@
+/*
+ * OTAA join retry policy
+ *
+ * Decides when the next join request goes out and on which sub-band:
+ * - the first attempt waits a random time, so a building full of nodes
+ *   powering up together does not join in the same second
+ * - the backoff doubles up to a cap with each sub-band tried, with equal
+ *   jitter (half fixed, half random) so retries stay spread out
+ * - US915: band_tries attempts run on one 8-channel sub-band, the one that
+ *   worked last time first, then the network default, then the rest in
+ *   ascending order. Most gateways only listen on one sub-band, so a join
+ *   on all 72 channels mostly goes unheard.
+ * The data rate is left to the stack: on US915 LoRaMAC alternates join
+ * requests between DR0 on the 125 kHz channels and DR4 on the 500 kHz one
+ * whatever DR is asked for, so two tries per sub-band cover both. Has no
+ * Zephyr dependency so it also builds on the host (see tests_host).
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef JOIN_POLICY_H_
+#define JOIN_POLICY_H_
+
+#include <stdint.h>
+
+#define JOIN_POLICY_MAX_BANDS 8
+
+/* US915 channel mask: 4 words of 125 kHz channels, 500 kHz channels, pad */
+#define JOIN_POLICY_US915_MASK_SIZE 6
+
+struct join_policy_cfg {
+    uint32_t first_max_ms;   /* Random delay before the first attempt, 0..this */
+    uint32_t base_ms;        /* Backoff after the first failure */
+    uint32_t max_ms;         /* Backoff cap */
+    uint8_t band_tries;      /* Attempts per sub-band, 0 for 1 */
+    uint8_t nbands;          /* Sub-bands to hunt, 0 or 1 for none */
+    uint8_t default_band;    /* First band without a preferred one */
+};
+
+struct join_policy_stats {
+    uint32_t attempts;       /* join_policy_next() calls */
+    uint32_t failures;       /* Failed attempts since the last join */
+    uint32_t joins;
+};
+
+struct join_policy {
+    struct join_policy_cfg cfg;
+    uint32_t rng;
+    uint8_t order[JOIN_POLICY_MAX_BANDS];   /* Hunt order */
+    uint8_t band;                           /* Band of the last planned attempt */
+    struct join_policy_stats stats;
+};
+
+/**
+ * seed: any value, e.g. from the entropy source; 0 is replaced
+ */
+void join_policy_init(struct join_policy *p, const struct join_policy_cfg *cfg, uint32_t seed);
+
+/**
+ * Hunt band first, e.g. the one persisted after the last join
+ */
+void join_policy_set_preferred(struct join_policy *p, uint8_t band);
+
+/**
+ * Plan the next attempt
+ * Returns the delay before it in ms, *band its sub-band
+ */
+uint32_t join_policy_next(struct join_policy *p, uint8_t *band);
+
+void join_policy_failed(struct join_policy *p);
+
+/**
+ * Joined: the next join, e.g. after the session was lost, starts over
+ */
+void join_policy_joined(struct join_policy *p);
+
+/**
+ * US915 channel mask enabling the eight 125 kHz channels and the 500 kHz
+ * channel of one sub-band (0..7)
+ */
+void join_policy_us915_mask(uint8_t band, uint16_t mask[JOIN_POLICY_US915_MASK_SIZE]);
+
+/**
+ * Sub-band a mask from join_policy_us915_mask() enables
+ * Returns the band, -1 if the mask is not a single sub-band
+ */
+int join_policy_us915_band(const uint16_t mask[JOIN_POLICY_US915_MASK_SIZE]);
+
+#endif /* JOIN_POLICY_H_ */
@@ -0,0 +1,288 @@
+/*
+ * Background LoRaWAN link bring-up
+ *
+ * lorawan_join() blocks for the join request and both receive windows, and
+ * a failed join used to end main(). Here it runs in a thread of its own that
+ * keeps retrying with backoff and jitter until the join succeeds.
+ *
+ * Each attempt is restricted to one US915 sub-band. The channel mask of the
+ * sub-band that joined is saved in settings, so after a reboot the first
+ * attempt goes out on the sub-band the gateway listens on.
+ *
+ * With CONFIG_LORAWAN_NVM_SETTINGS, lorawan_start() restores the session and
+ * frame counters saved before a reset. The link then comes up at once and
+ * skips the join. A link check on the first uplinks verifies that the network
+ * still knows the session. If none is answered, the session is dropped and the
+ * node joins again.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/random/random.h>
+#include <zephyr/settings/settings.h>
+
+#include <LoRaMac.h>
+
+#include "join_policy.h"
+#include "lora_link.h"
+
+LOG_MODULE_REGISTER(lora_link, CONFIG_LORAWAN_SERVICES_LOG_LEVEL);
+
+#define LORA_LINK_STACK_SIZE 2048
+#define LORA_LINK_PRIORITY   8
+
+/* Spread a site-wide power-up over a minute, back off up to 30 minutes */
+static const struct join_policy_cfg policy_cfg = {
+    .first_max_ms = 60 * 1000,
+    .base_ms = 15 * 1000,
+    .max_ms = 30 * 60 * 1000,
+    .band_tries = 2,
+    .nbands = JOIN_POLICY_MAX_BANDS,
+    .default_band = LORA_LINK_DEFAULT_SUBBAND - 1,
+};
+
+/* Channel mask of the last join, -1 when none was saved */
+static uint16_t saved_mask[JOIN_POLICY_US915_MASK_SIZE];
+static int saved_band = -1;
+
+static const struct lorawan_join_config *join_cfg;
+static lora_link_up_cb up_cb;
+static struct join_policy policy;
+static struct lora_link_stats stats;
+static atomic_t link_up;
+static atomic_t started;
+
+K_SEM_DEFINE(link_check_sem, 0, 1);
+
+static int chmask_set(const char *name, size_t len, settings_read_cb read_cb, void *cb_arg)
+{
+    ssize_t ret;
+
+    if (strcmp(name, "chmask") != 0) {
+        return -ENOENT;
+    }
+    if (len != sizeof(saved_mask)) {
+        return -EINVAL;
+    }
+
+    ret = read_cb(cb_arg, saved_mask, sizeof(saved_mask));
+    if (ret < 0) {
+        return ret;
+    }
+    saved_band = join_policy_us915_band(saved_mask);
+    return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(lora_link, "lora_link", NULL, chmask_set, NULL, NULL);
+
+static void load_band(void)
+{
+    int ret = settings_subsys_init();
+
+    if (ret == 0) {
+        ret = settings_load_subtree("lora_link");
+    }
+    if (ret < 0) {
+        LOG_WRN("Loading the channel mask failed: %d", ret);
+    }
+
+    if (saved_band >= 0) {
+        LOG_INF("Hunting from saved sub-band %d", saved_band + 1);
+        join_policy_set_preferred(&policy, (uint8_t)saved_band);
+    }
+}
+
+/**
+ * Keep the mask of the sub-band that joined, written only when it changed
+ */
+static void save_band(uint8_t band)
+{
+    int ret;
+
+    if (saved_band == band) {
+        return;
+    }
+
+    join_policy_us915_mask(band, saved_mask);
+    ret = settings_save_one("lora_link/chmask", saved_mask, sizeof(saved_mask));
+    if (ret < 0) {
+        LOG_ERR("Saving the channel mask failed: %d", ret);
+        return;
+    }
+    saved_band = band;
+}
+
+static void set_band(uint8_t band)
+{
+    uint16_t mask[JOIN_POLICY_US915_MASK_SIZE];
+    int ret;
+
+    join_policy_us915_mask(band, mask);
+    ret = lorawan_set_channels_mask(mask, ARRAY_SIZE(mask));
+    if (ret < 0) {
+        LOG_ERR("lorawan_set_channels_mask failed: %d", ret);
+    }
+}
+
+/**
+ * Whether lorawan_start() restored an activated session from settings
+ */
+static bool session_restored(void)
+{
+    MibRequestConfirm_t mib = {.Type = MIB_NETWORK_ACTIVATION};
+
+    if (LoRaMacMibGetRequestConfirm(&mib) != LORAMAC_STATUS_OK) {
+        return false;
+    }
+    return mib.Param.NetworkActivation != ACTIVATION_TYPE_NONE;
+}
+
+static void link_check_ans(uint8_t demod_margin, uint8_t nb_gateways)
+{
+    LOG_INF("Link check: margin %u dB, %u gateways", demod_margin, nb_gateways);
+    k_sem_give(&link_check_sem);
+}
+
+/**
+ * Check that the network still accepts the restored session. The first
+ * request rides on the next regular uplink, later ones are sent on their own.
+ */
+static bool session_verified(void)
+{
+    k_sem_reset(&link_check_sem);
+    lorawan_register_link_check_ans_callback(link_check_ans);
+
+    for (int i = 0; i < LORA_LINK_CHECK_TRIES; i++) {
+        int ret = lorawan_request_link_check(i > 0);
+
+        if (ret < 0) {
+            LOG_ERR("lorawan_request_link_check failed: %d", ret);
+        }
+        if (k_sem_take(&link_check_sem, K_MSEC(LORA_LINK_CHECK_WAIT_MS)) == 0) {
+            return true;
+        }
+        LOG_WRN("Restored session: link check %d unanswered", i + 1);
+    }
+    return false;
+}
+
+static void link_is_up(void)
+{
+    stats.up_ms = k_uptime_get_32();
+    if (up_cb != NULL) {
+        up_cb();
+        /* Once: the services keep running across a re-join */
+        up_cb = NULL;
+    }
+    atomic_set(&link_up, 1);
+}
+
+/**
+ * DR the stack sent the last join request at. On US915 it picks the DR
+ * itself, alternating between 125 kHz and 500 kHz channels.
+ */
+static uint8_t join_datarate(void)
+{
+    MibRequestConfirm_t mib = {.Type = MIB_CHANNELS_DATARATE};
+
+    if (LoRaMacMibGetRequestConfirm(&mib) != LORAMAC_STATUS_OK) {
+        return stats.last_dr;
+    }
+    return (uint8_t)mib.Param.ChannelsDatarate;
+}
+
+/**
+ * Join over OTAA, retrying until it succeeds
+ */
+static void join(void)
+{
+    while (1) {
+        uint8_t band;
+        uint32_t delay = join_policy_next(&policy, &band);
+        int ret;
+
+        stats.next_delay_ms = delay;
+        stats.last_band = band + 1;
+        LOG_INF("Join attempt %u on sub-band %u in %u ms", policy.stats.attempts, band + 1,
+                delay);
+        k_msleep(delay);
+
+        set_band(band);
+
+        stats.attempts++;
+        ret = lorawan_join(join_cfg);
+        stats.last_dr = join_datarate();
+        if (ret == 0) {
+            break;
+        }
+
+        stats.failures++;
+        stats.last_err = ret;
+        join_policy_failed(&policy);
+        LOG_WRN("Join at DR%u failed: %d", stats.last_dr, ret);
+    }
+
+    join_policy_joined(&policy);
+    save_band(policy.band);
+    LOG_INF("Joined at DR%u on sub-band %u after %u attempts, %u ms after boot", stats.last_dr,
+            stats.last_band, stats.attempts, k_uptime_get_32());
+}
+
+static void lora_link_thread(void *p1, void *p2, void *p3)
+{
+    ARG_UNUSED(p1);
+    ARG_UNUSED(p2);
+    ARG_UNUSED(p3);
+
+    join_policy_init(&policy, &policy_cfg, sys_rand32_get());
+    load_band();
+
+    if (session_restored()) {
+        stats.restored = true;
+        LOG_INF("Session restored, join skipped");
+        link_is_up();
+        if (session_verified()) {
+            return;
+        }
+
+        LOG_WRN("Restored session rejected, joining again");
+        stats.restored = false;
+        stats.rejected++;
+        atomic_set(&link_up, 0);
+        join();
+        link_is_up();
+        return;
+    }
+
+    join();
+    link_is_up();
+}
+
+K_THREAD_DEFINE(lora_link_tid, LORA_LINK_STACK_SIZE, lora_link_thread, NULL, NULL, NULL,
+                LORA_LINK_PRIORITY, 0, SYS_FOREVER_MS);
+
+int lora_link_start(const struct lorawan_join_config *cfg, lora_link_up_cb up)
+{
+    if (!atomic_cas(&started, 0, 1)) {
+        return -EALREADY;
+    }
+
+    join_cfg = cfg;
+    up_cb = up;
+    k_thread_start(lora_link_tid);
+    return 0;
+}
+
+bool lora_link_is_up(void)
+{
+    return atomic_get(&link_up) != 0;
+}
+
+void lora_link_get_stats(struct lora_link_stats *out)
+{
+    *out = stats;
+}
@@ -0,0 +1,63 @@
+/*
+ * Background LoRaWAN link bring-up
+ *
+ * Joins over OTAA from its own thread, retrying per join_policy.h, so
+ * sampling starts at boot and never waits on the network.
+ *
+ * US915 only: joins hunt one 8-channel sub-band at a time, starting with
+ * the one saved by the last successful join.
+ *
+ * A session restored from settings after a reset brings the link up without
+ * a join. It is verified with link checks and replaced by a new join if the
+ * network does not answer.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef LORA_LINK_H_
+#define LORA_LINK_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <zephyr/lorawan/lorawan.h>
+
+/* Sub-band (1..8) hunted first when none was saved, 2 on most networks */
+#ifndef LORA_LINK_DEFAULT_SUBBAND
+#define LORA_LINK_DEFAULT_SUBBAND 2
+#endif
+
+/* Link checks on a restored session, each answered within the wait or a new join */
+#define LORA_LINK_CHECK_TRIES   3
+#define LORA_LINK_CHECK_WAIT_MS (150 * 1000)
+
+/**
+ * Called from the link thread once the link is up, joined or restored, e.g.
+ * to start the services. Called once even if a restored session is replaced
+ * by a join later.
+ */
+typedef void (*lora_link_up_cb)(void);
+
+struct lora_link_stats {
+    uint32_t attempts;        /* Join requests sent */
+    uint32_t failures;        /* ...that failed */
+    int last_err;             /* lorawan_join() result of the last failure */
+    uint8_t last_dr;          /* DR the stack sent the last request at */
+    uint8_t last_band;        /* Sub-band (1..8) of the last attempt */
+    uint32_t next_delay_ms;   /* Wait before the current attempt */
+    uint32_t up_ms;           /* Uptime when the link came up, 0 before */
+    bool restored;            /* Running on a session restored at boot */
+    uint32_t rejected;        /* Restored sessions the network did not answer */
+};
+
+/**
+ * Start joining in the background. cfg and the keys it points to must stay
+ * valid until the link is up.
+ * Returns 0 on success, -EALREADY if already started
+ */
+int lora_link_start(const struct lorawan_join_config *cfg, lora_link_up_cb up);
+
+bool lora_link_is_up(void);
+
+void lora_link_get_stats(struct lora_link_stats *stats);
+
+#endif /* LORA_LINK_H_ */
@@ -0,0 +1,213 @@
+/*
+ * Streaming LZ4 decoder for compressed FUOTA images
+ *
+ * A byte-wise state machine over the LZ4 sequence fields; literal runs are
+ * passed through in bulk.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "delta.h"
+#include "lz4s.h"
+
+enum {
+    ST_TOKEN,
+    ST_LIT_LEN,
+    ST_LIT,
+    ST_OFF_LO,
+    ST_OFF_HI,
+    ST_MATCH_LEN,
+    ST_DONE,
+    ST_ERROR,
+};
+
+static uint32_t get_le32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+int lz4s_parse_header(const uint8_t *buf, size_t len, struct lz4s_hdr *hdr)
+{
+    if (len < LZ4S_HDR_SIZE || get_le32(buf) != LZ4S_MAGIC) {
+        return -ENOMSG;
+    }
+
+    hdr->new_size = get_le32(&buf[4]);
+    hdr->new_crc = get_le32(&buf[8]);
+    hdr->comp_size = get_le32(&buf[12]);
+
+    if (hdr->new_size == 0 || hdr->comp_size <= LZ4S_HDR_SIZE) {
+        return -EINVAL;
+    }
+    return 0;
+}
+
+void lz4s_init(struct lz4s_dec *d, const struct lz4s_hdr *hdr, const struct lz4s_io *io)
+{
+    memset(d, 0, sizeof(*d));
+    d->hdr = *hdr;
+    d->io = io;
+    d->state = ST_TOKEN;
+}
+
+static int emit(struct lz4s_dec *d, const uint8_t *data, uint32_t len)
+{
+    d->crc = delta_crc32(d->crc, data, len);
+    d->out += len;
+    return d->io->write_out(d->io->ctx, data, len);
+}
+
+/* A sequence is complete: next one, or the end of the image */
+static int seq_done(struct lz4s_dec *d)
+{
+    if (d->out < d->hdr.new_size) {
+        d->state = ST_TOKEN;
+        return 0;
+    }
+    if (d->crc != d->hdr.new_crc) {
+        return -EBADMSG;
+    }
+    d->state = ST_DONE;
+    return 0;
+}
+
+/* The literals are written: the match follows, unless the image is complete */
+static int literals_done(struct lz4s_dec *d)
+{
+    if (d->out == d->hdr.new_size) {
+        return seq_done(d);
+    }
+    d->state = ST_OFF_LO;
+    return 0;
+}
+
+/* Add to a length, an image never has that many bytes left */
+static int add_len(struct lz4s_dec *d, uint32_t n)
+{
+    d->len += n;
+    return (d->len > d->hdr.new_size - d->out) ? -EINVAL : 0;
+}
+
+/**
+ * Copy the match from the bytes already written; an offset shorter than
+ * the length repeats them, so the chunks never reach past the output
+ */
+static int copy_match(struct lz4s_dec *d)
+{
+    if (add_len(d, 0) < 0) {
+        return -EINVAL;
+    }
+    while (d->len > 0) {
+        uint32_t n = d->len;
+        int ret;
+
+        n = (n < d->offset) ? n : d->offset;
+        n = (n < LZ4S_CHUNK) ? n : LZ4S_CHUNK;
+        ret = d->io->read_out(d->io->ctx, d->out - d->offset, d->buf, n);
+        if (ret < 0) {
+            return ret;
+        }
+        ret = emit(d, d->buf, n);
+        if (ret < 0) {
+            return ret;
+        }
+        d->len -= n;
+    }
+    return seq_done(d);
+}
+
+static int step(struct lz4s_dec *d, uint8_t b)
+{
+    switch (d->state) {
+    case ST_TOKEN:
+        d->token = b;
+        d->len = b >> 4;
+        if (d->len == 15) {
+            d->state = ST_LIT_LEN;
+        } else if (d->len > 0) {
+            d->state = ST_LIT;
+            return add_len(d, 0);
+        } else {
+            return literals_done(d);
+        }
+        return 0;
+
+    case ST_LIT_LEN:
+        if (add_len(d, b) < 0) {
+            return -EINVAL;
+        }
+        if (b == 255) {
+            return 0;
+        }
+        d->state = ST_LIT;
+        return 0;
+
+    case ST_OFF_LO:
+        d->offset = b;
+        d->state = ST_OFF_HI;
+        return 0;
+
+    case ST_OFF_HI:
+        d->offset |= (uint16_t)(b << 8);
+        if (d->offset == 0 || d->offset > d->out) {
+            return -EINVAL;
+        }
+        d->len = LZ4S_MIN_MATCH + (d->token & 0x0F);
+        if ((d->token & 0x0F) == 15) {
+            d->state = ST_MATCH_LEN;
+            return 0;
+        }
+        return copy_match(d);
+
+    case ST_MATCH_LEN:
+        d->len += b;
+        if (d->len > d->hdr.new_size) {
+            return -EINVAL;
+        }
+        return (b == 255) ? 0 : copy_match(d);
+
+    default:
+        return -EINVAL;
+    }
+}
+
+int lz4s_feed(struct lz4s_dec *d, const uint8_t *data, size_t len)
+{
+    size_t i = 0;
+
+    while (i < len && d->state != ST_DONE) {
+        int ret;
+
+        if (d->state == ST_ERROR) {
+            return -EINVAL;
+        }
+
+        if (d->state == ST_LIT) {
+            /* Literal run: straight through, no per-byte step */
+            uint32_t n = (len - i < d->len) ? (uint32_t)(len - i) : d->len;
+
+            ret = emit(d, &data[i], n);
+            i += n;
+            d->len -= n;
+            if (ret == 0 && d->len == 0) {
+                ret = literals_done(d);
+            }
+        } else {
+            ret = step(d, data[i++]);
+        }
+
+        if (ret < 0) {
+            d->state = ST_ERROR;
+            return ret;
+        }
+    }
+    return 0;
+}
+
+bool lz4s_done(const struct lz4s_dec *d)
+{
+    return d->state == ST_DONE;
+}
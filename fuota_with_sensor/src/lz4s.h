@@ -0,0 +1,89 @@
+/*
+ * Streaming LZ4 decoder for compressed FUOTA images
+ *
+ * A compressed image is the signed image as LZ4 block sequences, made by
+ * tools/mklz4 from zephyr.signed.bin:
+ * - header: "LZS1", new size, new CRC-32, compressed size (header
+ *   included), integers little-endian
+ * - LZ4 sequences until the new size is reached: token, literal length,
+ *   literals, 16 bit match offset, match length (see the LZ4 block format);
+ *   the last sequence has literals only
+ *
+ * LZ4 needs no dictionary in RAM: a match copies bytes already written, so
+ * the decoder reads them back through a callback, from the output flash.
+ * It takes the image in chunks of any size and has a fixed RAM footprint of
+ * a few dozen bytes and a LZ4S_CHUNK copy buffer. Has no Zephyr dependency
+ * so it also builds on the host (see tests_host); lz4s_flash.c binds it to
+ * slot1.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef LZ4S_H_
+#define LZ4S_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define LZ4S_MAGIC    0x31535A4C   /* "LZS1" */
+#define LZ4S_HDR_SIZE 16
+
+/* Farthest match, shortest match */
+#define LZ4S_WINDOW    65535
+#define LZ4S_MIN_MATCH 4
+
+/* Match bytes read back per callback */
+#define LZ4S_CHUNK 64
+
+struct lz4s_hdr {
+    uint32_t new_size;
+    uint32_t new_crc;
+    uint32_t comp_size;
+};
+
+struct lz4s_io {
+    void *ctx;
+    /* Read back new bytes already written */
+    int (*read_out)(void *ctx, uint32_t off, void *buf, size_t len);
+    int (*write_out)(void *ctx, const void *buf, size_t len);
+};
+
+struct lz4s_dec {
+    struct lz4s_hdr hdr;
+    const struct lz4s_io *io;
+    uint8_t state;
+    uint8_t token;
+    uint16_t offset;    /* Match being read */
+    uint32_t len;       /* Literals or match bytes of the current sequence */
+    uint32_t out;       /* New bytes written */
+    uint32_t crc;       /* CRC-32 of the new bytes, running */
+    uint8_t buf[LZ4S_CHUNK];
+};
+
+/**
+ * Parse a compressed image header
+ * Returns 0 on success, -ENOMSG if buf is not a compressed image, -EINVAL
+ * for an inconsistent header
+ */
+int lz4s_parse_header(const uint8_t *buf, size_t len, struct lz4s_hdr *hdr);
+
+/**
+ * Start decoding an image whose header was parsed; feed the sequences after it
+ */
+void lz4s_init(struct lz4s_dec *d, const struct lz4s_hdr *hdr, const struct lz4s_io *io);
+
+/**
+ * Feed the next compressed bytes
+ * Returns 0 on success, -EINVAL for a malformed stream or a match beyond
+ * the image, -EBADMSG if the new image does not match its CRC, callback
+ * errors
+ */
+int lz4s_feed(struct lz4s_dec *d, const uint8_t *data, size_t len);
+
+/**
+ * Whether the whole new image was written and matched its CRC
+ */
+bool lz4s_done(const struct lz4s_dec *d);
+
+#endif /* LZ4S_H_ */
@@ -0,0 +1,79 @@
+/*
+ * Compressed FUOTA images decoded in place in slot1
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/storage/flash_map.h>
+
+#include "lz4s_flash.h"
+#include "slot_inplace.h"
+
+LOG_MODULE_REGISTER(lz4s_flash, CONFIG_LORAWAN_SERVICES_LOG_LEVEL);
+
+#define SLOT_PARTITION slot1_partition
+
+int lz4s_flash_check(struct lz4s_hdr *hdr)
+{
+    const struct flash_area *fa;
+    uint8_t buf[LZ4S_HDR_SIZE];
+    int ret;
+
+    ret = flash_area_open(FIXED_PARTITION_ID(SLOT_PARTITION), &fa);
+    if (ret < 0) {
+        return ret;
+    }
+    ret = flash_area_read(fa, 0, buf, sizeof(buf));
+    flash_area_close(fa);
+    if (ret < 0) {
+        return ret;
+    }
+
+    ret = lz4s_parse_header(buf, sizeof(buf), hdr);
+    if (ret < 0) {
+        return (ret == -ENOMSG) ? ret : -EBADMSG;
+    }
+    if (hdr->new_size > FIXED_PARTITION_SIZE(SLOT_PARTITION) ||
+        hdr->comp_size > FIXED_PARTITION_SIZE(SLOT_PARTITION)) {
+        return -ENOSPC;
+    }
+    return 0;
+}
+
+static int feed(void *dec, const uint8_t *buf, size_t len)
+{
+    return lz4s_feed(dec, buf, len);
+}
+
+int lz4s_flash_apply(const struct lz4s_hdr *hdr, struct lz4s_flash_stats *stats)
+{
+    static struct slot_inplace slot;
+    static struct lz4s_dec dec;
+    const struct lz4s_io io = {&slot, slot_inplace_read_out, slot_inplace_write};
+    uint32_t start = k_uptime_get_32();
+    int ret;
+
+    ret = slot_inplace_start(&slot, hdr->comp_size);
+    stats->move_ms = k_uptime_get_32() - start;
+
+    if (ret == 0) {
+        lz4s_init(&dec, hdr, &io);
+        ret = slot_inplace_run(&slot, LZ4S_HDR_SIZE, feed, &dec);
+    }
+    if (ret == 0 && !lz4s_done(&dec)) {
+        ret = -EBADMSG;
+    }
+    ret = slot_inplace_finish(&slot, ret, hdr->new_size, hdr->new_crc);
+
+    stats->comp_size = hdr->comp_size;
+    stats->new_size = hdr->new_size;
+    stats->decode_ms = k_uptime_get_32() - start - stats->move_ms;
+    if (ret < 0) {
+        LOG_ERR("Decoding the compressed image failed: %d", ret);
+    }
+    return ret;
+}
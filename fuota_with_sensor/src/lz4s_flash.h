@@ -0,0 +1,41 @@
+/*
+ * Compressed FUOTA images decoded in place in slot1
+ *
+ * The fragmented data transport writes the compressed image (see lz4s.h)
+ * to the start of slot1, where it is decoded in place (see slot_inplace.h).
+ * The image only has to fit in the slot alongside the part of the input
+ * not read yet.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef LZ4S_FLASH_H_
+#define LZ4S_FLASH_H_
+
+#include <stdint.h>
+
+#include "lz4s.h"
+
+struct lz4s_flash_stats {
+    uint32_t comp_size;
+    uint32_t new_size;
+    uint32_t move_ms;     /* Moving the input to the end of the slot */
+    uint32_t decode_ms;   /* Decoding, erases and verification included */
+};
+
+/**
+ * Check whether slot1 holds a compressed image
+ * Returns 0 if so, -ENOMSG if not, -EBADMSG for an inconsistent header,
+ * -ENOSPC if the image does not fit, negative flash error
+ */
+int lz4s_flash_check(struct lz4s_hdr *hdr);
+
+/**
+ * Decode the checked image in place in slot1
+ * Returns 0 if slot1 holds the new image and matches its CRC, -ENOSPC if
+ * the output caught up with the input, lz4s_feed() errors, negative flash
+ * error; slot1 is left unusable on error
+ */
+int lz4s_flash_apply(const struct lz4s_hdr *hdr, struct lz4s_flash_stats *stats);
+
+#endif /* LZ4S_FLASH_H_ */
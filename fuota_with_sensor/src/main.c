@@ -7,12 +7,15 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <string.h>
+
 #include <zephyr/device.h>
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
 #include <zephyr/lorawan/lorawan.h>
 
 #include <zephyr/dfu/mcuboot.h>
+#include <zephyr/sys/byteorder.h>
 #include <zephyr/sys/reboot.h>
 
 // testing printk
@@ -25,6 +28,24 @@
 #include <zephyr/rtio/rtio.h>
 #include <zephyr/dsp/print_format.h>
 
+#include "accel_stream.h"
+#include "anomaly.h"
+#include "batch.h"
+#include "delta_flash.h"
+#include "frag_session.h"
+#include "lora_link.h"
+#include "lz4s_flash.h"
+#include "nvm_store.h"
+#include "payload.h"
+#include "rbe.h"
+#include "sensor_acq.h"
+#include "sample_sched.h"
+#include "tlog.h"
+#include "tlog_flash.h"
+#include "tscodec.h"
+#include "uplink.h"
+#include "vib_features.h"
+#include "vib_fft.h"
 
 
 LOG_MODULE_REGISTER(lorawan_fuota, CONFIG_LORAWAN_SERVICES_LOG_LEVEL);
@@ -34,20 +55,18 @@ LOG_MODULE_REGISTER(lorawan_fuota, CONFIG_LORAWAN_SERVICES_LOG_LEVEL);
 #define LORAWAN_JOIN_EUI { 0x00, 0x80, 0xE1, 0x15, 0x06, 0x1D, 0x9F, 0x39 }
 #define LORAWAN_APP_KEY  { 0x3D, 0xBF, 0x23, 0xF7, 0x33, 0xA4, 0x89, 0x19, 0xA4, 0x5A, 0x7F, 0xC6, 0x49, 0xFC, 0x64, 0xE9 }
 
-#define DELAY K_SECONDS(5)
+/* Task periods of the sampling scheduler (0 disables a task) */
+static const uint32_t sched_periods[SAMPLE_SCHED_NUM_TASKS] = {
+	[SAMPLE_SCHED_ACCEL] = SAMPLE_SCHED_ACCEL_PERIOD_MS,
+	[SAMPLE_SCHED_ENV] = SAMPLE_SCHED_ENV_PERIOD_MS,
+	[SAMPLE_SCHED_UPLINK] = SAMPLE_SCHED_UPLINK_PERIOD_MS,
+};
 
 char data[] = {'d', 'a', 't', 'a', ' ', 's', 'e', 'n', 'd'};
 
 /* ==================== BME280 Setup ==================== */
 const struct device *const bme280_dev = DEVICE_DT_GET_ANY(bosch_bme280);
 
-SENSOR_DT_READ_IODEV(bme280_iodev, DT_COMPAT_GET_ANY_STATUS_OKAY(bosch_bme280),
-        {SENSOR_CHAN_AMBIENT_TEMP, 0},
-        {SENSOR_CHAN_HUMIDITY, 0},
-        {SENSOR_CHAN_PRESS, 0});
-
-RTIO_DEFINE(bme280_ctx, 1, 1);
-
 /* ==================== ADXL345 Setup ==================== */
 const struct device *const adxl345_dev = DEVICE_DT_GET_ANY(adi_adxl345);
 
@@ -93,138 +112,142 @@ static const struct device *init_adxl345(void)
     return adxl345_dev;
 }
 
-/* ==================== Sensor Reading Functions ==================== */
+/* ==================== Payload Packing ==================== */
 
 /**
- * Read BME280 sensor data (Temperature, Pressure, Humidity)
- * Returns 0 on success, error code on failure
+ * Convert a Q31 value with the given shift to fixed-point x1000
+ * Real value is value * 2^shift / 2^31, so x1000 => (value * 1000) >> (31 - shift)
  */
-static int read_bme280_data(struct sensor_q31_data *temp_data,
-                            struct sensor_q31_data *press_data,
-                            struct sensor_q31_data *hum_data)
-{
-    uint8_t buf[128];
-    
-    /* Read sensor data asynchronously using RTIO */
-    int rc = sensor_read(&bme280_iodev, &bme280_ctx, buf, sizeof(buf));
-    if (rc != 0) {
-        LOG_ERR("BME280: sensor_read() failed: %d", rc);
-        return rc;
-    }
+static int32_t q31_to_x1000(q31_t value, int8_t shift)
+{
+    /* Use int64_t to prevent overflow during multiplication */
+    int64_t scaled = (int64_t)value * 1000;
 
-    /* Get the decoder API */
-    const struct sensor_decoder_api *decoder;
-    rc = sensor_get_decoder(bme280_dev, &decoder);
-    if (rc != 0) {
-        LOG_ERR("BME280: sensor_get_decoder() failed: %d", rc);
-        return rc;
+    if (shift > 31) {
+        scaled <<= (shift - 31);
+    } else {
+        scaled >>= (31 - shift);
     }
 
-    /* Decode temperature data */
-    uint32_t temp_fit = 0;
-    decoder->decode(buf,
-                    (struct sensor_chan_spec){SENSOR_CHAN_AMBIENT_TEMP, 0},
-                    &temp_fit, 1, temp_data);
-
-    /* Decode pressure data */
-    uint32_t press_fit = 0;
-    decoder->decode(buf,
-                    (struct sensor_chan_spec){SENSOR_CHAN_PRESS, 0},
-                    &press_fit, 1, press_data);
-
-    /* Decode humidity data */
-    uint32_t hum_fit = 0;
-    decoder->decode(buf,
-                    (struct sensor_chan_spec){SENSOR_CHAN_HUMIDITY, 0},
-                    &hum_fit, 1, hum_data);
+    return (int32_t)scaled;
+}
 
-    return 0;
+/* Spectrum bands for 100 Hz ODR: rotation/unbalance, harmonics, bearings, structure */
+static const struct vib_fft_band fft_bands[] = {
+	{10, 50}, {50, 120}, {120, 250}, {250, 500},
+};
+
+/* Axis fed to the FFT, Z is normal to the mounting surface */
+#define VIB_FFT_AXIS 2
+
+/* Sensor frames (UPLINK_FPORT_TELEMETRY) carry batches of records, see batch.h */
+
+/* Longest a record waits for its frame to fill up */
+#define BATCH_MAX_AGE_MS (10 * 60 * 1000)
+
+/* Smallest max payload of the region (US915 DR0), used until the DR is known */
+#define UPLINK_MIN_PAYLOAD 11
+
+/* Send sensor frames only on change or heartbeat (0 = every uplink period) */
+#ifndef UPLINK_REPORT_BY_EXCEPTION
+#define UPLINK_REPORT_BY_EXCEPTION 1
+#endif
+
+/* Deadbands in packed units; heartbeat keeps FUOTA downlink slots coming */
+static const struct rbe_config rbe_cfg = {
+	.deadband = {
+		[RBE_CH_TEMP] = 200,       /* 0.2 degC */
+		[RBE_CH_HUM] = 2000,       /* 2 %RH */
+		[RBE_CH_PRESS] = 100,      /* 0.1 kPa */
+		[RBE_CH_VIB_RMS] = 10,     /* 10 mg */
+		[RBE_CH_VIB_LEVEL] = 8,    /* 3 dB */
+	},
+	.heartbeat_ms = 10 * 60 * 1000,
+};
+
+/* Anomaly alerts go out ahead of telemetry as UPLINK_CLASS_ALERT */
+
+/* Noise floors and thresholds: 4 sigma spikes, CUSUM k = 0.5, h = 5 */
+static const struct anomaly_config anomaly_cfg[ANOMALY_NUM_CH] = {
+	[ANOMALY_CH_TEMP] = {.min_std = 50, .z_thresh_q8 = 4 * 256,
+			     .cusum_k_q8 = 128, .cusum_h_q8 = 5 * 256},
+	[ANOMALY_CH_HUM] = {.min_std = 500, .z_thresh_q8 = 4 * 256,
+			    .cusum_k_q8 = 128, .cusum_h_q8 = 5 * 256},
+	[ANOMALY_CH_VIB_RMS] = {.min_std = 2, .z_thresh_q8 = 4 * 256,
+				.cusum_k_q8 = 128, .cusum_h_q8 = 5 * 256},
+	[ANOMALY_CH_VIB_KURT] = {.min_std = 32, .z_thresh_q8 = 4 * 256,
+				 .cusum_k_q8 = 128, .cusum_h_q8 = 5 * 256},
+};
+
+BUILD_ASSERT(SAMPLE_SCHED_ACCEL_PERIOD_MS <= ACCEL_STREAM_DRAIN_MAX_MS,
+	     "vibration ring overflows between drains");
+BUILD_ASSERT(ARRAY_SIZE(fft_bands) == PAYLOAD_FFT_BANDS, "spectrum bands differ from the schema");
+BUILD_ASSERT(PAYLOAD_RECORD_MAX <= BATCH_RECORD_MAX, "sensor record too big for the batch");
+BUILD_ASSERT(BATCH_HDR_SIZE + PAYLOAD_COMPACT_SIZE <= UPLINK_MIN_PAYLOAD,
+	     "compact record must fit the slowest data rate");
+BUILD_ASSERT(PAYLOAD_RECORD_MAX <= TLOG_RECORD_MAX, "sensor record too big for the telemetry log");
+BUILD_ASSERT(PAYLOAD_MAX_FIELDS + 1 <= TSCODEC_MAX_CHANNELS, "record has too many fields to batch");
+BUILD_ASSERT(PAYLOAD_COMPACT_press == PAYLOAD_FULL_press, "records must share the env fields");
+BUILD_ASSERT(PAYLOAD_FULL_band0 - PAYLOAD_FULL_x_rms == VIB_AXES * 5, "5 fields per vibration axis");
+
+static void fill_env_fields(const struct sensor_acq_sample *sample, int32_t *values)
+{
+    values[PAYLOAD_FULL_temp] = q31_to_x1000(sample->temp, sample->temp_shift);
+    values[PAYLOAD_FULL_hum] = q31_to_x1000(sample->hum, sample->hum_shift);
+    values[PAYLOAD_FULL_press] = q31_to_x1000(sample->press, sample->press_shift);
 }
 
 /**
- * Read ADXL345 sensor data (X, Y, Z acceleration)
- * Returns 0 on success, error code on failure
+ * Pack sensor data into one full batch record, layout in payload_schema.h
+ * Vibration fields are zero until the first window completes (vib/spec == NULL)
+ * Returns the record size
  */
-static int read_adxl345_data(struct sensor_value accel[3])
+static int pack_sensor_payload(const struct sensor_acq_sample *sample,
+                               const struct vib_features *vib,
+                               const struct vib_spectrum *spec, uint8_t *payload)
 {
-    /* Fetch sample from the sensor */
-    int rc = sensor_sample_fetch(adxl345_dev);
-    if (rc != 0) {
-        LOG_ERR("ADXL345: sensor_sample_fetch() failed: %d", rc);
-        return rc;
-    }
+    int32_t values[PAYLOAD_FULL_NUM_FIELDS] = {0};
+    int32_t *v;
 
-    /* Get acceleration data for all three axes */
-    rc = sensor_channel_get(adxl345_dev, SENSOR_CHAN_ACCEL_X, &accel[0]);
-    if (rc != 0) {
-        LOG_ERR("ADXL345: sensor_channel_get(ACCEL_X) failed: %d", rc);
-        return rc;
-    }
+    fill_env_fields(sample, values);
 
-    rc = sensor_channel_get(adxl345_dev, SENSOR_CHAN_ACCEL_Y, &accel[1]);
-    if (rc != 0) {
-        LOG_ERR("ADXL345: sensor_channel_get(ACCEL_Y) failed: %d", rc);
-        return rc;
+    v = &values[PAYLOAD_FULL_x_rms];
+    for (int i = 0; vib != NULL && i < VIB_AXES; i++) {
+        const struct vib_axis_features *f = &vib->axis[i];
+
+        *v++ = f->rms_mg;
+        *v++ = f->p2p_mg;
+        *v++ = f->crest_q8;
+        *v++ = f->skew_q8;
+        *v++ = f->kurt_q8;
     }
 
-    rc = sensor_channel_get(adxl345_dev, SENSOR_CHAN_ACCEL_Z, &accel[2]);
-    if (rc != 0) {
-        LOG_ERR("ADXL345: sensor_channel_get(ACCEL_Z) failed: %d", rc);
-        return rc;
+    v = &values[PAYLOAD_FULL_band0];
+    for (int b = 0; spec != NULL && b < PAYLOAD_FFT_BANDS; b++) {
+        *v++ = spec->band_lvl[b];
+    }
+    if (spec != NULL) {
+        values[PAYLOAD_FULL_peak_freq] = spec->peak_chz;
+        values[PAYLOAD_FULL_peak_lvl] = spec->peak_lvl;
     }
 
-    return 0;
+    return payload_encode(&payload_schema_full, values, payload);
 }
 
 /**
- * Pack sensor data into binary payload
- * Payload format (12 bytes):
- * - temp_x100 (2 bytes): Temperature * 100, range -327.68 ~ +327.67 °C
- * - hum_x100 (2 bytes): Humidity * 100, range 0 ~ 655.35 %
- * - press_x10 (2 bytes): Pressure * 10, e.g. 1013.2 hPa → 10132
- * - accel_x (2 bytes): X acceleration * 1000 (m/s²)
- * - accel_y (2 bytes): Y acceleration * 1000 (m/s²)
- * - accel_z (2 bytes): Z acceleration * 1000 (m/s²)
- * Returns the payload size
+ * Pack the compact record used when a full one does not fit the data rate
+ * vib_rms: AC RMS of the acceleration vector in mg, 0 before the first window
+ * Returns the record size
  */
-static int pack_sensor_payload(struct sensor_q31_data *temp_data,
-                               struct sensor_q31_data *hum_data,
-                               struct sensor_q31_data *press_data,
-                               struct sensor_value accel[3],
-                               uint8_t *payload)
-{
-    /* Convert Q31 sensor values to fixed-point x1000 without float */
-    /* Q31 means value is scaled by 2^31. */
-    /* We want (value / 2^31) * 1000 => (value * 1000) / 2^31 */
-    /* Use int64_t to prevent overflow during multiplication */
-    
-    int16_t temp_x1000 = (int16_t)(((int64_t)temp_data->readings[0].temperature * 1000) / 2147483648LL);
-    int16_t hum_x1000 = (int16_t)(((int64_t)hum_data->readings[0].humidity * 1000) / 2147483648LL);
-    int16_t press_x1000 = (int16_t)(((int64_t)press_data->readings[0].pressure * 1000) / 2147483648LL);
-
-    /* Convert standard sensor values to fixed-point x1000 without float */
-    /* sensor_value has val1 (int) and val2 (micro, /1,000,000) */
-    /* val * 1000 = val1 * 1000 + val2 / 1000 */
-    
-    int16_t accel_x_1000 = (int16_t)(accel[0].val1 * 1000 + accel[0].val2 / 1000);
-    int16_t accel_y_1000 = (int16_t)(accel[1].val1 * 1000 + accel[1].val2 / 1000);
-    int16_t accel_z_1000 = (int16_t)(accel[2].val1 * 1000 + accel[2].val2 / 1000);
-
-    /* Pack into binary payload (12 bytes) */
-    payload[0] = (uint8_t)(temp_x1000 >> 8);
-    payload[1] = (uint8_t)(temp_x1000 & 0xFF);
-    payload[2] = (uint8_t)(hum_x1000 >> 8);
-    payload[3] = (uint8_t)(hum_x1000 & 0xFF);
-    payload[4] = (uint8_t)(press_x1000 >> 8);
-    payload[5] = (uint8_t)(press_x1000 & 0xFF);
-    payload[6] = (uint8_t)(accel_x_1000 >> 8);
-    payload[7] = (uint8_t)(accel_x_1000 & 0xFF);
-    payload[8] = (uint8_t)(accel_y_1000 >> 8);
-    payload[9] = (uint8_t)(accel_y_1000 & 0xFF);
-    payload[10] = (uint8_t)(accel_z_1000 >> 8);
-    payload[11] = (uint8_t)(accel_z_1000 & 0xFF);
-
-    return 12; /* 12 bytes total */
+static int pack_compact_payload(const struct sensor_acq_sample *sample, uint16_t vib_rms,
+                                uint8_t *payload)
+{
+    int32_t values[PAYLOAD_COMPACT_NUM_FIELDS];
+
+    fill_env_fields(sample, values);
+    values[PAYLOAD_COMPACT_vib_rms] = vib_rms;
+
+    return payload_encode(&payload_schema_compact, values, payload);
 }
 
 static void downlink_info(uint8_t port, uint8_t flags, int16_t rssi, int8_t snr, uint8_t len,
@@ -236,32 +259,807 @@ static void downlink_info(uint8_t port, uint8_t flags, int16_t rssi, int8_t snr,
 	}
 }
 
+/* Max payload of the current DR, applied to the batch on the next plan */
+static atomic_t dr_max_payload = ATOMIC_INIT(UPLINK_MIN_PAYLOAD);
+
 static void datarate_changed(enum lorawan_datarate dr)
 {
 	uint8_t unused, max_size;
 
 	lorawan_get_payload_sizes(&unused, &max_size);
 	LOG_INF("New Datarate: DR %d, Max Payload %d", dr, max_size);
+	atomic_set(&dr_max_payload, max_size);
+	uplink_set_datarate(dr);
 }
 
+/* Set by the frag transport, the main loop rebuilds and installs the image */
+static atomic_t fuota_received;
+
 static void fuota_finished(void)
 {
-	LOG_INF("FUOTA finished. Reset device to apply firmware upgrade.");
+	LOG_INF("FUOTA finished, installing the firmware upgrade");
+	atomic_set(&fuota_received, 1);
+}
+
+/**
+ * Runs in the link thread once joined: start the LoRaWAN services and the
+ * uplink thread
+ */
+static void link_up(void)
+{
+	uint8_t unused, max_size;
+
+	lorawan_enable_adr(true);
+
+	lorawan_get_payload_sizes(&unused, &max_size);
+	atomic_set(&dr_max_payload, max_size);
+
+	/*
+	 * Clock synchronization is required to schedule the multicast session
+	 * in class C mode. It can also be used independent of FUOTA.
+	 */
+	lorawan_clock_sync_run();
+
+	/*
+	 * The multicast session setup service is automatically started in the
+	 * background. It is also responsible for switching to class C at a
+	 * specified time.
+	 */
+
+	/*
+	 * The fragmented data transport transfers the actual firmware image.
+	 * It could also be used in a class A session, but would take very long
+	 * in that case. Ours keeps the FEC rows in slot1 instead of RAM.
+	 */
+	frag_session_start(fuota_finished);
 
 	/*
-	 * In an actual application the firmware should be rebooted here if
-	 * no important tasks are pending
+	 * Regular uplinks are required to open downlink slots in class A for
+	 * FUOTA setup by the server. Sampling and uplinks run on absolute
+	 * deadlines, so the period does not stretch by the TX airtime.
 	 */
+	uplink_start();
+}
+
+/* ==================== Scheduled Tasks ==================== */
+
+static bool sensors_ready;
+
+/* Latest decoded sensor cycle, NULL until the first successful read */
+static const struct sensor_acq_sample *env_sample;
+
+static uint32_t accel_frames_pending;
+
+/* ADXL345 read one-shot with the BME280 because its FIFO does not stream */
+static bool accel_oneshot;
+
+/*
+ * Motor health features, one window is 2.56 s at 100 Hz. Without the stream
+ * the 1 Hz one-shot reads fill a 60 s window instead: the amplitude
+ * statistics still hold at that rate, the spectrum does not.
+ */
+#define VIB_ONESHOT_WINDOW 60
+
+static struct vib_features_engine vib_engine;
+
+/* Spectrum of one axis, filled sample by sample from the stream */
+static int16_t fft_window[VIB_FFT_LEN];
+static uint16_t fft_fill;
+static bool fft_ready;
+static struct vib_spectrum fft_spec;
+static uint32_t fft_runs;
+static uint32_t fft_cycles_last;
+static uint32_t fft_cycles_max;
+
+/* Edge anomaly detection over environment and vibration features (SRS 02) */
+static struct anomaly_detector anomaly_det;
+static bool anomaly_ready;
+
+/**
+ * Send an alert uplink right away if any channel raised an event
+ */
+static void report_anomaly(uint16_t flags)
+{
+	uint8_t alert[ANOMALY_ALERT_SIZE];
+
+	if (flags == 0) {
+		return;
+	}
+
+	anomaly_encode_alert(&anomaly_det, flags, alert);
+	LOG_WRN("[ANOMALY] flags 0x%04x score %u", flags, anomaly_score(&anomaly_det));
+
+	int ret = uplink_enqueue(UPLINK_CLASS_ALERT, alert, sizeof(alert), k_uptime_get_32());
+	if (ret < 0) {
+		LOG_ERR("uplink_enqueue (alert) failed: %d", ret);
+	}
+}
+
+/**
+ * AC RMS of the acceleration vector, mg
+ */
+static int32_t vib_total_rms(const struct vib_features *vib)
+{
+    uint64_t power = 0;
 
-	int rc = boot_request_upgrade(BOOT_UPGRADE_PERMANENT);
-    if (rc) {
-        printk("boot_request_upgrade failed: %d\n", rc);
-        return;
+    for (int i = 0; i < VIB_AXES; i++) {
+        power += (uint32_t)vib->axis[i].rms_mg * vib->axis[i].rms_mg;
     }
+    return (int32_t)vib_isqrt64(power);
+}
+
+/**
+ * Convert a Q31 m/s^2 reading to mg, saturating to int16
+ */
+static int16_t accel_to_mg(q31_t value, int8_t shift)
+{
+	int64_t mg = (int64_t)q31_to_x1000(value, shift) * 1000 / 9807;
+
+	return (int16_t)CLAMP(mg, INT16_MIN, INT16_MAX);
+}
+
+/**
+ * Feed a completed vibration window to the detector
+ */
+static void check_vib_anomaly(const struct vib_features *vib)
+{
+	uint16_t kurt = 0;
+
+	if (!anomaly_ready) {
+		return;
+	}
+
+	for (int i = 0; i < VIB_AXES; i++) {
+		kurt = MAX(kurt, vib->axis[i].kurt_q8);
+	}
+
+	uint16_t flags = anomaly_update(&anomaly_det, ANOMALY_CH_VIB_RMS, vib_total_rms(vib));
+
+	flags |= anomaly_update(&anomaly_det, ANOMALY_CH_VIB_KURT, kurt);
+	report_anomaly(flags);
+}
+
+static struct rbe_filter rbe;
+
+/* Records waiting for a frame at the current data rate */
+static struct batch uplink_batch;
+
+/*
+ * Store-and-forward (SRS 04): records go to the telemetry log first and
+ * reach the batch from there. One sensor frame is in flight at a time; the
+ * log cursor moves past its records once lorawan_send() succeeded, a failure
+ * rewinds to the cursor and retries at the next uplink period.
+ */
+static struct tlog_flash telemetry_flash;
+static struct tlog telemetry_log;
+static bool log_ready;
+
+/* Log position after each queued record, parallel to uplink_batch */
+static struct tlog_pos batch_pos[BATCH_MAX_RECORDS];
+static uint8_t batch_pos_head;
+
+static bool sensor_inflight;
+static struct tlog_pos sensor_inflight_end;
+
+/* Last sensor frame failed */
+static bool link_down;
+
+/*
+ * Until the join and after a failed frame, records are compact and only
+ * every OUTAGE_LOG_EVERY-th cycle is logged. A compact entry takes 16 bytes,
+ * 127 per 2 KB page, and the 2 pages of the log never erased under the
+ * head hold 254 of them: 25 h of outage at one record per 6 min (SRS 04).
+ */
+#define OUTAGE_LOG_EVERY 6
+
+static uint8_t outage_cycles;
+
+/* Backlog beyond the batch: full frames back to back until it is drained */
+static bool catching_up;
+
+#define SENSOR_TX_OK     1
+#define SENSOR_TX_FAILED 2
+
+static atomic_t sensor_tx_result;
+
+static void uplink_done(enum uplink_class cls, int result)
+{
+	if (cls == UPLINK_CLASS_TELEMETRY) {
+		atomic_set(&sensor_tx_result, (result == 0) ? SENSOR_TX_OK : SENSOR_TX_FAILED);
+	}
+}
+
+/**
+ * Forget the queued records, they are read from the cursor again
+ */
+static void rewind_batch(void)
+{
+	tlog_rewind(&telemetry_log);
+	batch_clear(&uplink_batch);
+	batch_pos_head = 0;
+}
+
+/**
+ * Apply the result of the sensor frame in flight
+ * Returns true if it was sent
+ */
+static bool check_sensor_tx(void)
+{
+	atomic_val_t result = atomic_clear(&sensor_tx_result);
+
+	if (!sensor_inflight || result == 0) {
+		return false;
+	}
+	sensor_inflight = false;
+
+	if (result == SENSOR_TX_FAILED) {
+		link_down = true;
+		rewind_batch();
+		return false;
+	}
+
+	link_down = false;
+	int ret = tlog_commit(&telemetry_log, &sensor_inflight_end);
+	if (ret < 0) {
+		LOG_ERR("tlog_commit failed: %d", ret);
+	}
+	return true;
+}
+
+/**
+ * Keep a record for the next frame
+ */
+static void queue_record(const uint8_t *rec, uint8_t len)
+{
+	if (!log_ready) {
+		batch_add(&uplink_batch, rec, len, k_uptime_get_32());
+		return;
+	}
+
+	int ret = tlog_append(&telemetry_log, rec, len);
+	if (ret < 0) {
+		LOG_ERR("tlog_append failed: %d", ret);
+	}
+}
+
+/**
+ * Re-encode a full record that no longer fits a frame at the current DR,
+ * e.g. one logged at DR3 and read back after a drop to DR0, as the compact
+ * record of the same cycle
+ * Returns the record size
+ */
+static int fit_record_to_dr(uint8_t *rec, int len)
+{
+	int32_t values[PAYLOAD_FULL_NUM_FIELDS];
+	uint64_t power = 0;
+
+	if (len <= batch_record_space(&uplink_batch) ||
+	    payload_unpack(&payload_schema_full, rec, len, values) < 0) {
+		return len;
+	}
+
+	for (int f = PAYLOAD_FULL_temp; f <= PAYLOAD_FULL_press; f++) {
+		values[f] = payload_expand(&payload_schema_full, f, values[f]);
+	}
+	for (int i = 0; i < VIB_AXES; i++) {
+		int f = PAYLOAD_FULL_x_rms + i * (PAYLOAD_FULL_y_rms - PAYLOAD_FULL_x_rms);
+		uint32_t rms = payload_expand(&payload_schema_full, f, values[f]);
+
+		power += (uint64_t)rms * rms;
+	}
+	values[PAYLOAD_COMPACT_vib_rms] = (int32_t)vib_isqrt64(power);
+
+	return payload_encode(&payload_schema_compact, values, rec);
+}
+
+/**
+ * Queue logged records behind the batch, as many as it holds
+ */
+static void fill_batch_from_log(void)
+{
+	uint8_t rec[TLOG_RECORD_MAX];
+	struct tlog_pos next;
+	int len;
+
+	while (uplink_batch.count < BATCH_MAX_RECORDS &&
+	       (len = tlog_read(&telemetry_log, rec, &next)) > 0) {
+		len = fit_record_to_dr(rec, len);
+		batch_pos[(batch_pos_head + uplink_batch.count) % BATCH_MAX_RECORDS] = next;
+		batch_add(&uplink_batch, rec, (uint8_t)len, k_uptime_get_32());
+	}
+
+	if (tlog_unread(&telemetry_log)) {
+		catching_up = true;
+	}
+}
+
+/**
+ * Send the next frame of logged records unless one is still in flight
+ */
+static void send_logged_frame(uint8_t *frame)
+{
+	if (sensor_inflight) {
+		return;
+	}
+
+	/* Records queued at a faster DR are read again and re-encoded, not dropped */
+	for (uint8_t i = 0; i < uplink_batch.count; i++) {
+		if (uplink_batch.rec_len[(uplink_batch.head + i) % BATCH_MAX_RECORDS] >
+		    batch_record_space(&uplink_batch)) {
+			rewind_batch();
+			break;
+		}
+	}
+
+	fill_batch_from_log();
+
+	uint8_t before = uplink_batch.count;
+	uint32_t oldest_ms = uplink_batch.rec_ms[uplink_batch.head];
+	int len = batch_pop(&uplink_batch, k_uptime_get_32(), catching_up, frame);
+	uint8_t taken = before - uplink_batch.count;
+
+	if (len > 0 && !uplink_airtime_allows(UPLINK_CLASS_TELEMETRY, len)) {
+		/* Over budget: the records stay in the log for a later frame */
+		rewind_batch();
+		return;
+	}
+
+	/* Every queued record fits the DR, so taken are exactly the frame's records */
+	if (taken > 0) {
+		sensor_inflight_end = batch_pos[(batch_pos_head + taken - 1) % BATCH_MAX_RECORDS];
+		batch_pos_head = (batch_pos_head + taken) % BATCH_MAX_RECORDS;
+	}
+	if (uplink_batch.count == 0 && !tlog_unread(&telemetry_log)) {
+		catching_up = false;
+	}
+	if (len <= 0) {
+		return;
+	}
+
+	int ret = uplink_enqueue(UPLINK_CLASS_TELEMETRY, frame, len, oldest_ms);
+	if (ret < 0) {
+		LOG_ERR("uplink_enqueue (sensor) failed: %d", ret);
+		rewind_batch();
+		return;
+	}
+	sensor_inflight = true;
+}
+
+/**
+ * Stretch the frame and heartbeat intervals so that full frames at the
+ * current DR stay within the airtime budget; at DR3 they stay as configured.
+ * Not before the join, the DR is not known yet and nothing is sent anyway.
+ */
+static void pace_to_airtime(void)
+{
+	uint32_t pace = lora_link_is_up() ? uplink_airtime_pace_ms(uplink_batch.max_payload) : 0;
+
+	batch_set_max_age(&uplink_batch, MAX(BATCH_MAX_AGE_MS, pace));
+	rbe_set_heartbeat(&rbe, MAX(rbe_cfg.heartbeat_ms, pace));
+}
 
-    k_msleep(100);
-    sys_reboot(SYS_REBOOT_COLD);
-	
+/**
+ * Hand every frame that is due to the uplink thread
+ */
+static void flush_batch(void)
+{
+	static uint8_t frame[BATCH_FRAME_MAX];
+
+	bool up = lora_link_is_up();
+
+	batch_set_max_payload(&uplink_batch, (uint8_t)atomic_get(&dr_max_payload));
+	pace_to_airtime();
+
+	/* Until the join, records wait in the log, or in the batch without one */
+	if (up && log_ready) {
+		send_logged_frame(frame);
+	} else if (up) {
+		/* No log to fall back on: hold frames in the batch while over budget */
+		while (uplink_batch.count > 0 &&
+		       uplink_airtime_allows(UPLINK_CLASS_TELEMETRY, uplink_batch.max_payload)) {
+			uint32_t oldest_ms = uplink_batch.rec_ms[uplink_batch.head];
+
+			int len = batch_pop(&uplink_batch, k_uptime_get_32(), false, frame);
+
+			if (len <= 0) {
+				break;
+			}
+
+			/* Sampling continues during TX and RX windows */
+			int ret = uplink_enqueue(UPLINK_CLASS_TELEMETRY, frame, len, oldest_ms);
+			if (ret < 0) {
+				LOG_ERR("uplink_enqueue (sensor) failed: %d", ret);
+			}
+		}
+	}
+
+	LOG_INF("[BATCH] %u records in %u frames (%u bytes), %u pending, %u dropped, "
+		"max payload %u",
+		uplink_batch.stats.records, uplink_batch.stats.frames, uplink_batch.stats.bytes,
+		uplink_batch.count, uplink_batch.stats.dropped, uplink_batch.max_payload);
+	LOG_INF("[CODEC] %u compressed frames, %u bytes raw",
+		uplink_batch.stats.compressed, uplink_batch.stats.raw_bytes);
+}
+
+/**
+ * Report-by-exception decision for the current sensor frame
+ * Returns true if the frame should be sent
+ */
+static bool rbe_should_send(const struct vib_features *vib, const struct vib_spectrum *spec,
+			    uint8_t len)
+{
+	int32_t values[RBE_NUM_CH] = {
+		[RBE_CH_TEMP] = q31_to_x1000(env_sample->temp, env_sample->temp_shift),
+		[RBE_CH_HUM] = q31_to_x1000(env_sample->hum, env_sample->hum_shift),
+		[RBE_CH_PRESS] = q31_to_x1000(env_sample->press, env_sample->press_shift),
+		[RBE_CH_VIB_RMS] = (vib != NULL) ? vib_total_rms(vib) : 0,
+	};
+
+	for (int b = 0; spec != NULL && b < spec->nbands; b++) {
+		values[RBE_CH_VIB_LEVEL] = MAX(values[RBE_CH_VIB_LEVEL], spec->band_lvl[b]);
+	}
+
+	bool send = rbe_check(&rbe, values, k_uptime_get_32(), len);
+
+	LOG_INF("[RBE] %s: %u sent (%u change, %u heartbeat), %u suppressed (%u bytes)",
+		send ? "send" : "suppress", rbe.stats.sent, rbe.stats.sent_change,
+		rbe.stats.sent_heartbeat, rbe.stats.suppressed, rbe.stats.suppressed_bytes);
+	return send;
+}
+
+static void run_fft(void)
+{
+	uint32_t start = k_cycle_get_32();
+	int ret = vib_fft_process(fft_window, &fft_spec);
+
+	fft_cycles_last = k_cycle_get_32() - start;
+	fft_cycles_max = MAX(fft_cycles_max, fft_cycles_last);
+
+	if (ret < 0) {
+		LOG_ERR("vib_fft_process failed: %d", ret);
+		return;
+	}
+	fft_runs++;
+}
+
+/**
+ * Drain the vibration frames captured since the last burst into the
+ * feature engine
+ */
+static void run_accel_task(void)
+{
+	static struct accel_frame accel_frames[ACCEL_STREAM_WATERMARK];
+	size_t n;
+
+	while ((n = accel_stream_read(accel_frames, ARRAY_SIZE(accel_frames))) > 0) {
+		for (size_t i = 0; i < n; i++) {
+			const int16_t axis[VIB_AXES] = {
+				accel_frames[i].x, accel_frames[i].y, accel_frames[i].z,
+			};
+
+			if (vib_features_add(&vib_engine, axis[0], axis[1], axis[2])) {
+				check_vib_anomaly(&vib_engine.last);
+			}
+
+			if (fft_ready) {
+				fft_window[fft_fill++] = axis[VIB_FFT_AXIS];
+				if (fft_fill == VIB_FFT_LEN) {
+					run_fft();
+					fft_fill = 0;
+				}
+			}
+		}
+		accel_frames_pending += n;
+	}
+}
+
+/**
+ * Read the BME280, and the ADXL345 alongside it when its FIFO does not stream
+ */
+static void run_env_task(void)
+{
+	const struct sensor_acq_sample *sample = NULL;
+
+	if (!sensors_ready) {
+		return;
+	}
+
+	int rc_acq = sensor_acq_read(&sample);
+	if (rc_acq != 0) {
+		LOG_ERR("Sensor acquisition failed with code %d", rc_acq);
+		env_sample = NULL;
+		return;
+	}
+
+	env_sample = sample;
+
+	if (accel_oneshot &&
+	    vib_features_add(&vib_engine, accel_to_mg(sample->accel[0], sample->accel_shift),
+			     accel_to_mg(sample->accel[1], sample->accel_shift),
+			     accel_to_mg(sample->accel[2], sample->accel_shift))) {
+		check_vib_anomaly(&vib_engine.last);
+	}
+
+	if (anomaly_ready) {
+		uint16_t flags = anomaly_update(&anomaly_det, ANOMALY_CH_TEMP,
+						q31_to_x1000(sample->temp, sample->temp_shift));
+
+		flags |= anomaly_update(&anomaly_det, ANOMALY_CH_HUM,
+					q31_to_x1000(sample->hum, sample->hum_shift));
+		report_anomaly(flags);
+	}
+}
+
+static void log_sched_stats(void)
+{
+	for (int i = 0; i < SAMPLE_SCHED_NUM_TASKS; i++) {
+		struct sample_sched_stats st;
+
+		sample_sched_get_stats(i, &st);
+		if (st.period_ms == 0) {
+			continue;
+		}
+		LOG_INF("[SCHED] task %d: %u runs, %u overruns, jitter last %u us, avg %u us, max %u us",
+			i, st.runs, st.overruns, st.jitter_last_us, st.jitter_avg_us, st.jitter_max_us);
+	}
+}
+
+/* Diagnostics frame once an hour at the 60 s uplink period */
+#define DIAG_EVERY_UPLINKS 60
+#define DIAG_VERSION       1
+#define DIAG_SIZE          11
+
+BUILD_ASSERT(DIAG_SIZE <= UPLINK_MIN_PAYLOAD, "diagnostics must fit the slowest data rate");
+
+static uint32_t diag_countdown;
+
+static uint16_t sat16(uint32_t v)
+{
+	return (v > UINT16_MAX) ? UINT16_MAX : (uint16_t)v;
+}
+
+/**
+ * Queue the device health frame, big-endian with saturating counters:
+ * version, uptime (h), frames given up on, frames and records dropped,
+ * telemetry log sectors lost, anomaly events
+ */
+static void send_diagnostics(const struct uplink_stats *up, const struct accel_stream_stats *accel)
+{
+	uint8_t diag[DIAG_SIZE];
+	uint32_t failed = 0, dropped = uplink_batch.stats.dropped + accel->dropped;
+
+	for (int c = 0; c < UPLINK_NUM_CLASSES; c++) {
+		failed += up->cls[c].failed;
+		dropped += up->cls[c].dropped;
+	}
+
+	diag[0] = DIAG_VERSION;
+	sys_put_be16(sat16(k_uptime_get() / (60 * 60 * 1000)), &diag[1]);
+	sys_put_be16(sat16(failed), &diag[3]);
+	sys_put_be16(sat16(dropped), &diag[5]);
+	sys_put_be16(sat16(log_ready ? telemetry_log.stats.lost_sectors : 0), &diag[7]);
+	sys_put_be16(sat16(anomaly_det.events), &diag[9]);
+
+	if (!lora_link_is_up() || !uplink_airtime_allows(UPLINK_CLASS_DIAG, sizeof(diag))) {
+		return;
+	}
+
+	int ret = uplink_enqueue(UPLINK_CLASS_DIAG, diag, sizeof(diag), k_uptime_get_32());
+	if (ret < 0) {
+		LOG_ERR("uplink_enqueue (diag) failed: %d", ret);
+	}
+}
+
+/**
+ * Rebuild the image if a delta patch or a compressed image is what was
+ * received, then reboot into it. Runs in the main loop, both decode in
+ * place in slot1 for seconds.
+ */
+static void install_update(void)
+{
+	struct delta_flash_stats st;
+	struct lz4s_flash_stats lz_st;
+	struct delta_hdr hdr;
+	struct lz4s_hdr lz_hdr;
+	int rc = delta_flash_check(&hdr);
+
+	if (rc == 0) {
+		rc = delta_flash_apply(&hdr, &st);
+		if (rc < 0) {
+			return;
+		}
+		LOG_INF("[FUOTA] delta patch %u B rebuilt a %u B image in %u ms",
+			st.patch_size, st.new_size, st.apply_ms);
+	} else if (rc == -ENOMSG && (rc = lz4s_flash_check(&lz_hdr)) == 0) {
+		rc = lz4s_flash_apply(&lz_hdr, &lz_st);
+		if (rc < 0) {
+			return;
+		}
+		LOG_INF("[FUOTA] compressed image %u B -> %u B, moved in %u ms, "
+			"decoded in %u ms (%u B/s)",
+			lz_st.comp_size, lz_st.new_size, lz_st.move_ms, lz_st.decode_ms,
+			(uint32_t)((uint64_t)lz_st.new_size * 1000 / MAX(lz_st.decode_ms, 1)));
+	} else if (rc == -ENOMSG) {
+		LOG_INF("[FUOTA] full image");
+	} else {
+		LOG_ERR("Update rejected: %d", rc);
+		return;
+	}
+
+	rc = boot_request_upgrade(BOOT_UPGRADE_PERMANENT);
+	if (rc) {
+		LOG_ERR("boot_request_upgrade failed: %d", rc);
+		return;
+	}
+
+	/* The new image resumes the session, it needs the latest MAC state */
+	rc = nvm_store_flush();
+	if (rc < 0) {
+		LOG_ERR("nvm_store_flush failed: %d", rc);
+	}
+
+	k_msleep(100);
+	sys_reboot(SYS_REBOOT_COLD);
+}
+
+/**
+ * Pack the latest sensor cycle and send it
+ */
+static void run_uplink_task(void)
+{
+	struct accel_stream_stats accel_stats;
+	struct sensor_acq_stats acq_stats;
+	struct uplink_stats up_stats;
+	struct lora_link_stats link_stats;
+	struct nvm_store_stats nvm_stats;
+	struct frag_session_stats frag_stats;
+	int ret;
+
+	accel_stream_get_stats(&accel_stats);
+	LOG_INF("[ADXL345] Stream: %u frames, %u bursts, %u dropped, %u re-arms refused",
+		accel_frames_pending, accel_stats.bursts, accel_stats.dropped,
+		accel_stats.arm_failed);
+	accel_frames_pending = 0;
+
+	sensor_acq_get_stats(&acq_stats);
+	if (acq_stats.adxl345_us > 0) {
+		LOG_INF("[ACQ] %u us combined (BME280 %u us, ADXL345 %u us, saved %u us)",
+			acq_stats.combined_us, acq_stats.bme280_us,
+			acq_stats.adxl345_us, acq_stats.saved_us);
+	} else {
+		LOG_INF("[ACQ] BME280 %u us", acq_stats.bme280_us);
+	}
+
+	log_sched_stats();
+
+	lora_link_get_stats(&link_stats);
+	uplink_get_stats(&up_stats);
+	LOG_INF("[JOIN] %s: %u attempts, %u failed (last %d), DR%u, sub-band %u, "
+		"up at %u ms, first uplink at %u ms",
+		!lora_link_is_up() ? "joining" : link_stats.restored ? "restored" : "joined",
+		link_stats.attempts, link_stats.failures, link_stats.last_err, link_stats.last_dr,
+		link_stats.last_band, link_stats.up_ms, up_stats.first_tx_ms);
+	if (link_stats.rejected > 0) {
+		LOG_INF("[JOIN] %u restored sessions rejected", link_stats.rejected);
+	}
+
+	nvm_store_get_stats(&nvm_stats);
+	LOG_INF("[NVM] %u saves (%u unchanged, %u coalesced), %u writes (%u bytes), "
+		"busy %u us (max %u), FCnt reserved to %u, err %d",
+		nvm_stats.saves, nvm_stats.unchanged, nvm_stats.coalesced, nvm_stats.writes,
+		nvm_stats.bytes, nvm_stats.busy_us, nvm_stats.busy_max_us,
+		nvm_stats.fcnt_reserved, nvm_stats.last_err);
+
+	frag_session_get_stats(&frag_stats);
+	if (frag_stats.nb_frag > 0) {
+		LOG_INF("[FRAG] %u fragments of %u B: %u received, %u missing, %u coded, "
+			"%u redundant, rows %u of %u (%u dropped), %u rebuilt",
+			frag_stats.nb_frag, frag_stats.frag_size, frag_stats.received,
+			frag_stats.missing, frag_stats.fec.coded, frag_stats.fec.redundant,
+			frag_stats.rows,
+			frag_stats.max_rows, frag_stats.fec.no_room, frag_stats.fec.solved);
+		if (frag_stats.resumed > 0) {
+			LOG_INF("[FRAG] %u fragments kept across a reset",
+				frag_stats.resumed);
+		}
+	}
+
+	LOG_INF("[UPLINK] depth %u (max %u), tx %u ms (max %u)",
+		up_stats.depth, up_stats.depth_max, up_stats.tx_last_ms, up_stats.tx_max_ms);
+	LOG_INF("[AIRTIME] %u ms in the last hour (budget %u, peak %u), %u ms total, "
+		"%u deferred, frame age %u s",
+		up_stats.airtime_hour_ms, UPLINK_AIRTIME_BUDGET_MS, up_stats.airtime_peak_ms,
+		up_stats.airtime_total_ms, up_stats.airtime_deferred,
+		uplink_batch.max_age_ms / 1000);
+	for (int c = 0; c < UPLINK_NUM_CLASSES; c++) {
+		const struct uplink_class_stats *st = &up_stats.cls[c];
+
+		LOG_INF("[UPLINK] class %d: %u sent, %u failed, %u dropped, %u retries, "
+			"latency %u ms (max %u)",
+			c, st->sent, st->failed, st->dropped, st->retries,
+			st->latency_last_ms, st->latency_max_ms);
+	}
+
+	if (++diag_countdown >= DIAG_EVERY_UPLINKS) {
+		diag_countdown = 0;
+		send_diagnostics(&up_stats, &accel_stats);
+	}
+
+	if (log_ready) {
+		LOG_INF("[TLOG] backlog %u bytes%s, %u records, %u commits, %u erases, "
+			"%u sectors lost, %u torn",
+			tlog_backlog(&telemetry_log), catching_up ? " (catching up)" : "",
+			telemetry_log.stats.appended, telemetry_log.stats.commits,
+			telemetry_log.stats.erases, telemetry_log.stats.lost_sectors,
+			telemetry_log.stats.torn);
+	}
+
+	if (!sensors_ready) {
+		/* Fallback to original data if sensors not available */
+		ret = lora_link_is_up() ? uplink_enqueue(UPLINK_CLASS_TELEMETRY, (const uint8_t *)data,
+							 sizeof(data), k_uptime_get_32()) : 0;
+		if (ret < 0) {
+			LOG_ERR("uplink_enqueue failed: %d", ret);
+		}
+		return;
+	}
+
+	if (env_sample == NULL) {
+		LOG_ERR("No valid sensor reading to send");
+		return;
+	}
+
+	LOG_INF("[BME280] Temp: %s%d.%d Degree | Pressure: %s%d.%d Pa | Humidity: %s%d.%d %%",
+		PRIq_arg(env_sample->temp, 6, env_sample->temp_shift),
+		PRIq_arg(env_sample->press, 6, env_sample->press_shift),
+		PRIq_arg(env_sample->hum, 6, env_sample->hum_shift));
+
+	const struct vib_features *vib = (vib_engine.windows > 0) ? &vib_engine.last : NULL;
+
+	for (int i = 0; vib != NULL && i < VIB_AXES; i++) {
+		const struct vib_axis_features *f = &vib->axis[i];
+
+		LOG_INF("[VIB] axis %d: rms %u mg, p2p %u mg, crest %u, skew %d, kurt %u (Q8)",
+			i, f->rms_mg, f->p2p_mg, f->crest_q8, f->skew_q8, f->kurt_q8);
+	}
+
+	LOG_INF("[ANOMALY] %u events, score %u", anomaly_det.events, anomaly_score(&anomaly_det));
+
+	const struct vib_spectrum *spec = (fft_runs > 0) ? &fft_spec : NULL;
+
+	if (spec != NULL) {
+		LOG_INF("[FFT] bands %u %u %u %u, peak %u.%02u Hz lvl %u, "
+			"%u cycles (%u us, max %u us)",
+			spec->band_lvl[0], spec->band_lvl[1], spec->band_lvl[2], spec->band_lvl[3],
+			spec->peak_chz / 100, spec->peak_chz % 100, spec->peak_lvl,
+			fft_cycles_last, k_cyc_to_us_floor32(fft_cycles_last),
+			k_cyc_to_us_floor32(fft_cycles_max));
+	}
+
+	/* Re-plan first so the record format matches the current DR */
+	batch_set_max_payload(&uplink_batch, (uint8_t)atomic_get(&dr_max_payload));
+
+	uint8_t sensor_payload[PAYLOAD_RECORD_MAX];
+	int payload_size;
+
+	bool outage = link_down || !lora_link_is_up();
+	bool keep = !outage || outage_cycles == 0;
+
+	outage_cycles = outage ? (outage_cycles + 1) % OUTAGE_LOG_EVERY : 0;
+
+	if (!outage && batch_record_space(&uplink_batch) >= PAYLOAD_FULL_SIZE) {
+		payload_size = pack_sensor_payload(env_sample, vib, spec, sensor_payload);
+	} else {
+		payload_size = pack_compact_payload(env_sample,
+						    (vib != NULL) ? vib_total_rms(vib) : 0,
+						    sensor_payload);
+	}
+
+	if (keep && (!UPLINK_REPORT_BY_EXCEPTION || rbe_should_send(vib, spec, payload_size))) {
+		queue_record(sensor_payload, payload_size);
+	}
+
+	flush_batch();
 }
 
 int main(void)
@@ -270,10 +1068,11 @@ int main(void)
 	printk("FUOTA app booting...\n");
 
 	const struct device *lora_dev;
-	struct lorawan_join_config join_cfg;
-	uint8_t dev_eui[] = LORAWAN_DEV_EUI; 
-	uint8_t join_eui[] = LORAWAN_JOIN_EUI;
-	uint8_t app_key[] = LORAWAN_APP_KEY;
+	/* Used by the link thread until the join succeeds */
+	static struct lorawan_join_config join_cfg;
+	static uint8_t dev_eui[] = LORAWAN_DEV_EUI;
+	static uint8_t join_eui[] = LORAWAN_JOIN_EUI;
+	static uint8_t app_key[] = LORAWAN_APP_KEY;
 	int ret;
 
 	struct lorawan_downlink_cb downlink_cb = {
@@ -289,129 +1088,108 @@ int main(void)
 		LOG_ERR("Failed to initialize sensors. Continuing with LoRaWAN setup.");
 	}
 
-	lora_dev = DEVICE_DT_GET(DT_ALIAS(lora0));
-	if (!device_is_ready(lora_dev)) {
-		LOG_ERR("%s: device not ready.", lora_dev->name);
-		return -ENODEV;
+	ret = vib_fft_init(ACCEL_STREAM_ODR_HZ, fft_bands, ARRAY_SIZE(fft_bands));
+	if (ret < 0) {
+		LOG_ERR("vib_fft_init failed: %d", ret);
 	}
+	fft_ready = (ret == 0);
 
-	ret = lorawan_start();
+	ret = anomaly_init(&anomaly_det, anomaly_cfg);
 	if (ret < 0) {
-		LOG_ERR("lorawan_start failed: %d", ret);
-		return ret;
+		LOG_ERR("anomaly_init failed: %d", ret);
 	}
+	anomaly_ready = (ret == 0);
 
-	lorawan_register_downlink_callback(&downlink_cb);
-	lorawan_register_dr_changed_callback(datarate_changed);
-
-	join_cfg.mode = LORAWAN_ACT_OTAA;
-	join_cfg.dev_eui = dev_eui;
-	join_cfg.otaa.join_eui = join_eui;
-	join_cfg.otaa.app_key = app_key;
-	join_cfg.otaa.nwk_key = app_key;
+	rbe_init(&rbe, &rbe_cfg);
+	batch_init(&uplink_batch, UPLINK_MIN_PAYLOAD, BATCH_MAX_AGE_MS);
+	batch_set_codec(&uplink_batch, payload_batch_fields);
 
-	LOG_INF("Joining network over OTAA");
-	ret = lorawan_join(&join_cfg);
+	ret = tlog_flash_open(&telemetry_flash);
+	if (ret == 0) {
+		ret = tlog_mount(&telemetry_log, &telemetry_flash);
+	}
 	if (ret < 0) {
-		LOG_ERR("lorawan_join_network failed: %d", ret);
-		return ret;
+		LOG_ERR("Telemetry log unavailable (%d), records are not kept across outages", ret);
 	}
-
-	lorawan_enable_adr(true);
+	log_ready = (ret == 0);
+	uplink_set_done_cb(uplink_done);
 
 	/*
-	 * Clock synchronization is required to schedule the multicast session
-	 * in class C mode. It can also be used independent of FUOTA.
+	 * Vibration capture runs from the ADXL345 FIFO independent of the uplink
+	 * loop. Builds without the stream read it one-shot alongside the BME280;
+	 * with it, one-shot register reads would steal the FIFO's samples.
 	 */
-	lorawan_clock_sync_run();
+	if (adxl345 != NULL && IS_ENABLED(CONFIG_ADXL345_STREAM)) {
+		ret = accel_stream_start();
+		if (ret < 0) {
+			LOG_ERR("accel_stream_start failed: %d", ret);
+		}
+	}
 
-	/*
-	 * The multicast session setup service is automatically started in the
-	 * background. It is also responsible for switching to class C at a
-	 * specified time.
-	 */
+	accel_oneshot = (adxl345 != NULL && !IS_ENABLED(CONFIG_ADXL345_STREAM));
+	sensors_ready = (sensor_acq_init(bme280, accel_oneshot ? adxl345 : NULL) == 0);
+	if (!sensors_ready) {
+		LOG_ERR("sensor_acq_init failed, sensor uplinks disabled");
+		accel_oneshot = false;
+	}
+	vib_features_init(&vib_engine, accel_oneshot ? VIB_ONESHOT_WINDOW : VIB_WINDOW_MAX);
 
-	/*
-	 * The fragmented data transport transfers the actual firmware image.
-	 * It could also be used in a class A session, but would take very long
-	 * in that case.
-	 */
-	lorawan_frag_transport_run(fuota_finished);
+	/* Sampling starts right away, records wait in the telemetry log until the join */
+	ret = sample_sched_start(sched_periods);
+	if (ret < 0) {
+		LOG_ERR("sample_sched_start failed: %d", ret);
+		return ret;
+	}
+
+	lora_dev = DEVICE_DT_GET(DT_ALIAS(lora0));
+	ret = device_is_ready(lora_dev) ? lorawan_start() : -ENODEV;
+	if (ret < 0) {
+		LOG_ERR("LoRaWAN unavailable (%d), sampling only", ret);
+	} else {
+		lorawan_register_downlink_callback(&downlink_cb);
+		lorawan_register_dr_changed_callback(datarate_changed);
+
+		join_cfg.mode = LORAWAN_ACT_OTAA;
+		join_cfg.dev_eui = dev_eui;
+		join_cfg.otaa.join_eui = join_eui;
+		join_cfg.otaa.app_key = app_key;
+		join_cfg.otaa.nwk_key = app_key;
+
+		LOG_INF("Restoring the session or joining over OTAA in the background");
+		lora_link_start(&join_cfg, link_up);
+	}
+
+	bool was_up = false;
 
-	/*
-	 * Regular uplinks are required to open downlink slots in class A for
-	 * FUOTA setup by the server.
-	 */
 	while (1) {
-		/* Try to read and send sensor data */
-		if (bme280 != NULL && adxl345 != NULL) {
-			struct sensor_q31_data temp_data = {0};
-			struct sensor_q31_data press_data = {0};
-			struct sensor_q31_data hum_data = {0};
-			struct sensor_value accel[3] = {0};
-
-			/* Read BME280 data */
-			int rc_bme280 = read_bme280_data(&temp_data, &press_data, &hum_data);
-			
-			/* Read ADXL345 data */
-			int rc_adxl345 = read_adxl345_data(accel);
-
-			if (rc_bme280 == 0 && rc_adxl345 == 0) {
-            LOG_INF("[BME280] Temp: %s%d.%d Degree | Pressure: %s%d.%d Pa | Humidity: %s%d.%d %%",
-                    PRIq_arg(temp_data.readings[0].temperature, 6, temp_data.shift),
-                    PRIq_arg(press_data.readings[0].pressure, 6, press_data.shift),
-                    PRIq_arg(hum_data.readings[0].humidity, 6, hum_data.shift));
-            
-            LOG_INF("[ADXL345] Accel X: %d.%06d m/s*s | Y: %d.%06d m/s*s | Z: %d.%06d m/s*s",
-                    accel[0].val1, accel[0].val2,
-                    accel[1].val1, accel[1].val2,
-                    accel[2].val1, accel[2].val2);
-            
-            LOG_INF("---");
-        } else {
-            if (rc_bme280 != 0) {
-                LOG_ERR("BME280 read failed with code %d", rc_bme280);
-            }
-            if (rc_adxl345 != 0) {
-                LOG_ERR("ADXL345 read failed with code %d", rc_adxl345);
-            }
-        }
-
-			/* Pack and send sensor data if both readings were successful */
-			if (rc_bme280 == 0 && rc_adxl345 == 0) {
-				uint8_t sensor_payload[12];
-				int payload_size = pack_sensor_payload(&temp_data, &hum_data, &press_data,
-														accel, sensor_payload);
-
-				ret = lorawan_send(2, sensor_payload, payload_size, LORAWAN_MSG_UNCONFIRMED);
-
-				if (ret == 0) {
-					LOG_INF("Sensor data sent!");
-				} else {
-					LOG_ERR("lorawan_send (sensor) failed: %d", ret);
-				}
-			} else {
-				if (rc_bme280 != 0) {
-					LOG_ERR("BME280 read failed: %d", rc_bme280);
-				}
-				if (rc_adxl345 != 0) {
-					LOG_ERR("ADXL345 read failed: %d", rc_adxl345);
-				}
-			}
-		} else {
-			/* Fallback to original data if sensors not available */
-			ret = lorawan_send(2, data, sizeof(data), LORAWAN_MSG_UNCONFIRMED);
-
-			if (ret == 0) {
-				LOG_INF("Updated sent!");
-			} else {
-				LOG_ERR("lorawan_send failed: %d", ret);
-			}
+		uint32_t due = sample_sched_wait(K_FOREVER);
+		bool up = lora_link_is_up();
+
+		/* Records logged before a reset go out as soon as the link is back */
+		if (up && !was_up) {
+			flush_batch();
 		}
+		was_up = up;
 
+		/* Solving the block and decoding it run here, not in the stack's context */
+		if (atomic_clear(&fuota_received) && frag_session_finish() == 0) {
+			install_update();
+		}
 
+		/* Results arrive between uplink periods, the 160 ms tick picks them up */
+		if (log_ready && check_sensor_tx() && catching_up) {
+			flush_batch();
+		}
 
-		k_sleep(DELAY);
+		if (due & BIT(SAMPLE_SCHED_ACCEL)) {
+			run_accel_task();
+		}
+		if (due & BIT(SAMPLE_SCHED_ENV)) {
+			run_env_task();
+		}
+		if (due & BIT(SAMPLE_SCHED_UPLINK)) {
+			run_uplink_task();
+		}
 	}
 
 	return 0;
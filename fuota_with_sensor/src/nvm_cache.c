@@ -0,0 +1,208 @@
+/*
+ * Write-back cache for persisted settings
+ *
+ * Values live in one pool, each slot keeps the area it got first; the
+ * LoRaWAN groups never change size, so the pool does not fragment.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "nvm_cache.h"
+
+void nvm_cache_init(struct nvm_cache *c, uint32_t delay_ms)
+{
+    memset(c, 0, sizeof(*c));
+    c->delay_ms = delay_ms;
+}
+
+static int check(const char *name, uint16_t len)
+{
+    if (name[0] == '\0' || strlen(name) >= NVM_CACHE_NAME_MAX) {
+        return -ENAMETOOLONG;
+    }
+    if (len > NVM_CACHE_VALUE_MAX) {
+        return -EMSGSIZE;
+    }
+    return 0;
+}
+
+/**
+ * Make room for len bytes in a slot, a new area at the end of the pool if
+ * the old one is too small
+ */
+static int reserve(struct nvm_cache *c, struct nvm_cache_entry *e, uint16_t len)
+{
+    if (len <= e->cap) {
+        return 0;
+    }
+    if (c->pool_used + len > NVM_CACHE_POOL) {
+        return -ENOMEM;
+    }
+    e->off = c->pool_used;
+    e->cap = len;
+    c->pool_used += len;
+    return 0;
+}
+
+int nvm_cache_load(struct nvm_cache *c, uint16_t slot, const char *name, const void *val,
+                   uint16_t len)
+{
+    struct nvm_cache_entry *e;
+    int ret = check(name, len);
+
+    if (ret < 0) {
+        return ret;
+    }
+    if (slot >= NVM_CACHE_ENTRIES || c->entries[slot].name[0] != '\0') {
+        return -EINVAL;
+    }
+
+    e = &c->entries[slot];
+    ret = reserve(c, e, len);
+    if (ret < 0) {
+        return ret;
+    }
+    strcpy(e->name, name);
+    memcpy(&c->pool[e->off], val, len);
+    e->len = len;
+    return 0;
+}
+
+int nvm_cache_find(const struct nvm_cache *c, const char *name)
+{
+    for (int i = 0; i < NVM_CACHE_ENTRIES; i++) {
+        if (strcmp(c->entries[i].name, name) == 0 && name[0] != '\0') {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int nvm_cache_stage(struct nvm_cache *c, const char *name, const void *val, uint16_t len,
+                    uint32_t now_ms, bool urgent)
+{
+    struct nvm_cache_entry *e;
+    int slot = nvm_cache_find(c, name);
+    int ret = check(name, len);
+
+    if (ret < 0) {
+        return ret;
+    }
+    c->stats.staged++;
+
+    if (slot < 0) {
+        for (slot = 0; slot < NVM_CACHE_ENTRIES && c->entries[slot].name[0] != '\0'; slot++) {
+        }
+        if (slot == NVM_CACHE_ENTRIES) {
+            return -ENOSPC;
+        }
+        if (len == 0) {
+            /* Deleting what was never stored */
+            c->stats.unchanged++;
+            return -ENOENT;
+        }
+    } else if (c->entries[slot].len == len &&
+               memcmp(&c->pool[c->entries[slot].off], val, len) == 0) {
+        c->stats.unchanged++;
+        c->entries[slot].urgent |= urgent && c->entries[slot].dirty;
+        return slot;
+    }
+
+    e = &c->entries[slot];
+    ret = reserve(c, e, len);
+    if (ret < 0) {
+        return ret;
+    }
+    strcpy(e->name, name);
+    memcpy(&c->pool[e->off], val, len);
+    e->len = len;
+
+    if (e->dirty) {
+        c->stats.coalesced++;
+    } else {
+        e->dirty = true;
+        e->dirty_ms = now_ms;
+    }
+    e->urgent |= urgent;
+    return slot;
+}
+
+const uint8_t *nvm_cache_value(const struct nvm_cache *c, uint16_t slot)
+{
+    return &c->pool[c->entries[slot].off];
+}
+
+static uint32_t due_in(const struct nvm_cache *c, const struct nvm_cache_entry *e,
+                       uint32_t now_ms)
+{
+    uint32_t age = now_ms - e->dirty_ms;
+
+    return (e->urgent || age >= c->delay_ms) ? 0 : c->delay_ms - age;
+}
+
+int nvm_cache_due(const struct nvm_cache *c, uint32_t now_ms, bool all)
+{
+    for (int i = 0; i < NVM_CACHE_ENTRIES; i++) {
+        const struct nvm_cache_entry *e = &c->entries[i];
+
+        if (e->dirty && (all || due_in(c, e, now_ms) == 0)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+uint32_t nvm_cache_next_ms(const struct nvm_cache *c, uint32_t now_ms)
+{
+    uint32_t next = UINT32_MAX;
+
+    for (int i = 0; i < NVM_CACHE_ENTRIES; i++) {
+        const struct nvm_cache_entry *e = &c->entries[i];
+
+        if (e->dirty && due_in(c, e, now_ms) < next) {
+            next = due_in(c, e, now_ms);
+        }
+    }
+    return next;
+}
+
+void nvm_cache_written(struct nvm_cache *c, uint16_t slot)
+{
+    struct nvm_cache_entry *e = &c->entries[slot];
+
+    e->dirty = false;
+    e->urgent = false;
+    if (e->len == 0) {
+        /* Deleted: the slot is free again, its pool area stays with it */
+        e->name[0] = '\0';
+    }
+    c->stats.written++;
+}
+
+bool nvm_cache_reserve(uint32_t *reserved, uint32_t fcnt, uint32_t step)
+{
+    /* Renew at half the window, the write may land a few frames late */
+    if (fcnt < *reserved && *reserved - fcnt > step / 2) {
+        return false;
+    }
+    *reserved = (fcnt > UINT32_MAX - step) ? UINT32_MAX : fcnt + step;
+    return true;
+}
+
+uint32_t nvm_cache_crc32(const void *data, size_t len)
+{
+    const uint8_t *p = data;
+    uint32_t crc = 0xFFFFFFFF;
+
+    /* Bitwise: runs once per save of a small group */
+    while (len--) {
+        crc ^= *p++;
+        for (int i = 0; i < 8; i++) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+        }
+    }
+    return ~crc;
+}
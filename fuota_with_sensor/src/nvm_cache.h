@@ -0,0 +1,119 @@
+/*
+ * Write-back cache for persisted settings
+ *
+ * The LoRaWAN stack saves its MAC state and frame counters after nearly
+ * every uplink. Saves land here first:
+ * - a value equal to the cached one is dropped
+ * - a changed value is marked dirty and only written to flash once it has
+ *   been dirty for the configured delay, so a run of updates to one key
+ *   costs one flash write
+ * - urgent values (e.g. a new DevNonce) are due at once
+ *
+ * Frame counters are persisted in reserved jumps: nvm_cache_reserve() asks
+ * for a write of fcnt + step only once the counter has used up half of the
+ * last reservation. After a reset the stack restores the reserved value and
+ * counts on from there, so no counter is ever reused although most
+ * increments are never written.
+ *
+ * Has no Zephyr dependency so it also builds on the host (see tests_host);
+ * nvm_store.c is the settings backend that binds it to NVS.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef NVM_CACHE_H_
+#define NVM_CACHE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define NVM_CACHE_ENTRIES   12
+#define NVM_CACHE_NAME_MAX  32     /* Including the NUL */
+#define NVM_CACHE_VALUE_MAX 1280   /* US915 RegionGroup2 is the largest */
+#define NVM_CACHE_POOL      3072   /* Value bytes for all entries */
+
+struct nvm_cache_entry {
+    char name[NVM_CACHE_NAME_MAX];  /* Empty for a free slot */
+    uint16_t off;                   /* Value in the pool */
+    uint16_t cap;
+    uint16_t len;                   /* 0: deleted */
+    bool dirty;
+    bool urgent;
+    uint32_t dirty_ms;              /* First change not yet written */
+};
+
+struct nvm_cache_stats {
+    uint32_t staged;      /* nvm_cache_stage() calls */
+    uint32_t unchanged;   /* ...with the value already cached */
+    uint32_t coalesced;   /* ...on an entry that was still dirty */
+    uint32_t written;     /* Entries written back */
+};
+
+struct nvm_cache {
+    struct nvm_cache_entry entries[NVM_CACHE_ENTRIES];
+    uint8_t pool[NVM_CACHE_POOL];
+    uint16_t pool_used;
+    uint32_t delay_ms;
+    struct nvm_cache_stats stats;
+};
+
+/**
+ * delay_ms: how long a changed value may stay in RAM only
+ */
+void nvm_cache_init(struct nvm_cache *c, uint32_t delay_ms);
+
+/**
+ * Put a value read from flash into slot, clean
+ * Returns 0 on success, -EINVAL for a bad slot or a slot in use,
+ * -ENAMETOOLONG, -EMSGSIZE above NVM_CACHE_VALUE_MAX, -ENOMEM if the pool is
+ * full
+ */
+int nvm_cache_load(struct nvm_cache *c, uint16_t slot, const char *name, const void *val,
+                   uint16_t len);
+
+/**
+ * Store a value saved by the application, len 0 deletes it
+ * Returns the slot, or the errors of nvm_cache_load(), -ENOSPC if all
+ * slots are taken, -ENOENT when deleting a name that is not stored
+ */
+int nvm_cache_stage(struct nvm_cache *c, const char *name, const void *val, uint16_t len,
+                    uint32_t now_ms, bool urgent);
+
+/**
+ * Returns the slot holding name, -1 if none
+ */
+int nvm_cache_find(const struct nvm_cache *c, const char *name);
+
+const uint8_t *nvm_cache_value(const struct nvm_cache *c, uint16_t slot);
+
+/**
+ * Next dirty slot to write: urgent or dirty for the delay, any dirty one
+ * with all set
+ * Returns the slot, -1 if none is due
+ */
+int nvm_cache_due(const struct nvm_cache *c, uint32_t now_ms, bool all);
+
+/**
+ * Time until the next slot is due, UINT32_MAX if nothing is dirty
+ */
+uint32_t nvm_cache_next_ms(const struct nvm_cache *c, uint32_t now_ms);
+
+/**
+ * The slot's value is in flash
+ */
+void nvm_cache_written(struct nvm_cache *c, uint16_t slot);
+
+/**
+ * Frame counter reservation: once fcnt is within step / 2 of *reserved,
+ * reserve up to fcnt + step
+ * Returns true when the new *reserved has to be written now
+ */
+bool nvm_cache_reserve(uint32_t *reserved, uint32_t fcnt, uint32_t step);
+
+/**
+ * CRC-32 (IEEE 802.3), as the LoRaMAC NVM groups carry it
+ */
+uint32_t nvm_cache_crc32(const void *data, size_t len);
+
+#endif /* NVM_CACHE_H_ */
@@ -0,0 +1,356 @@
+/*
+ * Settings backend on NVS with a write-back cache
+ *
+ * Each key is one NVS entry, "name\0value", at a fixed id per cache slot.
+ * All entries are read into the cache at init; loads are served from RAM.
+ * NVS spreads the writes over the sectors of the storage partition and
+ * skips a write whose data equals the stored entry.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#include <zephyr/device.h>
+#include <zephyr/drivers/flash.h>
+#include <zephyr/fs/nvs.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/storage/flash_map.h>
+
+#include <LoRaMac.h>
+
+#include "nvm_cache.h"
+#include "nvm_store.h"
+
+LOG_MODULE_REGISTER(nvm_store, CONFIG_LORAWAN_SERVICES_LOG_LEVEL);
+
+#define NVM_PARTITION storage_partition
+
+/* NVS id of cache slot 0 */
+#define NVM_ID_BASE 1
+
+/* Keys of the LoRaWAN NVM groups, see subsys/lorawan/nvm */
+#define LORAWAN_PREFIX "lorawan/nvm/"
+#define CRYPTO_KEY     LORAWAN_PREFIX "Crypto"
+
+/* After a join the other session groups follow the crypto group within this */
+#define JOIN_SETTLE_MS 1000
+
+/* Retry of a failed write */
+#define RETRY_MS (10 * 1000)
+
+BUILD_ASSERT(sizeof(LoRaMacCryptoNvmData_t) <= NVM_CACHE_VALUE_MAX);
+BUILD_ASSERT(sizeof(RegionNvmDataGroup2_t) <= NVM_CACHE_VALUE_MAX);
+
+static struct nvs_fs fs;
+static struct nvm_cache cache;
+static K_MUTEX_DEFINE(cache_lock);
+static struct k_work_delayable flush_work;
+static bool flush_all;
+static bool joined;
+static uint32_t fcnt_reserved;
+static struct nvm_store_stats stats;
+
+/* One NVS entry, also used to patch the crypto group; guarded by cache_lock */
+static uint8_t record[NVM_CACHE_NAME_MAX + NVM_CACHE_VALUE_MAX];
+static LoRaMacCryptoNvmData_t crypto;
+
+/**
+ * Write name and value as the entry of a slot, delete it for len 0
+ */
+static int write_entry(uint16_t slot, const char *name, const void *val, uint16_t len)
+{
+    size_t name_len = strlen(name) + 1;
+    uint32_t start = k_cycle_get_32();
+    uint32_t busy_us;
+    ssize_t ret;
+
+    if (len == 0) {
+        ret = nvs_delete(&fs, NVM_ID_BASE + slot);
+    } else {
+        memcpy(record, name, name_len);
+        memcpy(&record[name_len], val, len);
+        ret = nvs_write(&fs, NVM_ID_BASE + slot, record, name_len + len);
+    }
+
+    busy_us = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+    stats.busy_us += busy_us;
+    stats.busy_max_us = MAX(stats.busy_max_us, busy_us);
+
+    if (ret < 0) {
+        stats.last_err = ret;
+        LOG_ERR("Writing %s failed: %d", name, (int)ret);
+        return ret;
+    }
+
+    /* nvs_write() returns 0 when the entry already held the data */
+    if (ret > 0 || len == 0) {
+        stats.writes++;
+        stats.bytes += ret;
+    }
+    return 0;
+}
+
+static int write_slot(uint16_t slot)
+{
+    const struct nvm_cache_entry *e = &cache.entries[slot];
+    int ret = write_entry(slot, e->name, nvm_cache_value(&cache, slot), e->len);
+
+    if (ret == 0) {
+        nvm_cache_written(&cache, slot);
+    }
+    return ret;
+}
+
+static int write_dirty(bool all)
+{
+    int slot;
+
+    while ((slot = nvm_cache_due(&cache, k_uptime_get_32(), all)) >= 0) {
+        int ret = write_slot(slot);
+
+        if (ret < 0) {
+            return ret;
+        }
+    }
+    return 0;
+}
+
+static void schedule(void)
+{
+    uint32_t next = nvm_cache_next_ms(&cache, k_uptime_get_32());
+
+    if (flush_all) {
+        next = MIN(next, JOIN_SETTLE_MS);
+    }
+    if (next != UINT32_MAX) {
+        k_work_reschedule(&flush_work, K_MSEC(next));
+    }
+}
+
+static void flush_handler(struct k_work *work)
+{
+    ARG_UNUSED(work);
+
+    k_mutex_lock(&cache_lock, K_FOREVER);
+    if (write_dirty(flush_all) < 0) {
+        k_work_reschedule(&flush_work, K_MSEC(RETRY_MS));
+    } else {
+        flush_all = false;
+        schedule();
+    }
+    k_mutex_unlock(&cache_lock);
+}
+
+/**
+ * Persist the crypto group with the uplink counter at its reservation
+ * Returns true if it has to be written soon; sets joined if before the
+ * next uplink
+ */
+static bool crypto_save(LoRaMacCryptoNvmData_t *c)
+{
+    int slot = nvm_cache_find(&cache, CRYPTO_KEY);
+    bool urgent = false;
+
+    if (slot >= 0 && cache.entries[slot].len == sizeof(crypto)) {
+        LoRaMacCryptoNvmData_t old;
+
+        memcpy(&old, nvm_cache_value(&cache, slot), sizeof(old));
+        slot = (old.DevNonce == c->DevNonce && old.JoinNonce == c->JoinNonce) ? slot : -1;
+    } else {
+        slot = -1;
+    }
+
+    if (slot < 0) {
+        /* Joined: a reused DevNonce fails the next join, the session counts from 0 */
+        fcnt_reserved = c->FCntList.FCntUp;
+        flush_all = true;
+        joined = true;
+        urgent = true;
+    }
+
+    urgent |= nvm_cache_reserve(&fcnt_reserved, c->FCntList.FCntUp, NVM_STORE_FCNT_STEP);
+    c->FCntList.FCntUp = fcnt_reserved;
+    c->Crc32 = nvm_cache_crc32(c, sizeof(*c) - sizeof(c->Crc32));
+    return urgent;
+}
+
+static int store_save(struct settings_store *cs, const char *name, const char *value,
+                      size_t val_len)
+{
+    ARG_UNUSED(cs);
+
+    /* Only the LoRaWAN groups change at uplink rate */
+    bool urgent = strncmp(name, LORAWAN_PREFIX, strlen(LORAWAN_PREFIX)) != 0;
+    int slot;
+
+    if (value == NULL) {
+        val_len = 0;
+    }
+
+    k_mutex_lock(&cache_lock, K_FOREVER);
+
+    if (val_len == sizeof(crypto) && strcmp(name, CRYPTO_KEY) == 0) {
+        memcpy(&crypto, value, sizeof(crypto));
+        urgent = crypto_save(&crypto);
+        value = (const char *)&crypto;
+    }
+
+    slot = nvm_cache_stage(&cache, name, value, val_len, k_uptime_get_32(), urgent);
+    stats.saves = cache.stats.staged;
+    stats.unchanged = cache.stats.unchanged;
+    stats.coalesced = cache.stats.coalesced;
+    stats.fcnt_reserved = fcnt_reserved;
+
+    if (slot >= 0 && joined) {
+        /* Not on the uplink path: the first uplink of the session follows */
+        joined = false;
+        write_slot(slot);
+    }
+    if (slot >= 0) {
+        schedule();
+    } else if (slot != -ENOENT) {
+        LOG_ERR("Caching %s failed: %d", name, slot);
+    }
+
+    k_mutex_unlock(&cache_lock);
+    return (slot >= 0 || slot == -ENOENT) ? 0 : slot;
+}
+
+struct read_ctx {
+    const uint8_t *val;
+    size_t len;
+};
+
+static ssize_t read_value(void *cb_arg, void *data, size_t len)
+{
+    struct read_ctx *ctx = cb_arg;
+
+    len = MIN(len, ctx->len);
+    memcpy(data, ctx->val, len);
+    return len;
+}
+
+static int store_load(struct settings_store *cs, const struct settings_load_arg *arg)
+{
+    ARG_UNUSED(cs);
+
+    k_mutex_lock(&cache_lock, K_FOREVER);
+    for (uint16_t slot = 0; slot < NVM_CACHE_ENTRIES; slot++) {
+        const struct nvm_cache_entry *e = &cache.entries[slot];
+        struct read_ctx ctx = {nvm_cache_value(&cache, slot), e->len};
+
+        if (e->name[0] != '\0' && e->len > 0) {
+            settings_call_set_handler(e->name, e->len, read_value, &ctx, arg);
+        }
+    }
+    k_mutex_unlock(&cache_lock);
+    return 0;
+}
+
+static const struct settings_store_itf store_itf = {
+    .csi_load = store_load,
+    .csi_save = store_save,
+};
+
+static struct settings_store store = {
+    .cs_itf = &store_itf,
+};
+
+/**
+ * Read every entry into the cache, skipping malformed ones
+ */
+static void load_entries(void)
+{
+    for (uint16_t slot = 0; slot < NVM_CACHE_ENTRIES; slot++) {
+        ssize_t len = nvs_read(&fs, NVM_ID_BASE + slot, record, sizeof(record));
+        size_t name_len;
+
+        if (len <= 0 || len > sizeof(record)) {
+            continue;
+        }
+        name_len = strnlen((const char *)record, MIN(len, NVM_CACHE_NAME_MAX));
+        if (name_len + 1 >= len || name_len == NVM_CACHE_NAME_MAX) {
+            LOG_WRN("Dropping malformed entry %u", NVM_ID_BASE + slot);
+            continue;
+        }
+        nvm_cache_load(&cache, slot, (const char *)record, &record[name_len + 1],
+                       len - name_len - 1);
+    }
+
+    int slot = nvm_cache_find(&cache, CRYPTO_KEY);
+
+    if (slot < 0 || cache.entries[slot].len != sizeof(crypto)) {
+        return;
+    }
+
+    /*
+     * The stack restores the counter cached here and counts on from it.
+     * Flash gets the next reservation before the first uplink, so a reset
+     * before the renewal at half of it lands reuses no counter either.
+     */
+    memcpy(&crypto, nvm_cache_value(&cache, slot), sizeof(crypto));
+    fcnt_reserved = crypto.FCntList.FCntUp;
+    nvm_cache_reserve(&fcnt_reserved, crypto.FCntList.FCntUp, NVM_STORE_FCNT_STEP);
+    crypto.FCntList.FCntUp = fcnt_reserved;
+    crypto.Crc32 = nvm_cache_crc32(&crypto, sizeof(crypto) - sizeof(crypto.Crc32));
+    write_entry(slot, CRYPTO_KEY, &crypto, sizeof(crypto));
+    stats.fcnt_reserved = fcnt_reserved;
+}
+
+/* Called by settings_subsys_init() with CONFIG_SETTINGS_CUSTOM */
+int settings_backend_init(void)
+{
+    struct flash_pages_info info;
+    int ret;
+
+    fs.flash_device = FIXED_PARTITION_DEVICE(NVM_PARTITION);
+    if (!device_is_ready(fs.flash_device)) {
+        return -ENODEV;
+    }
+
+    fs.offset = FIXED_PARTITION_OFFSET(NVM_PARTITION);
+    ret = flash_get_page_info_by_offs(fs.flash_device, fs.offset, &info);
+    if (ret < 0) {
+        return ret;
+    }
+    fs.sector_size = info.size;
+    fs.sector_count = FIXED_PARTITION_SIZE(NVM_PARTITION) / info.size;
+
+    ret = nvs_mount(&fs);
+    if (ret < 0) {
+        LOG_ERR("nvs_mount failed: %d", ret);
+        return ret;
+    }
+
+    nvm_cache_init(&cache, NVM_STORE_DELAY_MS);
+    load_entries();
+    k_work_init_delayable(&flush_work, flush_handler);
+
+    settings_src_register(&store);
+    settings_dst_register(&store);
+    return 0;
+}
+
+int nvm_store_flush(void)
+{
+    int ret;
+
+    k_mutex_lock(&cache_lock, K_FOREVER);
+    ret = write_dirty(true);
+    if (ret == 0) {
+        flush_all = false;
+    }
+    k_mutex_unlock(&cache_lock);
+    return ret;
+}
+
+void nvm_store_get_stats(struct nvm_store_stats *out)
+{
+    k_mutex_lock(&cache_lock, K_FOREVER);
+    *out = stats;
+    k_mutex_unlock(&cache_lock);
+}
@@ -0,0 +1,50 @@
+/*
+ * Settings backend on NVS with a write-back cache
+ *
+ * Replaces the stock NVS settings backend (CONFIG_SETTINGS_CUSTOM). Every
+ * settings_save_one() goes through nvm_cache.h: the LoRaWAN MAC state is
+ * written at most once per NVM_STORE_DELAY_MS, the uplink frame counter in
+ * jumps of NVM_STORE_FCNT_STEP, and only a new DevNonce or session and the
+ * other settings keys are written right away. Writes happen on the system
+ * work queue, off the uplink path; only the reservation at boot and the
+ * crypto group after a join are written in the caller's context.
+ *
+ * Power-fail safety: NVS writes each key atomically. A reset loses at most
+ * the MAC state of the last delay, and the frame counter restored is always
+ * above every counter already sent.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef NVM_STORE_H_
+#define NVM_STORE_H_
+
+#include <stdint.h>
+
+/* Longest a MAC state change stays in RAM only */
+#define NVM_STORE_DELAY_MS  (10 * 60 * 1000)
+
+/* Uplink frame counters reserved per write */
+#define NVM_STORE_FCNT_STEP 64
+
+struct nvm_store_stats {
+    uint32_t saves;          /* settings_save_one() calls reaching the backend */
+    uint32_t unchanged;      /* ...with the value already stored */
+    uint32_t coalesced;      /* ...folded into a pending write */
+    uint32_t writes;         /* NVS writes and deletes that programmed flash */
+    uint32_t bytes;          /* Bytes programmed */
+    uint32_t fcnt_reserved;  /* Frame counter persisted, next reservation point */
+    uint32_t busy_us;        /* Time spent in NVS writes */
+    uint32_t busy_max_us;    /* Longest single write, a sector erase included */
+    int last_err;            /* Last NVS error, 0 if none */
+};
+
+/**
+ * Write every pending value now, e.g. before a reboot
+ * Returns 0 on success, negative NVS error
+ */
+int nvm_store_flush(void);
+
+void nvm_store_get_stats(struct nvm_store_stats *stats);
+
+#endif /* NVM_STORE_H_ */
@@ -0,0 +1,174 @@
+/*
+ * Table-driven sensor record encoder
+ *
+ * Each field is saturated to its range, then offset and rounded to its step,
+ * both fixed at compile time from payload_schema.h, with integer math only.
+ * Fields are packed through a 64-bit accumulator: after each field the
+ * pending bits are stored as a whole big-endian word into a scratch buffer
+ * with 8 bytes of slack and the write pointer advances by the completed
+ * bytes, so no field needs a branch on its width or alignment.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "payload.h"
+
+/* Number of k in 0..31 with range >> k > max: the smallest fitting exponent */
+#define EXP_STEP(range, max, k) + ((((uint64_t)(range)) >> (k)) > (max))
+#define EXP_STEP8(range, max, k)                                                   \
+    EXP_STEP(range, max, k) EXP_STEP(range, max, k + 1) EXP_STEP(range, max, k + 2) \
+    EXP_STEP(range, max, k + 3) EXP_STEP(range, max, k + 4) EXP_STEP(range, max, k + 5) \
+    EXP_STEP(range, max, k + 6) EXP_STEP(range, max, k + 7)
+#define FIELD_EXP(lo, hi, max)                                                     \
+    (0 EXP_STEP8((int64_t)(hi) - (lo), max, 0) EXP_STEP8((int64_t)(hi) - (lo), max, 8) \
+       EXP_STEP8((int64_t)(hi) - (lo), max, 16) EXP_STEP8((int64_t)(hi) - (lo), max, 24))
+
+#define FIELD_MAX(bits) ((uint32_t)((1ULL << (bits)) - 1))
+
+#define PAYLOAD_FIELD(name, bits, lo, hi, scale, unit) \
+    {(bits), FIELD_EXP(lo, hi, FIELD_MAX(bits)), (lo), (hi), FIELD_MAX(bits)},
+
+#define PAYLOAD_CHECK_FIELD(name, bits, lo, hi, ...)                                  \
+    _Static_assert((bits) >= 1 && (bits) <= 31, "field " #name " must be 1..31 bits"); \
+    _Static_assert((lo) < (hi) && (int64_t)(hi) - (lo) <= INT32_MAX,                  \
+                   "field " #name " range must be non-empty and below 2^31");
+
+PAYLOAD_FULL_FIELDS(PAYLOAD_CHECK_FIELD)
+PAYLOAD_COMPACT_FIELDS(PAYLOAD_CHECK_FIELD)
+
+static const struct payload_field full_fields[] = {PAYLOAD_FULL_FIELDS(PAYLOAD_FIELD)};
+static const struct payload_field compact_fields[] = {PAYLOAD_COMPACT_FIELDS(PAYLOAD_FIELD)};
+
+const struct payload_schema payload_schema_full = {
+    .id = PAYLOAD_ID(PAYLOAD_KIND_FULL),
+    .nfields = PAYLOAD_FULL_NUM_FIELDS,
+    .size = PAYLOAD_FULL_SIZE,
+    .fields = full_fields,
+};
+
+const struct payload_schema payload_schema_compact = {
+    .id = PAYLOAD_ID(PAYLOAD_KIND_COMPACT),
+    .nfields = PAYLOAD_COMPACT_NUM_FIELDS,
+    .size = PAYLOAD_COMPACT_SIZE,
+    .fields = compact_fields,
+};
+
+static const struct payload_schema *const schemas[] = {
+    &payload_schema_full,
+    &payload_schema_compact,
+};
+
+/* Unaligned big-endian 64-bit access, a load/store plus byte swap on GCC */
+static void put_be64(uint8_t *p, uint64_t v)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    v = __builtin_bswap64(v);
+    memcpy(p, &v, sizeof(v));
+#else
+    for (int i = 0; i < 8; i++) {
+        p[i] = (uint8_t)(v >> (56 - 8 * i));
+    }
+#endif
+}
+
+static uint64_t get_be64(const uint8_t *p)
+{
+    uint64_t v;
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    memcpy(&v, p, sizeof(v));
+    v = __builtin_bswap64(v);
+#else
+    v = 0;
+    for (int i = 0; i < 8; i++) {
+        v = (v << 8) | p[i];
+    }
+#endif
+    return v;
+}
+
+const struct payload_schema *payload_schema_find(uint8_t id)
+{
+    for (size_t i = 0; i < sizeof(schemas) / sizeof(schemas[0]); i++) {
+        if (schemas[i]->id == id) {
+            return schemas[i];
+        }
+    }
+    return NULL;
+}
+
+int payload_encode(const struct payload_schema *schema, const int32_t *values, uint8_t *rec)
+{
+    uint8_t tmp[PAYLOAD_RECORD_MAX + 8];
+    uint8_t *p = tmp;
+    uint64_t acc = 0;
+    unsigned int nbits = 0;
+
+    for (int i = 0; i < schema->nfields; i++) {
+        const struct payload_field *f = &schema->fields[i];
+        int32_t v = values[i];
+
+        v = (v < f->lo) ? f->lo : v;
+        v = (v > f->hi) ? f->hi : v;
+
+        /* Offset and round to the field step; hi - lo < 2^31 so no wrap */
+        uint32_t w = ((uint32_t)v - (uint32_t)f->lo + ((1U << f->exp) >> 1)) >> f->exp;
+
+        w = (w > f->max) ? f->max : w;
+
+        /* Fewer than 8 bits pending, so at most 39 after this field */
+        acc = (acc << f->bits) | w;
+        nbits += f->bits;
+        put_be64(p, acc << (64 - nbits));
+        p += nbits >> 3;
+        nbits &= 7;
+        acc &= (1U << nbits) - 1;
+    }
+
+    rec[0] = schema->id;
+    memcpy(&rec[1], tmp, schema->size - 1);
+    return schema->size;
+}
+
+int payload_unpack(const struct payload_schema *schema, const uint8_t *rec, size_t len,
+                   int32_t *values)
+{
+    uint8_t tmp[PAYLOAD_RECORD_MAX + 8];
+    unsigned int pos = 0;
+
+    if (len != schema->size || rec[0] != schema->id) {
+        return -EINVAL;
+    }
+
+    memcpy(tmp, &rec[1], len - 1);
+    memset(&tmp[len - 1], 0, 8);
+
+    for (int i = 0; i < schema->nfields; i++) {
+        const struct payload_field *f = &schema->fields[i];
+        values[i] = (int32_t)((get_be64(&tmp[pos >> 3]) << (pos & 7)) >> (64 - f->bits));
+        pos += f->bits;
+    }
+    return schema->nfields;
+}
+
+int32_t payload_expand(const struct payload_schema *schema, int field, uint32_t wire)
+{
+    const struct payload_field *f = &schema->fields[field];
+
+    return (int32_t)((uint32_t)f->lo + (wire << f->exp));
+}
+
+int payload_batch_fields(const uint8_t *rec, uint8_t len, int32_t *fields)
+{
+    const struct payload_schema *schema = (len > 0) ? payload_schema_find(rec[0]) : NULL;
+
+    if (schema == NULL || payload_unpack(schema, rec, len, &fields[1]) < 0) {
+        return -EINVAL;
+    }
+
+    fields[0] = rec[0];
+    return schema->nfields + 1;
+}
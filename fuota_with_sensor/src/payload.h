@@ -0,0 +1,88 @@
+/*
+ * Table-driven sensor record encoder
+ *
+ * Record layouts come from payload_schema.h. Encoding walks the field
+ * table of a schema, the same loop for every field with no per-field
+ * branches; unpacking is its inverse and shared with the host decoder.
+ * Has no Zephyr dependency so it also builds on the host (see tests_host).
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef PAYLOAD_H_
+#define PAYLOAD_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "payload_schema.h"
+
+/* Field indices, e.g. PAYLOAD_FULL_temp */
+#define PAYLOAD_ENUM_FULL(name, ...) PAYLOAD_FULL_##name,
+#define PAYLOAD_ENUM_COMPACT(name, ...) PAYLOAD_COMPACT_##name,
+
+enum { PAYLOAD_FULL_FIELDS(PAYLOAD_ENUM_FULL) PAYLOAD_FULL_NUM_FIELDS };
+enum { PAYLOAD_COMPACT_FIELDS(PAYLOAD_ENUM_COMPACT) PAYLOAD_COMPACT_NUM_FIELDS };
+
+/* Record sizes including the id byte */
+#define PAYLOAD_BITS(name, bits, ...) + (bits)
+#define PAYLOAD_SIZE(fields) (1 + ((0 fields(PAYLOAD_BITS)) + 7) / 8)
+
+#define PAYLOAD_FULL_SIZE    PAYLOAD_SIZE(PAYLOAD_FULL_FIELDS)
+#define PAYLOAD_COMPACT_SIZE PAYLOAD_SIZE(PAYLOAD_COMPACT_FIELDS)
+
+/* Bounds over all schemas */
+#define PAYLOAD_MAX_FIELDS PAYLOAD_FULL_NUM_FIELDS
+#define PAYLOAD_RECORD_MAX PAYLOAD_FULL_SIZE
+
+struct payload_field {
+    uint8_t bits;
+    uint8_t exp;     /* One wire step is 2^exp encoder units */
+    int32_t lo;      /* Encoder value of wire 0, saturation bounds */
+    int32_t hi;
+    uint32_t max;    /* Largest wire value, (1 << bits) - 1 */
+};
+
+struct payload_schema {
+    uint8_t id;
+    uint8_t nfields;
+    uint8_t size;    /* Record bytes including the id */
+    const struct payload_field *fields;
+};
+
+extern const struct payload_schema payload_schema_full;
+extern const struct payload_schema payload_schema_compact;
+
+/**
+ * Look up a schema by the id byte of a record
+ * Returns the schema, NULL for an unknown id
+ */
+const struct payload_schema *payload_schema_find(uint8_t id);
+
+/**
+ * Pack values[nfields] (encoder units) into rec, which must hold
+ * schema->size bytes
+ * Returns the record size
+ */
+int payload_encode(const struct payload_schema *schema, const int32_t *values, uint8_t *rec);
+
+/**
+ * Unpack a record into values[nfields] in wire units
+ * Returns the number of fields, -EINVAL if len or the id do not match
+ */
+int payload_unpack(const struct payload_schema *schema, const uint8_t *rec, size_t len,
+                   int32_t *values);
+
+/**
+ * Encoder units of a wire value of a field
+ */
+int32_t payload_expand(const struct payload_schema *schema, int field, uint32_t wire);
+
+/**
+ * Batch codec field unpacker (batch_fields_cb): the id byte, then the
+ * fields of the record's schema
+ * Returns the number of fields, -EINVAL for an unknown record
+ */
+int payload_batch_fields(const uint8_t *rec, uint8_t len, int32_t *fields);
+
+#endif /* PAYLOAD_H_ */
@@ -0,0 +1,80 @@
+/*
+ * Sensor record schema
+ *
+ * The one definition of every uplink record layout. payload.c expands it
+ * into the encoder tables used by the firmware, the host decoder in
+ * ../decoder expands it into field names and physical units. Change a
+ * layout here and bump PAYLOAD_SCHEMA_VERSION; nothing else describes it.
+ *
+ * Each record starts with an id byte, PAYLOAD_ID(kind), followed by the
+ * fields packed MSB first with no padding between them, zero padded to a
+ * whole byte. Fields are listed as
+ *
+ *   X(name, bits, lo, hi, scale, unit)
+ *
+ * - bits: width on the wire, 1..31
+ * - lo, hi: range of the value handed to the encoder (encoder units). Values
+ *   outside it saturate. The encoder sends (value - lo) / 2^exp, rounded,
+ *   with exp the smallest exponent that makes hi - lo fit the bits; both are
+ *   fixed at compile time, so no field can overflow
+ * - scale, unit: physical value = encoder value * scale, for the host
+ *
+ * Environment ranges are the BME280 operating range; vibration fields keep
+ * the range of their vib_features types. The Q8 shape factors saturate at
+ * 16 for crest factor and kurtosis, and at +/-8 for skewness.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef PAYLOAD_SCHEMA_H_
+#define PAYLOAD_SCHEMA_H_
+
+#define PAYLOAD_SCHEMA_VERSION 2
+
+/* Record kinds, high nibble of the id byte */
+#define PAYLOAD_KIND_FULL    1
+#define PAYLOAD_KIND_COMPACT 2
+
+#define PAYLOAD_ID(kind) (((kind) << 4) | PAYLOAD_SCHEMA_VERSION)
+
+/* Spectrum bands carried by the full record */
+#define PAYLOAD_FFT_BANDS 4
+
+/* Features of one vibration axis over the last window, shape factors in Q8 */
+#define PAYLOAD_AXIS_FIELDS(X, axis)                                    \
+    X(axis##_rms,   16,      0, 65535,  1.0,         "mg")              \
+    X(axis##_p2p,   16,      0, 65535,  1.0,         "mg")              \
+    X(axis##_crest,  8,      0, 4095,   1.0 / 256,   "")                \
+    X(axis##_skew,   8,  -2048, 2047,   1.0 / 256,   "")                \
+    X(axis##_kurt,   8,      0, 4095,   1.0 / 256,   "")
+
+/* Temperature, humidity and pressure x1000, sent in steps of 0.002 */
+#define PAYLOAD_ENV_FIELDS(X)                                           \
+    X(temp,         16, -40000, 85000,  0.001,       "degC")            \
+    X(hum,          16,      0, 100000, 0.001,       "%RH")             \
+    X(press,        16,  30000, 110000, 0.001,       "kPa")
+
+/*
+ * Full record: environment, features of X, Y and Z, spectrum summary of one
+ * axis: band levels (1-5, 5-12, 12-25, 25-50 Hz, 8 per octave of power, see
+ * vib_spectrum), peak frequency and level. Vibration fields are zero until
+ * the first window completes.
+ */
+#define PAYLOAD_FULL_FIELDS(X)                                          \
+    PAYLOAD_ENV_FIELDS(X)                                               \
+    PAYLOAD_AXIS_FIELDS(X, x)                                           \
+    PAYLOAD_AXIS_FIELDS(X, y)                                           \
+    PAYLOAD_AXIS_FIELDS(X, z)                                           \
+    X(band0,         8,      0, 255,    1.0,         "lvl")             \
+    X(band1,         8,      0, 255,    1.0,         "lvl")             \
+    X(band2,         8,      0, 255,    1.0,         "lvl")             \
+    X(band3,         8,      0, 255,    1.0,         "lvl")             \
+    X(peak_freq,    16,      0, 65535,  0.01,        "Hz")              \
+    X(peak_lvl,      8,      0, 255,    1.0,         "lvl")
+
+/* Compact record for DR0: environment and AC RMS of the acceleration vector */
+#define PAYLOAD_COMPACT_FIELDS(X)                                       \
+    PAYLOAD_ENV_FIELDS(X)                                               \
+    X(vib_rms,      16,      0, 65535,  1.0,         "mg")
+
+#endif /* PAYLOAD_SCHEMA_H_ */
@@ -0,0 +1,61 @@
+/*
+ * Report-by-exception uplink filter
+ *
+ * Deadbands are measured against the last *sent* value, not the previous
+ * sample, so a slow drift still produces a frame once it adds up.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include "rbe.h"
+
+void rbe_init(struct rbe_filter *f, const struct rbe_config *cfg)
+{
+    memset(f, 0, sizeof(*f));
+    f->cfg = *cfg;
+}
+
+void rbe_set_heartbeat(struct rbe_filter *f, uint32_t heartbeat_ms)
+{
+    f->cfg.heartbeat_ms = heartbeat_ms;
+}
+
+static bool outside_deadband(const struct rbe_filter *f, const int32_t values[RBE_NUM_CH])
+{
+    for (int i = 0; i < RBE_NUM_CH; i++) {
+        int64_t diff = (int64_t)values[i] - f->reference[i];
+
+        if (f->cfg.deadband[i] != RBE_DEADBAND_OFF &&
+            (diff > f->cfg.deadband[i] || diff < -(int64_t)f->cfg.deadband[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool rbe_check(struct rbe_filter *f, const int32_t values[RBE_NUM_CH], uint32_t now_ms,
+               uint8_t len)
+{
+    bool changed = !f->have_reference || outside_deadband(f, values);
+    bool heartbeat = !changed && f->cfg.heartbeat_ms != 0 &&
+                     (now_ms - f->last_sent_ms) >= f->cfg.heartbeat_ms;
+
+    if (!changed && !heartbeat) {
+        f->stats.suppressed++;
+        f->stats.suppressed_bytes += len;
+        return false;
+    }
+
+    memcpy(f->reference, values, sizeof(f->reference));
+    f->have_reference = true;
+    f->last_sent_ms = now_ms;
+    f->stats.sent++;
+    if (changed) {
+        f->stats.sent_change++;
+    } else {
+        f->stats.sent_heartbeat++;
+    }
+    return true;
+}
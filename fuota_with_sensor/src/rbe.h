@@ -0,0 +1,66 @@
+/*
+ * Report-by-exception uplink filter
+ *
+ * A frame is sent only when a channel moved past its deadband since the last
+ * sent frame, or when the heartbeat interval expired. The heartbeat also
+ * keeps class A downlink windows open for FUOTA setup. Has no Zephyr
+ * dependency so it also builds on the host (see tests_host).
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef RBE_H_
+#define RBE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+enum rbe_channel {
+    RBE_CH_TEMP,       /* 0.001 degC */
+    RBE_CH_HUM,        /* 0.001 %RH */
+    RBE_CH_PRESS,      /* 0.001 kPa */
+    RBE_CH_VIB_RMS,    /* Total AC RMS, mg */
+    RBE_CH_VIB_LEVEL,  /* Loudest spectrum band, vib_spectrum level */
+    RBE_NUM_CH,
+};
+
+/* Deadband that never triggers a frame on its own */
+#define RBE_DEADBAND_OFF INT32_MAX
+
+struct rbe_config {
+    int32_t deadband[RBE_NUM_CH];   /* Change that forces a frame, channel units */
+    uint32_t heartbeat_ms;          /* Longest silence, 0 = no heartbeat */
+};
+
+struct rbe_stats {
+    uint32_t sent;              /* Frames let through */
+    uint32_t sent_change;       /* ...because a channel left its deadband */
+    uint32_t sent_heartbeat;    /* ...because the heartbeat expired */
+    uint32_t suppressed;        /* Frames not sent */
+    uint32_t suppressed_bytes;  /* Payload bytes not sent */
+};
+
+struct rbe_filter {
+    struct rbe_config cfg;
+    int32_t reference[RBE_NUM_CH];  /* Values of the last sent frame */
+    uint32_t last_sent_ms;
+    bool have_reference;
+    struct rbe_stats stats;
+};
+
+void rbe_init(struct rbe_filter *f, const struct rbe_config *cfg);
+
+/**
+ * New heartbeat interval, e.g. to pace frames to an airtime budget
+ */
+void rbe_set_heartbeat(struct rbe_filter *f, uint32_t heartbeat_ms);
+
+/**
+ * Decide whether the current values are worth a frame of len bytes.
+ * On true the values become the new reference, the caller must send.
+ * Returns true to send, false to suppress
+ */
+bool rbe_check(struct rbe_filter *f, const int32_t values[RBE_NUM_CH], uint32_t now_ms,
+               uint8_t len);
+
+#endif /* RBE_H_ */
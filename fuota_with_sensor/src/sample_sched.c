@@ -0,0 +1,143 @@
+/*
+ * Drift-free periodic sampling scheduler
+ *
+ * A single periodic k_timer provides the time base. Zephyr reloads periodic
+ * timers from the previous expiry, not from when the handler ran, so release
+ * times stay on an absolute grid regardless of how long the tasks take.
+ * Each release is posted as an event bit to the sampling thread.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include "sample_sched.h"
+
+LOG_MODULE_REGISTER(sample_sched, CONFIG_LORAWAN_SERVICES_LOG_LEVEL);
+
+struct sched_task {
+    uint32_t period_ticks;   /* In scheduler ticks, 0 = disabled */
+    int64_t deadline;        /* Kernel ticks of the pending release */
+    uint64_t jitter_sum_us;
+    struct sample_sched_stats stats;
+};
+
+static struct sched_task tasks[SAMPLE_SCHED_NUM_TASKS];
+static uint32_t tick_ms;
+static int64_t start_ticks;
+static uint32_t tick_count;
+
+static K_EVENT_DEFINE(sched_events);
+
+static uint32_t period_gcd(uint32_t a, uint32_t b)
+{
+    while (b != 0) {
+        uint32_t r = a % b;
+
+        a = b;
+        b = r;
+    }
+    return a;
+}
+
+static void sched_timer_expiry(struct k_timer *timer)
+{
+    ARG_UNUSED(timer);
+
+    tick_count++;
+
+    for (int i = 0; i < SAMPLE_SCHED_NUM_TASKS; i++) {
+        struct sched_task *t = &tasks[i];
+
+        if (t->period_ticks == 0 || (tick_count % t->period_ticks) != 0) {
+            continue;
+        }
+
+        if (k_event_test(&sched_events, BIT(i))) {
+            /* Previous release not picked up yet, keep its deadline */
+            t->stats.overruns++;
+            continue;
+        }
+
+        t->deadline = start_ticks + k_ms_to_ticks_ceil64((uint64_t)tick_count * tick_ms);
+        k_event_post(&sched_events, BIT(i));
+    }
+}
+
+static K_TIMER_DEFINE(sched_timer, sched_timer_expiry, NULL);
+
+int sample_sched_start(const uint32_t period_ms[SAMPLE_SCHED_NUM_TASKS])
+{
+    uint32_t base = 0;
+
+    for (int i = 0; i < SAMPLE_SCHED_NUM_TASKS; i++) {
+        if (period_ms[i] != 0) {
+            base = (base == 0) ? period_ms[i] : period_gcd(base, period_ms[i]);
+        }
+    }
+
+    if (base == 0) {
+        return -EINVAL;
+    }
+
+    k_timer_stop(&sched_timer);
+    k_event_clear(&sched_events, BIT_MASK(SAMPLE_SCHED_NUM_TASKS));
+
+    tick_ms = base;
+    tick_count = 0;
+    for (int i = 0; i < SAMPLE_SCHED_NUM_TASKS; i++) {
+        tasks[i] = (struct sched_task){
+            .period_ticks = period_ms[i] / base,
+            .stats.period_ms = period_ms[i],
+        };
+    }
+
+    start_ticks = k_uptime_ticks();
+    k_timer_start(&sched_timer, K_MSEC(base), K_MSEC(base));
+
+    LOG_INF("Scheduler tick %u ms (accel %u ms, env %u ms, uplink %u ms)", base,
+            period_ms[SAMPLE_SCHED_ACCEL], period_ms[SAMPLE_SCHED_ENV],
+            period_ms[SAMPLE_SCHED_UPLINK]);
+    return 0;
+}
+
+uint32_t sample_sched_wait(k_timeout_t timeout)
+{
+    uint32_t due = k_event_wait(&sched_events, BIT_MASK(SAMPLE_SCHED_NUM_TASKS),
+                                false, timeout);
+    int64_t now = k_uptime_ticks();
+
+    if (due == 0) {
+        return 0;
+    }
+
+    for (int i = 0; i < SAMPLE_SCHED_NUM_TASKS; i++) {
+        struct sched_task *t = &tasks[i];
+
+        if ((due & BIT(i)) == 0) {
+            continue;
+        }
+
+        int64_t late = now - t->deadline;
+        uint32_t jitter_us = (late > 0) ? (uint32_t)k_ticks_to_us_floor64(late) : 0;
+
+        t->stats.runs++;
+        t->stats.jitter_last_us = jitter_us;
+        t->stats.jitter_max_us = MAX(t->stats.jitter_max_us, jitter_us);
+        t->jitter_sum_us += jitter_us;
+        t->stats.jitter_avg_us = (uint32_t)(t->jitter_sum_us / t->stats.runs);
+    }
+
+    /* Deadlines are read before clearing, the timer only rewrites them once cleared */
+    k_event_clear(&sched_events, due);
+    return due;
+}
+
+void sample_sched_get_stats(enum sample_sched_task task, struct sample_sched_stats *stats)
+{
+    unsigned int key = irq_lock();
+
+    *stats = tasks[task].stats;
+    irq_unlock(key);
+}
@@ -0,0 +1,54 @@
+/*
+ * Drift-free periodic sampling scheduler
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef SAMPLE_SCHED_H_
+#define SAMPLE_SCHED_H_
+
+#include <stdint.h>
+#include <zephyr/kernel.h>
+
+enum sample_sched_task {
+    SAMPLE_SCHED_ACCEL,   /* Drain ADXL345 FIFO bursts */
+    SAMPLE_SCHED_ENV,     /* BME280 temperature/pressure/humidity */
+    SAMPLE_SCHED_UPLINK,  /* LoRaWAN uplink */
+    SAMPLE_SCHED_NUM_TASKS,
+};
+
+/* Default task periods, 0 disables a task */
+#define SAMPLE_SCHED_ACCEL_PERIOD_MS  160   /* 16-frame bursts at 100 Hz */
+#define SAMPLE_SCHED_ENV_PERIOD_MS    1000  /* 1 Hz */
+#define SAMPLE_SCHED_UPLINK_PERIOD_MS 60000 /* SRS 01: 60 s +-5 s */
+
+/**
+ * Release jitter of one task: how late it started compared to its absolute
+ * deadline start + n * period. Deadlines never move, so a slow run does not
+ * stretch the following periods.
+ */
+struct sample_sched_stats {
+    uint32_t period_ms;
+    uint32_t runs;          /* Releases handed to the task */
+    uint32_t overruns;      /* Releases lost because the previous one was still pending */
+    uint32_t jitter_last_us;
+    uint32_t jitter_max_us;
+    uint32_t jitter_avg_us;
+};
+
+/**
+ * Start the scheduler with one period per task (milliseconds, 0 = disabled).
+ * The k_timer ticks at the GCD of the enabled periods.
+ * Returns 0 on success, error code on failure
+ */
+int sample_sched_start(const uint32_t period_ms[SAMPLE_SCHED_NUM_TASKS]);
+
+/**
+ * Block until at least one task is due.
+ * Returns a bitmask of due tasks (BIT(enum sample_sched_task)), 0 on timeout.
+ */
+uint32_t sample_sched_wait(k_timeout_t timeout);
+
+void sample_sched_get_stats(enum sample_sched_task task, struct sample_sched_stats *stats);
+
+#endif /* SAMPLE_SCHED_H_ */
@@ -0,0 +1,68 @@
+/*
+ * Concurrent BME280 + ADXL345 acquisition over RTIO
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef SENSOR_ACQ_H_
+#define SENSOR_ACQ_H_
+
+#include <stdint.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/sensor.h>
+#include <zephyr/drivers/sensor_data_types.h>
+
+/**
+ * Acquisition latency, in microseconds.
+ * With the ADXL345 in the cycle both reads are submitted together, so the
+ * cycle only waits for the slower bus. Every 64th cycle times each read
+ * alone instead, which gives the per-sensor figures and serial_us, what
+ * the same reads cost back to back. Without it, as when its FIFO streams,
+ * every cycle is the BME280 read and the ADXL345 fields stay 0.
+ */
+struct sensor_acq_stats {
+    uint32_t cycles;       /* Completed acquisition cycles */
+    uint32_t errors;       /* Cycles with at least one failed read */
+    uint32_t bme280_us;    /* BME280 read alone, last baseline */
+    uint32_t adxl345_us;   /* ADXL345 read alone, last baseline */
+    uint32_t combined_us;  /* Both reads in one batch, last cycle */
+    uint32_t serial_us;    /* bme280_us + adxl345_us */
+    uint32_t saved_us;     /* serial_us - combined_us */
+};
+
+/**
+ * One decoded acquisition cycle.
+ * Values are the decoder's Q31 output; the real value is value * 2^shift / 2^31.
+ * Units: °C, kPa, %RH and m/s².
+ */
+struct sensor_acq_sample {
+    q31_t temp;
+    q31_t press;
+    q31_t hum;
+    q31_t accel[3];      /* Zero when the ADXL345 is not part of the cycle */
+    int8_t temp_shift;
+    int8_t press_shift;
+    int8_t hum_shift;
+    int8_t accel_shift;
+};
+
+/**
+ * Bind the sensor devices and resolve their decoders once
+ * adxl345 must be NULL with CONFIG_ADXL345_STREAM: the accelerometer is
+ * read through its FIFO stream then, single register reads would pop
+ * samples out of the FIFO.
+ * Returns 0 on success, -EBUSY for an ADXL345 the stream owns, error code
+ * on failure
+ */
+int sensor_acq_init(const struct device *bme280, const struct device *adxl345);
+
+/**
+ * Read BME280 and ADXL345 in one RTIO batch and decode every channel into the
+ * engine's static sample record. The record stays valid until the next call.
+ * Returns 0 on success, error code on failure
+ */
+int sensor_acq_read(const struct sensor_acq_sample **sample);
+
+void sensor_acq_get_stats(struct sensor_acq_stats *stats);
+
+#endif /* SENSOR_ACQ_H_ */
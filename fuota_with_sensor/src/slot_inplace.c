@@ -0,0 +1,176 @@
+/*
+ * In-place decoding of a FUOTA download in slot1
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include <zephyr/drivers/flash.h>
+#include <zephyr/kernel.h>
+
+#include "delta.h"
+#include "slot_inplace.h"
+
+#define SLOT_PARTITION slot1_partition
+
+/* Flash read and stream_flash buffer, a multiple of the 8 byte write block */
+#define BLOCK_SIZE 256
+
+static uint8_t block[BLOCK_SIZE];
+static uint8_t stream_buf[BLOCK_SIZE];
+
+int slot_inplace_crc(const struct flash_area *fa, uint32_t len, uint32_t *crc)
+{
+    *crc = 0;
+    for (uint32_t off = 0; off < len; off += BLOCK_SIZE) {
+        uint32_t n = MIN(len - off, BLOCK_SIZE);
+        int ret = flash_area_read(fa, off, block, n);
+
+        if (ret < 0) {
+            return ret;
+        }
+        *crc = delta_crc32(*crc, block, n);
+    }
+    return 0;
+}
+
+/**
+ * Move the input to the end of the slot, from its last page on: a page is
+ * erased once its bytes were moved higher up
+ */
+static int move_input(struct slot_inplace *s)
+{
+    uint32_t pages = DIV_ROUND_UP(s->size, s->page);
+
+    for (uint32_t i = pages; i-- > 0;) {
+        uint32_t src = i * s->page;
+        int ret = flash_area_erase(s->fa, s->shift + src, s->page);
+
+        for (uint32_t off = 0; off < s->page && ret == 0; off += BLOCK_SIZE) {
+            ret = flash_area_read(s->fa, src + off, block, BLOCK_SIZE);
+            if (ret == 0) {
+                ret = flash_area_write(s->fa, s->shift + src + off, block, BLOCK_SIZE);
+            }
+        }
+        if (ret < 0) {
+            return ret;
+        }
+    }
+    return 0;
+}
+
+int slot_inplace_start(struct slot_inplace *s, uint32_t size)
+{
+    struct flash_pages_info info;
+    int ret;
+
+    memset(s, 0, sizeof(*s));
+    s->size = size;
+    ret = flash_area_open(FIXED_PARTITION_ID(SLOT_PARTITION), &s->fa);
+    if (ret < 0) {
+        s->fa = NULL;
+        return ret;
+    }
+
+    ret = flash_get_page_info_by_offs(FIXED_PARTITION_DEVICE(SLOT_PARTITION),
+                                      FIXED_PARTITION_OFFSET(SLOT_PARTITION), &info);
+    if (ret < 0) {
+        return ret;
+    }
+    s->page = info.size;
+    s->shift = ROUND_DOWN(s->fa->fa_size - ROUND_UP(size, s->page), s->page);
+    return (s->shift > 0) ? move_input(s) : -ENOSPC;
+}
+
+int slot_inplace_write(void *ctx, const void *buf, size_t len)
+{
+    struct slot_inplace *s = ctx;
+
+    while (s->erased < s->out + len) {
+        int ret;
+
+        if (s->erased + s->page > s->shift + s->in) {
+            return -ENOSPC;
+        }
+        ret = flash_area_erase(s->fa, s->erased, s->page);
+        if (ret < 0) {
+            return ret;
+        }
+        s->erased += s->page;
+    }
+    s->out += len;
+    return stream_flash_buffered_write(&s->stream, buf, len, false);
+}
+
+int slot_inplace_read_out(void *ctx, uint32_t off, void *buf, size_t len)
+{
+    struct slot_inplace *s = ctx;
+    uint32_t flushed = stream_flash_bytes_written(&s->stream);
+    uint8_t *p = buf;
+
+    if (off < flushed) {
+        size_t n = MIN(len, flushed - off);
+        int ret = flash_area_read(s->fa, off, p, n);
+
+        if (ret < 0) {
+            return ret;
+        }
+        off += n;
+        p += n;
+        len -= n;
+    }
+    /* stream_flash fills its buffer from the start, flushed bytes excluded */
+    memcpy(p, &stream_buf[off - flushed], len);
+    return 0;
+}
+
+int slot_inplace_run(struct slot_inplace *s, uint32_t skip, slot_inplace_feed_cb feed,
+                     void *dec)
+{
+    int ret;
+
+    ret = stream_flash_init(&s->stream, FIXED_PARTITION_DEVICE(SLOT_PARTITION), stream_buf,
+                            sizeof(stream_buf), FIXED_PARTITION_OFFSET(SLOT_PARTITION),
+                            FIXED_PARTITION_SIZE(SLOT_PARTITION), NULL);
+    if (ret < 0) {
+        return ret;
+    }
+
+    s->in = skip;
+    while (ret == 0 && s->in < s->size) {
+        uint32_t n = MIN(s->size - s->in, BLOCK_SIZE);
+
+        ret = flash_area_read(s->fa, s->shift + s->in, block, n);
+        s->in += n;
+        if (ret == 0) {
+            ret = feed(dec, block, n);
+        }
+    }
+    if (ret == 0) {
+        ret = stream_flash_buffered_write(&s->stream, NULL, 0, true);
+    }
+    return ret;
+}
+
+int slot_inplace_finish(struct slot_inplace *s, int ret, uint32_t new_size, uint32_t new_crc)
+{
+    uint32_t crc;
+
+    if (s->fa == NULL) {
+        return ret;
+    }
+    /* The decoder checked what it wrote, this what reached flash */
+    if (ret == 0) {
+        ret = slot_inplace_crc(s->fa, new_size, &crc);
+    }
+    if (ret == 0 && crc != new_crc) {
+        ret = -EBADMSG;
+    }
+    if (ret == 0) {
+        ret = flash_area_erase(s->fa, s->erased, s->fa->fa_size - s->erased);
+    }
+    flash_area_close(s->fa);
+    return ret;
+}
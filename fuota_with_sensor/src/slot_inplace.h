@@ -0,0 +1,82 @@
+/*
+ * In-place decoding of a FUOTA download in slot1
+ *
+ * The fragmented data transport writes its input, a compressed image or a
+ * delta patch, to the start of slot1. The input is moved to the end of the
+ * slot, page by page from its last one, then decoded forward into the start
+ * of the slot: an output page is erased only once the input in it was read.
+ * This needs no other partition, the output only has to fit in the slot
+ * alongside the part of the input not read yet. Shared by lz4s_flash.c and
+ * delta_flash.c, which only bring their decoder.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef SLOT_INPLACE_H_
+#define SLOT_INPLACE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <zephyr/storage/flash_map.h>
+#include <zephyr/storage/stream_flash.h>
+
+/**
+ * Hand the next input bytes to the decoder
+ * Returns 0 on success, decoder error
+ */
+typedef int (*slot_inplace_feed_cb)(void *dec, const uint8_t *buf, size_t len);
+
+struct slot_inplace {
+    const struct flash_area *fa;
+    struct stream_flash_ctx stream;
+    uint32_t page;
+    uint32_t size;     /* Input size */
+    uint32_t shift;    /* Where the input was moved */
+    uint32_t in;       /* Input bytes read */
+    uint32_t out;      /* Output bytes passed to the stream */
+    uint32_t erased;   /* Output pages erased, up to here */
+};
+
+/**
+ * Open slot1 and move its first size bytes to the end of the slot
+ * Returns 0 on success, -ENOSPC if the input leaves no page free, negative
+ * flash error; slot_inplace_finish() closes the slot either way
+ */
+int slot_inplace_start(struct slot_inplace *s, uint32_t size);
+
+/**
+ * Feed the moved input from offset skip on to feed(), then flush the
+ * output to flash. The decoder writes through slot_inplace_write().
+ * Returns 0 on success, -ENOSPC if the output caught up with the input,
+ * feed() errors, negative flash error
+ */
+int slot_inplace_run(struct slot_inplace *s, uint32_t skip, slot_inplace_feed_cb feed,
+                     void *dec);
+
+/**
+ * Decoder write callback, ctx is the struct slot_inplace
+ */
+int slot_inplace_write(void *ctx, const void *buf, size_t len);
+
+/**
+ * Decoder read-back callback, ctx is the struct slot_inplace: output bytes
+ * come from flash, or from the stream buffer if not flushed yet
+ */
+int slot_inplace_read_out(void *ctx, uint32_t off, void *buf, size_t len);
+
+/**
+ * With ret 0, check the CRC of the output as it reached flash and erase the
+ * rest of the slot, input and MCUboot trailer. Closes the slot.
+ * Returns ret if it is an error, -EBADMSG on a CRC mismatch, negative
+ * flash error
+ */
+int slot_inplace_finish(struct slot_inplace *s, int ret, uint32_t new_size, uint32_t new_crc);
+
+/**
+ * CRC-32 (delta_crc32()) of the first len bytes of a partition
+ * Returns 0 on success, negative flash error
+ */
+int slot_inplace_crc(const struct flash_area *fa, uint32_t len, uint32_t *crc);
+
+#endif /* SLOT_INPLACE_H_ */
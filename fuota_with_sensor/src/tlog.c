@@ -0,0 +1,425 @@
+/*
+ * Flash-backed store-and-forward telemetry log (SRS 04)
+ *
+ * Mount reads one header per sector plus the entries of the head sector,
+ * append is a single program operation, and erasing happens only when the
+ * head moves into the next sector.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "tlog.h"
+
+#define TLOG_MAGIC      0x31474C54   /* "TLG1" */
+#define HDR_SIZE        16           /* Sector header, also its aligned size */
+#define ENTRY_HDR_SIZE  4
+#define ENTRY_ERASED    0xFF
+#define TYPE_RECORD     'R'
+#define TYPE_CURSOR     'C'
+#define CURSOR_SIZE     8
+
+#define ENTRY_MAX (ENTRY_HDR_SIZE + TLOG_RECORD_MAX + TLOG_WRITE_BLOCK_MAX)
+
+_Static_assert(TLOG_MAX_SECTORS <= 32, "tlog_mount() keeps one bit per sector in a uint32_t");
+
+static uint16_t crc16(uint16_t crc, const uint8_t *p, size_t len)
+{
+    /* CRC-16/CCITT, bitwise: entries are short */
+    while (len--) {
+        crc ^= (uint16_t)(*p++ << 8);
+        for (int i = 0; i < 8; i++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+static void put_le32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t get_le32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint32_t align(const struct tlog *log, uint32_t n)
+{
+    return (n + log->flash->write_block - 1) & ~(uint32_t)(log->flash->write_block - 1);
+}
+
+static uint32_t sector_base(const struct tlog *log, uint32_t seq)
+{
+    return (seq % log->flash->sector_count) * log->flash->sector_size;
+}
+
+static struct tlog_pos sector_start(uint32_t seq)
+{
+    return (struct tlog_pos){seq, HDR_SIZE};
+}
+
+static bool pos_before(const struct tlog_pos *a, const struct tlog_pos *b)
+{
+    return (a->seq < b->seq) || (a->seq == b->seq && a->off < b->off);
+}
+
+/* Returns 0 and fills seq/cursor if sector idx holds a valid header */
+static int read_header(struct tlog *log, uint16_t idx, uint32_t *seq, struct tlog_pos *cursor)
+{
+    uint8_t h[HDR_SIZE];
+    int ret = log->flash->read(log->flash->ctx, (uint32_t)idx * log->flash->sector_size, h,
+                               sizeof(h));
+
+    if (ret < 0) {
+        return ret;
+    }
+    if (get_le32(h) != TLOG_MAGIC ||
+        crc16(0xFFFF, h, HDR_SIZE - 2) != (uint16_t)(h[14] | (h[15] << 8))) {
+        return -EINVAL;
+    }
+
+    *seq = get_le32(&h[4]);
+    cursor->seq = get_le32(&h[8]);
+    cursor->off = h[12] | (h[13] << 8);
+    return (*seq % log->flash->sector_count == idx) ? 0 : -EINVAL;
+}
+
+static int write_header(struct tlog *log, uint32_t seq)
+{
+    uint8_t h[HDR_SIZE];
+    uint16_t crc;
+
+    put_le32(h, TLOG_MAGIC);
+    put_le32(&h[4], seq);
+    put_le32(&h[8], log->cursor.seq);
+    h[12] = (uint8_t)log->cursor.off;
+    h[13] = (uint8_t)(log->cursor.off >> 8);
+    crc = crc16(0xFFFF, h, HDR_SIZE - 2);
+    h[14] = (uint8_t)crc;
+    h[15] = (uint8_t)(crc >> 8);
+
+    return log->flash->write(log->flash->ctx, sector_base(log, seq), h, sizeof(h));
+}
+
+/*
+ * Read and check the entry at pos
+ * Returns its aligned size, 0 if the sector ends here (erased or no room for
+ * a header), -EBADMSG for a torn or corrupt entry, negative flash error
+ */
+static int read_entry(struct tlog *log, const struct tlog_pos *pos, uint8_t *type,
+                      uint8_t *data, uint8_t *len)
+{
+    uint8_t e[ENTRY_MAX];
+    uint32_t size;
+    int ret;
+
+    if (pos->off + ENTRY_HDR_SIZE > log->flash->sector_size) {
+        return 0;
+    }
+
+    ret = log->flash->read(log->flash->ctx, sector_base(log, pos->seq) + pos->off, e,
+                           ENTRY_HDR_SIZE);
+    if (ret < 0) {
+        return ret;
+    }
+    if (e[0] == ENTRY_ERASED && e[1] == ENTRY_ERASED) {
+        return 0;
+    }
+
+    size = align(log, ENTRY_HDR_SIZE + e[0]);
+    if (e[0] == 0 || e[0] > TLOG_RECORD_MAX || (e[1] != TYPE_RECORD && e[1] != TYPE_CURSOR) ||
+        pos->off + size > log->flash->sector_size) {
+        return -EBADMSG;
+    }
+
+    ret = log->flash->read(log->flash->ctx, sector_base(log, pos->seq) + pos->off +
+                           ENTRY_HDR_SIZE, &e[ENTRY_HDR_SIZE], e[0]);
+    if (ret < 0) {
+        return ret;
+    }
+    if (crc16(crc16(0xFFFF, &e[1], 1), &e[ENTRY_HDR_SIZE], e[0]) !=
+        (uint16_t)(e[2] | (e[3] << 8))) {
+        return -EBADMSG;
+    }
+
+    *type = e[1];
+    *len = e[0];
+    memcpy(data, &e[ENTRY_HDR_SIZE], e[0]);
+    return (int)size;
+}
+
+/* True if a record follows pos in its sector */
+static bool records_after(struct tlog *log, struct tlog_pos pos)
+{
+    uint8_t data[TLOG_RECORD_MAX];
+    uint8_t type, len;
+    int size;
+
+    while ((size = read_entry(log, &pos, &type, data, &len)) > 0) {
+        if (type == TYPE_RECORD) {
+            return true;
+        }
+        pos.off += (uint32_t)size;
+    }
+    return false;
+}
+
+/* Move the head into the next sector, dropping the oldest one if needed */
+static int rotate(struct tlog *log)
+{
+    uint32_t next = log->head.seq + 1;
+    int ret;
+
+    if (next - log->tail_seq >= log->flash->sector_count) {
+        uint32_t old = log->tail_seq++;
+
+        if (log->cursor.seq == old) {
+            if (records_after(log, log->cursor)) {
+                log->stats.lost_sectors++;
+            }
+            log->cursor = sector_start(log->tail_seq);
+        }
+        if (pos_before(&log->rd, &log->cursor)) {
+            log->rd = log->cursor;
+        }
+    }
+
+    ret = log->flash->erase(log->flash->ctx, sector_base(log, next), log->flash->sector_size);
+    log->stats.erases++;
+    if (ret < 0) {
+        return ret;
+    }
+
+    /* Claim the sector before its header is known good, a retry erases it again */
+    log->head = (struct tlog_pos){next, log->flash->sector_size};
+    ret = write_header(log, next);
+    if (ret < 0) {
+        return ret;
+    }
+    log->head = sector_start(next);
+    return 0;
+}
+
+static int append_entry(struct tlog *log, uint8_t type, const uint8_t *data, uint8_t len)
+{
+    uint8_t e[ENTRY_MAX];
+    uint32_t size = align(log, ENTRY_HDR_SIZE + len);
+    uint16_t crc = crc16(crc16(0xFFFF, &type, 1), data, len);
+    int ret;
+
+    if (log->head.off + size > log->flash->sector_size) {
+        ret = rotate(log);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+
+    memset(e, ENTRY_ERASED, size);
+    e[0] = len;
+    e[1] = type;
+    e[2] = (uint8_t)crc;
+    e[3] = (uint8_t)(crc >> 8);
+    memcpy(&e[ENTRY_HDR_SIZE], data, len);
+
+    ret = log->flash->write(log->flash->ctx, sector_base(log, log->head.seq) + log->head.off,
+                            e, size);
+
+    /* Never program the same place twice, even after a failed write */
+    log->head.off += size;
+    return ret;
+}
+
+static int format(struct tlog *log)
+{
+    int ret = log->flash->erase(log->flash->ctx, 0, log->flash->sector_size);
+
+    log->stats.erases++;
+    if (ret < 0) {
+        return ret;
+    }
+
+    log->tail_seq = 0;
+    log->cursor = sector_start(0);
+    log->rd = log->cursor;
+    log->head = log->cursor;
+    return write_header(log, 0);
+}
+
+int tlog_mount(struct tlog *log, const struct tlog_flash *flash)
+{
+    uint32_t seqs[TLOG_MAX_SECTORS];
+    uint32_t valid = 0;   /* Bit i: sector i has a valid header */
+    uint32_t head_seq = 0;
+    struct tlog_pos pos, cursor;
+    uint8_t data[TLOG_RECORD_MAX];
+    uint8_t type, len;
+    int size;
+
+    if (flash->sector_count < 2 || flash->sector_count > TLOG_MAX_SECTORS || flash->write_block == 0 ||
+        flash->write_block > TLOG_WRITE_BLOCK_MAX ||
+        (flash->write_block & (flash->write_block - 1)) != 0 ||
+        flash->sector_size < HDR_SIZE + ENTRY_MAX || flash->sector_size > UINT16_MAX + 1) {
+        return -EINVAL;
+    }
+
+    memset(log, 0, sizeof(*log));
+    log->flash = flash;
+
+    for (uint16_t i = 0; i < flash->sector_count; i++) {
+        int ret = read_header(log, i, &seqs[i], &cursor);
+
+        if (ret == 0) {
+            valid |= 1U << i;
+            if (valid == (1U << i) || seqs[i] > head_seq) {
+                head_seq = seqs[i];
+            }
+        } else if (ret != -EINVAL) {
+            return ret;
+        }
+    }
+
+    if (valid == 0) {
+        return format(log);
+    }
+
+    /* Oldest sector: walk back while the sequence stays contiguous */
+    log->tail_seq = head_seq;
+    while (log->tail_seq > 0 && head_seq - log->tail_seq + 1 < flash->sector_count) {
+        uint32_t prev = log->tail_seq - 1;
+        uint16_t idx = prev % flash->sector_count;
+
+        if (!(valid & (1U << idx)) || seqs[idx] != prev) {
+            break;
+        }
+        log->tail_seq = prev;
+    }
+
+    /* Latest cursor: the head header, then cursor entries of the head sector */
+    read_header(log, head_seq % flash->sector_count, &head_seq, &log->cursor);
+    pos = sector_start(head_seq);
+    while ((size = read_entry(log, &pos, &type, data, &len)) > 0) {
+        if (type == TYPE_CURSOR && len == CURSOR_SIZE) {
+            log->cursor.seq = get_le32(data);
+            log->cursor.off = get_le32(&data[4]);
+        }
+        pos.off += (uint32_t)size;
+    }
+    if (size == -EBADMSG) {
+        /* Torn write: close the sector, the next append rotates */
+        log->stats.torn++;
+        pos.off = flash->sector_size;
+    } else if (size < 0) {
+        return size;
+    }
+    log->head = pos;
+
+    if (log->cursor.seq < log->tail_seq) {
+        log->cursor = sector_start(log->tail_seq);
+    }
+    if (pos_before(&log->head, &log->cursor)) {
+        log->cursor = log->head;
+    }
+    log->rd = log->cursor;
+    return 0;
+}
+
+int tlog_append(struct tlog *log, const uint8_t *rec, uint8_t len)
+{
+    int ret;
+
+    if (len == 0 || len > TLOG_RECORD_MAX) {
+        return -EMSGSIZE;
+    }
+
+    ret = append_entry(log, TYPE_RECORD, rec, len);
+    if (ret == 0) {
+        log->stats.appended++;
+    }
+    return ret;
+}
+
+int tlog_read(struct tlog *log, uint8_t *rec, struct tlog_pos *next)
+{
+    uint8_t type, len;
+
+    if (log->rd.seq < log->tail_seq) {
+        log->rd = sector_start(log->tail_seq);
+    }
+
+    while (pos_before(&log->rd, &log->head)) {
+        int size = read_entry(log, &log->rd, &type, rec, &len);
+
+        if (size < 0 && size != -EBADMSG) {
+            return size;
+        }
+        if (size <= 0) {
+            /* End of this sector, or a torn entry that closed it */
+            if (log->rd.seq == log->head.seq) {
+                log->rd = log->head;
+                break;
+            }
+            log->rd = sector_start(log->rd.seq + 1);
+            continue;
+        }
+
+        log->rd.off += (uint32_t)size;
+        if (type == TYPE_RECORD) {
+            *next = log->rd;
+            return len;
+        }
+    }
+    return -ENOENT;
+}
+
+int tlog_commit(struct tlog *log, const struct tlog_pos *pos)
+{
+    uint8_t data[CURSOR_SIZE];
+    bool all_read = !pos_before(&log->rd, &log->head);
+    int ret;
+
+    if (!pos_before(&log->cursor, pos)) {
+        return 0;
+    }
+
+    log->cursor = *pos;
+    if (log->cursor.seq < log->tail_seq) {
+        log->cursor = sector_start(log->tail_seq);
+    }
+
+    put_le32(data, log->cursor.seq);
+    put_le32(&data[4], log->cursor.off);
+    ret = append_entry(log, TYPE_CURSOR, data, sizeof(data));
+    log->stats.commits++;
+
+    if (all_read) {
+        log->rd = log->head;
+    }
+    return ret;
+}
+
+void tlog_rewind(struct tlog *log)
+{
+    log->rd = log->cursor;
+}
+
+bool tlog_unread(const struct tlog *log)
+{
+    return pos_before(&log->rd, &log->head);
+}
+
+uint32_t tlog_backlog(const struct tlog *log)
+{
+    uint32_t data = log->flash->sector_size - HDR_SIZE;
+
+    if (!pos_before(&log->cursor, &log->head)) {
+        return 0;
+    }
+    return (log->head.seq - log->cursor.seq) * data + log->head.off - log->cursor.off;
+}
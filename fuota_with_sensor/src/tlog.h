@@ -0,0 +1,114 @@
+/*
+ * Flash-backed store-and-forward telemetry log (SRS 04)
+ *
+ * A circular log of records over the sectors of one flash partition. Every
+ * sensor record is appended before it is batched; the read cursor only
+ * moves past records once the frame carrying them was sent, so a link
+ * outage or a reboot loses nothing until the log wraps. Has no Zephyr
+ * dependency so it also builds on the host (see tests_host); tlog_flash.c
+ * binds it to the flash partition.
+ *
+ * Layout, every write a multiple of the flash write block:
+ * - sector header: magic, sector sequence number, committed cursor, CRC.
+ *   Sector seq lives in sector seq % sector_count, so the sectors are used
+ *   in turn and wear evenly.
+ * - entries: length, type, CRC-16 of type and data, data, padding.
+ *   A record, or a cursor update written by tlog_commit().
+ *
+ * Power-fail safety: a torn entry fails its CRC and ends the scan of its
+ * sector at mount; the sector is closed and appending continues in the
+ * next one. A torn sector header leaves the sector invalid, so the previous
+ * head stays the head.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef TLOG_H_
+#define TLOG_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define TLOG_RECORD_MAX      64   /* Largest record */
+#define TLOG_WRITE_BLOCK_MAX 16   /* Largest flash program unit supported */
+#define TLOG_MAX_SECTORS     32   /* Largest sector count, one bit each at mount */
+
+struct tlog_flash {
+    void *ctx;
+    int (*read)(void *ctx, uint32_t off, void *buf, size_t len);
+    int (*write)(void *ctx, uint32_t off, const void *buf, size_t len);
+    int (*erase)(void *ctx, uint32_t off, size_t len);
+    uint32_t sector_size;
+    uint16_t sector_count;   /* 2..TLOG_MAX_SECTORS */
+    uint8_t write_block;     /* Power of 2, up to TLOG_WRITE_BLOCK_MAX */
+};
+
+/* Position of an entry: sector sequence number and offset in the sector */
+struct tlog_pos {
+    uint32_t seq;
+    uint32_t off;
+};
+
+struct tlog_stats {
+    uint32_t appended;      /* Records written */
+    uint32_t commits;       /* Cursor updates written */
+    uint32_t erases;        /* Sectors erased */
+    uint32_t lost_sectors;  /* Sectors with unsent records overwritten */
+    uint32_t torn;          /* Torn entries found at mount */
+};
+
+struct tlog {
+    const struct tlog_flash *flash;
+    struct tlog_pos head;     /* Next append */
+    uint32_t tail_seq;        /* Oldest sector still holding data */
+    struct tlog_pos cursor;   /* First record not yet sent, persistent */
+    struct tlog_pos rd;       /* Next record to read, RAM only */
+    struct tlog_stats stats;
+};
+
+/**
+ * Find head, tail and cursor, or format an empty partition
+ * Returns 0 on success, -EINVAL on bad geometry, negative flash error
+ */
+int tlog_mount(struct tlog *log, const struct tlog_flash *flash);
+
+/**
+ * Append one record. When the log is full the oldest sector is erased,
+ * unsent records in it are lost.
+ * Returns 0 on success, -EMSGSIZE if len is 0 or above TLOG_RECORD_MAX,
+ * negative flash error
+ */
+int tlog_append(struct tlog *log, const uint8_t *rec, uint8_t len);
+
+/**
+ * Read the next record from the read position. *next is the position after
+ * it, to be handed to tlog_commit() once it was sent.
+ * Returns the record length, -ENOENT when everything was read, negative
+ * flash error
+ */
+int tlog_read(struct tlog *log, uint8_t *rec, struct tlog_pos *next);
+
+/**
+ * Mark everything before pos as sent and persist the cursor
+ * Returns 0 on success, negative flash error
+ */
+int tlog_commit(struct tlog *log, const struct tlog_pos *pos);
+
+/**
+ * Move the read position back to the cursor, e.g. after a failed send
+ */
+void tlog_rewind(struct tlog *log);
+
+/**
+ * Returns true if records were appended after the read position
+ */
+bool tlog_unread(const struct tlog *log);
+
+/**
+ * Returns the bytes between the cursor and the head: the unsent backlog
+ * plus entry overhead and the cursor entries written since
+ */
+uint32_t tlog_backlog(const struct tlog *log);
+
+#endif /* TLOG_H_ */
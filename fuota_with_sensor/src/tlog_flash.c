@@ -0,0 +1,77 @@
+/*
+ * Telemetry log backend on the telemetry flash partition
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/storage/flash_map.h>
+
+#include "tlog_flash.h"
+
+#define TLOG_PARTITION telemetry_partition
+
+#if FIXED_PARTITION_EXISTS(TLOG_PARTITION)
+
+static int fa_read(void *ctx, uint32_t off, void *buf, size_t len)
+{
+    return flash_area_read(ctx, off, buf, len);
+}
+
+static int fa_write(void *ctx, uint32_t off, const void *buf, size_t len)
+{
+    return flash_area_write(ctx, off, buf, len);
+}
+
+static int fa_erase(void *ctx, uint32_t off, size_t len)
+{
+    return flash_area_erase(ctx, off, len);
+}
+
+int tlog_flash_open(struct tlog_flash *flash)
+{
+    static struct flash_sector sectors[TLOG_MAX_SECTORS];
+    const struct flash_area *fa;
+    uint32_t count = ARRAY_SIZE(sectors);
+    int ret;
+
+    ret = flash_area_open(FIXED_PARTITION_ID(TLOG_PARTITION), &fa);
+    if (ret < 0) {
+        return ret;
+    }
+
+    ret = flash_area_get_sectors(FIXED_PARTITION_ID(TLOG_PARTITION), &count, sectors);
+    if (ret < 0) {
+        flash_area_close(fa);
+        return ret;
+    }
+
+    /* tlog addresses sector i at i * sector_size */
+    for (uint32_t i = 1; i < count; i++) {
+        if (sectors[i].fs_size != sectors[0].fs_size) {
+            flash_area_close(fa);
+            return -EINVAL;
+        }
+    }
+
+    flash->ctx = (void *)fa;
+    flash->read = fa_read;
+    flash->write = fa_write;
+    flash->erase = fa_erase;
+    flash->sector_size = sectors[0].fs_size;
+    flash->sector_count = (uint16_t)count;
+    flash->write_block = (uint8_t)flash_area_align(fa);
+    return 0;
+}
+
+#else
+
+int tlog_flash_open(struct tlog_flash *flash)
+{
+    ARG_UNUSED(flash);
+    return -ENODEV;
+}
+
+#endif /* FIXED_PARTITION_EXISTS(TLOG_PARTITION) */
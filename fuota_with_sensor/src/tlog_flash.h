@@ -0,0 +1,19 @@
+/*
+ * Telemetry log backend on the telemetry flash partition
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef TLOG_FLASH_H_
+#define TLOG_FLASH_H_
+
+#include "tlog.h"
+
+/**
+ * Open the telemetry partition and describe it for tlog_mount()
+ * Returns 0 on success, -ENODEV without the partition, -EINVAL if its pages
+ * are not uniform, negative flash_area error
+ */
+int tlog_flash_open(struct tlog_flash *flash);
+
+#endif /* TLOG_FLASH_H_ */
@@ -0,0 +1,177 @@
+/*
+ * Delta-of-delta varint codec for batched telemetry
+ *
+ * Second differences of a channel sampled at a steady rate are near zero
+ * whenever the signal is constant or ramps linearly, which is what slow
+ * environment channels do between two uplinks.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "tscodec.h"
+
+static uint64_t zigzag(int64_t v)
+{
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static int64_t unzigzag(uint64_t v)
+{
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static size_t put_varint(uint8_t *p, uint64_t v)
+{
+    size_t n = 0;
+
+    while (v >= 0x80) {
+        p[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+static size_t varint_len(uint64_t v)
+{
+    size_t n = 1;
+
+    while (v >= 0x80) {
+        v >>= 7;
+        n++;
+    }
+    return n;
+}
+
+/* Returns bytes consumed, 0 on truncated or over-long input */
+static size_t get_varint(const uint8_t *p, size_t len, uint64_t *v)
+{
+    uint64_t r = 0;
+
+    for (size_t n = 0; n < len && n < 10; n++) {
+        r |= (uint64_t)(p[n] & 0x7F) << (7 * n);
+        if ((p[n] & 0x80) == 0) {
+            *v = r;
+            return n + 1;
+        }
+    }
+    return 0;
+}
+
+int tscodec_enc_init(struct tscodec_enc *enc, uint8_t *buf, size_t cap, uint8_t channels)
+{
+    if (channels == 0 || channels > TSCODEC_MAX_CHANNELS) {
+        return -EINVAL;
+    }
+    if (cap < TSCODEC_HDR_SIZE) {
+        return -ENOSPC;
+    }
+
+    memset(enc, 0, sizeof(*enc));
+    enc->buf = buf;
+    enc->cap = cap;
+    enc->channels = channels;
+    enc->len = TSCODEC_HDR_SIZE;
+    buf[0] = channels;
+    buf[1] = 0;
+    return 0;
+}
+
+/* Number written for a channel: base value, delta, then delta-of-delta */
+static int64_t enc_value(const struct tscodec_enc *enc, int c, int32_t value)
+{
+    int64_t delta = (int64_t)value - enc->prev[c];
+
+    if (enc->count == 0) {
+        return value;
+    }
+    if (enc->count == 1) {
+        return delta;
+    }
+    return delta - enc->prev_delta[c];
+}
+
+int tscodec_enc_add(struct tscodec_enc *enc, const int32_t *values)
+{
+    size_t n = 0;
+
+    if (enc->count == UINT8_MAX) {
+        return -EOVERFLOW;
+    }
+
+    /* Size the record first so a full stream is left untouched, without scratch */
+    for (int c = 0; c < enc->channels; c++) {
+        n += varint_len(zigzag(enc_value(enc, c, values[c])));
+    }
+    if (enc->len + n > enc->cap) {
+        return -ENOSPC;
+    }
+
+    for (int c = 0; c < enc->channels; c++) {
+        enc->len += put_varint(&enc->buf[enc->len], zigzag(enc_value(enc, c, values[c])));
+        enc->prev_delta[c] = (int64_t)values[c] - enc->prev[c];
+        enc->prev[c] = values[c];
+    }
+    enc->buf[1] = ++enc->count;
+    return 0;
+}
+
+size_t tscodec_enc_len(const struct tscodec_enc *enc)
+{
+    return enc->len;
+}
+
+int tscodec_decode(const uint8_t *buf, size_t len, int32_t *values, size_t max_values,
+                   uint8_t *channels)
+{
+    int64_t prev[TSCODEC_MAX_CHANNELS] = {0};
+    int64_t prev_delta[TSCODEC_MAX_CHANNELS] = {0};
+
+    if (len < TSCODEC_HDR_SIZE || buf[0] == 0 || buf[0] > TSCODEC_MAX_CHANNELS) {
+        return -EINVAL;
+    }
+
+    uint8_t ch = buf[0];
+    uint8_t count = buf[1];
+    size_t pos = TSCODEC_HDR_SIZE;
+
+    if ((size_t)count * ch > max_values) {
+        return -ENOSPC;
+    }
+
+    for (int r = 0; r < count; r++) {
+        for (int c = 0; c < ch; c++) {
+            uint64_t raw;
+            size_t used = get_varint(&buf[pos], len - pos, &raw);
+
+            if (used == 0) {
+                return -EINVAL;
+            }
+            pos += used;
+
+            int64_t v = unzigzag(raw);
+            int64_t delta;
+
+            if (r == 0) {
+                delta = 0;
+                prev[c] = v;
+            } else {
+                delta = (r == 1) ? v : prev_delta[c] + v;
+                prev[c] += delta;
+            }
+            prev_delta[c] = delta;
+            values[r * ch + c] = (int32_t)prev[c];
+        }
+    }
+
+    if (pos != len) {
+        return -EINVAL;
+    }
+    if (channels != NULL) {
+        *channels = ch;
+    }
+    return count;
+}
@@ -0,0 +1,66 @@
+/*
+ * Delta-of-delta varint codec for batched telemetry
+ *
+ * Encodes a series of records, each a vector of integer channels. The first
+ * record is stored as base values, the second as deltas and every later one
+ * as delta-of-delta; each number is zig-zag mapped and written as a LEB128
+ * varint, so a slowly changing channel costs one byte per record. Has no
+ * Zephyr dependency: the same source is the host decoder (see tests_host).
+ *
+ * Stream format:
+ *   channels (1), records (1), then per record per channel one varint
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef TSCODEC_H_
+#define TSCODEC_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TSCODEC_MAX_CHANNELS 32
+#define TSCODEC_HDR_SIZE     2
+
+/* Worst case bytes of one record (10-byte varint per channel) */
+#define TSCODEC_RECORD_MAX(channels) ((channels) * 10)
+
+struct tscodec_enc {
+    uint8_t *buf;
+    size_t cap;
+    size_t len;
+    uint8_t channels;
+    uint8_t count;
+    int32_t prev[TSCODEC_MAX_CHANNELS];
+    int64_t prev_delta[TSCODEC_MAX_CHANNELS];
+};
+
+/**
+ * Start a stream in buf
+ * Returns 0 on success, -EINVAL on a bad channel count, -ENOSPC if cap
+ * cannot even hold the header
+ */
+int tscodec_enc_init(struct tscodec_enc *enc, uint8_t *buf, size_t cap, uint8_t channels);
+
+/**
+ * Append one record. On -ENOSPC the stream is left unchanged, so the
+ * caller can finish it and start the next one with this record.
+ * Returns 0 on success, -ENOSPC if the record does not fit, -EOVERFLOW after
+ * 255 records
+ */
+int tscodec_enc_add(struct tscodec_enc *enc, const int32_t *values);
+
+/**
+ * Returns the stream length in bytes
+ */
+size_t tscodec_enc_len(const struct tscodec_enc *enc);
+
+/**
+ * Decode a stream into values[record * channels + channel]
+ * Returns the number of records, -EINVAL on a malformed stream, -ENOSPC if
+ * more than max_values values would be produced
+ */
+int tscodec_decode(const uint8_t *buf, size_t len, int32_t *values, size_t max_values,
+                   uint8_t *channels);
+
+#endif /* TSCODEC_H_ */
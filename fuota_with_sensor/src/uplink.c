@@ -0,0 +1,303 @@
+/*
+ * Uplink thread decoupling LoRaWAN TX from sampling
+ *
+ * lorawan_send() blocks for the whole TX plus both RX windows, which can be
+ * seconds at low data rates. Frames are handed over through one k_msgq per
+ * traffic class so the sampling thread never waits on the radio; a counting
+ * semaphore wakes the thread for a frame in any class. A confirmed frame
+ * that failed waits out its backoff in a retry queue while the thread keeps
+ * sending the other frames.
+ *
+ * The airtime budget is shared with the callers of uplink_airtime_allows(),
+ * a spinlock guards it.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/lorawan/lorawan.h>
+
+#include "airtime.h"
+#include "uplink.h"
+
+LOG_MODULE_REGISTER(uplink, CONFIG_LORAWAN_SERVICES_LOG_LEVEL);
+
+#define UPLINK_STACK_SIZE 1536
+#define UPLINK_PRIORITY   7
+
+struct uplink_msg {
+    uint32_t event_ms;
+    uint32_t retry_ms;   /* Uptime the next send is due, in the retry queue */
+    uint8_t sends;       /* lorawan_send() calls so far */
+    uint8_t len;
+    uint8_t data[UPLINK_MAX_PAYLOAD];
+};
+
+K_MSGQ_DEFINE(alert_msgq, sizeof(struct uplink_msg), UPLINK_ALERT_DEPTH, 4);
+K_MSGQ_DEFINE(frag_msgq, sizeof(struct uplink_msg), UPLINK_FRAG_DEPTH, 4);
+K_MSGQ_DEFINE(telemetry_msgq, sizeof(struct uplink_msg), UPLINK_TELEMETRY_DEPTH, 4);
+K_MSGQ_DEFINE(diag_msgq, sizeof(struct uplink_msg), UPLINK_DIAG_DEPTH, 4);
+
+/* Alerts waiting out their backoff, all with the same delay so in due order */
+K_MSGQ_DEFINE(retry_msgq, sizeof(struct uplink_msg), UPLINK_ALERT_DEPTH, 4);
+
+K_SEM_DEFINE(uplink_sem, 0, UPLINK_ALERT_DEPTH + UPLINK_FRAG_DEPTH + UPLINK_TELEMETRY_DEPTH +
+             UPLINK_DIAG_DEPTH);
+
+struct uplink_class_cfg {
+    struct k_msgq *msgq;
+    uint8_t port;
+    enum lorawan_message_type type;
+    uint8_t sends;   /* lorawan_send() calls before giving up */
+};
+
+static const struct uplink_class_cfg class_cfg[UPLINK_NUM_CLASSES] = {
+    [UPLINK_CLASS_ALERT] = {&alert_msgq, UPLINK_FPORT_ALERT, LORAWAN_MSG_CONFIRMED,
+                            UPLINK_ALERT_SENDS},
+    [UPLINK_CLASS_FRAG] = {&frag_msgq, UPLINK_FPORT_FRAG, LORAWAN_MSG_UNCONFIRMED, 1},
+    [UPLINK_CLASS_TELEMETRY] = {&telemetry_msgq, UPLINK_FPORT_TELEMETRY,
+                                LORAWAN_MSG_UNCONFIRMED, 1},
+    [UPLINK_CLASS_DIAG] = {&diag_msgq, UPLINK_FPORT_DIAG, LORAWAN_MSG_UNCONFIRMED, 1},
+};
+
+static struct uplink_stats stats;
+static uplink_done_cb done_cb;
+
+/* Set up statically, callers may ask for the pace before uplink_start() */
+static struct airtime_budget airtime = AIRTIME_BUDGET_INITIALIZER(UPLINK_AIRTIME_BUDGET_MS);
+static struct k_spinlock airtime_lock;
+static atomic_t datarate;
+
+static uint32_t queued_frames(void)
+{
+    uint32_t depth = 0;
+
+    for (int c = 0; c < UPLINK_NUM_CLASSES; c++) {
+        depth += k_msgq_num_used_get(class_cfg[c].msgq);
+    }
+    return depth + k_msgq_num_used_get(&retry_msgq);
+}
+
+int uplink_enqueue(enum uplink_class cls, const uint8_t *data, uint8_t len, uint32_t event_ms)
+{
+    /* Built on the caller's stack, k_msgq copies it */
+    struct uplink_msg msg;
+
+    if (cls >= UPLINK_NUM_CLASSES) {
+        return -EINVAL;
+    }
+    if (len > UPLINK_MAX_PAYLOAD) {
+        return -EMSGSIZE;
+    }
+
+    msg.event_ms = event_ms;
+    msg.sends = 0;
+    msg.len = len;
+    memcpy(msg.data, data, len);
+
+    if (k_msgq_put(class_cfg[cls].msgq, &msg, K_NO_WAIT) != 0) {
+        stats.cls[cls].dropped++;
+        return -ENOBUFS;
+    }
+
+    stats.cls[cls].queued++;
+    stats.depth_max = MAX(stats.depth_max, queued_frames());
+    k_sem_give(&uplink_sem);
+    return 0;
+}
+
+/**
+ * Take the next frame, highest class first
+ * Returns its class
+ */
+static enum uplink_class next_msg(struct uplink_msg *msg)
+{
+    int c;
+
+    for (c = 0; c < UPLINK_NUM_CLASSES - 1; c++) {
+        if (k_msgq_get(class_cfg[c].msgq, msg, K_NO_WAIT) == 0) {
+            break;
+        }
+    }
+    if (c == UPLINK_NUM_CLASSES - 1) {
+        /* The semaphore counts a frame, so it is in the last class */
+        k_msgq_get(class_cfg[c].msgq, msg, K_NO_WAIT);
+    }
+    return (enum uplink_class)c;
+}
+
+void uplink_set_datarate(uint8_t dr)
+{
+    atomic_set(&datarate, dr);
+}
+
+static uint32_t frame_airtime_us(uint8_t len)
+{
+    return airtime_us915_us((uint8_t)atomic_get(&datarate), len);
+}
+
+bool uplink_airtime_allows(enum uplink_class cls, uint8_t len)
+{
+    k_spinlock_key_t key;
+    bool ok;
+
+    if (cls == UPLINK_CLASS_ALERT) {
+        return true;
+    }
+
+    key = k_spin_lock(&airtime_lock);
+    ok = airtime_allows(&airtime, k_uptime_get_32(), frame_airtime_us(len));
+    k_spin_unlock(&airtime_lock, key);
+    return ok;
+}
+
+uint32_t uplink_airtime_pace_ms(uint8_t len)
+{
+    k_spinlock_key_t key = k_spin_lock(&airtime_lock);
+    uint32_t pace = airtime_pace_ms(&airtime, k_uptime_get_32(), frame_airtime_us(len));
+
+    k_spin_unlock(&airtime_lock, key);
+    return pace;
+}
+
+/**
+ * Charge what a send put on air: one frame when it went out, every MAC
+ * try of a confirmed frame that was never acknowledged, nothing for an
+ * unconfirmed frame the stack refused
+ */
+static void charge_airtime(const struct uplink_class_cfg *cfg, uint8_t len, int ret)
+{
+    uint32_t frames = (ret == 0) ? 1 :
+                      (cfg->type == LORAWAN_MSG_CONFIRMED) ? UPLINK_ALERT_TRIES : 0;
+    k_spinlock_key_t key;
+
+    if (frames == 0) {
+        return;
+    }
+
+    key = k_spin_lock(&airtime_lock);
+    airtime_charge(&airtime, k_uptime_get_32(), frames * frame_airtime_us(len));
+    k_spin_unlock(&airtime_lock, key);
+}
+
+/**
+ * Send a frame once. A confirmed frame that failed with sends left goes to
+ * the retry queue; otherwise the result is final.
+ */
+static void send_msg(enum uplink_class cls, struct uplink_msg *msg)
+{
+    const struct uplink_class_cfg *cfg = &class_cfg[cls];
+    struct uplink_class_stats *st = &stats.cls[cls];
+    uint32_t tx_start = k_uptime_get_32();
+    int ret;
+
+    if (msg->sends == 0) {
+        st->latency_last_ms = tx_start - msg->event_ms;
+        st->latency_max_ms = MAX(st->latency_max_ms, st->latency_last_ms);
+    } else {
+        st->retries++;
+    }
+    msg->sends++;
+
+    ret = lorawan_send(cfg->port, msg->data, msg->len, cfg->type);
+
+    stats.tx_last_ms = k_uptime_get_32() - tx_start;
+    stats.tx_max_ms = MAX(stats.tx_max_ms, stats.tx_last_ms);
+    charge_airtime(cfg, msg->len, ret);
+
+    if (ret != 0 && msg->sends < cfg->sends) {
+        msg->retry_ms = k_uptime_get_32() + UPLINK_ALERT_BACKOFF_MS;
+        if (k_msgq_put(&retry_msgq, msg, K_NO_WAIT) == 0) {
+            LOG_WRN("lorawan_send failed on port %d: %d, retrying", cfg->port, ret);
+            return;
+        }
+    }
+
+    if (ret == 0) {
+        if (stats.first_tx_ms == 0) {
+            stats.first_tx_ms = tx_start;
+            LOG_INF("First uplink %u ms after reset", tx_start);
+        }
+        st->sent++;
+        LOG_INF("Uplink sent on port %d, %d bytes", cfg->port, msg->len);
+    } else {
+        st->failed++;
+        LOG_ERR("lorawan_send failed on port %d: %d", cfg->port, ret);
+    }
+
+    if (done_cb != NULL) {
+        done_cb(cls, ret);
+    }
+}
+
+static void uplink_thread(void *p1, void *p2, void *p3)
+{
+    ARG_UNUSED(p1);
+    ARG_UNUSED(p2);
+    ARG_UNUSED(p3);
+
+    static struct uplink_msg msg;
+
+    while (1) {
+        k_timeout_t wait = K_FOREVER;
+
+        /* A retry that is due goes first, else wait for a frame until it is */
+        if (k_msgq_peek(&retry_msgq, &msg) == 0) {
+            int32_t due = (int32_t)(msg.retry_ms - k_uptime_get_32());
+
+            if (due <= 0) {
+                k_msgq_get(&retry_msgq, &msg, K_NO_WAIT);
+                send_msg(UPLINK_CLASS_ALERT, &msg);
+                continue;
+            }
+            wait = K_MSEC(due);
+        }
+
+        if (k_sem_take(&uplink_sem, wait) != 0) {
+            continue;
+        }
+        send_msg(next_msg(&msg), &msg);
+    }
+}
+
+K_THREAD_DEFINE(uplink_tid, UPLINK_STACK_SIZE, uplink_thread, NULL, NULL, NULL,
+                UPLINK_PRIORITY, 0, SYS_FOREVER_MS);
+
+void uplink_start(void)
+{
+    /* Only alerts are confirmed, so this bounds their MAC retransmissions */
+    int ret = lorawan_set_conf_msg_tries(UPLINK_ALERT_TRIES);
+
+    if (ret < 0) {
+        LOG_ERR("lorawan_set_conf_msg_tries failed: %d", ret);
+    }
+
+    /* A restored session reports no DR change, take the DR its payload size implies */
+    uint8_t unused, max_size;
+
+    lorawan_get_payload_sizes(&unused, &max_size);
+    atomic_set(&datarate, airtime_us915_dr_of_payload(max_size));
+
+    k_thread_start(uplink_tid);
+}
+
+void uplink_set_done_cb(uplink_done_cb cb)
+{
+    done_cb = cb;
+}
+
+void uplink_get_stats(struct uplink_stats *out)
+{
+    k_spinlock_key_t key = k_spin_lock(&airtime_lock);
+
+    *out = stats;
+    out->depth = queued_frames();
+    out->airtime_hour_ms = airtime_used_us(&airtime, k_uptime_get_32()) / 1000;
+    out->airtime_peak_ms = airtime.stats.peak_us / 1000;
+    out->airtime_total_ms = (uint32_t)(airtime.stats.total_us / 1000);
+    out->airtime_deferred = airtime.stats.deferred;
+    k_spin_unlock(&airtime_lock, key);
+}
@@ -0,0 +1,125 @@
+/*
+ * Uplink thread decoupling LoRaWAN TX from sampling
+ *
+ * Frames are queued per traffic class, each with its own FPort. The thread
+ * always sends from the highest class that has a frame waiting, so an alert
+ * never queues behind routine telemetry.
+ *
+ * Every transmission is charged to a rolling one-hour airtime budget at
+ * the time-on-air of the current DR (see airtime.h). Alerts always go out;
+ * callers hold back other classes while uplink_airtime_allows() says no.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef UPLINK_H_
+#define UPLINK_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Largest LoRaWAN application payload (US915 DR3/DR4) */
+#define UPLINK_MAX_PAYLOAD 242
+
+/* Traffic classes, highest priority first */
+enum uplink_class {
+    UPLINK_CLASS_ALERT,       /* Anomaly events, confirmed */
+    UPLINK_CLASS_FRAG,        /* Fragmentation package answers, see frag_session.h */
+    UPLINK_CLASS_TELEMETRY,   /* Sensor frames */
+    UPLINK_CLASS_DIAG,        /* Device health counters */
+    UPLINK_NUM_CLASSES,
+};
+
+/* FPort of each class */
+#define UPLINK_FPORT_TELEMETRY 2
+#define UPLINK_FPORT_ALERT     3
+#define UPLINK_FPORT_DIAG      4
+#define UPLINK_FPORT_FRAG      201
+
+/* Frames that can wait per class while the radio is busy */
+#define UPLINK_ALERT_DEPTH     4
+#define UPLINK_TELEMETRY_DEPTH 4
+#define UPLINK_DIAG_DEPTH      1
+#define UPLINK_FRAG_DEPTH      2
+
+/*
+ * Confirmed alert: MAC transmissions per send, then sends before giving up,
+ * BACKOFF_MS apart. Other frames are sent during the backoff.
+ */
+#define UPLINK_ALERT_TRIES     4
+#define UPLINK_ALERT_SENDS     3
+#define UPLINK_ALERT_BACKOFF_MS 5000
+
+/* Self-imposed airtime per hour; US915 has no duty-cycle limit of its own */
+#ifndef UPLINK_AIRTIME_BUDGET_MS
+#define UPLINK_AIRTIME_BUDGET_MS 10000
+#endif
+
+struct uplink_class_stats {
+    uint32_t queued;          /* Frames accepted by uplink_enqueue() */
+    uint32_t sent;            /* lorawan_send() succeeded */
+    uint32_t failed;          /* Gave up on the frame */
+    uint32_t dropped;         /* Rejected because the class queue was full */
+    uint32_t retries;         /* Extra sends of confirmed frames */
+    uint32_t latency_last_ms; /* Event -> TX start of the last frame */
+    uint32_t latency_max_ms;
+};
+
+struct uplink_stats {
+    uint32_t depth;           /* Frames waiting right now, all classes */
+    uint32_t depth_max;       /* High watermark of depth */
+    uint32_t tx_last_ms;      /* Duration of the last lorawan_send() */
+    uint32_t tx_max_ms;
+    uint32_t first_tx_ms;     /* Uptime of the first frame sent: reset to first uplink */
+    uint32_t airtime_hour_ms; /* Time-on-air in the last hour */
+    uint32_t airtime_peak_ms; /* Highest hourly use seen */
+    uint32_t airtime_total_ms;/* Time-on-air since start */
+    uint32_t airtime_deferred;/* Frames held back by the budget */
+    struct uplink_class_stats cls[UPLINK_NUM_CLASSES];
+};
+
+/**
+ * Called from the uplink thread once a frame was sent or given up on, with
+ * the last lorawan_send() result. Must not block.
+ */
+typedef void (*uplink_done_cb)(enum uplink_class cls, int result);
+
+/**
+ * Start the uplink thread
+ */
+void uplink_start(void);
+
+/**
+ * Queue a frame for transmission without blocking the caller
+ * event_ms: uptime of the event the frame reports, for the latency stats
+ * Returns 0 on success, -EINVAL for an unknown class, -EMSGSIZE if too long,
+ * -ENOBUFS if the class queue is full
+ */
+int uplink_enqueue(enum uplink_class cls, const uint8_t *data, uint8_t len, uint32_t event_ms);
+
+/**
+ * Current data rate, from the DR changed callback. uplink_start() seeds it
+ * from the max payload of the session.
+ */
+void uplink_set_datarate(uint8_t dr);
+
+/**
+ * Whether a frame of len bytes of a class fits the airtime budget now.
+ * Always true for alerts; counts a deferral otherwise.
+ */
+bool uplink_airtime_allows(enum uplink_class cls, uint8_t len);
+
+/**
+ * Spacing between frames of len bytes that keeps within the budget at the
+ * current DR, see airtime_pace_ms()
+ */
+uint32_t uplink_airtime_pace_ms(uint8_t len);
+
+/**
+ * Register the send result callback, NULL to remove it
+ */
+void uplink_set_done_cb(uplink_done_cb cb);
+
+void uplink_get_stats(struct uplink_stats *stats);
+
+#endif /* UPLINK_H_ */
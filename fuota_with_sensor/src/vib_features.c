@@ -0,0 +1,194 @@
+/*
+ * Streaming vibration feature extractor (fixed point)
+ *
+ * Each axis keeps the power sums S1..S4 of d = x - center. The center is the
+ * mean of the previous window (or the first sample of the very first one), so
+ * d stays close to zero-mean and the central moments follow from the shifted
+ * sums without catastrophic cancellation. With |d| <= VIB_CLIP_MG and at most
+ * VIB_WINDOW_MAX samples every intermediate fits in int64.
+ *
+ * Moments are computed as per-sample averages in Q4 (1/16 mg^k):
+ *   m2 = r2 - a^2
+ *   m3 = r3 - 3 a r2 + 2 a^3
+ *   m4 = r4 - 4 a r3 + 6 a^2 r2 - 3 a^4
+ * where a = S1/n and rk = Sk/n.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "vib_features.h"
+
+#define Q4 16
+
+static int64_t clamp64(int64_t v, int64_t lo, int64_t hi)
+{
+    return (v < lo) ? lo : ((v > hi) ? hi : v);
+}
+
+static int64_t abs64(int64_t v)
+{
+    return (v < 0) ? -v : v;
+}
+
+uint32_t vib_isqrt64(uint64_t v)
+{
+    uint64_t res = 0;
+    uint64_t bit = (uint64_t)1 << 62;
+
+    while (bit > v) {
+        bit >>= 2;
+    }
+
+    while (bit != 0) {
+        if (v >= res + bit) {
+            v -= res + bit;
+            res = (res >> 1) + bit;
+        } else {
+            res >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    return (uint32_t)res;
+}
+
+/**
+ * Per-sample average of a power sum in Q4
+ */
+static int64_t avg_q4(int64_t sum, uint16_t n)
+{
+    if (abs64(sum) > INT64_MAX / Q4) {
+        return (sum / n) * Q4;
+    }
+    return (sum * Q4) / n;
+}
+
+static void acc_reset(struct vib_axis_acc *acc)
+{
+    int32_t center = acc->center;
+
+    memset(acc, 0, sizeof(*acc));
+    acc->center = center;
+    acc->min = INT32_MAX;
+    acc->max = INT32_MIN;
+}
+
+static void finalize_axis(const struct vib_axis_acc *acc, uint16_t n,
+                          struct vib_axis_features *out)
+{
+    int64_t a = avg_q4(acc->s1, n);
+    int64_t r2 = avg_q4(acc->s2, n);
+    int64_t r3 = avg_q4(acc->s3, n);
+    int64_t r4 = avg_q4(acc->s4, n);
+    int64_t a2 = (a * a) / Q4;
+
+    /* Central moments, Q4 */
+    int64_t m2 = r2 - a2;
+    int64_t m3 = r3 - (3 * a * r2) / Q4 + (2 * a2 * a) / Q4;
+    int64_t m4 = r4 - (4 * a * r3) / Q4 + (6 * a2 * r2) / Q4 - (3 * a2 * a2) / Q4;
+
+    memset(out, 0, sizeof(*out));
+    out->mean_mg = (int16_t)clamp64(acc->center + (a + (a >= 0 ? Q4 / 2 : -Q4 / 2)) / Q4,
+                                    INT16_MIN, INT16_MAX);
+    out->p2p_mg = (uint16_t)clamp64((int64_t)acc->max - acc->min, 0, UINT16_MAX);
+
+    if (m2 <= 0) {
+        /* Constant signal, higher order features are undefined */
+        return;
+    }
+
+    int64_t rms_q4 = vib_isqrt64((uint64_t)m2 * Q4);
+
+    if (rms_q4 == 0) {
+        return;
+    }
+
+    int64_t peak_q4 = abs64((int64_t)acc->max * Q4 - a);
+    int64_t low_q4 = abs64((int64_t)acc->min * Q4 - a);
+
+    if (low_q4 > peak_q4) {
+        peak_q4 = low_q4;
+    }
+
+    out->rms_mg = (uint16_t)clamp64((rms_q4 + Q4 / 2) / Q4, 0, UINT16_MAX);
+    out->crest_q8 = (uint16_t)clamp64((peak_q4 * 256) / rms_q4, 0, UINT16_MAX);
+
+    /* skew = m3 / m2^1.5 = 16 m3 / (m2 * rms_q4) */
+    out->skew_q8 = (int16_t)clamp64((m3 * 4096) / (m2 * rms_q4), INT16_MIN, INT16_MAX);
+
+    /* kurt = m4 / m2^2 = 16 m4 / m2^2, divided in two steps to stay in range */
+    int64_t kurt = ((m4 > 0 ? m4 : 0) * Q4) / m2;
+
+    out->kurt_q8 = (uint16_t)clamp64((kurt * 256) / m2, 0, UINT16_MAX);
+}
+
+int vib_features_init(struct vib_features_engine *eng, uint16_t window)
+{
+    if (window == 0 || window > VIB_WINDOW_MAX) {
+        return -EINVAL;
+    }
+
+    memset(eng, 0, sizeof(*eng));
+    eng->window = window;
+    for (int i = 0; i < VIB_AXES; i++) {
+        acc_reset(&eng->acc[i]);
+    }
+    return 0;
+}
+
+bool vib_features_add(struct vib_features_engine *eng, int16_t x, int16_t y, int16_t z)
+{
+    const int16_t v[VIB_AXES] = {x, y, z};
+    bool clipped = false;
+
+    for (int i = 0; i < VIB_AXES; i++) {
+        struct vib_axis_acc *acc = &eng->acc[i];
+
+        if (eng->count == 0 && !eng->centered) {
+            acc->center = v[i];
+        }
+
+        int64_t d = (int64_t)v[i] - acc->center;
+
+        if (d > VIB_CLIP_MG || d < -VIB_CLIP_MG) {
+            d = clamp64(d, -VIB_CLIP_MG, VIB_CLIP_MG);
+            clipped = true;
+        }
+
+        int64_t d2 = d * d;
+
+        acc->s1 += d;
+        acc->s2 += d2;
+        acc->s3 += d2 * d;
+        acc->s4 += d2 * d2;
+        if (d < acc->min) {
+            acc->min = (int32_t)d;
+        }
+        if (d > acc->max) {
+            acc->max = (int32_t)d;
+        }
+    }
+
+    eng->clipped += clipped ? 1 : 0;
+    if (++eng->count < eng->window) {
+        return false;
+    }
+
+    for (int i = 0; i < VIB_AXES; i++) {
+        finalize_axis(&eng->acc[i], eng->count, &eng->last.axis[i]);
+        /* Next window is centered on this window's mean */
+        eng->acc[i].center = eng->last.axis[i].mean_mg;
+        acc_reset(&eng->acc[i]);
+    }
+    eng->last.samples = eng->count;
+    eng->last.clipped = eng->clipped;
+    eng->count = 0;
+    eng->clipped = 0;
+    eng->centered = true;
+    eng->windows++;
+    return true;
+}
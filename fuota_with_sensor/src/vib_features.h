@@ -0,0 +1,84 @@
+/*
+ * Streaming vibration feature extractor (fixed point)
+ *
+ * Per-axis RMS, peak-to-peak, crest factor, skewness and kurtosis over a
+ * window of accelerometer samples. O(1) work per sample and integer-only math,
+ * the STM32WL55 Cortex-M4 has no FPU. Has no Zephyr dependency so it also
+ * builds on the host (see tests_host).
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef VIB_FEATURES_H_
+#define VIB_FEATURES_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define VIB_AXES 3
+
+/* Largest window; keeps the 4th power sums inside int64 */
+#define VIB_WINDOW_MAX 256
+
+/* Deviations from the window center are clipped to +-this many mg */
+#define VIB_CLIP_MG 8191
+
+/* Features of one axis over one window */
+struct vib_axis_features {
+    int16_t mean_mg;
+    uint16_t rms_mg;     /* AC RMS (standard deviation) */
+    uint16_t p2p_mg;     /* Peak to peak */
+    uint16_t crest_q8;   /* Peak deviation / RMS, Q8 */
+    int16_t skew_q8;     /* Skewness, Q8 */
+    uint16_t kurt_q8;    /* Kurtosis (3.0 for Gaussian noise), Q8 */
+};
+
+struct vib_features {
+    struct vib_axis_features axis[VIB_AXES];
+    uint16_t samples;
+    uint16_t clipped;    /* Samples that hit VIB_CLIP_MG */
+};
+
+/*
+ * Shifted power sums: samples are accumulated relative to a center close to
+ * the mean (the previous window's mean), which keeps the sums small and makes
+ * the moment formulas numerically stable in exact integer arithmetic.
+ */
+struct vib_axis_acc {
+    int32_t center;
+    int64_t s1;
+    int64_t s2;
+    int64_t s3;
+    int64_t s4;
+    int32_t min;
+    int32_t max;
+};
+
+struct vib_features_engine {
+    struct vib_axis_acc acc[VIB_AXES];
+    uint16_t window;
+    uint16_t count;
+    uint16_t clipped;
+    bool centered;       /* Centers come from a previous window */
+    uint32_t windows;    /* Completed windows */
+    struct vib_features last;
+};
+
+/**
+ * Reset the engine for windows of the given length (1..VIB_WINDOW_MAX)
+ * Returns 0 on success, -EINVAL on a bad window length
+ */
+int vib_features_init(struct vib_features_engine *eng, uint16_t window);
+
+/**
+ * Add one sample in mg. Returns true when it completed a window; the results
+ * are then in eng->last.
+ */
+bool vib_features_add(struct vib_features_engine *eng, int16_t x, int16_t y, int16_t z);
+
+/**
+ * Integer square root, floor(sqrt(v))
+ */
+uint32_t vib_isqrt64(uint64_t v);
+
+#endif /* VIB_FEATURES_H_ */
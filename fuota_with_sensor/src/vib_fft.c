@@ -0,0 +1,308 @@
+/*
+ * Vibration spectrum summary (fixed point FFT)
+ *
+ * Pipeline per window:
+ *   1. remove the mean and apply a block floating point gain 2^shift so the
+ *      largest deviation uses the full q15 range
+ *   2. Hann window
+ *   3. real FFT, output scaled by 1/N (arm_rfft_q15 or the reference below)
+ *   4. per-bin power re^2 + im^2, summed per band
+ *
+ * Mean square of a band in mg^2 (one-sided, Hann power gain 3/8):
+ *   P = 2 * sum(p_k) / 2^(2 shift) / (3/8) = sum(p_k) * 16/3 / 2^(2 shift)
+ *
+ * The sine table is built by integer rotation, so neither the target (no FPU)
+ * nor the host needs libm.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "vib_fft.h"
+
+#ifdef CONFIG_CMSIS_DSP
+#include <arm_math.h>
+#endif
+
+#define QUARTER (VIB_FFT_LEN / 4)
+#define HALF    (VIB_FFT_LEN / 2)
+
+/* 2*pi in Q30 */
+#define TWO_PI_Q30 6746518852LL
+#define ONE_Q30    (1LL << 30)
+
+/* sin(2*pi*k/N) for k = 0..N/4, Q15 */
+static int16_t sin_tab[QUARTER + 1];
+static int16_t hann[VIB_FFT_LEN];
+
+static int16_t fft_in[VIB_FFT_LEN];
+static int16_t fft_out[2 * VIB_FFT_LEN];
+
+static uint16_t fs;
+static uint8_t num_bands;
+static uint16_t band_lo[VIB_FFT_MAX_BANDS];
+static uint16_t band_hi[VIB_FFT_MAX_BANDS];
+static bool ready;
+
+#ifdef CONFIG_CMSIS_DSP
+static arm_rfft_instance_q15 rfft;
+
+/* Per-length init only links the twiddles of that length */
+#if VIB_FFT_LEN == 256
+#define RFFT_INIT(s) arm_rfft_init_256_q15(s, 0, 1)
+#else
+#define RFFT_INIT(s) arm_rfft_init_512_q15(s, 0, 1)
+#endif
+#endif /* CONFIG_CMSIS_DSP */
+
+static int64_t mul_q30(int64_t a, int64_t b)
+{
+    return (a * b + (1LL << 29)) >> 30;
+}
+
+static void build_sin_table(void)
+{
+    /* Rotation step from Taylor series, theta = 2*pi/N is small */
+    int64_t t = TWO_PI_Q30 / VIB_FFT_LEN;
+    int64_t t2 = mul_q30(t, t);
+    int64_t t3 = mul_q30(t2, t);
+    int64_t step_c = ONE_Q30 - t2 / 2 + mul_q30(t2, t2) / 24;
+    int64_t step_s = t - t3 / 6 + mul_q30(t3, t2) / 120;
+    int64_t c = ONE_Q30;
+    int64_t s = 0;
+
+    for (int k = 0; k <= QUARTER; k++) {
+        int64_t q15 = (s + (1 << 14)) >> 15;
+
+        sin_tab[k] = (int16_t)((q15 > INT16_MAX) ? INT16_MAX : q15);
+
+        int64_t nc = mul_q30(c, step_c) - mul_q30(s, step_s);
+
+        s = mul_q30(s, step_c) + mul_q30(c, step_s);
+        c = nc;
+    }
+}
+
+/* sin(2*pi*k/N), Q15 */
+static int16_t sin_q15(uint32_t k)
+{
+    k &= VIB_FFT_LEN - 1;
+    if (k <= QUARTER) {
+        return sin_tab[k];
+    } else if (k <= HALF) {
+        return sin_tab[HALF - k];
+    } else if (k <= HALF + QUARTER) {
+        return (int16_t)-sin_tab[k - HALF];
+    }
+    return (int16_t)-sin_tab[VIB_FFT_LEN - k];
+}
+
+static int16_t cos_q15(uint32_t k)
+{
+    return sin_q15(k + QUARTER);
+}
+
+/* 8 * log2(v), floor */
+static uint32_t log2_q3(uint64_t v)
+{
+    uint32_t e = 0;
+
+    if (v == 0) {
+        return 0;
+    }
+    while ((v >> e) > 1) {
+        e++;
+    }
+
+    /* Mantissa in [1, 2) as Q30, then one fraction bit per squaring */
+    uint64_t m = (e > 30) ? (v >> (e - 30)) : (v << (30 - e));
+    uint32_t r = e;
+
+    for (int i = 0; i < 3; i++) {
+        m = (m * m) >> 30;
+        r <<= 1;
+        if (m >= (2ULL << 30)) {
+            m >>= 1;
+            r |= 1;
+        }
+    }
+    return r;
+}
+
+/* Level code of a sum of bin powers, see vib_spectrum */
+static uint8_t power_level(uint64_t sum, uint8_t shift)
+{
+    int32_t lvl = (int32_t)log2_q3((sum * 256) / 3) - 16 * shift;
+
+    return (uint8_t)((lvl < 0) ? 0 : ((lvl > UINT8_MAX) ? UINT8_MAX : lvl));
+}
+
+int vib_fft_init(uint16_t fs_hz, const struct vib_fft_band *bands, uint8_t nbands)
+{
+    if (fs_hz == 0 || bands == NULL || nbands == 0 || nbands > VIB_FFT_MAX_BANDS) {
+        return -EINVAL;
+    }
+
+    for (int i = 0; i < nbands; i++) {
+        /* Bin k is centered on k * fs / N, in 0.1 Hz: k = f_dhz * N / (10 fs) */
+        uint32_t lo = ((uint32_t)bands[i].lo_dhz * VIB_FFT_LEN + 10U * fs_hz - 1) /
+                      (10U * fs_hz);
+        uint32_t hi = ((uint32_t)bands[i].hi_dhz * VIB_FFT_LEN + 10U * fs_hz - 1) /
+                      (10U * fs_hz);
+
+        if (bands[i].hi_dhz <= bands[i].lo_dhz) {
+            return -EINVAL;
+        }
+        /* DC is removed and Nyquist is not a full bin, keep [1, N/2) */
+        band_lo[i] = (uint16_t)((lo < 1) ? 1 : ((lo > HALF) ? HALF : lo));
+        band_hi[i] = (uint16_t)((hi > HALF) ? HALF : hi);
+    }
+
+    fs = fs_hz;
+    num_bands = nbands;
+
+    build_sin_table();
+    for (int n = 0; n < VIB_FFT_LEN; n++) {
+        /* 0.5 - 0.5 cos(2 pi n / N) */
+        hann[n] = (int16_t)((INT16_MAX - cos_q15(n)) >> 1);
+    }
+
+#ifdef CONFIG_CMSIS_DSP
+    if (RFFT_INIT(&rfft) != ARM_MATH_SUCCESS) {
+        return -EINVAL;
+    }
+#endif
+
+    ready = true;
+    return 0;
+}
+
+void vib_fft_reference(const int16_t *in, int16_t *out)
+{
+    /* Bit reversed copy into the complex buffer, imaginary part zero */
+    for (uint32_t i = 0; i < VIB_FFT_LEN; i++) {
+        uint32_t r = 0;
+
+        for (uint32_t b = 1; b < VIB_FFT_LEN; b <<= 1) {
+            r = (r << 1) | ((i & b) ? 1 : 0);
+        }
+        out[2 * r] = in[i];
+        out[2 * r + 1] = 0;
+    }
+
+    /* Radix-2 DIT butterflies, halving every stage gives the 1/N scaling */
+    for (uint32_t size = 2; size <= VIB_FFT_LEN; size <<= 1) {
+        uint32_t half = size / 2;
+        uint32_t step = VIB_FFT_LEN / size;
+
+        for (uint32_t base = 0; base < VIB_FFT_LEN; base += size) {
+            for (uint32_t j = 0; j < half; j++) {
+                int32_t wr = cos_q15(j * step);
+                int32_t wi = -sin_q15(j * step);
+                int16_t *a = &out[2 * (base + j)];
+                int16_t *b = &out[2 * (base + j + half)];
+                int32_t tr = (b[0] * wr - b[1] * wi) >> 15;
+                int32_t ti = (b[0] * wi + b[1] * wr) >> 15;
+                int32_t ar = a[0];
+                int32_t ai = a[1];
+
+                a[0] = (int16_t)((ar + tr) >> 1);
+                a[1] = (int16_t)((ai + ti) >> 1);
+                b[0] = (int16_t)((ar - tr) >> 1);
+                b[1] = (int16_t)((ai - ti) >> 1);
+            }
+        }
+    }
+}
+
+int vib_fft_process(const int16_t *samples_mg, struct vib_spectrum *out)
+{
+    int32_t sum = 0;
+    int32_t peak = 0;
+
+    if (!ready) {
+        return -EINVAL;
+    }
+
+    for (int n = 0; n < VIB_FFT_LEN; n++) {
+        sum += samples_mg[n];
+    }
+
+    int32_t mean = sum / VIB_FFT_LEN;
+
+    for (int n = 0; n < VIB_FFT_LEN; n++) {
+        int32_t d = samples_mg[n] - mean;
+
+        d = (d < 0) ? -d : d;
+        peak = (d > peak) ? d : peak;
+    }
+
+    /* Block floating point: largest deviation into [2^14, 2^15) */
+    uint8_t shift = 0;
+
+    while (peak != 0 && (peak << (shift + 1)) <= INT16_MAX) {
+        shift++;
+    }
+
+    for (int n = 0; n < VIB_FFT_LEN; n++) {
+        int32_t d = samples_mg[n] - mean;
+
+        /* Only clamp when the mean removal itself overflowed 16 bits */
+        d = (shift == 0) ? ((d > INT16_MAX) ? INT16_MAX : ((d < -INT16_MAX) ? -INT16_MAX : d))
+                         : d * (1 << shift);
+        fft_in[n] = (int16_t)((d * hann[n]) >> 15);
+    }
+
+#ifdef CONFIG_CMSIS_DSP
+    arm_rfft_q15(&rfft, fft_in, fft_out);
+#else
+    vib_fft_reference(fft_in, fft_out);
+#endif
+
+    uint64_t band_sum[VIB_FFT_MAX_BANDS] = {0};
+    uint32_t peak_pow = 0;
+    uint32_t peak_bin = 0;
+
+    for (uint32_t k = 1; k < HALF; k++) {
+        int32_t re = fft_out[2 * k];
+        int32_t im = fft_out[2 * k + 1];
+        uint32_t p = (uint32_t)(re * re) + (uint32_t)(im * im);
+
+        if (p > peak_pow) {
+            peak_pow = p;
+            peak_bin = k;
+        }
+        for (int b = 0; b < num_bands; b++) {
+            if (k >= band_lo[b] && k < band_hi[b]) {
+                band_sum[b] += p;
+            }
+        }
+    }
+
+    out->nbands = num_bands;
+    out->shift = shift;
+    for (int b = 0; b < VIB_FFT_MAX_BANDS; b++) {
+        out->band_lvl[b] = (b < num_bands) ? power_level(band_sum[b], shift) : 0;
+    }
+    out->peak_lvl = power_level(peak_pow, shift);
+    out->peak_chz = (uint16_t)((peak_bin * fs * 100U) / VIB_FFT_LEN);
+
+    return 0;
+}
+
+int vib_fft_encode(const struct vib_spectrum *spec, uint8_t *buf)
+{
+    uint8_t *p = buf;
+
+    for (int b = 0; b < spec->nbands; b++) {
+        *p++ = spec->band_lvl[b];
+    }
+    *p++ = (uint8_t)(spec->peak_chz >> 8);
+    *p++ = (uint8_t)(spec->peak_chz & 0xFF);
+    *p++ = spec->peak_lvl;
+
+    return (int)(p - buf);
+}
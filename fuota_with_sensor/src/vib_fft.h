@@ -0,0 +1,75 @@
+/*
+ * Vibration spectrum summary (fixed point FFT)
+ *
+ * Real FFT over one window of single-axis accelerometer samples, reduced to
+ * a handful of band levels and the dominant peak so it fits in an uplink.
+ * Uses CMSIS-DSP arm_rfft_q15 when CONFIG_CMSIS_DSP is enabled, otherwise a
+ * portable radix-2 q15 implementation with the same 1/N output scaling. Has
+ * no Zephyr dependency so it also builds on the host (see tests_host).
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef VIB_FFT_H_
+#define VIB_FFT_H_
+
+#include <stdint.h>
+
+/* FFT length in samples, 256 or 512 */
+#ifndef VIB_FFT_LEN
+#define VIB_FFT_LEN 256
+#endif
+
+#if (VIB_FFT_LEN != 256) && (VIB_FFT_LEN != 512)
+#error "VIB_FFT_LEN must be 256 or 512"
+#endif
+
+#define VIB_FFT_MAX_BANDS 4
+
+/* Encoded bytes: one level per band, peak frequency (2) and peak level (1) */
+#define VIB_FFT_SUMMARY_SIZE(nbands) ((nbands) + 3)
+
+/* Frequency band [lo, hi) in 0.1 Hz */
+struct vib_fft_band {
+    uint16_t lo_dhz;
+    uint16_t hi_dhz;
+};
+
+/*
+ * Levels are 8 * log2(mean square in 1/16 mg^2), i.e. 8 steps per octave of
+ * power (0.38 dB). 0 means below 0.25 mg RMS, 255 is beyond full scale.
+ */
+struct vib_spectrum {
+    uint8_t band_lvl[VIB_FFT_MAX_BANDS];
+    uint8_t nbands;
+    uint8_t peak_lvl;     /* Level of the strongest bin */
+    uint16_t peak_chz;    /* Frequency of the strongest bin in 0.01 Hz */
+    uint8_t shift;        /* Block floating point gain applied to the input */
+};
+
+/**
+ * Configure the sample rate and bands, build the window and twiddle tables
+ * Returns 0 on success, -EINVAL on bad parameters
+ */
+int vib_fft_init(uint16_t fs_hz, const struct vib_fft_band *bands, uint8_t nbands);
+
+/**
+ * Transform one window of VIB_FFT_LEN samples in mg and summarize it
+ * Returns 0 on success, -EINVAL if vib_fft_init() was not called
+ */
+int vib_fft_process(const int16_t *samples_mg, struct vib_spectrum *out);
+
+/**
+ * Portable q15 real FFT, the reference for the CMSIS-DSP path.
+ * in: VIB_FFT_LEN q15 samples. out: VIB_FFT_LEN interleaved re/im pairs
+ * (bins 0..N-1), scaled by 1/N like arm_rfft_q15. Needs vib_fft_init().
+ */
+void vib_fft_reference(const int16_t *in, int16_t *out);
+
+/**
+ * Serialize a summary, VIB_FFT_SUMMARY_SIZE(nbands) bytes, big endian
+ * Returns the number of bytes written
+ */
+int vib_fft_encode(const struct vib_spectrum *spec, uint8_t *buf);
+
+#endif /* VIB_FFT_H_ */
@@ -0,0 +1,108 @@
+/*
+ * Payload Encoder/Decoder Host Benchmark
+ *
+ * Times payload_encode() per full record and payload_decode_frame() on
+ * DR3 frames of full records, raw and compressed, the bulk decode path of
+ * a network server integration.
+ *
+ * Usage: bench_payload [frames]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "batch.h"
+#include "payload.h"
+#include "payload_decoder.h"
+
+#define DR3_MAX 242
+
+static double now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void make_values(int32_t *v, int i)
+{
+    for (int f = 0; f < PAYLOAD_FULL_NUM_FIELDS; f++) {
+        v[f] = (f * 37 + i * 3) % 200;
+    }
+    v[PAYLOAD_FULL_temp] = 21500 + (rand() % 41) - 20;
+    v[PAYLOAD_FULL_hum] = 45000 + i * 10;
+    v[PAYLOAD_FULL_press] = 60000 - i;
+}
+
+/* Build a DR3 frame from 7 full records, returns its length */
+static int make_frame(uint8_t *frame, int compressed)
+{
+    struct batch b;
+    int32_t v[PAYLOAD_FULL_NUM_FIELDS];
+    uint8_t rec[PAYLOAD_RECORD_MAX];
+
+    batch_init(&b, DR3_MAX, 0);
+    if (compressed) {
+        batch_set_codec(&b, payload_batch_fields);
+    }
+    for (int i = 0; i < 7; i++) {
+        make_values(v, i);
+        payload_encode(&payload_schema_full, v, rec);
+        batch_add(&b, rec, PAYLOAD_FULL_SIZE, 0);
+    }
+    return batch_pop(&b, 0, true, frame);
+}
+
+static void bench_decode(const char *name, const uint8_t *frame, int len, long frames)
+{
+    struct payload_record recs[16];
+    long records = 0;
+    int64_t checksum = 0;
+    double start = now_ns();
+
+    for (long i = 0; i < frames; i++) {
+        int n = payload_decode_frame(frame, len, recs, 16);
+
+        records += n;
+        checksum += recs[n - 1].values[PAYLOAD_FULL_hum];
+    }
+
+    double ns = now_ns() - start;
+
+    printf("decode %s (%d bytes, %ld records/frame): %.0f ns/frame, %.1f ns/record, "
+           "%.2f M frames/s (checksum %lld)\n",
+           name, len, records / frames, ns / frames, ns / records, frames * 1e3 / ns,
+           (long long)checksum);
+}
+
+int main(int argc, char **argv)
+{
+    long frames = (argc > 1) ? atol(argv[1]) : 2000000;
+    static uint8_t raw[BATCH_FRAME_MAX];
+    static uint8_t packed[BATCH_FRAME_MAX];
+    int32_t v[PAYLOAD_FULL_NUM_FIELDS];
+    uint8_t rec[PAYLOAD_RECORD_MAX];
+    unsigned int checksum = 0;
+
+    if (frames <= 0) {
+        fprintf(stderr, "usage: %s [frames]\n", argv[0]);
+        return 1;
+    }
+
+    make_values(v, 0);
+    double start = now_ns();
+
+    for (long i = 0; i < frames; i++) {
+        v[PAYLOAD_FULL_hum] = (int32_t)(i & 0xFFFF);
+        payload_encode(&payload_schema_full, v, rec);
+        checksum += rec[3];
+    }
+    printf("encode full record: %.1f ns/record (checksum %u)\n",
+           (now_ns() - start) / frames, checksum);
+
+    bench_decode("raw", raw, make_frame(raw, 0), frames);
+    bench_decode("compressed", packed, make_frame(packed, 1), frames);
+    return 0;
+}
@@ -0,0 +1,23 @@
+/*
+ * Minimal assertion helpers shared by the host tests
+ *
+ * Same conventions as sensors_test/tests_unit_mock: every test function
+ * returns 0 on success and 1 on the first failed assertion.
+ */
+
+#ifndef TEST_UTIL_H
+#define TEST_UTIL_H
+
+#include <stdio.h>
+
+#define TEST_PASS(name) printf("✓ PASS: %s\n", name)
+#define ASSERT_TRUE(cond, msg) \
+    if (!(cond)) { fprintf(stderr, "Assertion failed: %s\n", msg); return 1; }
+#define ASSERT_EQUAL(a, b, msg) \
+    do { long long a_ = (long long)(a), b_ = (long long)(b); \
+    if (a_ != b_) { fprintf(stderr, "Assertion failed: %s (%lld != %lld)\n", msg, a_, b_); return 1; } } while (0)
+#define ASSERT_RANGE(val, min, max, msg) \
+    do { long long v_ = (long long)(val); \
+    if (v_ < (long long)(min) || v_ > (long long)(max)) { fprintf(stderr, "Assertion failed: %s (%lld not in [%lld,%lld])\n", msg, v_, (long long)(min), (long long)(max)); return 1; } } while (0)
+
+#endif /* TEST_UTIL_H */
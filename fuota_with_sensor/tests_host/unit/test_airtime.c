@@ -0,0 +1,148 @@
+/*
+ * Airtime Host Tests
+ *
+ * Time-on-air against the Semtech calculator, and the sliding one-hour
+ * budget: expiry, deferral and pacing
+ */
+
+#include <stdio.h>
+
+#include "airtime.h"
+#include "test_util.h"
+
+/**
+ * Test 1: Time-on-air matches the reference formula, including LDRO at
+ * SF11/SF12 and the 500 kHz DR4
+ */
+int test_time_on_air(void)
+{
+    printf("\n[TEST 1] Time-on-air\n");
+
+    ASSERT_EQUAL(airtime_lora_us(7, 125, 23), 61696, "SF7/125, 23 bytes");
+    ASSERT_EQUAL(airtime_lora_us(10, 125, 24), 370688, "SF10/125, 24 bytes");
+    ASSERT_EQUAL(airtime_lora_us(9, 125, 66), 390144, "SF9/125, 66 bytes");
+    ASSERT_EQUAL(airtime_lora_us(11, 125, 20), 741376, "SF11/125 with LDRO");
+    ASSERT_EQUAL(airtime_lora_us(12, 125, 64), 2793472, "SF12/125 with LDRO");
+    ASSERT_EQUAL(airtime_lora_us(8, 500, 255), 176768, "SF8/500, 255 bytes");
+
+    ASSERT_EQUAL(airtime_us915_us(0, 11), 370688, "US915 DR0, max payload");
+    ASSERT_EQUAL(airtime_us915_us(3, 10), 61696, "US915 DR3");
+    ASSERT_EQUAL(airtime_us915_us(5, 10), 0, "Unknown DR");
+    ASSERT_TRUE(airtime_us915_us(0, 11) > 5 * airtime_us915_us(3, 11),
+                "DR0 costs over 5x DR3 for the same frame");
+
+    ASSERT_EQUAL(airtime_us915_dr_of_payload(11), 0, "DR0 from its max payload");
+    ASSERT_EQUAL(airtime_us915_dr_of_payload(53), 1, "DR1 from its max payload");
+    ASSERT_EQUAL(airtime_us915_dr_of_payload(125), 2, "DR2 from its max payload");
+    ASSERT_EQUAL(airtime_us915_dr_of_payload(242), 3, "DR3 for the payload DR4 shares");
+
+    TEST_PASS("test_time_on_air");
+    return 0;
+}
+
+/**
+ * Test 2: Airtime leaves the window an hour after it was spent
+ */
+int test_window(void)
+{
+    printf("\n[TEST 2] Sliding window\n");
+
+    struct airtime_budget b;
+    uint32_t t0 = UINT32_MAX - 30 * 60 * 1000;   /* Crosses the uptime wrap */
+
+    airtime_init(&b, 10000, t0);
+    for (int m = 0; m < 60; m++) {
+        airtime_charge(&b, t0 + (uint32_t)m * 60000, 100000);
+    }
+    ASSERT_EQUAL(airtime_used_us(&b, t0 + 59 * 60000), 6000000, "An hour of frames");
+    ASSERT_EQUAL(airtime_used_us(&b, t0 + 60 * 60000), 5900000, "First minute expired");
+    ASSERT_EQUAL(airtime_used_us(&b, t0 + 90 * 60000), 2900000, "Half expired");
+    ASSERT_EQUAL(airtime_used_us(&b, t0 + 200 * 60000), 0, "All expired after idle");
+    ASSERT_EQUAL(b.stats.frames, 60, "Frames counted");
+    ASSERT_EQUAL(b.stats.total_us, 6000000, "Total kept");
+    ASSERT_EQUAL(b.stats.peak_us, 6000000, "Peak kept");
+
+    TEST_PASS("test_window");
+    return 0;
+}
+
+/**
+ * Test 3: A node stuck at DR0 is held to its budget, DR3 is not
+ */
+int test_budget(void)
+{
+    printf("\n[TEST 3] Budget at DR0 and DR3\n");
+
+    struct airtime_budget b;
+    uint32_t toa0 = airtime_us915_us(0, 11);
+    uint32_t toa3 = airtime_us915_us(3, 11);
+    int sent = 0;
+
+    /* One frame a minute for two hours */
+    airtime_init(&b, 10000, 0);
+    for (uint32_t m = 0; m < 120; m++) {
+        if (airtime_allows(&b, m * 60000, toa0)) {
+            airtime_charge(&b, m * 60000, toa0);
+            sent++;
+        }
+    }
+    ASSERT_RANGE(sent, 2 * 26, 2 * 27, "DR0: 10 s / 371 ms per hour");
+    ASSERT_TRUE(b.stats.peak_us <= 10000000, "Never over budget");
+    ASSERT_EQUAL(b.stats.deferred, 120 - sent, "Rest deferred");
+
+    airtime_init(&b, 10000, 0);
+    for (uint32_t m = 0; m < 120; m++) {
+        ASSERT_TRUE(airtime_allows(&b, m * 60000, toa3), "DR3: the same frames fit");
+        airtime_charge(&b, m * 60000, toa3);
+    }
+
+    TEST_PASS("test_budget");
+    return 0;
+}
+
+/**
+ * Test 4: Pacing spreads the remaining budget and slows down as it runs out
+ */
+int test_pace(void)
+{
+    printf("\n[TEST 4] Pacing\n");
+
+    struct airtime_budget b;
+
+    airtime_init(&b, 10000, 0);
+    ASSERT_EQUAL(airtime_pace_ms(&b, 0, 100000), 36000, "100 frames per hour");
+
+    airtime_charge(&b, 0, 5000000);
+    ASSERT_EQUAL(airtime_pace_ms(&b, 0, 100000), 72000, "Half left, half the rate");
+
+    airtime_charge(&b, 0, 10000000);
+    ASSERT_EQUAL(airtime_pace_ms(&b, 0, 100000), 16 * 36000, "Capped when exhausted");
+
+    ASSERT_EQUAL(airtime_pace_ms(&b, 61 * 60000, 100000), 36000, "Back after an hour");
+
+    struct airtime_budget s = AIRTIME_BUDGET_INITIALIZER(10000);
+
+    ASSERT_EQUAL(airtime_pace_ms(&s, 5000, 100000), 36000, "Static budget paces from boot");
+
+    TEST_PASS("test_pace");
+    return 0;
+}
+
+/* ==================== Test Runner ==================== */
+
+int main(void)
+{
+    int failed = 0;
+
+    failed += test_time_on_air();
+    failed += test_window();
+    failed += test_budget();
+    failed += test_pace();
+
+    if (failed == 0) {
+        printf("\n✓ ALL TESTS PASSED\n");
+    } else {
+        printf("\n✗ %d TEST(S) FAILED\n", failed);
+    }
+    return failed;
+}
@@ -0,0 +1,219 @@
+/*
+ * Anomaly Detector Host Tests
+ *
+ * Feeds noisy baselines with injected spikes and level shifts and checks
+ * the rolling statistics, z-scores, CUSUM events and alert encoding
+ */
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "anomaly.h"
+#include "test_util.h"
+
+static const struct anomaly_config cfg[ANOMALY_NUM_CH] = {
+    [ANOMALY_CH_TEMP] = {.min_std = 50, .z_thresh_q8 = 4 * 256, .cusum_k_q8 = 128, .cusum_h_q8 = 5 * 256},
+    [ANOMALY_CH_HUM] = {.min_std = 500, .z_thresh_q8 = 4 * 256, .cusum_k_q8 = 128, .cusum_h_q8 = 5 * 256},
+    [ANOMALY_CH_VIB_RMS] = {.min_std = 2, .z_thresh_q8 = 4 * 256, .cusum_k_q8 = 128, .cusum_h_q8 = 5 * 256},
+    [ANOMALY_CH_VIB_KURT] = {.min_std = 32, .z_thresh_q8 = 4 * 256, .cusum_k_q8 = 128, .cusum_h_q8 = 5 * 256},
+};
+
+/* Deterministic noise in [-amp, amp] */
+static int32_t noise(int32_t amp)
+{
+    return (rand() % (2 * amp + 1)) - amp;
+}
+
+static uint16_t feed(struct anomaly_detector *det, enum anomaly_channel ch, int n,
+                     int32_t base, int32_t amp)
+{
+    uint16_t flags = 0;
+
+    for (int i = 0; i < n; i++) {
+        flags |= anomaly_update(det, ch, base + noise(amp));
+    }
+    return flags;
+}
+
+/**
+ * Test 1: Configuration validation
+ */
+int test_init_validation(void)
+{
+    printf("\n[TEST 1] Configuration validation\n");
+
+    struct anomaly_detector det;
+    struct anomaly_config bad[ANOMALY_NUM_CH];
+
+    for (int i = 0; i < ANOMALY_NUM_CH; i++) {
+        bad[i] = cfg[i];
+    }
+    bad[ANOMALY_CH_HUM].min_std = 0;
+
+    ASSERT_EQUAL(anomaly_init(&det, bad), -EINVAL, "Zero noise floor rejected");
+    ASSERT_EQUAL(anomaly_init(&det, cfg), 0, "Valid config accepted");
+
+    TEST_PASS("test_init_validation");
+    return 0;
+}
+
+/**
+ * Test 2: Rolling sums stay exact once the window wraps
+ */
+int test_rolling_statistics(void)
+{
+    printf("\n[TEST 2] Rolling statistics\n");
+
+    struct anomaly_detector det;
+
+    anomaly_init(&det, cfg);
+    for (int i = 0; i < 3 * ANOMALY_WINDOW + 5; i++) {
+        anomaly_update(&det, ANOMALY_CH_TEMP, 20000 + 10 * i);
+    }
+
+    /* Window now holds the last ANOMALY_WINDOW values */
+    int64_t sum = 0;
+    int64_t sumsq = 0;
+
+    for (int i = 2 * ANOMALY_WINDOW + 5; i < 3 * ANOMALY_WINDOW + 5; i++) {
+        int64_t v = 20000 + 10 * i;
+
+        sum += v;
+        sumsq += v * v;
+    }
+    ASSERT_EQUAL(det.ch[ANOMALY_CH_TEMP].count, ANOMALY_WINDOW, "Window full");
+    ASSERT_EQUAL(det.ch[ANOMALY_CH_TEMP].sum, sum, "Rolling sum exact");
+    ASSERT_EQUAL(det.ch[ANOMALY_CH_TEMP].sumsq, sumsq, "Rolling sum of squares exact");
+
+    TEST_PASS("test_rolling_statistics");
+    return 0;
+}
+
+/**
+ * Test 3: Quiet baseline raises nothing, a spike raises a z event
+ */
+int test_spike_detection(void)
+{
+    printf("\n[TEST 3] Spike detection\n");
+
+    struct anomaly_detector det;
+
+    srand(3);
+    anomaly_init(&det, cfg);
+    ASSERT_EQUAL(feed(&det, ANOMALY_CH_VIB_RMS, 200, 100, 5), 0, "Noise alone is quiet");
+
+    uint16_t flags = anomaly_update(&det, ANOMALY_CH_VIB_RMS, 160);
+    const struct anomaly_channel_state *c = &det.ch[ANOMALY_CH_VIB_RMS];
+
+    printf("   spike z %d (Q8) score %u flags 0x%04x\n", c->z_q8, c->score, flags);
+    ASSERT_TRUE(flags & ANOMALY_FLAG(ANOMALY_CH_VIB_RMS, ANOMALY_EV_SPIKE_HIGH), "Spike flagged");
+    ASSERT_TRUE(c->z_q8 > 10 * 256, "z well above threshold");
+    ASSERT_EQUAL(anomaly_score(&det), c->score, "Overall score");
+
+    /* Same spike again is inside the hold-off */
+    ASSERT_EQUAL(anomaly_update(&det, ANOMALY_CH_VIB_RMS, 160), 0, "Hold-off");
+
+    TEST_PASS("test_spike_detection");
+    return 0;
+}
+
+/**
+ * Test 4: Slow drift below the spike threshold is caught by CUSUM
+ */
+int test_cusum_shift(void)
+{
+    printf("\n[TEST 4] CUSUM level shift\n");
+
+    struct anomaly_detector det;
+    uint16_t flags = 0;
+    int n;
+
+    srand(4);
+    anomaly_init(&det, cfg);
+    feed(&det, ANOMALY_CH_HUM, 100, 45000, 1000);
+
+    /* Shift by ~1.5 sigma: too small for a spike */
+    for (n = 1; n <= ANOMALY_WINDOW && flags == 0; n++) {
+        flags = anomaly_update(&det, ANOMALY_CH_HUM, 45900 + noise(1000));
+        ASSERT_TRUE(!(flags & ANOMALY_FLAG(ANOMALY_CH_HUM, ANOMALY_EV_SPIKE_HIGH)),
+                    "No spike for a small shift");
+    }
+
+    printf("   shift detected after %d samples, flags 0x%04x\n", n - 1, flags);
+    ASSERT_EQUAL(flags, ANOMALY_FLAG(ANOMALY_CH_HUM, ANOMALY_EV_SHIFT_UP), "Upward shift");
+
+    TEST_PASS("test_cusum_shift");
+    return 0;
+}
+
+/**
+ * Test 5: Constant channel uses the noise floor instead of dividing by zero
+ */
+int test_noise_floor(void)
+{
+    printf("\n[TEST 5] Noise floor\n");
+
+    struct anomaly_detector det;
+
+    anomaly_init(&det, cfg);
+    for (int i = 0; i < ANOMALY_WINDOW; i++) {
+        anomaly_update(&det, ANOMALY_CH_TEMP, 21000);
+    }
+
+    ASSERT_EQUAL(anomaly_update(&det, ANOMALY_CH_TEMP, 21040), 0, "Within floor");
+    ASSERT_RANGE(det.ch[ANOMALY_CH_TEMP].z_q8, 204, 205, "z = 40 / 50");
+    ASSERT_TRUE(anomaly_update(&det, ANOMALY_CH_TEMP, 20700) &
+                ANOMALY_FLAG(ANOMALY_CH_TEMP, ANOMALY_EV_SPIKE_LOW), "Drop flagged");
+
+    TEST_PASS("test_noise_floor");
+    return 0;
+}
+
+/**
+ * Test 6: Alert encoding
+ */
+int test_alert_encoding(void)
+{
+    printf("\n[TEST 6] Alert encoding\n");
+
+    struct anomaly_detector det;
+    uint8_t buf[ANOMALY_ALERT_SIZE];
+
+    anomaly_init(&det, cfg);
+    det.ch[ANOMALY_CH_TEMP].z_q8 = -3 * 256;
+    det.ch[ANOMALY_CH_VIB_KURT].z_q8 = 100 * 256;
+    det.ch[ANOMALY_CH_VIB_KURT].score = 255;
+
+    ASSERT_EQUAL(anomaly_encode_alert(&det, 0x8001, buf), ANOMALY_ALERT_SIZE, "Size");
+    ASSERT_EQUAL(buf[0], 0x80, "Flags MSB");
+    ASSERT_EQUAL(buf[1], 0x01, "Flags LSB");
+    ASSERT_EQUAL(buf[2], 255, "Score");
+    ASSERT_EQUAL((int8_t)buf[3 + ANOMALY_CH_TEMP], -24, "z Q3");
+    ASSERT_EQUAL((int8_t)buf[3 + ANOMALY_CH_VIB_KURT], 127, "z saturates");
+
+    TEST_PASS("test_alert_encoding");
+    return 0;
+}
+
+/* ==================== Test Runner ==================== */
+
+int main(void)
+{
+    int failed = 0;
+
+    failed += test_init_validation();
+    failed += test_rolling_statistics();
+    failed += test_spike_detection();
+    failed += test_cusum_shift();
+    failed += test_noise_floor();
+    failed += test_alert_encoding();
+
+    if (failed == 0) {
+        printf("\n✓ ALL TESTS PASSED\n");
+    } else {
+        printf("\n✗ %d TEST(S) FAILED\n", failed);
+    }
+    return failed;
+}
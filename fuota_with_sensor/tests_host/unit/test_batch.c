@@ -0,0 +1,224 @@
+/*
+ * Uplink Batching Host Tests
+ *
+ * Checks frame filling per data rate, re-planning on DR changes, age and
+ * format flushes and the overflow policy
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "batch.h"
+#include "test_util.h"
+
+/* US915 max application payloads */
+#define DR0_MAX 11
+#define DR1_MAX 53
+#define DR3_MAX 242
+
+#define AGE_MS 900000
+
+static uint8_t frame[BATCH_FRAME_MAX];
+
+static void make_record(uint8_t *rec, uint8_t len, uint8_t tag)
+{
+    memset(rec, tag, len);
+}
+
+/* Pop everything that is due, returns the number of frames */
+static int drain(struct batch *b, uint32_t now, bool force, int *last_len)
+{
+    int frames = 0;
+    int len;
+
+    while ((len = batch_pop(b, now, force, frame)) > 0) {
+        *last_len = len;
+        frames++;
+    }
+    return frames;
+}
+
+/**
+ * Test 1: Records accumulate until the DR3 frame is full
+ */
+int test_fill_frame(void)
+{
+    printf("\n[TEST 1] Fill a DR3 frame\n");
+
+    struct batch b;
+    uint8_t rec[34];
+    int len = 0;
+
+    batch_init(&b, DR3_MAX, AGE_MS);
+    ASSERT_EQUAL(batch_record_space(&b), 241, "Record space");
+
+    for (int i = 0; i < 6; i++) {
+        make_record(rec, sizeof(rec), (uint8_t)i);
+        ASSERT_EQUAL(batch_add(&b, rec, sizeof(rec), i * 60000), 0, "Add");
+        ASSERT_EQUAL(batch_pop(&b, i * 60000, false, frame), 0, "Not full yet");
+    }
+
+    make_record(rec, sizeof(rec), 6);
+    batch_add(&b, rec, sizeof(rec), 6 * 60000);
+    ASSERT_EQUAL(drain(&b, 6 * 60000, false, &len), 1, "One frame");
+    ASSERT_EQUAL(len, 1 + 7 * 34, "Seven records");
+    ASSERT_EQUAL(frame[0], 34, "Header holds the record size");
+    ASSERT_EQUAL(frame[1 + 6 * 34], 6, "Records in order");
+
+    TEST_PASS("test_fill_frame");
+    return 0;
+}
+
+/**
+ * Test 2: Dropping to DR0 re-plans pending records into small frames
+ */
+int test_replan_on_dr_change(void)
+{
+    printf("\n[TEST 2] Re-plan on DR change\n");
+
+    struct batch b;
+    uint8_t rec[8];
+    int len = 0;
+
+    batch_init(&b, DR3_MAX, AGE_MS);
+    for (int i = 0; i < 5; i++) {
+        make_record(rec, sizeof(rec), (uint8_t)i);
+        batch_add(&b, rec, sizeof(rec), 0);
+    }
+    ASSERT_EQUAL(drain(&b, 0, false, &len), 0, "Nothing due at DR3");
+
+    batch_set_max_payload(&b, DR0_MAX);
+    ASSERT_EQUAL(drain(&b, 0, false, &len), 5, "One record per DR0 frame");
+    ASSERT_EQUAL(len, 9, "Header + 8 bytes");
+    ASSERT_EQUAL(b.stats.replans, 1, "Replan counted");
+
+    TEST_PASS("test_replan_on_dr_change");
+    return 0;
+}
+
+/**
+ * Test 3: Records too big for the new DR are dropped, not stuck
+ */
+int test_oversize_after_dr_drop(void)
+{
+    printf("\n[TEST 3] Oversize record after DR drop\n");
+
+    struct batch b;
+    uint8_t big[34];
+    uint8_t small[8];
+    int len = 0;
+
+    batch_init(&b, DR1_MAX, AGE_MS);
+    batch_add(&b, big, sizeof(big), 0);
+    batch_set_max_payload(&b, DR0_MAX);
+    make_record(small, sizeof(small), 0xAA);
+    batch_add(&b, small, sizeof(small), 0);
+
+    ASSERT_EQUAL(drain(&b, 0, false, &len), 1, "Small record still sent");
+    ASSERT_EQUAL(frame[1], 0xAA, "Small record content");
+    ASSERT_EQUAL(b.stats.dropped, 1, "Oversize dropped");
+    ASSERT_EQUAL(batch_add(&b, big, BATCH_RECORD_MAX + 1, 0), -EMSGSIZE, "Record too long");
+
+    TEST_PASS("test_oversize_after_dr_drop");
+    return 0;
+}
+
+/**
+ * Test 4: A partial frame goes out when its oldest record ages out
+ */
+int test_age_flush(void)
+{
+    printf("\n[TEST 4] Age flush\n");
+
+    struct batch b;
+    uint8_t rec[34];
+    uint32_t t0 = UINT32_MAX - 1000;
+    int len = 0;
+
+    batch_init(&b, DR3_MAX, AGE_MS);
+    batch_add(&b, rec, sizeof(rec), t0);
+    batch_add(&b, rec, sizeof(rec), t0 + 60000);
+
+    ASSERT_EQUAL(drain(&b, t0 + AGE_MS - 1, false, &len), 0, "Not aged yet");
+    ASSERT_EQUAL(drain(&b, t0 + AGE_MS, false, &len), 1, "Aged across timer wrap");
+    ASSERT_EQUAL(len, 1 + 2 * 34, "Both records");
+    ASSERT_EQUAL(b.count, 0, "Queue empty");
+
+    TEST_PASS("test_age_flush");
+    return 0;
+}
+
+/**
+ * Test 5: A record of another size closes the current frame
+ */
+int test_format_change(void)
+{
+    printf("\n[TEST 5] Format change\n");
+
+    struct batch b;
+    uint8_t big[34];
+    uint8_t small[8];
+    int len = 0;
+
+    batch_init(&b, DR3_MAX, AGE_MS);
+    batch_add(&b, big, sizeof(big), 0);
+    batch_add(&b, big, sizeof(big), 0);
+    batch_add(&b, small, sizeof(small), 0);
+
+    ASSERT_EQUAL(drain(&b, 0, false, &len), 1, "Previous format flushed");
+    ASSERT_EQUAL(len, 1 + 2 * 34, "Two full records");
+    ASSERT_EQUAL(b.count, 1, "Small record waits");
+    ASSERT_EQUAL(drain(&b, 0, true, &len), 1, "Forced flush");
+    ASSERT_EQUAL(len, 9, "Small record frame");
+
+    TEST_PASS("test_format_change");
+    return 0;
+}
+
+/**
+ * Test 6: Overflow drops the oldest record
+ */
+int test_overflow(void)
+{
+    printf("\n[TEST 6] Overflow\n");
+
+    struct batch b;
+    uint8_t rec[4];
+    int len = 0;
+
+    batch_init(&b, DR3_MAX, AGE_MS);
+    for (int i = 0; i < BATCH_MAX_RECORDS + 2; i++) {
+        make_record(rec, sizeof(rec), (uint8_t)i);
+        batch_add(&b, rec, sizeof(rec), 0);
+    }
+
+    ASSERT_EQUAL(b.stats.dropped, 2, "Two oldest dropped");
+    ASSERT_EQUAL(drain(&b, 0, false, &len), 1, "Full queue flushes");
+    ASSERT_EQUAL(frame[1], 2, "Oldest surviving record first");
+    ASSERT_EQUAL(len, 1 + BATCH_MAX_RECORDS * 4, "All queued records");
+
+    TEST_PASS("test_overflow");
+    return 0;
+}
+
+/* ==================== Test Runner ==================== */
+
+int main(void)
+{
+    int failed = 0;
+
+    failed += test_fill_frame();
+    failed += test_replan_on_dr_change();
+    failed += test_oversize_after_dr_drop();
+    failed += test_age_flush();
+    failed += test_format_change();
+    failed += test_overflow();
+
+    if (failed == 0) {
+        printf("\n✓ ALL TESTS PASSED\n");
+    } else {
+        printf("\n✗ %d TEST(S) FAILED\n", failed);
+    }
+    return failed;
+}
@@ -0,0 +1,247 @@
+/*
+ * Delta Patch Host Tests
+ *
+ * Encoder and streaming decoder round trips on synthetic firmware images:
+ * a code change that shifts everything after it, identical and unrelated
+ * images, fragment-sized and byte-wise feeding, and corrupt patches
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "delta.h"
+#include "delta_encode.h"
+#include "test_util.h"
+
+#define IMAGE_SIZE   (90 * 1024)
+#define FLASH_BASE   0x08008000
+#define FRAG_SIZE    232
+#define PATCH_MAX    (2 * IMAGE_SIZE + 64)
+
+static uint8_t old_img[IMAGE_SIZE];
+static uint8_t new_img[IMAGE_SIZE + 1024];
+static uint8_t out_img[IMAGE_SIZE + 1024];
+static uint8_t patch[PATCH_MAX];
+
+struct mem_io {
+    const uint8_t *old;
+    size_t old_len;
+    size_t out_len;
+};
+
+static int mem_read(void *ctx, uint32_t off, void *buf, size_t len)
+{
+    struct mem_io *m = ctx;
+
+    if (off + len > m->old_len) {
+        return -EINVAL;
+    }
+    memcpy(buf, &m->old[off], len);
+    return 0;
+}
+
+static int mem_write(void *ctx, const void *buf, size_t len)
+{
+    struct mem_io *m = ctx;
+
+    if (m->out_len + len > sizeof(out_img)) {
+        return -ENOSPC;
+    }
+    memcpy(&out_img[m->out_len], buf, len);
+    m->out_len += len;
+    return 0;
+}
+
+/* Decode patch[0..len) fed in pieces of chunk bytes; returns the feed result */
+static int apply(const uint8_t *old, size_t old_len, size_t len, size_t chunk, bool *done)
+{
+    struct mem_io m = {old, old_len, 0};
+    struct delta_io io = {&m, mem_read, mem_write};
+    struct delta_hdr hdr;
+    struct delta_dec dec;
+    int ret = delta_parse_header(patch, len, &hdr);
+
+    *done = false;
+    if (ret < 0) {
+        return ret;
+    }
+    delta_init(&dec, &hdr, &io);
+    for (size_t off = DELTA_HDR_SIZE; off < len && ret == 0; off += chunk) {
+        ret = delta_feed(&dec, &patch[off], (len - off < chunk) ? len - off : chunk);
+    }
+    *done = delta_done(&dec);
+    return ret;
+}
+
+static uint32_t rng = 1;
+
+static uint32_t next_rand(void)
+{
+    rng = rng * 1103515245 + 12345;
+    return rng >> 8;
+}
+
+/**
+ * Image with Thumb-like code and a literal pool every 64 bytes holding an
+ * absolute address; ins bytes inserted at ins_at shift every later address
+ */
+static size_t make_image(uint8_t *img, size_t size, size_t ins_at, size_t ins)
+{
+    size_t n = 0;
+
+    rng = 42;
+    for (size_t i = 0; n < size + ins && i < size; i++) {
+        if (i == ins_at) {
+            for (size_t k = 0; k < ins; k++) {
+                img[n++] = (uint8_t)(0xA5 ^ k);
+            }
+        }
+        if (i % 64 == 60 && i + 4 <= size) {
+            uint32_t target = next_rand() % size;
+            uint32_t addr = FLASH_BASE + target + ((target >= ins_at) ? ins : 0);
+
+            img[n++] = (uint8_t)addr;
+            img[n++] = (uint8_t)(addr >> 8);
+            img[n++] = (uint8_t)(addr >> 16);
+            img[n++] = (uint8_t)(addr >> 24);
+            i += 3;
+            continue;
+        }
+        img[n++] = (uint8_t)(next_rand() & 0xF7);
+    }
+    return n;
+}
+
+/**
+ * Test 1: 300 bytes of new code in the middle: an order of magnitude fewer
+ * fragments than the full image
+ */
+int test_code_change(void)
+{
+    printf("\n[TEST 1] Code change shifting half the image\n");
+
+    size_t old_len = make_image(old_img, IMAGE_SIZE, IMAGE_SIZE, 0);
+    size_t new_len = make_image(new_img, IMAGE_SIZE, IMAGE_SIZE / 2, 300);
+    bool done;
+
+    /* A changed version string too */
+    memcpy(&new_img[1024], "v1.4.2", 6);
+
+    long len = delta_encode(old_img, old_len, new_img, new_len, patch, sizeof(patch));
+    size_t frags_full = (new_len + FRAG_SIZE - 1) / FRAG_SIZE;
+    size_t frags = ((size_t)len + FRAG_SIZE - 1) / FRAG_SIZE;
+
+    printf("  new %zu B, patch %ld B: %zu fragments instead of %zu\n", new_len, len, frags,
+           frags_full);
+    ASSERT_TRUE(len > 0, "Encoded");
+    ASSERT_TRUE(frags * 10 <= frags_full, "10x fewer fragments");
+
+    ASSERT_EQUAL(apply(old_img, old_len, len, FRAG_SIZE, &done), 0, "Applied per fragment");
+    ASSERT_TRUE(done, "Complete");
+    ASSERT_EQUAL(memcmp(out_img, new_img, new_len), 0, "New image rebuilt");
+
+    ASSERT_EQUAL(apply(old_img, old_len, len, 1, &done), 0, "Applied byte by byte");
+    ASSERT_TRUE(done && memcmp(out_img, new_img, new_len) == 0, "Same result");
+
+    TEST_PASS("test_code_change");
+    return 0;
+}
+
+/**
+ * Test 2: Identical images make a patch of a few bytes, unrelated ones one
+ * barely larger than the image
+ */
+int test_extremes(void)
+{
+    printf("\n[TEST 2] Identical and unrelated images\n");
+
+    size_t old_len = make_image(old_img, IMAGE_SIZE, IMAGE_SIZE, 0);
+    bool done;
+    long len;
+
+    len = delta_encode(old_img, old_len, old_img, old_len, patch, sizeof(patch));
+    printf("  identical: %ld B\n", len);
+    ASSERT_RANGE(len, DELTA_HDR_SIZE + 1, DELTA_HDR_SIZE + 16, "A single copy");
+    ASSERT_EQUAL(apply(old_img, old_len, len, FRAG_SIZE, &done), 0, "Applied");
+    ASSERT_TRUE(done && memcmp(out_img, old_img, old_len) == 0, "Rebuilt");
+
+    rng = 7;
+    for (size_t i = 0; i < 4096; i++) {
+        new_img[i] = (uint8_t)next_rand();
+    }
+    len = delta_encode(old_img, old_len, new_img, 4096, patch, sizeof(patch));
+    printf("  unrelated 4096 B: %ld B\n", len);
+    ASSERT_RANGE(len, 4096, 4096 + DELTA_HDR_SIZE + 8, "All literal");
+    ASSERT_EQUAL(apply(old_img, old_len, len, FRAG_SIZE, &done), 0, "Applied");
+    ASSERT_TRUE(done && memcmp(out_img, new_img, 4096) == 0, "Rebuilt");
+
+    ASSERT_EQUAL(delta_encode(old_img, old_len, new_img, 4096, patch, 100), -ENOSPC,
+                 "Output too small");
+
+    TEST_PASS("test_extremes");
+    return 0;
+}
+
+/**
+ * Test 3: A full image is no patch, a corrupt patch or the wrong base image
+ * never passes as complete
+ */
+int test_corrupt(void)
+{
+    printf("\n[TEST 3] Corrupt patches\n");
+
+    size_t old_len = make_image(old_img, IMAGE_SIZE, IMAGE_SIZE, 0);
+    size_t new_len = make_image(new_img, IMAGE_SIZE, 1000, 40);
+    struct delta_hdr hdr;
+    bool done;
+    long len;
+    int bad = 0;
+
+    ASSERT_EQUAL(delta_parse_header(old_img, old_len, &hdr), -ENOMSG, "Full image");
+    ASSERT_EQUAL(delta_parse_header(patch, 8, &hdr), -ENOMSG, "Too short");
+
+    len = delta_encode(old_img, old_len, new_img, new_len, patch, sizeof(patch));
+    ASSERT_EQUAL(delta_parse_header(patch, len, &hdr), 0, "Header");
+    ASSERT_EQUAL(hdr.patch_size, len, "Patch size in the header");
+    ASSERT_EQUAL(hdr.old_crc, delta_crc32(0, old_img, old_len), "Old CRC");
+
+    for (long pos = DELTA_HDR_SIZE; pos < len; pos += 37) {
+        patch[pos] ^= 0x5A;
+        int ret = apply(old_img, old_len, len, FRAG_SIZE, &done);
+
+        bad += (ret < 0 || !done);
+        ASSERT_TRUE(!done || memcmp(out_img, new_img, new_len) == 0, "Never a wrong image");
+        patch[pos] ^= 0x5A;
+    }
+    printf("  %d of %ld corruptions rejected\n", bad, (len - DELTA_HDR_SIZE + 36) / 37);
+    ASSERT_EQUAL(bad, (len - DELTA_HDR_SIZE + 36) / 37, "All rejected");
+
+    /* Different base: copies read other bytes, the CRC catches it */
+    old_img[5000] ^= 1;
+    ASSERT_TRUE(apply(old_img, old_len, len, FRAG_SIZE, &done) == -EBADMSG || !done,
+                "Wrong base image");
+    ASSERT_EQUAL(delta_crc32(0, "123456789", 9), 0xCBF43926, "CRC-32 check value");
+
+    TEST_PASS("test_corrupt");
+    return 0;
+}
+
+/* ==================== Test Runner ==================== */
+
+int main(void)
+{
+    int failed = 0;
+
+    failed += test_code_change();
+    failed += test_extremes();
+    failed += test_corrupt();
+
+    if (failed == 0) {
+        printf("\n✓ ALL TESTS PASSED\n");
+    } else {
+        printf("\n✗ %d TEST(S) FAILED\n", failed);
+    }
+    return failed;
+}
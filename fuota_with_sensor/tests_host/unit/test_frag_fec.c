@@ -0,0 +1,475 @@
+/*
+ * Fragment FEC Host Tests
+ *
+ * TS004 sessions over a lossy link: block rebuilt from uncoded and coded
+ * fragments with the rows in a flash-like area written once each, the
+ * limits of that area, RAM against the reference decoder, and sessions
+ * resumed from the journal and the rows after a power failure
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "frag_fec.h"
+#include "frag_journal.h"
+#include "test_util.h"
+
+#define FRAG_SIZE 232
+#define NB_FRAG   400
+
+static uint8_t block[NB_FRAG * FRAG_SIZE];
+static uint8_t slot[NB_FRAG * FRAG_SIZE];
+static uint8_t rows_area[FRAG_FEC_MAX_ROWS * FRAG_FEC_ROW_MAX];
+static uint8_t rows_written[FRAG_FEC_MAX_ROWS];
+static struct frag_fec fec;
+
+static int read_frag(void *ctx, uint16_t idx, uint8_t *buf, size_t len)
+{
+    (void)ctx;
+    memcpy(buf, &slot[idx * len], len);
+    return 0;
+}
+
+/* Flash: programmed bytes only take the same value again */
+static int write_frag(void *ctx, uint16_t idx, const uint8_t *buf, size_t len)
+{
+    (void)ctx;
+    for (size_t i = 0; i < len; i++) {
+        if (slot[idx * len + i] != 0xFF && slot[idx * len + i] != buf[i]) {
+            return -EIO;
+        }
+    }
+    memcpy(&slot[idx * len], buf, len);
+    return 0;
+}
+
+static int read_row(void *ctx, uint16_t row, uint8_t *buf, size_t len)
+{
+    (void)ctx;
+    memcpy(buf, &rows_area[row * len], len);
+    return 0;
+}
+
+/* Flash: a row is written once */
+static int write_row(void *ctx, uint16_t row, const uint8_t *buf, size_t len)
+{
+    (void)ctx;
+    if (rows_written[row]++) {
+        return -EIO;
+    }
+    memcpy(&rows_area[row * len], buf, len);
+    return 0;
+}
+
+static const struct frag_fec_io io = {NULL, read_frag, write_frag, read_row, write_row};
+
+static uint32_t rng;
+
+static uint32_t next_rand(void)
+{
+    rng = rng * 1103515245 + 12345;
+    return rng >> 8;
+}
+
+/* Coded fragment n as the server builds it */
+static void make_coded(uint32_t n, uint16_t nb_frag, uint8_t *out)
+{
+    uint8_t bits[FRAG_FEC_MAX_FRAGS / 8];
+
+    frag_fec_parity_row(n, nb_frag, bits);
+    memset(out, 0, FRAG_SIZE);
+    for (uint16_t i = 0; i < nb_frag; i++) {
+        if (bits[i / 8] & (1 << (i % 8))) {
+            for (int k = 0; k < FRAG_SIZE; k++) {
+                out[k] ^= block[i * FRAG_SIZE + k];
+            }
+        }
+    }
+}
+
+/**
+ * Run a session with a loss rate in percent, bursts of burst fragments;
+ * returns the coded fragments it took, -1 if redundancy ran out
+ */
+static int run_session(uint16_t nb_frag, int loss, int burst, int redundancy, uint16_t max_rows)
+{
+    uint8_t frag[FRAG_SIZE];
+    int lost = 0;
+
+    for (size_t i = 0; i < sizeof(block); i++) {
+        block[i] = (uint8_t)next_rand();
+    }
+    memset(slot, 0xFF, sizeof(slot));
+    memset(rows_written, 0, sizeof(rows_written));
+    frag_fec_init(&fec, &io, nb_frag, FRAG_SIZE, max_rows);
+
+    for (int c = 1; c <= nb_frag + redundancy; c++) {
+        if (lost > 0 || (int)(next_rand() % (100 * burst)) < loss) {
+            lost = (lost > 0) ? lost - 1 : burst - 1;
+            continue;
+        }
+        if (c <= nb_frag) {
+            memcpy(frag, &block[(c - 1) * FRAG_SIZE], FRAG_SIZE);
+        } else {
+            make_coded(c - nb_frag, nb_frag, frag);
+        }
+        if (frag_fec_put(&fec, c, frag, FRAG_SIZE) == 1) {
+            if (frag_fec_solve(&fec) < 0) {
+                return -1;
+            }
+            return (c > nb_frag) ? c - nb_frag : 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Test 1: No loss needs no coded fragment, a duplicate changes nothing
+ */
+int test_lossless(void)
+{
+    printf("\n[TEST 1] Lossless session\n");
+
+    rng = 1;
+    ASSERT_EQUAL(run_session(NB_FRAG, 0, 1, 0, FRAG_FEC_MAX_ROWS), 0, "Complete at the last");
+    ASSERT_EQUAL(memcmp(slot, block, sizeof(block)), 0, "Block in place");
+    ASSERT_EQUAL(frag_fec_put(&fec, 1, block, FRAG_SIZE), 1, "Still complete");
+
+    memset(slot, 0xFF, sizeof(slot));
+    frag_fec_init(&fec, &io, 4, FRAG_SIZE, 4);
+    ASSERT_EQUAL(frag_fec_solve(&fec), -EAGAIN, "Nothing to solve yet");
+    frag_fec_put(&fec, 2, block, FRAG_SIZE);
+    frag_fec_put(&fec, 2, block, FRAG_SIZE);
+    ASSERT_EQUAL(fec.stats.duplicates, 1, "Duplicate counted");
+    ASSERT_EQUAL(frag_fec_missing(&fec), 3, "Three missing");
+    ASSERT_EQUAL(frag_fec_put(&fec, 0, block, FRAG_SIZE), -EINVAL, "Counter 0");
+    ASSERT_EQUAL(frag_fec_put(&fec, 3, block, 10), -EINVAL, "Short fragment");
+    ASSERT_EQUAL(frag_fec_init(&fec, &io, FRAG_FEC_MAX_FRAGS + 1, FRAG_SIZE, 4), -EINVAL,
+                 "Too many fragments");
+
+    TEST_PASS("test_lossless");
+    return 0;
+}
+
+/**
+ * Test 2: Random and burst loss: rebuilt a few coded fragments past the
+ * number lost, each row written once
+ */
+int test_lossy(void)
+{
+    printf("\n[TEST 2] Lossy sessions\n");
+
+    static const struct {
+        int loss, burst;
+    } cases[] = {{5, 1}, {10, 1}, {20, 1}, {25, 8}};
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        rng = 100 + i;
+        int coded = run_session(NB_FRAG, cases[i].loss, cases[i].burst, 200, FRAG_FEC_MAX_ROWS);
+        uint16_t lost = NB_FRAG - fec.stats.uncoded;
+
+        printf("  %2d%% loss, bursts of %d: %3u lost, %3d coded sent, %3u received, "
+               "%3u rows\n", cases[i].loss, cases[i].burst, lost, coded, fec.stats.coded,
+               fec.rows);
+        ASSERT_TRUE(coded > 0, "Completed");
+        ASSERT_EQUAL(memcmp(slot, block, sizeof(block)), 0, "Block rebuilt");
+        ASSERT_EQUAL(fec.stats.solved, lost, "Every lost fragment solved");
+        ASSERT_EQUAL(fec.rows, lost, "One row per lost fragment");
+        ASSERT_TRUE(fec.stats.coded <= lost + 10, "Few redundant fragments");
+    }
+
+    TEST_PASS("test_lossy");
+    return 0;
+}
+
+/**
+ * Test 3: Every uncoded fragment lost on a short block, then more lost
+ * than the rows the flash holds
+ */
+int test_limits(void)
+{
+    printf("\n[TEST 3] Coded only, and out of rows\n");
+
+    uint8_t frag[FRAG_SIZE];
+    int c;
+
+    rng = 7;
+    run_session(40, 0, 1, 0, FRAG_FEC_MAX_ROWS);
+    memset(slot, 0xFF, sizeof(slot));
+    memset(rows_written, 0, sizeof(rows_written));
+    frag_fec_init(&fec, &io, 40, FRAG_SIZE, FRAG_FEC_MAX_ROWS);
+    for (c = 41; c < 200; c++) {
+        make_coded(c - 40, 40, frag);
+        if (frag_fec_put(&fec, c, frag, FRAG_SIZE) == 1) {
+            break;
+        }
+    }
+    printf("  40 fragments from %d coded ones\n", c - 40);
+    ASSERT_TRUE(c < 200, "Completed");
+    ASSERT_EQUAL(fec.stats.solved, 0, "Left to frag_fec_solve()");
+    ASSERT_EQUAL(frag_fec_solve(&fec), 0, "Solved");
+    ASSERT_EQUAL(memcmp(slot, block, 40 * FRAG_SIZE), 0, "Block rebuilt");
+
+    rng = 9;
+    ASSERT_EQUAL(run_session(NB_FRAG, 20, 1, 200, 30), -1, "30 rows for ~80 lost");
+    ASSERT_EQUAL(fec.rows, 30, "Rows full");
+    ASSERT_TRUE(fec.stats.no_room > 0, "Dropped");
+    ASSERT_EQUAL(frag_fec_missing(&fec), NB_FRAG - fec.stats.uncoded - 30, "Still missing");
+
+    TEST_PASS("test_limits");
+    return 0;
+}
+
+/**
+ * Test 4: Parity rows are reproducible and half dense at most; RAM against
+ * the square matrix the reference decoder keeps for the same redundancy
+ */
+int test_parity_and_ram(void)
+{
+    printf("\n[TEST 4] Parity rows and RAM\n");
+
+    uint8_t a[FRAG_FEC_MAX_FRAGS / 8], b[FRAG_FEC_MAX_FRAGS / 8];
+    int ones = 0;
+
+    frag_fec_parity_row(5, NB_FRAG, a);
+    frag_fec_parity_row(5, NB_FRAG, b);
+    ASSERT_EQUAL(memcmp(a, b, NB_FRAG / 8), 0, "Same row");
+    for (int i = 0; i < NB_FRAG; i++) {
+        ones += (a[i / 8] >> (i % 8)) & 1;
+    }
+    ASSERT_RANGE(ones, NB_FRAG / 4, NB_FRAG / 2, "Half dense at most");
+    frag_fec_parity_row(6, NB_FRAG, b);
+    ASSERT_TRUE(memcmp(a, b, NB_FRAG / 8) != 0, "Rows differ");
+
+    /* Reference decoder: bit matrix of R x R, plus a missing index per fragment */
+    uint32_t ref = FRAG_FEC_MAX_ROWS * FRAG_FEC_MAX_ROWS / 8 + 2 * FRAG_FEC_MAX_FRAGS;
+
+    printf("  %zu B for %d rows, the reference matrix and index %u B\n", sizeof(struct frag_fec),
+           FRAG_FEC_MAX_ROWS, ref);
+    ASSERT_TRUE(sizeof(struct frag_fec) < ref, "Less RAM");
+    ASSERT_EQUAL(frag_fec_row_len(NB_FRAG, FRAG_SIZE) % 8, 0, "Rows on write blocks");
+
+    TEST_PASS("test_parity_and_ram");
+    return 0;
+}
+
+/**
+ * Test 5: Journal records cover the fragments noted but the last few, in
+ * a record or two per window
+ */
+int test_journal(void)
+{
+    printf("\n[TEST 5] Journal\n");
+
+    struct frag_journal j;
+    uint32_t have[FRAG_FEC_MAX_FRAGS / 32] = {0};
+    uint32_t noted = 0, covered = 0;
+    int records = 0;
+    uint64_t rec, mask;
+    uint16_t base;
+
+    rng = 3;
+    frag_journal_init(&j);
+    for (uint16_t i = 0; i < NB_FRAG; i++) {
+        if (next_rand() % 10 == 0) {
+            continue;
+        }
+        noted++;
+        if (!frag_journal_add(&j, i, &rec)) {
+            continue;
+        }
+        records++;
+        ASSERT_EQUAL(frag_journal_parse(rec, &base, &mask), FRAG_JOURNAL_FRAGS, "Window");
+        for (int k = 0; k < FRAG_JOURNAL_WINDOW; k++) {
+            if ((mask >> k) & 1 && !(have[(base + k) / 32] & (1u << ((base + k) % 32)))) {
+                have[(base + k) / 32] |= 1u << ((base + k) % 32);
+                covered++;
+            }
+        }
+    }
+    printf("  %u fragments, %d records, %u covered\n", noted, records, covered);
+    ASSERT_RANGE(covered, noted - FRAG_JOURNAL_EVERY, noted, "All but the last few");
+    ASSERT_TRUE(records <= NB_FRAG / FRAG_JOURNAL_EVERY + NB_FRAG / FRAG_JOURNAL_WINDOW + 2,
+                "Few records");
+
+    ASSERT_EQUAL(frag_journal_parse(frag_journal_erased(17), &base, &mask),
+                 FRAG_JOURNAL_ERASED, "Erase record");
+    ASSERT_EQUAL(base, 17, "Its page");
+    ASSERT_EQUAL(frag_journal_parse(FRAG_JOURNAL_BLANK, &base, &mask), FRAG_JOURNAL_END,
+                 "Blank ends it");
+
+    TEST_PASS("test_journal");
+    return 0;
+}
+
+static uint64_t journal[512];
+static int journal_len;
+static struct frag_journal jstate;
+
+/* Received fragment, journaled as the session glue does */
+static int receive(uint16_t counter, const uint8_t *frag)
+{
+    uint16_t before = fec.stats.uncoded;
+    int ret = frag_fec_put(&fec, counter, frag, FRAG_SIZE);
+    uint64_t rec;
+
+    if (fec.stats.uncoded != before && frag_journal_add(&jstate, counter - 1, &rec)) {
+        journal[journal_len++] = rec;
+    }
+    return ret;
+}
+
+/* Fragment c of the session, lost at the loss rate in percent */
+static bool fragment(uint16_t c, int loss, uint8_t *frag)
+{
+    if ((int)(next_rand() % 100) < loss) {
+        return false;
+    }
+    if (c <= NB_FRAG) {
+        memcpy(frag, &block[(c - 1) * FRAG_SIZE], FRAG_SIZE);
+    } else {
+        make_coded(c - NB_FRAG, NB_FRAG, frag);
+    }
+    return true;
+}
+
+/**
+ * Reboot: replay the journal and the rows into a fresh decoder
+ * Returns frag_fec_resume()
+ */
+static int reboot(void)
+{
+    uint64_t mask;
+    uint16_t base;
+
+    frag_fec_init(&fec, &io, NB_FRAG, FRAG_SIZE, FRAG_FEC_MAX_ROWS);
+    for (int i = 0; i < journal_len; i++) {
+        if (frag_journal_parse(journal[i], &base, &mask) != FRAG_JOURNAL_FRAGS) {
+            continue;
+        }
+        for (int k = 0; k < FRAG_JOURNAL_WINDOW; k++) {
+            if ((mask >> k) & 1) {
+                frag_fec_mark(&fec, base + k);
+            }
+        }
+    }
+    frag_journal_init(&jstate);
+    return frag_fec_resume(&fec);
+}
+
+/**
+ * Power fails after the fragment counter `until`, the last row torn; back
+ * up, the device receives the session again from `next` on, or a new one
+ * from the start. Returns the fragments received after the reboot to
+ * complete, -1 if it did not
+ */
+static int outage(int loss, uint16_t until, uint16_t next, bool resume)
+{
+    uint8_t frag[FRAG_SIZE];
+    int received = 0;
+
+    for (size_t i = 0; i < sizeof(block); i++) {
+        block[i] = (uint8_t)next_rand();
+    }
+    memset(slot, 0xFF, sizeof(slot));
+    memset(rows_area, 0xFF, sizeof(rows_area));
+    memset(rows_written, 0, sizeof(rows_written));
+    frag_fec_init(&fec, &io, NB_FRAG, FRAG_SIZE, FRAG_FEC_MAX_ROWS);
+    frag_journal_init(&jstate);
+    journal_len = 0;
+
+    for (uint16_t c = 1; c <= until; c++) {
+        if (fragment(c, loss, frag)) {
+            receive(c, frag);
+        }
+    }
+    if (fec.rows > 0) {
+        uint16_t len = fec.row_len;
+
+        memset(&rows_area[(fec.rows - 1) * len + len / 2], 0xFF, len / 2);
+    }
+
+    if (!resume) {
+        /* Starting over: a new session, the slot erased */
+        memset(slot, 0xFF, sizeof(slot));
+        memset(rows_area, 0xFF, sizeof(rows_area));
+        memset(rows_written, 0, sizeof(rows_written));
+        journal_len = 0;
+        next = 1;
+    }
+    if (reboot() == 1) {
+        return (frag_fec_solve(&fec) == 0) ? 0 : -1;
+    }
+    for (uint16_t c = next; c < next + 3 * NB_FRAG; c++) {
+        if (!fragment(c, loss, frag)) {
+            continue;
+        }
+        received++;
+        if (receive(c, frag) == 1 && frag_fec_solve(&fec) == 0) {
+            return (memcmp(slot, block, sizeof(block)) == 0) ? received : -1;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Test 6: Sessions cut by a power failure, resumed against started over:
+ * the fragments the reboot saves
+ */
+int test_resume(void)
+{
+    printf("\n[TEST 6] Resume after a power failure\n");
+
+    /* Back 20 fragments later, or on the coded ones sent for the status */
+    static const struct {
+        const char *name;
+        uint16_t until, next;
+    } cases[] = {
+        {"60% of the uncoded fragments", NB_FRAG * 6 / 10, NB_FRAG * 6 / 10 + 20},
+        {"all uncoded, 20 coded fragments", NB_FRAG + 20, NB_FRAG + 200},
+    };
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        rng = 500 + i;
+        int resumed = outage(10, cases[i].until, cases[i].next, true);
+        uint16_t torn = 0;
+
+        for (uint16_t r = 0; r < fec.rows; r++) {
+            torn += (fec.row_pivot[r] == UINT16_MAX);
+        }
+        rng = 500 + i;
+        int restarted = outage(10, cases[i].until, 0, false);
+
+        printf("  after %s: %d fragments to complete resumed, %d started over, "
+               "%d saved\n", cases[i].name, resumed, restarted, restarted - resumed);
+        ASSERT_TRUE(resumed > 0 && restarted > 0, "Both complete");
+        ASSERT_TRUE(resumed * 2 < restarted, "Resume saves more than half");
+        ASSERT_EQUAL(torn, (i == 1) ? 1 : 0, "Torn row skipped");
+    }
+
+    TEST_PASS("test_resume");
+    return 0;
+}
+
+/* ==================== Test Runner ==================== */
+
+int main(void)
+{
+    int failed = 0;
+
+    failed += test_lossless();
+    failed += test_lossy();
+    failed += test_limits();
+    failed += test_parity_and_ram();
+    failed += test_journal();
+    failed += test_resume();
+
+    if (failed == 0) {
+        printf("\n✓ ALL TESTS PASSED\n");
+    } else {
+        printf("\n✗ %d TEST(S) FAILED\n", failed);
+    }
+    return failed;
+}
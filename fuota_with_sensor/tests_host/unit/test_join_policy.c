@@ -0,0 +1,182 @@
+/*
+ * Join Policy Host Tests
+ *
+ * Start-up spread across a fleet, exponential backoff with jitter and the
+ * US915 sub-band hunt
+ */
+
+#include <stdio.h>
+
+#include "join_policy.h"
+#include "test_util.h"
+
+static const struct join_policy_cfg cfg = {
+    .first_max_ms = 60000,
+    .base_ms = 15000,
+    .max_ms = 30 * 60 * 1000,
+    .band_tries = 2,
+};
+
+/**
+ * Test 1: 200 nodes powering up together spread their first join over the
+ * whole start-up window
+ */
+int test_first_attempt_spread(void)
+{
+    printf("\n[TEST 1] First attempt spread\n");
+
+    int per_10s[6] = {0};
+
+    for (uint32_t node = 1; node <= 200; node++) {
+        struct join_policy p;
+        uint8_t band;
+
+        join_policy_init(&p, &cfg, node * 2654435761u);
+        uint32_t delay = join_policy_next(&p, &band);
+
+        ASSERT_RANGE(delay, 0, cfg.first_max_ms, "Within the start-up window");
+        per_10s[delay / 10001]++;
+    }
+    for (int i = 0; i < 6; i++) {
+        printf("  %2d-%2d s: %d nodes\n", i * 10, i * 10 + 10, per_10s[i]);
+        ASSERT_RANGE(per_10s[i], 15, 55, "No crowd in any 10 s slot");
+    }
+
+    TEST_PASS("test_first_attempt_spread");
+    return 0;
+}
+
+/**
+ * Test 2: Backoff doubles per sub-band tried (2 failures) with equal jitter
+ * and stops at the cap
+ */
+int test_backoff(void)
+{
+    printf("\n[TEST 2] Exponential backoff\n");
+
+    struct join_policy p;
+    uint8_t band;
+
+    join_policy_init(&p, &cfg, 7);
+    join_policy_next(&p, &band);
+
+    for (int f = 1; f <= 48; f++) {
+        uint32_t expect = cfg.base_ms << (f / cfg.band_tries);
+
+        if (expect > cfg.max_ms) {
+            expect = cfg.max_ms;
+        }
+        join_policy_failed(&p);
+        ASSERT_RANGE(join_policy_next(&p, &band), expect / 2, expect, "Jittered backoff");
+    }
+
+    for (int f = 0; f < 100; f++) {
+        join_policy_failed(&p);
+    }
+    ASSERT_RANGE(join_policy_next(&p, &band), cfg.max_ms / 2, cfg.max_ms, "No overflow");
+    ASSERT_EQUAL(p.stats.failures, 148, "Failures counted");
+
+    join_policy_joined(&p);
+    ASSERT_RANGE(join_policy_next(&p, &band), 0, cfg.first_max_ms, "Starts over after a join");
+    ASSERT_EQUAL(p.stats.joins, 1, "Join counted");
+
+    TEST_PASS("test_backoff");
+    return 0;
+}
+
+/**
+ * Test 3: Two attempts run on each sub-band: the preferred one, the default,
+ * then the rest ascending, and the preferred one again after all eight
+ */
+int test_subband_hunt(void)
+{
+    printf("\n[TEST 3] Sub-band hunt\n");
+
+    static const uint8_t expect[] = {5, 1, 0, 2, 3, 4, 6, 7, 5};
+    struct join_policy_cfg hunt = cfg;
+    struct join_policy p;
+    uint8_t band;
+
+    hunt.nbands = 8;
+    hunt.default_band = 1;
+
+    join_policy_init(&p, &hunt, 3);
+    join_policy_next(&p, &band);
+    ASSERT_EQUAL(band, 1, "Default band without a saved one");
+
+    join_policy_init(&p, &hunt, 3);
+    join_policy_set_preferred(&p, 5);
+    for (unsigned int i = 0; i < sizeof(expect); i++) {
+        for (uint8_t t = 0; t < hunt.band_tries; t++) {
+            join_policy_next(&p, &band);
+            ASSERT_EQUAL(band, expect[i], "Hunt order");
+            join_policy_failed(&p);
+        }
+    }
+
+    /* The band that joined is the one to persist */
+    join_policy_init(&p, &hunt, 3);
+    for (int f = 0; f < 5; f++) {
+        join_policy_next(&p, &band);
+        join_policy_failed(&p);
+    }
+    join_policy_next(&p, &band);
+    join_policy_joined(&p);
+    ASSERT_EQUAL(p.band, 2, "Joined on the third band tried");
+
+    TEST_PASS("test_subband_hunt");
+    return 0;
+}
+
+/**
+ * Test 4: Sub-band masks as lorawan_set_channels_mask() takes them
+ */
+int test_us915_mask(void)
+{
+    printf("\n[TEST 4] US915 channel masks\n");
+
+    uint16_t mask[JOIN_POLICY_US915_MASK_SIZE];
+
+    join_policy_us915_mask(0, mask);
+    ASSERT_EQUAL(mask[0], 0x00FF, "Sub-band 1: channels 0-7");
+    ASSERT_EQUAL(mask[4], 0x0001, "Sub-band 1: channel 64");
+
+    join_policy_us915_mask(1, mask);
+    ASSERT_EQUAL(mask[0], 0xFF00, "Sub-band 2: channels 8-15");
+    ASSERT_EQUAL(mask[1], 0, "Nothing else");
+    ASSERT_EQUAL(mask[4], 0x0002, "Sub-band 2: channel 65");
+
+    join_policy_us915_mask(7, mask);
+    ASSERT_EQUAL(mask[3], 0xFF00, "Sub-band 8: channels 56-63");
+    ASSERT_EQUAL(mask[4], 0x0080, "Sub-band 8: channel 71");
+
+    for (uint8_t band = 0; band < JOIN_POLICY_MAX_BANDS; band++) {
+        join_policy_us915_mask(band, mask);
+        ASSERT_EQUAL(join_policy_us915_band(mask), band, "Round trip");
+    }
+
+    mask[0] = 0xFFFF;
+    ASSERT_EQUAL(join_policy_us915_band(mask), -1, "Two sub-bands rejected");
+
+    TEST_PASS("test_us915_mask");
+    return 0;
+}
+
+/* ==================== Test Runner ==================== */
+
+int main(void)
+{
+    int failed = 0;
+
+    failed += test_first_attempt_spread();
+    failed += test_backoff();
+    failed += test_subband_hunt();
+    failed += test_us915_mask();
+
+    if (failed == 0) {
+        printf("\n✓ ALL TESTS PASSED\n");
+    } else {
+        printf("\n✗ %d TEST(S) FAILED\n", failed);
+    }
+    return failed;
+}
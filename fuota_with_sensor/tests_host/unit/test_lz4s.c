@@ -0,0 +1,361 @@
+/*
+ * Compressed Image Host Tests
+ *
+ * Encoder and streaming decoder round trips on a synthetic signed firmware
+ * image, decoding in place in a slot as lz4s_flash.c does, incompressible
+ * and run-length data, and corrupt streams
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "delta.h"
+#include "lz4s.h"
+#include "lz4s_encode.h"
+#include "test_util.h"
+
+#define IMAGE_SIZE (80 * 1024)
+#define SLOT_SIZE  (96 * 1024)
+#define PAGE_SIZE  2048
+#define BLOCK_SIZE 256
+#define FRAG_SIZE  232
+
+static uint8_t img[SLOT_SIZE];
+static uint8_t comp[LZ4S_BOUND(SLOT_SIZE)];
+static uint8_t out[SLOT_SIZE];
+
+struct mem_io {
+    uint8_t *out;
+    size_t out_len;
+    size_t out_max;
+};
+
+static int mem_read(void *ctx, uint32_t off, void *buf, size_t len)
+{
+    struct mem_io *m = ctx;
+
+    if (off + len > m->out_len) {
+        return -EINVAL;
+    }
+    memcpy(buf, &m->out[off], len);
+    return 0;
+}
+
+static int mem_write(void *ctx, const void *buf, size_t len)
+{
+    struct mem_io *m = ctx;
+
+    if (m->out_len + len > m->out_max) {
+        return -ENOSPC;
+    }
+    memcpy(&m->out[m->out_len], buf, len);
+    m->out_len += len;
+    return 0;
+}
+
+/* Decode comp[0..len) fed in pieces of chunk bytes; returns the feed result */
+static int decode(size_t len, size_t chunk, bool *done)
+{
+    struct mem_io m = {out, 0, sizeof(out)};
+    struct lz4s_io io = {&m, mem_read, mem_write};
+    struct lz4s_hdr hdr;
+    struct lz4s_dec dec;
+    int ret = lz4s_parse_header(comp, len, &hdr);
+
+    *done = false;
+    if (ret < 0) {
+        return ret;
+    }
+    lz4s_init(&dec, &hdr, &io);
+    for (size_t off = LZ4S_HDR_SIZE; off < len && ret == 0; off += chunk) {
+        ret = lz4s_feed(&dec, &comp[off], (len - off < chunk) ? len - off : chunk);
+    }
+    *done = lz4s_done(&dec);
+    return ret;
+}
+
+static uint32_t rng;
+
+static uint32_t next_rand(void)
+{
+    rng = rng * 1103515245 + 12345;
+    return rng >> 8;
+}
+
+static void put16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+/**
+ * Signed image look-alike: MCUboot header, Thumb code built from a skewed
+ * set of instructions with prologues, epilogues and literal pools of
+ * absolute addresses, log strings, and a random signature TLV
+ */
+static size_t make_firmware(uint8_t *p, size_t size)
+{
+    static const char *const words[] = {
+        "sensor", "uplink", "failed", "LoRaWAN", "fragment", "%d", "%u ms", "join",
+        "flash", "battery", "[TLOG]", "read", "write", "erase", "session", "timeout",
+    };
+    uint16_t ops[1024];
+    size_t n = 0;
+
+    rng = 2024;
+    for (int i = 0; i < 1024; i++) {
+        ops[i] = (uint16_t)next_rand();
+    }
+
+    memset(p, 0, 512);
+    p[0] = 0x3D; p[1] = 0xB8; p[2] = 0xF3; p[3] = 0x96;
+    n = 512;
+
+    /* Code, 75% of the image */
+    while (n < size * 3 / 4) {
+        put16(&p[n], 0xB5F0);   /* push {r4-r7, lr} */
+        n += 2;
+        for (int k = 8 + next_rand() % 40; k > 0; k--) {
+            /* Skewed: the product of two uniforms favours low indices */
+            uint32_t r = (next_rand() % 32) * (next_rand() % 32);
+
+            put16(&p[n], ops[r]);
+            n += 2;
+        }
+        put16(&p[n], 0xBDF0);   /* pop {r4-r7, pc} */
+        n += 2;
+        for (int k = next_rand() % 4; k > 0; k--) {
+            uint32_t addr = 0x08008000 + (next_rand() % size & ~1u);
+
+            memcpy(&p[n], &addr, 4);
+            n += 4;
+        }
+    }
+
+    /* Strings */
+    while (n < size - 300) {
+        const char *w = words[next_rand() % 16];
+        size_t wl = strlen(w);
+
+        memcpy(&p[n], w, wl);
+        n += wl;
+        p[n++] = (next_rand() % 4 == 0) ? '\0' : ' ';
+    }
+
+    /* Signature */
+    while (n < size) {
+        p[n++] = (uint8_t)next_rand();
+    }
+    return n;
+}
+
+/**
+ * Test 1: A firmware image decodes from fragment-sized and single-byte
+ * feeds, in fewer fragments
+ */
+int test_firmware(void)
+{
+    printf("\n[TEST 1] Firmware image round trip\n");
+
+    size_t len = make_firmware(img, IMAGE_SIZE);
+    long comp_len = lz4s_encode(img, len, comp, sizeof(comp));
+    size_t frags_full = (len + FRAG_SIZE - 1) / FRAG_SIZE;
+    size_t frags = ((size_t)comp_len + FRAG_SIZE - 1) / FRAG_SIZE;
+    bool done;
+
+    printf("  %zu B -> %ld B (%.1f%%): %zu fragments instead of %zu\n", len, comp_len,
+           100.0 * comp_len / len, frags, frags_full);
+    ASSERT_TRUE(comp_len > 0, "Compressed");
+    ASSERT_TRUE(comp_len * 10 < (long)len * 8, "Below 80%");
+
+    ASSERT_EQUAL(decode(comp_len, FRAG_SIZE, &done), 0, "Decoded per fragment");
+    ASSERT_TRUE(done && memcmp(out, img, len) == 0, "Image rebuilt");
+    ASSERT_EQUAL(decode(comp_len, 1, &done), 0, "Decoded byte by byte");
+    ASSERT_TRUE(done && memcmp(out, img, len) == 0, "Same result");
+
+    TEST_PASS("test_firmware");
+    return 0;
+}
+
+struct inplace {
+    uint8_t *slot;
+    uint32_t shift;    /* Where the compressed image was moved */
+    uint32_t in;       /* Compressed bytes read so far */
+    uint32_t out;
+    uint32_t erased;   /* Pages erased for the output, up to here */
+};
+
+static int slot_read(void *ctx, uint32_t off, void *buf, size_t len)
+{
+    struct inplace *s = ctx;
+
+    memcpy(buf, &s->slot[off], len);
+    return 0;
+}
+
+/* An output page is erased only once all compressed bytes in it were read */
+static int slot_write(void *ctx, const void *buf, size_t len)
+{
+    struct inplace *s = ctx;
+
+    while (s->erased < s->out + len) {
+        if (s->erased + PAGE_SIZE > s->shift + s->in) {
+            return -ENOSPC;
+        }
+        memset(&s->slot[s->erased], 0xFF, PAGE_SIZE);
+        s->erased += PAGE_SIZE;
+    }
+    memcpy(&s->slot[s->out], buf, len);
+    s->out += len;
+    return 0;
+}
+
+/* Decode in place in out[] as a slot, the way lz4s_flash.c does */
+static int decode_in_place(long comp_len, size_t len)
+{
+    struct inplace s = {out, 0, 0, 0, 0};
+    struct lz4s_io io = {&s, slot_read, slot_write};
+    struct lz4s_hdr hdr;
+    struct lz4s_dec dec;
+    uint8_t block[BLOCK_SIZE];
+    int ret;
+
+    memset(out, 0xFF, SLOT_SIZE);
+    s.shift = (SLOT_SIZE - comp_len) / PAGE_SIZE * PAGE_SIZE;
+    memcpy(&out[s.shift], comp, comp_len);
+
+    ret = lz4s_parse_header(&out[s.shift], comp_len, &hdr);
+    lz4s_init(&dec, &hdr, &io);
+    s.in = LZ4S_HDR_SIZE;
+    while (ret == 0 && s.in < comp_len) {
+        uint32_t n = (comp_len - s.in < BLOCK_SIZE) ? comp_len - s.in : BLOCK_SIZE;
+
+        memcpy(block, &out[s.shift + s.in], n);
+        s.in += n;
+        ret = lz4s_feed(&dec, block, n);
+    }
+    if (ret == 0 && (!lz4s_done(&dec) || memcmp(out, img, len) != 0)) {
+        ret = -EBADMSG;
+    }
+    return ret;
+}
+
+/**
+ * Test 2: Decoding in place in the slot the image was received in; an
+ * image filling the slot is refused before it overwrites its input
+ */
+int test_in_place(void)
+{
+    printf("\n[TEST 2] Decoding in place\n");
+
+    size_t len = make_firmware(img, IMAGE_SIZE);
+    long comp_len = lz4s_encode(img, len, comp, sizeof(comp));
+
+    ASSERT_EQUAL(decode_in_place(comp_len, len), 0, "80 KB image in a 96 KB slot");
+
+    len = make_firmware(img, SLOT_SIZE - 512);
+    comp_len = lz4s_encode(img, len, comp, sizeof(comp));
+    ASSERT_EQUAL(decode_in_place(comp_len, len), -ENOSPC, "Full slot refused");
+
+    TEST_PASS("test_in_place");
+    return 0;
+}
+
+/**
+ * Test 3: Random data grows by the LZ4 bound at most, runs shrink to a
+ * few bytes and decode through overlapping matches
+ */
+int test_extremes(void)
+{
+    printf("\n[TEST 3] Incompressible data and runs\n");
+
+    long comp_len;
+    bool done;
+
+    rng = 99;
+    for (size_t i = 0; i < 8192; i++) {
+        img[i] = (uint8_t)next_rand();
+    }
+    comp_len = lz4s_encode(img, 8192, comp, sizeof(comp));
+    printf("  random 8192 B: %ld B\n", comp_len);
+    ASSERT_RANGE(comp_len, 8192, LZ4S_BOUND(8192), "Within the bound");
+    ASSERT_EQUAL(decode(comp_len, FRAG_SIZE, &done), 0, "Decoded");
+    ASSERT_TRUE(done && memcmp(out, img, 8192) == 0, "Rebuilt");
+
+    memset(img, 0xFF, 65536);
+    img[100] = 0;
+    comp_len = lz4s_encode(img, 65536, comp, sizeof(comp));
+    printf("  erased 64 KB: %ld B\n", comp_len);
+    ASSERT_TRUE(comp_len < 400, "Runs compress");
+    ASSERT_EQUAL(decode(comp_len, FRAG_SIZE, &done), 0, "Decoded");
+    ASSERT_TRUE(done && memcmp(out, img, 65536) == 0, "Rebuilt");
+
+    ASSERT_EQUAL(lz4s_encode(img, 65536, comp, 20), -ENOSPC, "Output too small");
+
+    TEST_PASS("test_extremes");
+    return 0;
+}
+
+/**
+ * Test 4: Corrupt streams never pass as a complete image
+ */
+int test_corrupt(void)
+{
+    printf("\n[TEST 4] Corrupt streams\n");
+
+    size_t len = make_firmware(img, 16 * 1024);
+    long comp_len = lz4s_encode(img, len, comp, sizeof(comp));
+    struct lz4s_hdr hdr;
+    int tried = 0, bad = 0;
+    bool done;
+
+    ASSERT_EQUAL(lz4s_parse_header(img, len, &hdr), -ENOMSG, "Full image");
+    ASSERT_EQUAL(lz4s_parse_header(comp, comp_len, &hdr), 0, "Header");
+    ASSERT_EQUAL(hdr.comp_size, comp_len, "Compressed size in the header");
+    ASSERT_EQUAL(hdr.new_crc, delta_crc32(0, img, len), "CRC");
+
+    for (long pos = LZ4S_HDR_SIZE; pos < comp_len; pos += 29) {
+        comp[pos] ^= 0x24;
+        int ret = decode(comp_len, FRAG_SIZE, &done);
+
+        tried++;
+        bad += (ret < 0 || !done);
+        ASSERT_TRUE(!done || memcmp(out, img, len) == 0, "Never a wrong image");
+        comp[pos] ^= 0x24;
+    }
+    printf("  %d of %d corruptions rejected\n", bad, tried);
+    ASSERT_EQUAL(bad, tried, "All rejected");
+
+    /* A match before the first byte */
+    static const uint8_t far[] = {0x10, 'a', 0x02, 0x00, 0x50, 'b', 'c', 'd', 'e', 'f'};
+
+    memcpy(&comp[LZ4S_HDR_SIZE], far, sizeof(far));
+    comp[4] = 10;
+    comp[12] = LZ4S_HDR_SIZE + sizeof(far);
+    ASSERT_EQUAL(decode(LZ4S_HDR_SIZE + sizeof(far), FRAG_SIZE, &done), -EINVAL,
+                 "Offset beyond the output");
+
+    TEST_PASS("test_corrupt");
+    return 0;
+}
+
+/* ==================== Test Runner ==================== */
+
+int main(void)
+{
+    int failed = 0;
+
+    failed += test_firmware();
+    failed += test_in_place();
+    failed += test_extremes();
+    failed += test_corrupt();
+
+    if (failed == 0) {
+        printf("\n✓ ALL TESTS PASSED\n");
+    } else {
+        printf("\n✗ %d TEST(S) FAILED\n", failed);
+    }
+    return failed;
+}
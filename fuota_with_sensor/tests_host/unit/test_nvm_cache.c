@@ -0,0 +1,239 @@
+/*
+ * NVM Cache Host Tests
+ *
+ * Write coalescing at uplink rate, urgent writes and deletes, frame counter
+ * reservation across power failures, and the LoRaMAC CRC-32
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "nvm_cache.h"
+#include "test_util.h"
+
+#define DELAY_MS   (10 * 60 * 1000)
+#define FCNT_STEP  64
+
+static struct nvm_cache cache;
+
+/* Write every due slot, as the flush work does */
+static int flush(uint32_t now_ms, bool all)
+{
+    int writes = 0;
+    int slot;
+
+    while ((slot = nvm_cache_due(&cache, now_ms, all)) >= 0) {
+        nvm_cache_written(&cache, (uint16_t)slot);
+        writes++;
+    }
+    return writes;
+}
+
+/**
+ * Test 1: A day of 5 s uplinks, each changing the MAC group: one write per
+ * delay instead of one per uplink
+ */
+int test_coalescing(void)
+{
+    printf("\n[TEST 1] Coalescing at uplink rate\n");
+
+    uint8_t group[200] = {0};
+    uint8_t region[1100] = {0};
+    int writes = 0;
+
+    nvm_cache_init(&cache, DELAY_MS);
+    ASSERT_TRUE(nvm_cache_stage(&cache, "lorawan/nvm/RegionGroup2", region, sizeof(region), 0,
+                                false) >= 0, "Large group cached");
+
+    for (uint32_t now = 0; now < 24 * 3600 * 1000u; now += 5000) {
+        group[0]++;
+        ASSERT_TRUE(nvm_cache_stage(&cache, "lorawan/nvm/MacGroup1", group, sizeof(group), now,
+                                    false) >= 0, "Staged");
+        /* Unchanged region group on every uplink */
+        nvm_cache_stage(&cache, "lorawan/nvm/RegionGroup2", region, sizeof(region), now, false);
+        writes += flush(now, false);
+    }
+
+    printf("  %u saves -> %d writes\n", cache.stats.staged, writes);
+    ASSERT_RANGE(writes, 24 * 6 - 3, 24 * 6 + 1, "One MAC write per 10 min, region once");
+    ASSERT_EQUAL(cache.stats.unchanged, 24 * 720, "Unchanged region saves dropped");
+    ASSERT_TRUE(nvm_cache_next_ms(&cache, 24 * 3600 * 1000u) <= DELAY_MS, "Next write planned");
+    ASSERT_EQUAL(flush(24 * 3600 * 1000u, true), 1, "Flush writes the pending group");
+    ASSERT_EQUAL(nvm_cache_next_ms(&cache, 0), UINT32_MAX, "Nothing dirty after a flush");
+
+    TEST_PASS("test_coalescing");
+    return 0;
+}
+
+/**
+ * Test 2: Urgent values are due at once, deletes free their slot
+ */
+int test_urgent_and_delete(void)
+{
+    printf("\n[TEST 2] Urgent writes and deletes\n");
+
+    const uint8_t mask[12] = {0xFF};
+    char long_name[NVM_CACHE_NAME_MAX + 1];
+    int slot;
+
+    nvm_cache_init(&cache, DELAY_MS);
+    slot = nvm_cache_stage(&cache, "lora_link/chmask", mask, sizeof(mask), 100, true);
+    ASSERT_EQUAL(slot, 0, "First slot");
+    ASSERT_EQUAL(nvm_cache_due(&cache, 100, false), 0, "Due at once");
+    ASSERT_EQUAL(nvm_cache_next_ms(&cache, 100), 0, "Nothing to wait for");
+    nvm_cache_written(&cache, 0);
+    ASSERT_EQUAL(nvm_cache_due(&cache, 100, false), -1, "Clean");
+
+    ASSERT_EQUAL(nvm_cache_stage(&cache, "lora_link/chmask", NULL, 0, 200, true), 0, "Delete");
+    ASSERT_EQUAL(nvm_cache_due(&cache, 200, false), 0, "Delete due");
+    nvm_cache_written(&cache, 0);
+    ASSERT_EQUAL(nvm_cache_find(&cache, "lora_link/chmask"), -1, "Slot freed");
+    ASSERT_EQUAL(nvm_cache_stage(&cache, "lora_link/chmask", NULL, 0, 300, true), -ENOENT,
+                 "Nothing to delete");
+    ASSERT_EQUAL(nvm_cache_stage(&cache, "fuota/state", mask, 8, 300, false), 0,
+                 "Freed slot and its pool area reused");
+    ASSERT_EQUAL(cache.pool_used, sizeof(mask), "No new pool area");
+
+    memset(long_name, 'k', sizeof(long_name) - 1);
+    long_name[sizeof(long_name) - 1] = '\0';
+    ASSERT_EQUAL(nvm_cache_stage(&cache, long_name, mask, 1, 0, false), -ENAMETOOLONG,
+                 "Name too long");
+    ASSERT_EQUAL(nvm_cache_stage(&cache, "big", cache.pool, NVM_CACHE_VALUE_MAX + 1, 0, false),
+                 -EMSGSIZE, "Value too large");
+
+    for (int i = 1; i < NVM_CACHE_ENTRIES; i++) {
+        char name[8];
+
+        snprintf(name, sizeof(name), "k%d", i);
+        ASSERT_EQUAL(nvm_cache_stage(&cache, name, mask, 1, 0, false), i, "Slots fill up");
+    }
+    ASSERT_EQUAL(nvm_cache_stage(&cache, "one/more", mask, 1, 0, false), -ENOSPC, "Full");
+
+    TEST_PASS("test_urgent_and_delete");
+    return 0;
+}
+
+/**
+ * Test 3: Values read back from flash go to their slot clean
+ */
+int test_load(void)
+{
+    printf("\n[TEST 3] Load from flash\n");
+
+    const uint8_t val[4] = {1, 2, 3, 4};
+
+    nvm_cache_init(&cache, DELAY_MS);
+    ASSERT_EQUAL(nvm_cache_load(&cache, 5, "lorawan/nvm/Crypto", val, sizeof(val)), 0, "Loaded");
+    ASSERT_EQUAL(nvm_cache_load(&cache, 5, "other", val, sizeof(val)), -EINVAL, "Slot taken");
+    ASSERT_EQUAL(nvm_cache_load(&cache, NVM_CACHE_ENTRIES, "x", val, 1), -EINVAL, "Bad slot");
+    ASSERT_EQUAL(nvm_cache_find(&cache, "lorawan/nvm/Crypto"), 5, "Found in its slot");
+    ASSERT_EQUAL(nvm_cache_due(&cache, 0, true), -1, "Clean after load");
+    ASSERT_EQUAL(memcmp(nvm_cache_value(&cache, 5), val, sizeof(val)), 0, "Value kept");
+
+    ASSERT_EQUAL(nvm_cache_stage(&cache, "lorawan/nvm/Crypto", val, sizeof(val), 0, false), 5,
+                 "Same value");
+    ASSERT_EQUAL(cache.stats.unchanged, 1, "Not dirtied");
+
+    TEST_PASS("test_load");
+    return 0;
+}
+
+/**
+ * Test 4: Power fails at random points while frames go out, also before a
+ * renewal lands; the counter restored is always above every counter sent,
+ * with one write per half reservation
+ */
+int test_fcnt_reservation(void)
+{
+    printf("\n[TEST 4] Frame counter reservation\n");
+
+    uint32_t rng = 12345;
+    uint32_t persisted;       /* In flash */
+    uint32_t reserved = 0;    /* In RAM */
+    uint32_t fcnt = 0;        /* Last counter sent */
+    uint32_t sent = 0;
+    uint32_t writes = 1;
+    int resets = 0;
+
+    /* Joined: written before the first uplink */
+    ASSERT_TRUE(nvm_cache_reserve(&reserved, 0, FCNT_STEP), "Reserved at the join");
+    persisted = reserved;
+
+    while (sent < 100000) {
+        fcnt++;
+        sent++;
+        /* The stack saves after the frame went out */
+        if (nvm_cache_reserve(&reserved, fcnt, FCNT_STEP)) {
+            writes++;
+            /* The write lands on the work queue a little later */
+            rng = rng * 1103515245 + 12345;
+            if ((rng >> 16) % 50 == 0) {
+                goto power_fail;
+            }
+            persisted = reserved;
+        }
+
+        rng = rng * 1103515245 + 12345;
+        if ((rng >> 16) % 997 != 0) {
+            continue;
+        }
+
+power_fail:
+        /* Reboot: the stack counts on from the persisted counter, flash
+         * gets the next reservation first */
+        resets++;
+        ASSERT_TRUE(persisted >= fcnt, "No counter reused after a reset");
+        fcnt = persisted;
+        reserved = persisted;
+        nvm_cache_reserve(&reserved, fcnt, FCNT_STEP);
+        persisted = reserved;
+        writes++;
+    }
+
+    printf("  %u frames, %d resets, %u writes\n", sent, resets, writes);
+    ASSERT_TRUE(resets > 50, "Resets exercised");
+    ASSERT_RANGE(writes, sent / FCNT_STEP, sent / (FCNT_STEP / 2) + 2 * resets + 1,
+                 "One write per half reservation");
+
+    reserved = UINT32_MAX - 10;
+    ASSERT_TRUE(nvm_cache_reserve(&reserved, UINT32_MAX - 5, FCNT_STEP), "Near the top");
+    ASSERT_EQUAL(reserved, UINT32_MAX, "Saturates");
+
+    TEST_PASS("test_fcnt_reservation");
+    return 0;
+}
+
+/**
+ * Test 5: CRC-32 matches the IEEE check value the LoRaMAC groups use
+ */
+int test_crc32(void)
+{
+    printf("\n[TEST 5] CRC-32\n");
+
+    ASSERT_EQUAL(nvm_cache_crc32("123456789", 9), 0xCBF43926, "Check value");
+    ASSERT_EQUAL(nvm_cache_crc32("", 0), 0, "Empty");
+
+    TEST_PASS("test_crc32");
+    return 0;
+}
+
+/* ==================== Test Runner ==================== */
+
+int main(void)
+{
+    int failed = 0;
+
+    failed += test_coalescing();
+    failed += test_urgent_and_delete();
+    failed += test_load();
+    failed += test_fcnt_reservation();
+    failed += test_crc32();
+
+    if (failed == 0) {
+        printf("\n✓ ALL TESTS PASSED\n");
+    } else {
+        printf("\n✗ %d TEST(S) FAILED\n", failed);
+    }
+    return failed;
+}
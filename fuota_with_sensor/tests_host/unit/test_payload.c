@@ -0,0 +1,281 @@
+/*
+ * Payload Schema Host Tests
+ *
+ * Round trips through the table-driven encoder over the full physical
+ * range of every field, saturation, unaligned fields, and the host frame
+ * decoder on raw and compressed batch frames
+ */
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "batch.h"
+#include "payload.h"
+#include "payload_decoder.h"
+#include "test_util.h"
+
+static uint8_t rec[PAYLOAD_RECORD_MAX];
+static int32_t in[PAYLOAD_MAX_FIELDS];
+static int32_t out[PAYLOAD_MAX_FIELDS];
+
+/* Encoder units of field f of the last unpacked record */
+static int32_t full_value(int f)
+{
+    return payload_expand(&payload_schema_full, f, (uint32_t)out[f]);
+}
+
+static void make_full(int32_t *v, int i)
+{
+    for (int f = 0; f < PAYLOAD_FULL_NUM_FIELDS; f++) {
+        v[f] = 0;
+    }
+    v[PAYLOAD_FULL_temp] = -1250 + 10 * i;
+    v[PAYLOAD_FULL_hum] = 45000 + i;
+    v[PAYLOAD_FULL_press] = 60000;
+    v[PAYLOAD_FULL_x_rms] = 120;
+    v[PAYLOAD_FULL_y_skew] = -40 * 16;
+    v[PAYLOAD_FULL_z_kurt] = 3 * 256;
+    v[PAYLOAD_FULL_band2] = 200;
+    v[PAYLOAD_FULL_peak_freq] = 1725;
+    v[PAYLOAD_FULL_peak_lvl] = 250;
+}
+
+/**
+ * Test 1: Record sizes and ids follow the schema
+ */
+int test_layout(void)
+{
+    printf("\n[TEST 1] Record layout\n");
+
+    ASSERT_EQUAL(PAYLOAD_FULL_SIZE, 35, "Full record size");
+    ASSERT_EQUAL(PAYLOAD_COMPACT_SIZE, 9, "Compact record size");
+    ASSERT_EQUAL(payload_schema_full.id, 0x12, "Full id");
+    ASSERT_EQUAL(payload_schema_compact.id, 0x22, "Compact id");
+    ASSERT_TRUE(payload_schema_find(0x12) == &payload_schema_full, "Find full");
+    ASSERT_TRUE(payload_schema_find(0x11) == NULL, "Old version");
+
+    /* Smallest exponents that fit each range */
+    ASSERT_EQUAL(payload_schema_full.fields[PAYLOAD_FULL_temp].exp, 1, "125 degC in 16 bits");
+    ASSERT_EQUAL(payload_schema_full.fields[PAYLOAD_FULL_hum].exp, 1, "100 %RH in 16 bits");
+    ASSERT_EQUAL(payload_schema_full.fields[PAYLOAD_FULL_press].exp, 1, "80 kPa in 16 bits");
+    ASSERT_EQUAL(payload_schema_full.fields[PAYLOAD_FULL_x_crest].exp, 4, "Q8 in 8 bits");
+    ASSERT_EQUAL(payload_schema_full.fields[PAYLOAD_FULL_x_rms].exp, 0, "Exact fit");
+
+    TEST_PASS("test_layout");
+    return 0;
+}
+
+/**
+ * Test 2: A full record round trips
+ */
+int test_roundtrip(void)
+{
+    printf("\n[TEST 2] Full record round trip\n");
+
+    make_full(in, 0);
+    ASSERT_EQUAL(payload_encode(&payload_schema_full, in, rec), PAYLOAD_FULL_SIZE, "Size");
+    ASSERT_EQUAL(rec[0], 0x12, "Id byte");
+    ASSERT_EQUAL(rec[1], 0x4B, "(-1.25 + 40) / 0.002, MSB first");
+    ASSERT_EQUAL(rec[2], 0xAF, "LSB");
+    ASSERT_EQUAL(payload_unpack(&payload_schema_full, rec, PAYLOAD_FULL_SIZE, out),
+                 PAYLOAD_FULL_NUM_FIELDS, "Unpack");
+
+    ASSERT_EQUAL(full_value(PAYLOAD_FULL_temp), -1250, "Negative temperature");
+    ASSERT_EQUAL(full_value(PAYLOAD_FULL_hum), 45000, "Humidity");
+    ASSERT_EQUAL(full_value(PAYLOAD_FULL_press), 60000, "Pressure");
+    ASSERT_EQUAL(full_value(PAYLOAD_FULL_y_skew), -40 * 16, "Negative skew");
+    ASSERT_EQUAL(full_value(PAYLOAD_FULL_x_skew), 0, "Zero skew");
+    ASSERT_EQUAL(full_value(PAYLOAD_FULL_z_kurt), 3 * 256, "Kurtosis");
+    ASSERT_EQUAL(full_value(PAYLOAD_FULL_peak_freq), 1725, "Peak frequency");
+    ASSERT_EQUAL(full_value(PAYLOAD_FULL_peak_lvl), 250, "Last field");
+
+    ASSERT_EQUAL(payload_unpack(&payload_schema_full, rec, PAYLOAD_FULL_SIZE - 1, out),
+                 -EINVAL, "Wrong length");
+    ASSERT_EQUAL(payload_unpack(&payload_schema_compact, rec, PAYLOAD_COMPACT_SIZE, out),
+                 -EINVAL, "Wrong id");
+
+    TEST_PASS("test_roundtrip");
+    return 0;
+}
+
+/**
+ * Test 3: Every field round trips over its whole range, including the
+ * 101 kPa and 100 %RH that used to overflow 16 bits
+ */
+int test_full_range(void)
+{
+    printf("\n[TEST 3] Full range round trip\n");
+
+    int worst[PAYLOAD_FULL_NUM_FIELDS] = {0};
+    int bad = 0;
+
+    for (int f = 0; f < PAYLOAD_FULL_NUM_FIELDS; f++) {
+        const struct payload_field *fd = &payload_schema_full.fields[f];
+        /* Half a step, a whole one in the partial step below hi */
+        int step = 1 << fd->exp;
+
+        for (int64_t v = fd->lo; v <= fd->hi; v += 1 + (fd->hi - fd->lo) / 20000) {
+            make_full(in, 0);
+            in[f] = (int32_t)v;
+            payload_encode(&payload_schema_full, in, rec);
+            payload_unpack(&payload_schema_full, rec, PAYLOAD_FULL_SIZE, out);
+
+            int err = abs(full_value(f) - (int32_t)v);
+
+            worst[f] = (err > worst[f]) ? err : worst[f];
+            if (err >= step || (err > step / 2 && v <= fd->lo + (int64_t)fd->max * step)) {
+                printf("   field %d value %lld: error %d\n", f, (long long)v, err);
+                bad++;
+                break;
+            }
+        }
+    }
+    ASSERT_EQUAL(bad, 0, "Within half a step, one in the top partial step");
+
+    in[PAYLOAD_FULL_press] = 101325;
+    payload_encode(&payload_schema_full, in, rec);
+    payload_unpack(&payload_schema_full, rec, PAYLOAD_FULL_SIZE, out);
+    printf("   101.325 kPa -> %d, temp error <= %d, press <= %d, skew <= %d\n",
+           full_value(PAYLOAD_FULL_press), worst[PAYLOAD_FULL_temp],
+           worst[PAYLOAD_FULL_press], worst[PAYLOAD_FULL_x_skew]);
+    ASSERT_EQUAL(full_value(PAYLOAD_FULL_press), 101326, "Sea level pressure, rounded");
+
+    TEST_PASS("test_full_range");
+    return 0;
+}
+
+/**
+ * Test 4: Out of range values saturate instead of wrapping
+ */
+int test_saturation(void)
+{
+    printf("\n[TEST 4] Saturation\n");
+
+    make_full(in, 0);
+    in[PAYLOAD_FULL_temp] = 90000;
+    in[PAYLOAD_FULL_hum] = -5;
+    in[PAYLOAD_FULL_press] = INT32_MAX;
+    in[PAYLOAD_FULL_x_skew] = INT32_MIN;
+    in[PAYLOAD_FULL_x_crest] = 300 * 256;
+
+    payload_encode(&payload_schema_full, in, rec);
+    payload_unpack(&payload_schema_full, rec, PAYLOAD_FULL_SIZE, out);
+
+    ASSERT_EQUAL(full_value(PAYLOAD_FULL_temp), 85000, "Above range");
+    ASSERT_EQUAL(full_value(PAYLOAD_FULL_hum), 0, "Below range");
+    ASSERT_EQUAL(full_value(PAYLOAD_FULL_press), 110000, "INT32_MAX");
+    ASSERT_EQUAL(full_value(PAYLOAD_FULL_x_skew), -2048, "INT32_MIN");
+    ASSERT_EQUAL(full_value(PAYLOAD_FULL_x_crest), 4080, "Rounding up stays in the field");
+
+    TEST_PASS("test_saturation");
+    return 0;
+}
+
+/**
+ * Test 5: Fields that do not start on a byte boundary
+ */
+int test_unaligned(void)
+{
+    printf("\n[TEST 5] Unaligned fields\n");
+
+    static const struct payload_field fields[] = {
+        {3, 0, -4, 3, 0x7},
+        {13, 0, 0, 8191, 0x1FFF},
+        {1, 0, 0, 1, 0x1},
+        {31, 0, -(1 << 30), (1 << 30) - 1, 0x7FFFFFFF},
+        {7, 2, 0, 508, 0x7F},
+    };
+    static const struct payload_schema schema = {0x7F, 5, 1 + 7, fields};
+    const int32_t v[5] = {-3, 5000, 1, -123456789, 401};
+    const int32_t expect[5] = {-3, 5000, 1, -123456789, 400};
+    uint8_t buf[8];
+
+    ASSERT_EQUAL(payload_encode(&schema, v, buf), 8, "55 bits in 7 bytes");
+    ASSERT_EQUAL(payload_unpack(&schema, buf, sizeof(buf), out), 5, "Unpack");
+    for (int i = 0; i < 5; i++) {
+        ASSERT_EQUAL(payload_expand(&schema, i, (uint32_t)out[i]), expect[i], "Value");
+    }
+    ASSERT_EQUAL(out[0], 1, "Offset binary");
+    ASSERT_EQUAL(buf[7] & 0x01, 0, "Zero padding");
+
+    TEST_PASS("test_unaligned");
+    return 0;
+}
+
+/**
+ * Test 6: The host decoder reads raw and compressed batch frames
+ */
+int test_decode_frames(void)
+{
+    printf("\n[TEST 6] Frame decoder\n");
+
+    struct batch b;
+    struct payload_record recs[16];
+    uint8_t frame[BATCH_FRAME_MAX];
+    int len;
+
+    /* Raw: no codec */
+    batch_init(&b, 242, 0);
+    for (int i = 0; i < 3; i++) {
+        make_full(in, i);
+        payload_encode(&payload_schema_full, in, rec);
+        batch_add(&b, rec, PAYLOAD_FULL_SIZE, 0);
+    }
+    len = batch_pop(&b, 0, true, frame);
+    ASSERT_EQUAL(frame[0], PAYLOAD_FULL_SIZE, "Raw frame");
+    ASSERT_EQUAL(payload_decode_frame(frame, len, recs, 16), 3, "Three records");
+    ASSERT_TRUE(recs[2].schema == &payload_schema_full, "Schema");
+    ASSERT_TRUE(fabs(payload_value(&recs[2], PAYLOAD_FULL_temp) + 1.23) < 1e-9, "degC");
+    ASSERT_TRUE(strcmp(payload_field_name(&payload_schema_full, PAYLOAD_FULL_y_skew),
+                       "y_skew") == 0, "Field name");
+    ASSERT_EQUAL(payload_decode_frame(frame, len, recs, 2), -ENOSPC, "Output too small");
+    ASSERT_EQUAL(payload_decode_frame(frame, len - 1, recs, 16), -EINVAL, "Truncated");
+
+    /* Compressed: compact records at DR1 */
+    batch_init(&b, 53, 900000);
+    batch_set_codec(&b, payload_batch_fields);
+    for (int i = 0; i < 4; i++) {
+        const int32_t v[PAYLOAD_COMPACT_NUM_FIELDS] = {21500, 45000, 60000, 10 + i};
+
+        payload_encode(&payload_schema_compact, v, rec);
+        batch_add(&b, rec, PAYLOAD_COMPACT_SIZE, 0);
+    }
+    len = batch_pop(&b, 0, true, frame);
+    ASSERT_EQUAL(frame[0], BATCH_HDR_CODEC | PAYLOAD_COMPACT_SIZE, "Compressed frame");
+
+    int n = payload_decode_frame(frame, len, recs, 16);
+
+    printf("   %d compact records in %d bytes\n", n, len);
+    ASSERT_EQUAL(n, 4, "All records");
+    ASSERT_TRUE(recs[0].schema == &payload_schema_compact, "Compact schema");
+    ASSERT_EQUAL(recs[n - 1].values[PAYLOAD_COMPACT_vib_rms], 10 + n - 1, "Last vib_rms");
+    ASSERT_TRUE(strcmp(payload_field_unit(&payload_schema_compact, PAYLOAD_COMPACT_hum),
+                       "%RH") == 0, "Field unit");
+
+    TEST_PASS("test_decode_frames");
+    return 0;
+}
+
+/* ==================== Test Runner ==================== */
+
+int main(void)
+{
+    int failed = 0;
+
+    failed += test_layout();
+    failed += test_roundtrip();
+    failed += test_full_range();
+    failed += test_saturation();
+    failed += test_unaligned();
+    failed += test_decode_frames();
+
+    if (failed == 0) {
+        printf("\n✓ ALL TESTS PASSED\n");
+    } else {
+        printf("\n✗ %d TEST(S) FAILED\n", failed);
+    }
+    return failed;
+}
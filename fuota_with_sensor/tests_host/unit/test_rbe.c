@@ -0,0 +1,134 @@
+/*
+ * Report-by-Exception Host Tests
+ *
+ * Checks deadband, drift and heartbeat decisions and the sent/suppressed
+ * counters
+ */
+
+#include <stdio.h>
+
+#include "rbe.h"
+#include "test_util.h"
+
+static const struct rbe_config cfg = {
+    .deadband = {
+        [RBE_CH_TEMP] = 200,
+        [RBE_CH_HUM] = 2000,
+        [RBE_CH_PRESS] = 100,
+        [RBE_CH_VIB_RMS] = 10,
+        [RBE_CH_VIB_LEVEL] = RBE_DEADBAND_OFF,
+    },
+    .heartbeat_ms = 600000,
+};
+
+static void set_values(int32_t *v, int32_t temp, int32_t rms, int32_t level)
+{
+    v[RBE_CH_TEMP] = temp;
+    v[RBE_CH_HUM] = 45000;
+    v[RBE_CH_PRESS] = 101325;
+    v[RBE_CH_VIB_RMS] = rms;
+    v[RBE_CH_VIB_LEVEL] = level;
+}
+
+/**
+ * Test 1: First frame always goes out, small changes are suppressed
+ */
+int test_deadband(void)
+{
+    printf("\n[TEST 1] Deadband\n");
+
+    struct rbe_filter f;
+    int32_t v[RBE_NUM_CH];
+
+    rbe_init(&f, &cfg);
+    set_values(v, 21000, 50, 100);
+    ASSERT_TRUE(rbe_check(&f, v, 0, 34), "First frame sent");
+
+    set_values(v, 21150, 55, 200);
+    ASSERT_TRUE(!rbe_check(&f, v, 60000, 34), "Inside deadbands");
+
+    set_values(v, 21150, 61, 200);
+    ASSERT_TRUE(rbe_check(&f, v, 120000, 34), "Vibration left its deadband");
+
+    ASSERT_EQUAL(f.stats.sent, 2, "Sent");
+    ASSERT_EQUAL(f.stats.sent_change, 2, "Sent on change");
+    ASSERT_EQUAL(f.stats.suppressed, 1, "Suppressed");
+    ASSERT_EQUAL(f.stats.suppressed_bytes, 34, "Suppressed bytes");
+
+    TEST_PASS("test_deadband");
+    return 0;
+}
+
+/**
+ * Test 2: Slow drift accumulates against the last sent value
+ */
+int test_drift(void)
+{
+    printf("\n[TEST 2] Drift\n");
+
+    struct rbe_filter f;
+    int32_t v[RBE_NUM_CH];
+    int sent_at = -1;
+
+    rbe_init(&f, &cfg);
+    set_values(v, 20000, 50, 0);
+    rbe_check(&f, v, 0, 34);
+
+    /* +50 m degC per minute never exceeds the band step to step */
+    for (int i = 1; i <= 10 && sent_at < 0; i++) {
+        set_values(v, 20000 + 50 * i, 50, 0);
+        if (rbe_check(&f, v, i * 60000, 34)) {
+            sent_at = i;
+        }
+    }
+    ASSERT_EQUAL(sent_at, 5, "Sent once the drift exceeds 200");
+
+    TEST_PASS("test_drift");
+    return 0;
+}
+
+/**
+ * Test 3: Heartbeat after a long quiet period, including timer wrap
+ */
+int test_heartbeat(void)
+{
+    printf("\n[TEST 3] Heartbeat\n");
+
+    struct rbe_filter f;
+    int32_t v[RBE_NUM_CH];
+    uint32_t t0 = UINT32_MAX - 300000;
+    int sent = 0;
+
+    rbe_init(&f, &cfg);
+    set_values(v, 21000, 50, 0);
+    rbe_check(&f, v, t0, 34);
+
+    for (int i = 1; i <= 20; i++) {
+        sent += rbe_check(&f, v, t0 + (uint32_t)i * 60000, 34) ? 1 : 0;
+    }
+
+    ASSERT_EQUAL(sent, 2, "One heartbeat every 10 minutes");
+    ASSERT_EQUAL(f.stats.sent_heartbeat, 2, "Heartbeat counter");
+    ASSERT_EQUAL(f.stats.suppressed, 18, "Suppressed");
+
+    TEST_PASS("test_heartbeat");
+    return 0;
+}
+
+/* ==================== Test Runner ==================== */
+
+int main(void)
+{
+    int failed = 0;
+
+    failed += test_deadband();
+    failed += test_drift();
+    failed += test_heartbeat();
+
+    if (failed == 0) {
+        printf("\n✓ ALL TESTS PASSED\n");
+    } else {
+        printf("\n✗ %d TEST(S) FAILED\n", failed);
+    }
+    return failed;
+}
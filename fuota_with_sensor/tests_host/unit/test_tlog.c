@@ -0,0 +1,381 @@
+/*
+ * Telemetry Log Host Tests
+ *
+ * Runs the store-and-forward log on a RAM model of the STM32WL flash
+ * (2 KB pages, 8-byte program unit, programming only clears bits) with
+ * power loss injected mid-write
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "test_util.h"
+#include "tlog.h"
+
+#define SECTOR_SIZE  2048
+#define SECTOR_COUNT 13
+#define WRITE_BLOCK  8
+
+static uint8_t mem[SECTOR_SIZE * SECTOR_COUNT];
+static uint32_t sector_erases[SECTOR_COUNT];
+static long power_budget = -1;   /* Bytes programmed before power fails, -1: never */
+
+static int sim_read(void *ctx, uint32_t off, void *buf, size_t len)
+{
+    (void)ctx;
+    memcpy(buf, &mem[off], len);
+    return 0;
+}
+
+static int sim_write(void *ctx, uint32_t off, const void *buf, size_t len)
+{
+    const uint8_t *p = buf;
+
+    (void)ctx;
+    if (off % WRITE_BLOCK != 0 || len % WRITE_BLOCK != 0) {
+        return -EINVAL;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (power_budget == 0) {
+            return -EIO;
+        }
+        if (power_budget > 0) {
+            power_budget--;
+        }
+        mem[off + i] &= p[i];
+    }
+    return 0;
+}
+
+static int sim_erase(void *ctx, uint32_t off, size_t len)
+{
+    (void)ctx;
+    if (power_budget == 0) {
+        return -EIO;
+    }
+    memset(&mem[off], 0xFF, len);
+    sector_erases[off / SECTOR_SIZE]++;
+    return 0;
+}
+
+static const struct tlog_flash sim = {
+    .read = sim_read,
+    .write = sim_write,
+    .erase = sim_erase,
+    .sector_size = SECTOR_SIZE,
+    .sector_count = SECTOR_COUNT,
+    .write_block = WRITE_BLOCK,
+};
+
+static void sim_reset(void)
+{
+    memset(mem, 0xFF, sizeof(mem));
+    memset(sector_erases, 0, sizeof(sector_erases));
+    power_budget = -1;
+}
+
+static void make_record(uint8_t *rec, uint8_t len, uint32_t n)
+{
+    for (uint8_t i = 0; i < len; i++) {
+        rec[i] = (uint8_t)(n * 7 + i);
+    }
+    memcpy(rec, &n, sizeof(n));
+}
+
+static uint32_t record_number(const uint8_t *rec)
+{
+    uint32_t n;
+
+    memcpy(&n, rec, sizeof(n));
+    return n;
+}
+
+/**
+ * Test 1: Records read back in order, the cursor survives a remount and
+ * uncommitted records are read again
+ */
+int test_append_commit_remount(void)
+{
+    printf("\n[TEST 1] Append, commit, remount\n");
+
+    struct tlog log;
+    struct tlog_pos next;
+    uint8_t rec[TLOG_RECORD_MAX];
+
+    sim_reset();
+    ASSERT_EQUAL(tlog_mount(&log, &sim), 0, "Format empty partition");
+    ASSERT_EQUAL(tlog_read(&log, rec, &next), -ENOENT, "Empty log");
+
+    for (uint32_t n = 0; n < 10; n++) {
+        make_record(rec, 9, n);
+        ASSERT_EQUAL(tlog_append(&log, rec, 9), 0, "Append");
+    }
+    for (uint32_t n = 0; n < 4; n++) {
+        ASSERT_EQUAL(tlog_read(&log, rec, &next), 9, "Read");
+        ASSERT_EQUAL(record_number(rec), n, "In order");
+    }
+    ASSERT_EQUAL(tlog_commit(&log, &next), 0, "Commit 4");
+    ASSERT_EQUAL(tlog_read(&log, rec, &next), 9, "Read a 5th, not committed");
+
+    ASSERT_EQUAL(tlog_mount(&log, &sim), 0, "Remount");
+    ASSERT_EQUAL(log.stats.torn, 0, "Nothing torn");
+    for (uint32_t n = 4; n < 10; n++) {
+        ASSERT_EQUAL(tlog_read(&log, rec, &next), 9, "Read after remount");
+        ASSERT_EQUAL(record_number(rec), n, "Resumes at the cursor");
+    }
+    ASSERT_EQUAL(tlog_read(&log, rec, &next), -ENOENT, "All read");
+    ASSERT_TRUE(!tlog_unread(&log), "Nothing unread");
+    ASSERT_EQUAL(tlog_commit(&log, &next), 0, "Commit all");
+    ASSERT_TRUE(!tlog_unread(&log), "Cursor entry is not unread data");
+    ASSERT_RANGE(tlog_backlog(&log), 0, 2 * 16, "Only the two cursor entries left");
+
+    ASSERT_EQUAL(tlog_mount(&log, &sim), 0, "Remount");
+    ASSERT_EQUAL(tlog_read(&log, rec, &next), -ENOENT, "Nothing left after remount");
+
+    make_record(rec, 0, 0);
+    ASSERT_EQUAL(tlog_append(&log, rec, 0), -EMSGSIZE, "Empty record");
+    ASSERT_EQUAL(tlog_append(&log, rec, TLOG_RECORD_MAX + 1), -EMSGSIZE, "Oversized record");
+
+    TEST_PASS("test_append_commit_remount");
+    return 0;
+}
+
+/**
+ * Test 2: A failed send rewinds to the cursor
+ */
+int test_rewind(void)
+{
+    printf("\n[TEST 2] Rewind after a failed send\n");
+
+    struct tlog log;
+    struct tlog_pos next;
+    uint8_t rec[TLOG_RECORD_MAX];
+
+    sim_reset();
+    tlog_mount(&log, &sim);
+    for (uint32_t n = 0; n < 6; n++) {
+        make_record(rec, 35, n);
+        tlog_append(&log, rec, 35);
+    }
+
+    tlog_read(&log, rec, &next);
+    tlog_read(&log, rec, &next);
+    tlog_commit(&log, &next);
+    tlog_read(&log, rec, &next);
+    tlog_read(&log, rec, &next);
+    tlog_rewind(&log);
+
+    ASSERT_EQUAL(tlog_read(&log, rec, &next), 35, "Read after rewind");
+    ASSERT_EQUAL(record_number(rec), 2, "Back at the cursor");
+    ASSERT_TRUE(tlog_unread(&log), "More unread");
+
+    TEST_PASS("test_rewind");
+    return 0;
+}
+
+/**
+ * Test 3: Filling the log many times over wraps, drops the oldest unsent
+ * sector, and spreads erases evenly over the sectors
+ */
+int test_wrap_and_wear(void)
+{
+    printf("\n[TEST 3] Wrap-around and wear\n");
+
+    struct tlog log;
+    struct tlog_pos next;
+    uint8_t rec[TLOG_RECORD_MAX];
+    uint32_t n = 0, expect, min_erase = UINT32_MAX, max_erase = 0;
+    int len;
+
+    sim_reset();
+    tlog_mount(&log, &sim);
+
+    /* Link up: everything is sent, nothing may be lost */
+    for (; n < 20000; n++) {
+        make_record(rec, 9, n);
+        ASSERT_EQUAL(tlog_append(&log, rec, 9), 0, "Append");
+        ASSERT_EQUAL(tlog_read(&log, rec, &next), 9, "Read");
+        ASSERT_EQUAL(record_number(rec), n, "In order");
+        if (n % 8 == 7) {
+            ASSERT_EQUAL(tlog_commit(&log, &next), 0, "Commit");
+        }
+    }
+    ASSERT_EQUAL(log.stats.lost_sectors, 0, "Nothing lost while sending");
+
+    /* Link down far longer than the log holds */
+    for (uint32_t i = 0; i < 5000; i++, n++) {
+        make_record(rec, 9, n);
+        ASSERT_EQUAL(tlog_append(&log, rec, 9), 0, "Append while offline");
+    }
+    ASSERT_TRUE(log.stats.lost_sectors > 0, "Oldest sectors dropped");
+    ASSERT_TRUE(tlog_backlog(&log) > (SECTOR_COUNT - 2) * SECTOR_SIZE, "Backlog near capacity");
+
+    /* Remount and drain: the newest records survive in order */
+    ASSERT_EQUAL(tlog_mount(&log, &sim), 0, "Remount");
+    len = tlog_read(&log, rec, &next);
+    ASSERT_EQUAL(len, 9, "Read oldest kept");
+    expect = record_number(rec);
+    ASSERT_TRUE(n - expect > 1500, "Most of the log kept");
+    while (len > 0) {
+        ASSERT_EQUAL(record_number(rec), expect, "Contiguous");
+        expect++;
+        len = tlog_read(&log, rec, &next);
+    }
+    ASSERT_EQUAL(expect, n, "Drained up to the newest");
+
+    for (int s = 0; s < SECTOR_COUNT; s++) {
+        min_erase = sector_erases[s] < min_erase ? sector_erases[s] : min_erase;
+        max_erase = sector_erases[s] > max_erase ? sector_erases[s] : max_erase;
+    }
+    printf("  Erases per sector: %u..%u\n", min_erase, max_erase);
+    ASSERT_TRUE(max_erase - min_erase <= 1, "Even wear");
+
+    TEST_PASS("test_wrap_and_wear");
+    return 0;
+}
+
+/**
+ * Test 4: Power loss at every byte of an append, a commit and a sector
+ * change leaves a log that mounts with every completed record and cursor
+ */
+int test_power_fail(void)
+{
+    printf("\n[TEST 4] Power loss during writes\n");
+
+    static uint8_t image[sizeof(mem)];
+    struct tlog log;
+    struct tlog_pos next, committed;
+    uint8_t rec[TLOG_RECORD_MAX];
+    uint32_t first, n;
+    int torn = 0;
+
+    /* Base image: the head one record short of a full sector */
+    sim_reset();
+    tlog_mount(&log, &sim);
+    for (n = 0; log.head.seq == 0 && log.head.off + 2 * 48 <= SECTOR_SIZE; n++) {
+        make_record(rec, 40, n);
+        tlog_append(&log, rec, 40);
+    }
+    for (int i = 0; i < 5; i++) {
+        tlog_read(&log, rec, &next);
+    }
+    tlog_commit(&log, &next);
+    committed = next;
+    memcpy(image, mem, sizeof(mem));
+
+    for (long budget = 0; budget <= 2 * 48 + 16 + 16; budget++) {
+        memcpy(mem, image, sizeof(mem));
+        ASSERT_EQUAL(tlog_mount(&log, &sim), 0, "Mount base image");
+
+        /* Record, commit, then a record that opens a new sector */
+        power_budget = budget;
+        make_record(rec, 40, n);
+        if (tlog_append(&log, rec, 40) == 0) {
+            tlog_read(&log, rec, &next);
+            tlog_read(&log, rec, &next);
+            if (tlog_commit(&log, &next) == 0) {
+                make_record(rec, 40, n + 1);
+                tlog_append(&log, rec, 40);
+            }
+        }
+        power_budget = -1;
+
+        ASSERT_EQUAL(tlog_mount(&log, &sim), 0, "Mount after power loss");
+        torn += (int)log.stats.torn;
+        ASSERT_TRUE(log.cursor.seq > committed.seq || log.cursor.off >= committed.off,
+                    "Cursor never goes back");
+
+        /* The log still takes records and keeps those it acknowledged */
+        make_record(rec, 40, 1000);
+        ASSERT_EQUAL(tlog_append(&log, rec, 40), 0, "Append after recovery");
+        first = UINT32_MAX;
+        uint32_t last = 0;
+        int len;
+        while ((len = tlog_read(&log, rec, &next)) > 0) {
+            ASSERT_EQUAL(len, 40, "Intact record");
+            if (first == UINT32_MAX) {
+                first = record_number(rec);
+            }
+            last = record_number(rec);
+        }
+        ASSERT_TRUE(first == 5 || first == 7, "Starts at a committed cursor");
+        ASSERT_EQUAL(last, 1000, "New record readable");
+    }
+    ASSERT_TRUE(torn > 0, "Torn entries were seen");
+
+    TEST_PASS("test_power_fail");
+    return 0;
+}
+
+/**
+ * Test 5: SRS 04, a day of compact records at one per minute fits the
+ * 26 KB partition without loss
+ */
+int test_24h_capacity(void)
+{
+    printf("\n[TEST 5] 24 h of compact records\n");
+
+    /* The telemetry partition: 3 pages, one record per 6 min in an outage */
+    struct tlog_flash part = sim;
+    struct tlog log;
+    struct tlog_pos next;
+    uint8_t rec[TLOG_RECORD_MAX];
+    uint32_t n = 0;
+
+    part.sector_count = 3;
+    sim_reset();
+    tlog_mount(&log, &part);
+    for (uint32_t i = 0; i < 24 * 10; i++) {
+        make_record(rec, 9, i);
+        ASSERT_EQUAL(tlog_append(&log, rec, 9), 0, "Append");
+    }
+    ASSERT_EQUAL(log.stats.lost_sectors, 0, "Nothing lost");
+    printf("  Backlog: %u bytes\n", tlog_backlog(&log));
+
+    while (tlog_read(&log, rec, &next) > 0) {
+        ASSERT_EQUAL(record_number(rec), n, "In order");
+        n++;
+    }
+    ASSERT_EQUAL(n, 24 * 10, "All records kept");
+
+    TEST_PASS("test_24h_capacity");
+    return 0;
+}
+
+int test_geometry(void)
+{
+    printf("\n[TEST 6] Sector count bounds\n");
+
+    struct tlog_flash part = sim;
+    struct tlog log;
+
+    part.sector_count = 1;
+    ASSERT_EQUAL(tlog_mount(&log, &part), -EINVAL, "One sector refused");
+    part.sector_count = TLOG_MAX_SECTORS + 1;
+    ASSERT_EQUAL(tlog_mount(&log, &part), -EINVAL, "Above TLOG_MAX_SECTORS refused");
+
+    TEST_PASS("test_geometry");
+    return 0;
+}
+
+/* ==================== Test Runner ==================== */
+
+int main(void)
+{
+    int failed = 0;
+
+    failed += test_append_commit_remount();
+    failed += test_rewind();
+    failed += test_wrap_and_wear();
+    failed += test_power_fail();
+    failed += test_24h_capacity();
+    failed += test_geometry();
+
+    if (failed == 0) {
+        printf("\n✓ ALL TESTS PASSED\n");
+    } else {
+        printf("\n✗ %d TEST(S) FAILED\n", failed);
+    }
+    return failed;
+}
@@ -0,0 +1,219 @@
+/*
+ * Time-Series Codec Host Tests
+ *
+ * Round trips through the delta-of-delta varint codec, checks its cost on
+ * slow channels, and the compressed frame path of the batch packer
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "batch.h"
+#include "test_util.h"
+#include "tscodec.h"
+
+#define MAX_RECORDS 64
+
+static uint8_t buf[MAX_RECORDS * TSCODEC_RECORD_MAX(5) + TSCODEC_HDR_SIZE];
+static int32_t in[MAX_RECORDS * TSCODEC_MAX_CHANNELS];
+static int32_t out[MAX_RECORDS * TSCODEC_MAX_CHANNELS];
+
+static int encode_all(int records, uint8_t channels, size_t cap)
+{
+    struct tscodec_enc enc;
+
+    tscodec_enc_init(&enc, buf, cap, channels);
+    for (int r = 0; r < records; r++) {
+        if (tscodec_enc_add(&enc, &in[r * channels]) != 0) {
+            break;
+        }
+    }
+    return (int)tscodec_enc_len(&enc);
+}
+
+/**
+ * Test 1: Random values including the int32 extremes round trip exactly
+ */
+int test_roundtrip_extremes(void)
+{
+    printf("\n[TEST 1] Round trip with extreme values\n");
+
+    const uint8_t ch = 5;
+    uint8_t ch_out = 0;
+
+    srand(12);
+    for (int r = 0; r < MAX_RECORDS; r++) {
+        for (int c = 0; c < ch; c++) {
+            in[r * ch + c] = (int32_t)(((uint32_t)rand() << 16) ^ (uint32_t)rand());
+        }
+    }
+    in[3 * ch] = INT32_MIN;
+    in[4 * ch] = INT32_MAX;
+    in[5 * ch] = INT32_MIN;
+
+    int len = encode_all(MAX_RECORDS, ch, sizeof(buf));
+    int n = tscodec_decode(buf, len, out, sizeof(out) / sizeof(out[0]), &ch_out);
+
+    ASSERT_EQUAL(n, MAX_RECORDS, "Record count");
+    ASSERT_EQUAL(ch_out, ch, "Channel count");
+    ASSERT_TRUE(memcmp(in, out, MAX_RECORDS * ch * sizeof(int32_t)) == 0, "Values match");
+
+    TEST_PASS("test_roundtrip_extremes");
+    return 0;
+}
+
+/**
+ * Test 2: Constant and linearly ramping channels cost one byte per value
+ */
+int test_slow_channels(void)
+{
+    printf("\n[TEST 2] Constant and ramping channels\n");
+
+    const uint8_t ch = 3;
+
+    for (int r = 0; r < 20; r++) {
+        in[r * ch + 0] = 21500;              /* Temperature, constant */
+        in[r * ch + 1] = 45000 + 250 * r;    /* Humidity, ramp */
+        in[r * ch + 2] = 101325 - 7 * r;     /* Pressure, ramp */
+    }
+
+    int len = encode_all(20, ch, sizeof(buf));
+
+    /* Base values (3 bytes each), first deltas (1-2 bytes), then 1 byte each */
+    printf("   20 records x 3 channels: %d bytes (raw 16-bit: %d)\n", len, 20 * 3 * 2);
+    ASSERT_TRUE(len <= TSCODEC_HDR_SIZE + 9 + 4 + 18 * 3, "One byte per later value");
+
+    TEST_PASS("test_slow_channels");
+    return 0;
+}
+
+/**
+ * Test 3: A record that does not fit leaves the stream unchanged
+ */
+int test_no_space(void)
+{
+    printf("\n[TEST 3] Out of space\n");
+
+    struct tscodec_enc enc;
+    const int32_t rec[2] = {1000000, -1000000};
+    uint8_t ch_out;
+
+    ASSERT_EQUAL(tscodec_enc_init(&enc, buf, 1, 2), -ENOSPC, "Header does not fit");
+    ASSERT_EQUAL(tscodec_enc_init(&enc, buf, 0, 0), -EINVAL, "No channels");
+
+    tscodec_enc_init(&enc, buf, 9, 2);
+    ASSERT_EQUAL(tscodec_enc_add(&enc, rec), 0, "First record fits");
+    ASSERT_EQUAL(tscodec_enc_len(&enc), TSCODEC_HDR_SIZE + 2 * 3, "3-byte varints");
+    ASSERT_EQUAL(tscodec_enc_add(&enc, rec), -ENOSPC, "Second record does not");
+    ASSERT_EQUAL(tscodec_decode(buf, tscodec_enc_len(&enc), out, 2, &ch_out), 1,
+                 "Stream still valid");
+    ASSERT_EQUAL(out[1], -1000000, "Value");
+
+    TEST_PASS("test_no_space");
+    return 0;
+}
+
+/**
+ * Test 4: Malformed streams are rejected
+ */
+int test_malformed(void)
+{
+    printf("\n[TEST 4] Malformed streams\n");
+
+    const uint8_t truncated[] = {1, 2, 0x80};
+    const uint8_t trailing[] = {1, 1, 0x02, 0x00};
+    const uint8_t too_many[] = {TSCODEC_MAX_CHANNELS + 1, 0};
+
+    ASSERT_EQUAL(tscodec_decode(truncated, sizeof(truncated), out, 16, NULL), -EINVAL,
+                 "Truncated varint");
+    ASSERT_EQUAL(tscodec_decode(trailing, sizeof(trailing), out, 16, NULL), -EINVAL,
+                 "Trailing bytes");
+    ASSERT_EQUAL(tscodec_decode(too_many, sizeof(too_many), out, 16, NULL), -EINVAL,
+                 "Channel count");
+    ASSERT_EQUAL(tscodec_decode(trailing, 3, out, 0, NULL), -ENOSPC, "Output too small");
+
+    TEST_PASS("test_malformed");
+    return 0;
+}
+
+/* Records for the batch test: 3 big-endian 16-bit fields */
+static int fields_be16x3(const uint8_t *rec, uint8_t len, int32_t *fields)
+{
+    if (len != 6) {
+        return -EINVAL;
+    }
+    for (int i = 0; i < 3; i++) {
+        fields[i] = (rec[2 * i] << 8) | rec[2 * i + 1];
+    }
+    return 3;
+}
+
+/**
+ * Test 5: The batch packer fits more records per DR1 frame with the codec
+ */
+int test_batch_codec(void)
+{
+    printf("\n[TEST 5] Compressed batch frames\n");
+
+    struct batch b;
+    uint8_t frame[BATCH_FRAME_MAX];
+    uint8_t ch_out;
+    int len;
+
+    batch_init(&b, 53, 900000);
+    batch_set_codec(&b, fields_be16x3);
+
+    for (int r = 0; r < BATCH_MAX_RECORDS; r++) {
+        const uint16_t v[3] = {21500, (uint16_t)(45000 + 10 * r), 10132};
+        uint8_t rec[6];
+
+        for (int i = 0; i < 3; i++) {
+            rec[2 * i] = (uint8_t)(v[i] >> 8);
+            rec[2 * i + 1] = (uint8_t)v[i];
+        }
+        batch_add(&b, rec, sizeof(rec), 0);
+    }
+
+    len = batch_pop(&b, 0, false, frame);
+    ASSERT_TRUE(len > 0, "Frame due");
+    ASSERT_EQUAL(frame[0], BATCH_HDR_CODEC | 6, "Compressed header");
+
+    int n = tscodec_decode(frame + 1, len - 1, out, sizeof(out) / sizeof(out[0]), &ch_out);
+
+    printf("   %d records in %d bytes (raw fits %d)\n", n, len, (53 - 1) / 6);
+    ASSERT_TRUE(n > (53 - 1) / 6, "More records than a raw frame");
+    ASSERT_EQUAL(out[(n - 1) * 3 + 1], 45000 + 10 * (n - 1), "Last humidity");
+    ASSERT_EQUAL(b.count, BATCH_MAX_RECORDS - n, "Rest still queued");
+
+    /* Two records are cheaper raw than with base values */
+    len = batch_pop(&b, 0, true, frame);
+    ASSERT_EQUAL(frame[0], 6, "Raw header for the rest");
+    ASSERT_EQUAL(len, BATCH_HDR_SIZE + (BATCH_MAX_RECORDS - n) * 6, "Rest in the forced frame");
+    ASSERT_EQUAL(b.stats.compressed, 1, "Compressed frame counted");
+    ASSERT_EQUAL(b.count, 0, "Queue drained");
+
+    TEST_PASS("test_batch_codec");
+    return 0;
+}
+
+/* ==================== Test Runner ==================== */
+
+int main(void)
+{
+    int failed = 0;
+
+    failed += test_roundtrip_extremes();
+    failed += test_slow_channels();
+    failed += test_no_space();
+    failed += test_malformed();
+    failed += test_batch_codec();
+
+    if (failed == 0) {
+        printf("\n✓ ALL TESTS PASSED\n");
+    } else {
+        printf("\n✗ %d TEST(S) FAILED\n", failed);
+    }
+    return failed;
+}
@@ -0,0 +1,226 @@
+/*
+ * Vibration Feature Extractor Host Tests
+ *
+ * Checks the fixed-point features against signals with known statistics
+ */
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "test_util.h"
+#include "vib_features.h"
+
+#define PI 3.14159265358979323846
+
+/* Feed one full window where all three axes carry the same signal plus an offset */
+static int run_window(struct vib_features_engine *eng, const int16_t *sig, int n, int16_t offset)
+{
+    int done = 0;
+
+    for (int i = 0; i < n; i++) {
+        done = vib_features_add(eng, sig[i], (int16_t)(sig[i] + offset), (int16_t)(-sig[i]));
+    }
+    return done;
+}
+
+/**
+ * Test 1: Window length validation
+ */
+int test_init_validation(void)
+{
+    printf("\n[TEST 1] Window length validation\n");
+
+    struct vib_features_engine eng;
+
+    ASSERT_EQUAL(vib_features_init(&eng, 0), -EINVAL, "Zero window rejected");
+    ASSERT_EQUAL(vib_features_init(&eng, VIB_WINDOW_MAX + 1), -EINVAL, "Oversized window rejected");
+    ASSERT_EQUAL(vib_features_init(&eng, VIB_WINDOW_MAX), 0, "Max window accepted");
+
+    TEST_PASS("test_init_validation");
+    return 0;
+}
+
+/**
+ * Test 2: Constant input has no AC content
+ */
+int test_constant_signal(void)
+{
+    printf("\n[TEST 2] Constant signal\n");
+
+    struct vib_features_engine eng;
+    int16_t sig[64];
+
+    for (int i = 0; i < 64; i++) {
+        sig[i] = 981;
+    }
+    vib_features_init(&eng, 64);
+    ASSERT_TRUE(run_window(&eng, sig, 64, 0), "Window should complete");
+
+    ASSERT_EQUAL(eng.last.samples, 64, "Sample count");
+    ASSERT_EQUAL(eng.last.axis[0].mean_mg, 981, "Mean");
+    ASSERT_EQUAL(eng.last.axis[0].rms_mg, 0, "RMS");
+    ASSERT_EQUAL(eng.last.axis[0].p2p_mg, 0, "Peak to peak");
+    ASSERT_EQUAL(eng.last.axis[0].kurt_q8, 0, "Kurtosis undefined -> 0");
+
+    TEST_PASS("test_constant_signal");
+    return 0;
+}
+
+/**
+ * Test 3: Sine wave on top of gravity, before and after re-centering
+ * RMS = A/sqrt(2), crest = sqrt(2), skewness = 0, kurtosis = 1.5
+ */
+int test_sine_wave(void)
+{
+    printf("\n[TEST 3] Sine wave\n");
+
+    struct vib_features_engine eng;
+    int16_t sig[200];
+
+    for (int i = 0; i < 200; i++) {
+        sig[i] = (int16_t)lround(1000.0 + 1000.0 * sin(2.0 * PI * i / 20.0));
+    }
+    vib_features_init(&eng, 200);
+
+    for (int w = 0; w < 2; w++) {
+        ASSERT_TRUE(run_window(&eng, sig, 200, 50), "Window should complete");
+
+        const struct vib_axis_features *f = &eng.last.axis[0];
+
+        printf("   window %d: mean %d rms %u p2p %u crest %u skew %d kurt %u\n",
+               w, f->mean_mg, f->rms_mg, f->p2p_mg, f->crest_q8, f->skew_q8, f->kurt_q8);
+        ASSERT_RANGE(f->mean_mg, 999, 1001, "Mean");
+        ASSERT_RANGE(f->rms_mg, 705, 709, "RMS");
+        ASSERT_RANGE(f->p2p_mg, 1998, 2000, "Peak to peak");
+        ASSERT_RANGE(f->crest_q8, 359, 365, "Crest factor ~1.414");
+        ASSERT_RANGE(f->skew_q8, -3, 3, "Skewness ~0");
+        ASSERT_RANGE(f->kurt_q8, 380, 388, "Kurtosis ~1.5");
+
+        ASSERT_EQUAL(eng.last.axis[1].mean_mg, 1050, "Offset axis mean");
+        ASSERT_EQUAL(eng.last.axis[1].rms_mg, f->rms_mg, "Offset does not change RMS");
+        ASSERT_EQUAL(eng.last.axis[2].rms_mg, f->rms_mg, "Inverted axis RMS");
+    }
+    ASSERT_EQUAL(eng.windows, 2, "Two windows completed");
+
+    TEST_PASS("test_sine_wave");
+    return 0;
+}
+
+/**
+ * Test 4: Square wave, crest factor and kurtosis are exactly 1
+ */
+int test_square_wave(void)
+{
+    printf("\n[TEST 4] Square wave\n");
+
+    struct vib_features_engine eng;
+    int16_t sig[128];
+
+    for (int i = 0; i < 128; i++) {
+        sig[i] = (i & 1) ? 500 : -500;
+    }
+    vib_features_init(&eng, 128);
+    run_window(&eng, sig, 128, 0);
+
+    const struct vib_axis_features *f = &eng.last.axis[0];
+
+    ASSERT_EQUAL(f->rms_mg, 500, "RMS");
+    ASSERT_RANGE(f->crest_q8, 255, 257, "Crest factor 1.0");
+    ASSERT_RANGE(f->kurt_q8, 255, 257, "Kurtosis 1.0");
+    ASSERT_RANGE(f->skew_q8, -1, 1, "Skewness 0");
+
+    TEST_PASS("test_square_wave");
+    return 0;
+}
+
+/**
+ * Test 5: Sparse impacts (bearing fault signature) give high kurtosis and crest
+ */
+int test_impulsive_signal(void)
+{
+    printf("\n[TEST 5] Impulsive signal\n");
+
+    struct vib_features_engine eng;
+    int16_t sig[256];
+
+    for (int i = 0; i < 256; i++) {
+        sig[i] = (i % 64 == 0) ? 2000 : ((i & 1) ? 20 : -20);
+    }
+    vib_features_init(&eng, 256);
+    run_window(&eng, sig, 256, 0);
+
+    const struct vib_axis_features *f = &eng.last.axis[0];
+
+    printf("   crest %u skew %d kurt %u\n", f->crest_q8, f->skew_q8, f->kurt_q8);
+    ASSERT_TRUE(f->kurt_q8 > 20 * 256, "Kurtosis well above Gaussian");
+    ASSERT_TRUE(f->crest_q8 > 5 * 256, "Crest factor well above sine");
+    ASSERT_TRUE(f->skew_q8 > 2 * 256, "Positive impacts skew right");
+    ASSERT_TRUE(eng.last.axis[2].skew_q8 < -2 * 256, "Inverted axis skews left");
+
+    TEST_PASS("test_impulsive_signal");
+    return 0;
+}
+
+/**
+ * Test 6: Deviations beyond the clip limit are counted and saturated
+ */
+int test_clipping(void)
+{
+    printf("\n[TEST 6] Clipping\n");
+
+    struct vib_features_engine eng;
+    int16_t sig[16];
+
+    for (int i = 0; i < 16; i++) {
+        sig[i] = (i == 8) ? 16000 : 0;
+    }
+    vib_features_init(&eng, 16);
+    run_window(&eng, sig, 16, 0);
+
+    ASSERT_EQUAL(eng.last.clipped, 1, "One clipped sample");
+    ASSERT_EQUAL(eng.last.axis[0].p2p_mg, VIB_CLIP_MG, "Peak to peak saturates at the clip");
+
+    TEST_PASS("test_clipping");
+    return 0;
+}
+
+/**
+ * Test 7: Integer square root
+ */
+int test_isqrt(void)
+{
+    printf("\n[TEST 7] Integer square root\n");
+
+    ASSERT_EQUAL(vib_isqrt64(0), 0, "sqrt(0)");
+    ASSERT_EQUAL(vib_isqrt64(15), 3, "sqrt(15)");
+    ASSERT_EQUAL(vib_isqrt64(16), 4, "sqrt(16)");
+    ASSERT_EQUAL(vib_isqrt64(1ULL << 62), 1ULL << 31, "sqrt(2^62)");
+    ASSERT_EQUAL(vib_isqrt64(UINT64_MAX), 0xFFFFFFFFULL, "sqrt(UINT64_MAX)");
+
+    TEST_PASS("test_isqrt");
+    return 0;
+}
+
+/* ==================== Test Runner ==================== */
+
+int main(void)
+{
+    int failed = 0;
+
+    failed += test_init_validation();
+    failed += test_constant_signal();
+    failed += test_sine_wave();
+    failed += test_square_wave();
+    failed += test_impulsive_signal();
+    failed += test_clipping();
+    failed += test_isqrt();
+
+    if (failed == 0) {
+        printf("\n✓ ALL TESTS PASSED\n");
+    } else {
+        printf("\n✗ %d TEST(S) FAILED\n", failed);
+    }
+    return failed;
+}
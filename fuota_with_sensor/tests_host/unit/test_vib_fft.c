@@ -0,0 +1,221 @@
+/*
+ * Vibration FFT Host Tests
+ *
+ * Checks the q15 reference FFT against a double precision DFT and the band
+ * summary against tones of known frequency and amplitude. Built once per
+ * supported VIB_FFT_LEN.
+ */
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "test_util.h"
+#include "vib_fft.h"
+
+#define PI 3.14159265358979323846
+#define FS_HZ 100
+
+/* 1-5, 5-12, 12-25, 25-50 Hz */
+static const struct vib_fft_band bands[] = {
+    {10, 50}, {50, 120}, {120, 250}, {250, 500},
+};
+
+static int16_t samples[VIB_FFT_LEN];
+
+/* Expected level of a sine of the given amplitude, see vib_spectrum */
+static double sine_level(double amp_mg)
+{
+    return 8.0 * log2(16.0 * amp_mg * amp_mg / 2.0);
+}
+
+static void make_tone(double freq_hz, double amp_mg, double offset_mg)
+{
+    for (int n = 0; n < VIB_FFT_LEN; n++) {
+        samples[n] = (int16_t)lround(offset_mg + amp_mg * sin(2.0 * PI * freq_hz * n / FS_HZ));
+    }
+}
+
+/**
+ * Test 1: Parameter validation
+ */
+int test_init_validation(void)
+{
+    printf("\n[TEST 1] Parameter validation (N=%d)\n", VIB_FFT_LEN);
+
+    const struct vib_fft_band inverted = {200, 100};
+    struct vib_spectrum spec;
+
+    ASSERT_EQUAL(vib_fft_init(0, bands, 4), -EINVAL, "Zero sample rate rejected");
+    ASSERT_EQUAL(vib_fft_init(FS_HZ, bands, 0), -EINVAL, "No bands rejected");
+    ASSERT_EQUAL(vib_fft_init(FS_HZ, bands, VIB_FFT_MAX_BANDS + 1), -EINVAL,
+                 "Too many bands rejected");
+    ASSERT_EQUAL(vib_fft_init(FS_HZ, &inverted, 1), -EINVAL, "Empty band rejected");
+    ASSERT_EQUAL(vib_fft_init(FS_HZ, bands, 4), 0, "Valid config accepted");
+    ASSERT_EQUAL(vib_fft_process(samples, &spec), 0, "Process after init");
+
+    TEST_PASS("test_init_validation");
+    return 0;
+}
+
+/**
+ * Test 2: Reference FFT matches DFT / N
+ */
+int test_reference_vs_dft(void)
+{
+    printf("\n[TEST 2] Reference FFT vs double DFT\n");
+
+    static int16_t in[VIB_FFT_LEN];
+    static int16_t out[2 * VIB_FFT_LEN];
+    int max_err = 0;
+
+    srand(1);
+    for (int n = 0; n < VIB_FFT_LEN; n++) {
+        in[n] = (int16_t)((rand() % 65535) - 32767);
+    }
+    vib_fft_init(FS_HZ, bands, 4);
+    vib_fft_reference(in, out);
+
+    for (int k = 0; k < VIB_FFT_LEN; k++) {
+        double re = 0.0;
+        double im = 0.0;
+
+        for (int n = 0; n < VIB_FFT_LEN; n++) {
+            re += in[n] * cos(2.0 * PI * k * n / VIB_FFT_LEN);
+            im -= in[n] * sin(2.0 * PI * k * n / VIB_FFT_LEN);
+        }
+
+        int err_re = abs(out[2 * k] - (int)lround(re / VIB_FFT_LEN));
+        int err_im = abs(out[2 * k + 1] - (int)lround(im / VIB_FFT_LEN));
+
+        max_err = (err_re > max_err) ? err_re : max_err;
+        max_err = (err_im > max_err) ? err_im : max_err;
+    }
+
+    printf("   max error %d LSB\n", max_err);
+    ASSERT_RANGE(max_err, 0, 6, "Error within a few LSB");
+
+    TEST_PASS("test_reference_vs_dft");
+    return 0;
+}
+
+/**
+ * Test 3: Tone on top of gravity lands in the right band and peak bin
+ */
+int test_tone_detection(void)
+{
+    printf("\n[TEST 3] Tone detection\n");
+
+    struct vib_spectrum spec;
+    /* Exactly on a bin: k * fs / N */
+    double freq = 32.0 * FS_HZ / VIB_FFT_LEN * (VIB_FFT_LEN / 256);
+
+    vib_fft_init(FS_HZ, bands, 4);
+    make_tone(freq, 500.0, 1000.0);
+    ASSERT_EQUAL(vib_fft_process(samples, &spec), 0, "Process");
+
+    printf("   %.2f Hz: bands %u %u %u %u, peak %u cHz lvl %u, shift %u (expect %.1f)\n",
+           freq, spec.band_lvl[0], spec.band_lvl[1], spec.band_lvl[2], spec.band_lvl[3],
+           spec.peak_chz, spec.peak_lvl, spec.shift, sine_level(500.0));
+    ASSERT_EQUAL(spec.nbands, 4, "Band count");
+    ASSERT_EQUAL(spec.peak_chz, (int)lround(freq * 100.0), "Peak frequency");
+    ASSERT_RANGE(spec.band_lvl[2], sine_level(500.0) - 2, sine_level(500.0) + 1, "Band level");
+    ASSERT_TRUE(spec.band_lvl[0] + 40 < spec.band_lvl[2], "Low band quiet");
+    ASSERT_TRUE(spec.band_lvl[3] + 40 < spec.band_lvl[2], "High band quiet");
+
+    TEST_PASS("test_tone_detection");
+    return 0;
+}
+
+/**
+ * Test 4: Levels are independent of the block floating point gain
+ * Doubling the amplitude adds 2 octaves of power = 16 steps
+ */
+int test_level_scaling(void)
+{
+    printf("\n[TEST 4] Level scaling\n");
+
+    struct vib_spectrum small;
+    struct vib_spectrum big;
+
+    vib_fft_init(FS_HZ, bands, 4);
+    make_tone(7.0, 20.0, 0.0);
+    vib_fft_process(samples, &small);
+    make_tone(7.0, 40.0, 0.0);
+    vib_fft_process(samples, &big);
+
+    printf("   20 mg: lvl %u shift %u, 40 mg: lvl %u shift %u\n",
+           small.band_lvl[1], small.shift, big.band_lvl[1], big.shift);
+    ASSERT_TRUE(small.shift != big.shift, "Different input gain");
+    ASSERT_RANGE(big.band_lvl[1] - small.band_lvl[1], 15, 17, "+16 steps per doubling");
+    ASSERT_RANGE(small.band_lvl[1], sine_level(20.0) - 3, sine_level(20.0) + 1,
+                 "Absolute level");
+
+    TEST_PASS("test_level_scaling");
+    return 0;
+}
+
+/**
+ * Test 5: Constant input reports silence
+ */
+int test_constant_input(void)
+{
+    printf("\n[TEST 5] Constant input\n");
+
+    struct vib_spectrum spec;
+
+    vib_fft_init(FS_HZ, bands, 4);
+    make_tone(0.0, 0.0, -981.0);
+    vib_fft_process(samples, &spec);
+
+    for (int b = 0; b < 4; b++) {
+        ASSERT_EQUAL(spec.band_lvl[b], 0, "Band silent");
+    }
+    ASSERT_EQUAL(spec.peak_lvl, 0, "No peak");
+
+    TEST_PASS("test_constant_input");
+    return 0;
+}
+
+/**
+ * Test 6: Encoded layout
+ */
+int test_encode(void)
+{
+    printf("\n[TEST 6] Encoding\n");
+
+    const struct vib_spectrum spec = {
+        .band_lvl = {10, 20, 30}, .nbands = 3, .peak_lvl = 99, .peak_chz = 0x1234,
+    };
+    uint8_t buf[VIB_FFT_SUMMARY_SIZE(VIB_FFT_MAX_BANDS)];
+    const uint8_t expected[] = {10, 20, 30, 0x12, 0x34, 99};
+
+    ASSERT_EQUAL(vib_fft_encode(&spec, buf), VIB_FFT_SUMMARY_SIZE(3), "Encoded size");
+    ASSERT_TRUE(memcmp(buf, expected, sizeof(expected)) == 0, "Encoded bytes");
+
+    TEST_PASS("test_encode");
+    return 0;
+}
+
+/* ==================== Test Runner ==================== */
+
+int main(void)
+{
+    int failed = 0;
+
+    failed += test_init_validation();
+    failed += test_reference_vs_dft();
+    failed += test_tone_detection();
+    failed += test_level_scaling();
+    failed += test_constant_input();
+    failed += test_encode();
+
+    if (failed == 0) {
+        printf("\n✓ ALL TESTS PASSED\n");
+    } else {
+        printf("\n✗ %d TEST(S) FAILED\n", failed);
+    }
+    return failed;
+}
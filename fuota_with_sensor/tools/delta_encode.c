@@ -0,0 +1,195 @@
+/*
+ * Delta patch encoder for FUOTA (host side)
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "delta.h"
+#include "delta_encode.h"
+
+#define HASH_BITS   16
+#define CHAIN_MAX   64
+
+/* A mismatch is fixed in place if this many of the next LOOKAHEAD bytes match */
+#define LOOKAHEAD   16
+#define LOOKAHEAD_OK 11
+
+struct out_buf {
+    uint8_t *p;
+    size_t len;
+    size_t max;
+    bool full;
+};
+
+static void put_byte(struct out_buf *o, uint8_t b)
+{
+    if (o->len < o->max) {
+        o->p[o->len++] = b;
+    } else {
+        o->full = true;
+    }
+}
+
+static void put_varint(struct out_buf *o, uint32_t v)
+{
+    while (v >= 0x80) {
+        put_byte(o, (uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    put_byte(o, (uint8_t)v);
+}
+
+static void put_le32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t hash(const uint8_t *p)
+{
+    uint32_t a, b;
+
+    memcpy(&a, p, 4);
+    memcpy(&b, p + 4, 4);
+    return ((a * 2654435761u) ^ (b * 2246822519u)) >> (32 - HASH_BITS);
+}
+
+static void put_insert(struct out_buf *o, const uint8_t *data, size_t len)
+{
+    if (len == 0) {
+        return;
+    }
+    put_byte(o, DELTA_OP_INSERT);
+    put_varint(o, (uint32_t)len);
+    for (size_t i = 0; i < len; i++) {
+        put_byte(o, data[i]);
+    }
+}
+
+/**
+ * Length of the copy of old[op..] as new[np..], mismatches that are
+ * followed by a mostly matching run count as fixes
+ */
+static size_t extend(const uint8_t *old, size_t old_len, const uint8_t *new_img, size_t new_len,
+                     size_t op, size_t np)
+{
+    size_t j = 0;
+
+    while (op + j < old_len && np + j < new_len) {
+        if (old[op + j] != new_img[np + j]) {
+            int match = 0;
+
+            for (size_t k = 1; k <= LOOKAHEAD && op + j + k < old_len && np + j + k < new_len;
+                 k++) {
+                match += old[op + j + k] == new_img[np + j + k];
+            }
+            if (match < LOOKAHEAD_OK) {
+                break;
+            }
+        }
+        j++;
+    }
+    return j;
+}
+
+long delta_encode(const uint8_t *old, size_t old_len, const uint8_t *new_img, size_t new_len,
+                  uint8_t *out, size_t out_max)
+{
+    struct out_buf o = {out, DELTA_HDR_SIZE, out_max, out_max < DELTA_HDR_SIZE};
+    int32_t *head = malloc(sizeof(int32_t) << HASH_BITS);
+    int32_t *chain = malloc(sizeof(int32_t) * (old_len + 1));
+    size_t old_end = 0;   /* End of the last copy in old */
+    size_t lit = 0;       /* First new byte not yet emitted */
+    size_t i = 0;
+
+    if (head == NULL || chain == NULL) {
+        free(head);
+        free(chain);
+        return -ENOMEM;
+    }
+
+    memset(head, 0xFF, sizeof(int32_t) << HASH_BITS);
+    for (size_t p = 0; p + DELTA_MIN_MATCH <= old_len; p++) {
+        uint32_t h = hash(&old[p]);
+
+        chain[p] = head[h];
+        head[h] = (int32_t)p;
+    }
+
+    while (i + DELTA_MIN_MATCH <= new_len) {
+        size_t best_len = 0;
+        size_t best_pos = 0;
+        int walked = 0;
+
+        for (int32_t p = head[hash(&new_img[i])]; p >= 0 && walked < CHAIN_MAX;
+             p = chain[p], walked++) {
+            if (memcmp(&old[p], &new_img[i], DELTA_MIN_MATCH) != 0) {
+                continue;
+            }
+
+            size_t len = extend(old, old_len, new_img, new_len, (size_t)p, i);
+
+            /* Longest wins; the chain visits the later old positions first */
+            if (len > best_len) {
+                best_len = len;
+                best_pos = (size_t)p;
+            }
+        }
+
+        if (best_len < DELTA_MIN_MATCH) {
+            i++;
+            continue;
+        }
+
+        put_insert(&o, &new_img[lit], i - lit);
+
+        int64_t delta = (int64_t)best_pos - (int64_t)old_end;
+        uint32_t fixes = 0;
+
+        for (size_t j = 0; j < best_len; j++) {
+            fixes += old[best_pos + j] != new_img[i + j];
+        }
+
+        put_byte(&o, DELTA_OP_COPY);
+        put_varint(&o, (uint32_t)best_len);
+        put_varint(&o, (uint32_t)((delta >= 0) ? delta * 2 : -delta * 2 - 1));
+        put_varint(&o, fixes);
+
+        size_t last = 0;
+
+        for (size_t j = 0; j < best_len; j++) {
+            if (old[best_pos + j] != new_img[i + j]) {
+                put_varint(&o, (uint32_t)(j - last));
+                put_byte(&o, new_img[i + j]);
+                last = j + 1;
+            }
+        }
+
+        old_end = best_pos + best_len;
+        i += best_len;
+        lit = i;
+    }
+    put_insert(&o, &new_img[lit], new_len - lit);
+
+    free(head);
+    free(chain);
+
+    if (o.full) {
+        return -ENOSPC;
+    }
+
+    put_le32(&out[0], DELTA_MAGIC);
+    put_le32(&out[4], (uint32_t)old_len);
+    put_le32(&out[8], delta_crc32(0, old, old_len));
+    put_le32(&out[12], (uint32_t)new_len);
+    put_le32(&out[16], delta_crc32(0, new_img, new_len));
+    put_le32(&out[20], (uint32_t)o.len);
+    return (long)o.len;
+}
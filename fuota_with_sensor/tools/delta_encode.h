@@ -0,0 +1,28 @@
+/*
+ * Delta patch encoder for FUOTA (host side)
+ *
+ * Produces the patch format of src/delta.h. Matches are found through a
+ * hash chain over every old position, then extended across sparse
+ * mismatches: a changed address in a literal pool becomes a byte fix inside
+ * the copy instead of ending it.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef DELTA_ENCODE_H_
+#define DELTA_ENCODE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Shortest exact match that starts a copy */
+#define DELTA_MIN_MATCH 8
+
+/**
+ * Encode the patch turning old into new_img into out[out_max]
+ * Returns the patch size, -ENOSPC if out is too small, -ENOMEM
+ */
+long delta_encode(const uint8_t *old, size_t old_len, const uint8_t *new_img, size_t new_len,
+                  uint8_t *out, size_t out_max);
+
+#endif /* DELTA_ENCODE_H_ */
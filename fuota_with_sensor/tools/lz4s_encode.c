@@ -0,0 +1,190 @@
+/*
+ * LZ4 encoder for compressed FUOTA images (host side)
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "delta.h"
+#include "lz4s.h"
+#include "lz4s_encode.h"
+
+#define HASH_BITS 16
+#define CHAIN_MAX 256
+
+/* LZ4 end rules: the last match starts MF_LIMIT bytes before the end at the
+ * latest, the last LAST_LITERALS bytes are literals */
+#define MF_LIMIT      12
+#define LAST_LITERALS 5
+
+struct out_buf {
+    uint8_t *p;
+    size_t len;
+    size_t max;
+    bool full;
+};
+
+static void put_byte(struct out_buf *o, uint8_t b)
+{
+    if (o->len < o->max) {
+        o->p[o->len++] = b;
+    } else {
+        o->full = true;
+    }
+}
+
+/* Length beyond the 15 of its token nibble */
+static void put_len(struct out_buf *o, size_t len)
+{
+    for (len -= 15; len >= 255; len -= 255) {
+        put_byte(o, 255);
+    }
+    put_byte(o, (uint8_t)len);
+}
+
+static void put_le32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+/**
+ * One sequence: literals, then a match unless match_len is 0
+ */
+static void put_seq(struct out_buf *o, const uint8_t *lit, size_t lit_len, size_t offset,
+                    size_t match_len)
+{
+    size_t ml = match_len ? match_len - LZ4S_MIN_MATCH : 0;
+
+    put_byte(o, (uint8_t)(((lit_len < 15) ? lit_len : 15) << 4 | ((ml < 15) ? ml : 15)));
+    if (lit_len >= 15) {
+        put_len(o, lit_len);
+    }
+    for (size_t i = 0; i < lit_len; i++) {
+        put_byte(o, lit[i]);
+    }
+    if (match_len == 0) {
+        return;
+    }
+    put_byte(o, (uint8_t)offset);
+    put_byte(o, (uint8_t)(offset >> 8));
+    if (ml >= 15) {
+        put_len(o, ml);
+    }
+}
+
+static uint32_t hash(const uint8_t *p)
+{
+    uint32_t v;
+
+    memcpy(&v, p, 4);
+    return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+struct matcher {
+    const uint8_t *img;
+    size_t len;
+    int32_t *head;
+    int32_t *prev;
+    size_t inserted;   /* Positions below this are in the chains */
+};
+
+static void insert_to(struct matcher *m, size_t pos)
+{
+    for (; m->inserted < pos && m->inserted + 4 <= m->len; m->inserted++) {
+        uint32_t h = hash(&m->img[m->inserted]);
+
+        m->prev[m->inserted] = m->head[h];
+        m->head[h] = (int32_t)m->inserted;
+    }
+}
+
+/* Longest match for pos, 0 if shorter than LZ4S_MIN_MATCH */
+static size_t find(struct matcher *m, size_t pos, size_t *offset)
+{
+    size_t limit = m->len - LAST_LITERALS - pos;
+    size_t best = 0;
+    int32_t cand;
+    int chain = CHAIN_MAX;
+
+    insert_to(m, pos);
+    for (cand = m->head[hash(&m->img[pos])]; cand >= 0 && chain-- > 0;
+         cand = m->prev[cand]) {
+        size_t n = 0;
+
+        if (pos - (size_t)cand > LZ4S_WINDOW) {
+            break;
+        }
+        while (n < limit && m->img[cand + n] == m->img[pos + n]) {
+            n++;
+        }
+        if (n > best) {
+            best = n;
+            *offset = pos - (size_t)cand;
+            if (n == limit) {
+                break;
+            }
+        }
+    }
+    return (best >= LZ4S_MIN_MATCH) ? best : 0;
+}
+
+long lz4s_encode(const uint8_t *img, size_t len, uint8_t *out, size_t out_max)
+{
+    struct out_buf o = {out, LZ4S_HDR_SIZE, out_max, false};
+    struct matcher m = {img, len, NULL, NULL, 0};
+    size_t anchor = 0;
+    size_t pos = 0;
+
+    if (out_max < LZ4S_HDR_SIZE) {
+        return -ENOSPC;
+    }
+
+    m.head = malloc(sizeof(int32_t) << HASH_BITS);
+    m.prev = malloc(sizeof(int32_t) * (len + 1));
+    if (m.head == NULL || m.prev == NULL) {
+        free(m.head);
+        free(m.prev);
+        return -ENOMEM;
+    }
+    memset(m.head, 0xFF, sizeof(int32_t) << HASH_BITS);
+
+    while (len > MF_LIMIT && pos < len - MF_LIMIT) {
+        size_t offset = 0, next_offset = 0;
+        size_t match = find(&m, pos, &offset);
+
+        if (match == 0) {
+            pos++;
+            continue;
+        }
+
+        /* Lazy: a longer match one byte on is worth a literal */
+        if (pos + 1 < len - MF_LIMIT && find(&m, pos + 1, &next_offset) > match + 1) {
+            pos++;
+            continue;
+        }
+
+        put_seq(&o, &img[anchor], pos - anchor, offset, match);
+        pos += match;
+        anchor = pos;
+    }
+    put_seq(&o, &img[anchor], len - anchor, 0, 0);
+
+    free(m.head);
+    free(m.prev);
+    if (o.full) {
+        return -ENOSPC;
+    }
+
+    put_le32(&out[0], LZ4S_MAGIC);
+    put_le32(&out[4], (uint32_t)len);
+    put_le32(&out[8], delta_crc32(0, img, len));
+    put_le32(&out[12], (uint32_t)o.len);
+    return (long)o.len;
+}
@@ -0,0 +1,28 @@
+/*
+ * LZ4 encoder for compressed FUOTA images (host side)
+ *
+ * Produces the format of src/lz4s.h. Matches are found through a hash chain
+ * over the LZ4 window with one step of lazy matching, and the sequences
+ * follow the end rules of the LZ4 block format, so any LZ4 block decoder
+ * also reads them after the header.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef LZ4S_ENCODE_H_
+#define LZ4S_ENCODE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Largest output for len bytes of input */
+#define LZ4S_BOUND(len) (16 + (len) + (len) / 255 + 16)
+
+/**
+ * Compress img into out[out_max]
+ * Returns the compressed size, header included, -ENOSPC if out is too
+ * small, -ENOMEM
+ */
+long lz4s_encode(const uint8_t *img, size_t len, uint8_t *out, size_t out_max);
+
+#endif /* LZ4S_ENCODE_H_ */
@@ -0,0 +1,159 @@
+/*
+ * mkdelta: delta patch for LoRaWAN FUOTA
+ *
+ * Diffs the zephyr.signed.bin running in the field against the new one and
+ * writes the patch to send through the fragmented transport instead of the
+ * full image. The patch is decoded again before it is written, so a patch
+ * that does not rebuild the new image byte for byte is never produced.
+ *
+ * Usage: mkdelta old.signed.bin new.signed.bin patch.bin [fragment size]
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "delta.h"
+#include "delta_encode.h"
+
+/* Fragment size the FUOTA server sets up sessions with */
+#define DEFAULT_FRAG_SIZE 232
+
+struct mem_io {
+    const uint8_t *old;
+    size_t old_len;
+    uint8_t *out;
+    size_t out_len;
+    size_t out_max;
+};
+
+static int mem_read(void *ctx, uint32_t off, void *buf, size_t len)
+{
+    struct mem_io *m = ctx;
+
+    if (off + len > m->old_len) {
+        return -EINVAL;
+    }
+    memcpy(buf, &m->old[off], len);
+    return 0;
+}
+
+static int mem_write(void *ctx, const void *buf, size_t len)
+{
+    struct mem_io *m = ctx;
+
+    if (m->out_len + len > m->out_max) {
+        return -ENOSPC;
+    }
+    memcpy(&m->out[m->out_len], buf, len);
+    m->out_len += len;
+    return 0;
+}
+
+static uint8_t *load(const char *path, size_t *len)
+{
+    FILE *f = fopen(path, "rb");
+    uint8_t *buf;
+    long size;
+
+    if (f == NULL) {
+        perror(path);
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    buf = malloc(size > 0 ? size : 1);
+    if (buf == NULL || fread(buf, 1, size, f) != (size_t)size) {
+        fprintf(stderr, "%s: read failed\n", path);
+        free(buf);
+        fclose(f);
+        return NULL;
+    }
+    fclose(f);
+    *len = (size_t)size;
+    return buf;
+}
+
+/* Rebuild the new image from old and patch, in fragment-sized feeds */
+static int verify(const uint8_t *old, size_t old_len, const uint8_t *new_img, size_t new_len,
+                  const uint8_t *patch, size_t patch_len, size_t frag)
+{
+    struct mem_io m = {old, old_len, malloc(new_len), 0, new_len};
+    struct delta_io io = {&m, mem_read, mem_write};
+    struct delta_hdr hdr;
+    struct delta_dec dec;
+    int ret = delta_parse_header(patch, patch_len, &hdr);
+
+    if (ret == 0) {
+        delta_init(&dec, &hdr, &io);
+        for (size_t off = DELTA_HDR_SIZE; off < patch_len && ret == 0; off += frag) {
+            ret = delta_feed(&dec, &patch[off], (patch_len - off < frag) ? patch_len - off : frag);
+        }
+    }
+    if (ret == 0 && (!delta_done(&dec) || memcmp(m.out, new_img, new_len) != 0)) {
+        ret = -EBADMSG;
+    }
+    free(m.out);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    size_t old_len, new_len;
+    size_t frag = (argc > 4) ? strtoul(argv[4], NULL, 0) : DEFAULT_FRAG_SIZE;
+    uint8_t *old, *new_img, *patch;
+    size_t patch_max;
+    long patch_len;
+    FILE *f;
+    int ret;
+
+    if (argc < 4 || frag == 0) {
+        fprintf(stderr, "Usage: %s old.signed.bin new.signed.bin patch.bin [fragment size]\n",
+                argv[0]);
+        return 2;
+    }
+
+    old = load(argv[1], &old_len);
+    new_img = load(argv[2], &new_len);
+    if (old == NULL || new_img == NULL) {
+        return 1;
+    }
+
+    /* Ops never cost twice the bytes they produce */
+    patch_max = DELTA_HDR_SIZE + 2 * new_len + 64;
+    patch = malloc(patch_max);
+    patch_len = (patch != NULL) ?
+                delta_encode(old, old_len, new_img, new_len, patch, patch_max) : -ENOMEM;
+    if (patch_len < 0) {
+        fprintf(stderr, "Encoding failed: %ld\n", patch_len);
+        return 1;
+    }
+
+    ret = verify(old, old_len, new_img, new_len, patch, (size_t)patch_len, frag);
+    if (ret < 0) {
+        fprintf(stderr, "Patch does not rebuild the new image: %d\n", ret);
+        return 1;
+    }
+
+    f = fopen(argv[3], "wb");
+    if (f == NULL || fwrite(patch, 1, patch_len, f) != (size_t)patch_len) {
+        perror(argv[3]);
+        return 1;
+    }
+    fclose(f);
+
+    size_t frags_full = (new_len + frag - 1) / frag;
+    size_t frags_delta = ((size_t)patch_len + frag - 1) / frag;
+
+    printf("old %zu B, new %zu B, patch %ld B\n", old_len, new_len, patch_len);
+    printf("%zu fragments of %zu B instead of %zu (%.1fx fewer)\n", frags_delta, frag,
+           frags_full, (double)frags_full / frags_delta);
+
+    free(old);
+    free(new_img);
+    free(patch);
+    return 0;
+}
@@ -0,0 +1,216 @@
+/*
+ * mklz4: compressed image for LoRaWAN FUOTA
+ *
+ * Compresses a zephyr.signed.bin into the format of src/lz4s.h, to send
+ * through the fragmented transport instead of the full image. The image is
+ * decompressed again before it is written, so an image that does not
+ * rebuild byte for byte is never produced.
+ *
+ * With --bench, compresses each image given and prints the compression
+ * ratio, the fragments saved and the host decode speed; nothing is written.
+ * The lead is how far the output runs ahead of the input: decoding in place
+ * in slot1 needs the compressed size plus the lead plus one flash page to
+ * fit in the slot.
+ *
+ * Usage: mklz4 image.signed.bin image.lz4 [fragment size]
+ *        mklz4 --bench image.signed.bin...
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "lz4s.h"
+#include "lz4s_encode.h"
+
+/* Fragment size the FUOTA server sets up sessions with */
+#define DEFAULT_FRAG_SIZE 232
+
+/* Decode runs timed per image in --bench */
+#define BENCH_RUNS 20
+
+struct mem_io {
+    uint8_t *out;
+    size_t out_len;
+    size_t out_max;
+};
+
+static int mem_read(void *ctx, uint32_t off, void *buf, size_t len)
+{
+    struct mem_io *m = ctx;
+
+    if (off + len > m->out_len) {
+        return -EINVAL;
+    }
+    memcpy(buf, &m->out[off], len);
+    return 0;
+}
+
+static int mem_write(void *ctx, const void *buf, size_t len)
+{
+    struct mem_io *m = ctx;
+
+    if (m->out_len + len > m->out_max) {
+        return -ENOSPC;
+    }
+    memcpy(&m->out[m->out_len], buf, len);
+    m->out_len += len;
+    return 0;
+}
+
+static uint8_t *load(const char *path, size_t *len)
+{
+    FILE *f = fopen(path, "rb");
+    uint8_t *buf;
+    long size;
+
+    if (f == NULL) {
+        perror(path);
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    buf = malloc(size > 0 ? size : 1);
+    if (buf == NULL || fread(buf, 1, size, f) != (size_t)size) {
+        fprintf(stderr, "%s: read failed\n", path);
+        free(buf);
+        fclose(f);
+        return NULL;
+    }
+    fclose(f);
+    *len = (size_t)size;
+    return buf;
+}
+
+/**
+ * Decompress in fragment-sized feeds and compare; lead is set to how far
+ * the output got ahead of the input, the room decoding in place needs
+ */
+static int verify(const uint8_t *img, size_t len, const uint8_t *comp, size_t comp_len,
+                  size_t frag, size_t *lead)
+{
+    struct mem_io m = {malloc(len), 0, len};
+    struct lz4s_io io = {&m, mem_read, mem_write};
+    struct lz4s_hdr hdr;
+    struct lz4s_dec dec;
+    int ret = lz4s_parse_header(comp, comp_len, &hdr);
+
+    *lead = 0;
+    if (ret == 0) {
+        lz4s_init(&dec, &hdr, &io);
+        for (size_t off = LZ4S_HDR_SIZE; off < comp_len && ret == 0; off += frag) {
+            ret = lz4s_feed(&dec, &comp[off], (comp_len - off < frag) ? comp_len - off : frag);
+            if (m.out_len > off && m.out_len - off > *lead) {
+                *lead = m.out_len - off;
+            }
+        }
+    }
+    if (ret == 0 && (!lz4s_done(&dec) || memcmp(m.out, img, len) != 0)) {
+        ret = -EBADMSG;
+    }
+    free(m.out);
+    return ret;
+}
+
+/* Host decode speed in MB/s */
+static double decode_speed(const uint8_t *comp, size_t comp_len, size_t len)
+{
+    struct mem_io m = {malloc(len), 0, len};
+    struct lz4s_io io = {&m, mem_read, mem_write};
+    struct lz4s_hdr hdr;
+    struct lz4s_dec dec;
+    clock_t start = clock();
+
+    lz4s_parse_header(comp, comp_len, &hdr);
+    for (int i = 0; i < BENCH_RUNS; i++) {
+        m.out_len = 0;
+        lz4s_init(&dec, &hdr, &io);
+        lz4s_feed(&dec, &comp[LZ4S_HDR_SIZE], comp_len - LZ4S_HDR_SIZE);
+    }
+    free(m.out);
+
+    double s = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    return (s > 0) ? (double)len * BENCH_RUNS / s / 1e6 : 0;
+}
+
+/**
+ * Compress path; writes the image to out_path unless it is NULL
+ * Returns 0 on success
+ */
+static int compress_file(const char *path, const char *out_path, size_t frag)
+{
+    size_t len, lead;
+    uint8_t *img = load(path, &len);
+    uint8_t *comp;
+    long comp_len;
+    FILE *f;
+    int ret;
+
+    if (img == NULL) {
+        return 1;
+    }
+
+    comp = malloc(LZ4S_BOUND(len));
+    comp_len = (comp != NULL) ? lz4s_encode(img, len, comp, LZ4S_BOUND(len)) : -ENOMEM;
+    if (comp_len < 0) {
+        fprintf(stderr, "%s: compression failed: %ld\n", path, comp_len);
+        return 1;
+    }
+
+    ret = verify(img, len, comp, (size_t)comp_len, frag, &lead);
+    if (ret < 0) {
+        fprintf(stderr, "%s: image does not decompress: %d\n", path, ret);
+        return 1;
+    }
+
+    size_t frags_full = (len + frag - 1) / frag;
+    size_t frags_comp = ((size_t)comp_len + frag - 1) / frag;
+
+    if (out_path == NULL) {
+        printf("%-40s %7zu %7ld %6.1f%% %5zu %5zu %7zu %7.1f\n", path, len, comp_len,
+               100.0 * comp_len / len, frags_full, frags_comp, lead,
+               decode_speed(comp, comp_len, len));
+    } else {
+        f = fopen(out_path, "wb");
+        if (f == NULL || fwrite(comp, 1, comp_len, f) != (size_t)comp_len) {
+            perror(out_path);
+            return 1;
+        }
+        fclose(f);
+        printf("image %zu B, compressed %ld B (%.1f%%), in-place lead %zu B\n", len, comp_len,
+               100.0 * comp_len / len, lead);
+        printf("%zu fragments of %zu B instead of %zu\n", frags_comp, frag, frags_full);
+    }
+
+    free(img);
+    free(comp);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int ret = 0;
+
+    if (argc >= 3 && strcmp(argv[1], "--bench") == 0) {
+        printf("%-40s %7s %7s %7s %5s %5s %7s %7s\n", "image", "bytes", "lz4", "ratio",
+               "frags", "lz4", "lead", "MB/s");
+        for (int i = 2; i < argc; i++) {
+            ret |= compress_file(argv[i], NULL, DEFAULT_FRAG_SIZE);
+        }
+        return ret;
+    }
+
+    size_t frag = (argc > 3) ? strtoul(argv[3], NULL, 0) : DEFAULT_FRAG_SIZE;
+
+    if (argc < 3 || frag == 0) {
+        fprintf(stderr, "Usage: %s image.signed.bin image.lz4 [fragment size]\n"
+                "       %s --bench image.signed.bin...\n", argv[0], argv[0]);
+        return 2;
+    }
+    return compress_file(argv[1], argv[2], frag);
+}